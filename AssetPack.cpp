@@ -0,0 +1,384 @@
+#pragma once
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+#include "Hash.h"
+
+#include <zlib/zlib.h>
+
+static_assert(sizeof(AssetPack::Header) == 16 && sizeof(AssetPack::Entry) == 40 && sizeof(AssetPack::ChunkIndex) == 8, "The asset pack layout is part of the file format");
+
+namespace
+{
+	// Across the job system if it's running, on this thread otherwise
+	void RunRange(u32 count, const JobSystem::RangeFunc &fnRange)
+	{
+		JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+		if (jobSystem.IsValid() && count > 1)
+		{
+			jobSystem.ParallelFor(count, 1, fnRange);
+		}
+		else
+		{
+			fnRange(0, count);
+		}
+	}
+
+	bool Inflate(const u8 *pStored, u64 storedSize, u8 *pOut, u64 size)
+	{
+		uLongf inflatedSize = static_cast<uLongf>(size);
+		int result = uncompress(pOut, &inflatedSize, pStored, static_cast<uLong>(storedSize));
+		return result == Z_OK && inflatedSize == size;
+	}
+
+	void Deflate(const u8 *pData, size_t size, int compressionLevel, Vec<u8> &out)
+	{
+		ASSERT(size <= UINT32_MAX, "Too big for zlib to deflate in one piece");
+
+		uLongf deflatedSize = compressBound(static_cast<uLong>(size));
+		out.resize(deflatedSize);
+		int result = compress2(out.data(), &deflatedSize, pData, static_cast<uLong>(size), compressionLevel);
+		ASSERT(result == Z_OK, "Deflating failed: " + to_string(result));
+		out.resize(deflatedSize);
+	}
+
+	// Chunk index, offsets, then every chunk deflated on its own
+	void DeflateChunked(const u8 *pData, size_t size, u32 chunkSize, int compressionLevel, Vec<u8> &out)
+	{
+		u32 chunkCount = static_cast<u32>((size + chunkSize - 1) / chunkSize);
+		Vec<Vec<u8>> chunks(chunkCount);
+
+		// Nested in the per file jobs, a big file still spreads over every core
+		RunRange(chunkCount, [&](u32 begin, u32 end)
+		{
+			for (u32 c = begin; c < end; c++)
+			{
+				size_t offset = static_cast<size_t>(c) * chunkSize;
+				Deflate(pData + offset, min<size_t>(chunkSize, size - offset), compressionLevel, chunks[c]);
+			}
+		});
+
+		AssetPack::ChunkIndex index = { chunkCount, chunkSize };
+		Vec<u64> offsets(chunkCount + 1);
+		offsets[0] = sizeof(index) + offsets.size() * sizeof(u64);
+		for (u32 c = 0; c < chunkCount; c++)
+		{
+			offsets[c + 1] = offsets[c] + chunks[c].size();
+		}
+
+		out.resize(static_cast<size_t>(offsets.back()));
+		memcpy(out.data(), &index, sizeof(index));
+		memcpy(out.data() + sizeof(index), offsets.data(), offsets.size() * sizeof(u64));
+		for (u32 c = 0; c < chunkCount; c++)
+		{
+			memcpy(out.data() + offsets[c], chunks[c].data(), chunks[c].size());
+		}
+	}
+}
+
+AssetPack::AssetPack(const string &path) :
+	pFile(make_shared<MappedFile>(path)),
+	pEntries(nullptr),
+	iEntryCount(0)
+{
+	const u8 *pData = pFile->GetData();
+	size_t size = pFile->GetSize();
+
+	ASSERT(size >= sizeof(Header), "Asset pack is too small: " + path);
+
+	const Header *pHeader = reinterpret_cast<const Header *>(pData);
+	ASSERT(pHeader->magic == MAGIC && pHeader->version == VERSION, "Not an asset pack or the wrong version: " + path);
+	ASSERT(pHeader->alignment != 0 && (pHeader->alignment & (pHeader->alignment - 1)) == 0, "Asset pack alignment isn't a power of two: " + path);
+	ASSERT(pHeader->alignment >= MIN_ALIGNMENT, "Asset pack alignment is below " + to_string(MIN_ALIGNMENT) + " bytes: " + path);
+	ASSERT(sizeof(Header) + static_cast<u64>(pHeader->entryCount) * sizeof(Entry) <= size, "Asset pack is cut short: " + path);
+
+	pEntries = reinterpret_cast<const Entry *>(pData + sizeof(Header));
+	iEntryCount = pHeader->entryCount;
+
+	// Check every entry up front, so reading from the pack later can't go out of bounds
+	for (u32 i = 0; i < iEntryCount; i++)
+	{
+		const Entry &entry = pEntries[i];
+		ASSERT(i == 0 || pEntries[i - 1].nameHash < entry.nameHash, "Asset pack entries aren't sorted: " + path);
+		ASSERT(entry.offset <= size && entry.storedSize <= size - entry.offset, "Asset pack entry out of bounds: " + path);
+		ASSERT(entry.offset % pHeader->alignment == 0, "Asset pack entry is misaligned: " + path);
+		ASSERT(entry.compression == Compression::Deflate || entry.compression == Compression::ChunkedDeflate ||
+			(entry.compression == Compression::None && entry.storedSize == entry.size), "Asset pack entry has a bad compression: " + path);
+	}
+}
+
+u64 AssetPack::HashName(const string &name)
+{
+	string normalized = name;
+	replace(normalized.begin(), normalized.end(), '\\', '/');
+	return Hash64(normalized);
+}
+
+const AssetPack::Entry *AssetPack::Find(const string &name) const
+{
+	return Find(HashName(name));
+}
+
+const AssetPack::Entry *AssetPack::Find(u64 nameHash) const
+{
+	const Entry *pEnd = pEntries + iEntryCount;
+	const Entry *pEntry = lower_bound(pEntries, pEnd, nameHash, [](const Entry &entry, u64 hash) { return entry.nameHash < hash; });
+	return pEntry != pEnd && pEntry->nameHash == nameHash ? pEntry : nullptr;
+}
+
+bool AssetPack::Contains(const string &name) const
+{
+	return Find(name) != nullptr;
+}
+
+span<const u8> AssetPack::GetView(const Entry &entry) const
+{
+	ASSERT(entry.compression == Compression::None, "Deflated asset pack entries can't be viewed in place");
+	return span<const u8>(pFile->GetData() + entry.offset, static_cast<size_t>(entry.size));
+}
+
+bool AssetPack::Read(const Entry &entry, u8 *pOut) const
+{
+	const u8 *pStored = pFile->GetData() + entry.offset;
+
+	switch (entry.compression)
+	{
+	case Compression::None:
+		memcpy(pOut, pStored, static_cast<size_t>(entry.size));
+		return true;
+	case Compression::Deflate:
+		return Inflate(pStored, entry.storedSize, pOut, entry.size);
+	default:
+		return ReadChunks(entry, 0, entry.size, pOut);
+	}
+}
+
+bool AssetPack::ReadRange(const Entry &entry, u64 offset, u64 size, u8 *pOut) const
+{
+	ASSERT(offset <= entry.size && size <= entry.size - offset, "Read past the end of an asset pack entry");
+
+	const u8 *pStored = pFile->GetData() + entry.offset;
+
+	switch (entry.compression)
+	{
+	case Compression::None:
+		memcpy(pOut, pStored + offset, static_cast<size_t>(size));
+		return true;
+	case Compression::Deflate:
+	{
+		Vec<u8> inflated(static_cast<size_t>(entry.size));
+		if (!Inflate(pStored, entry.storedSize, inflated.data(), entry.size))
+		{
+			return false;
+		}
+		memcpy(pOut, inflated.data() + offset, static_cast<size_t>(size));
+		return true;
+	}
+	default:
+		return ReadChunks(entry, offset, size, pOut);
+	}
+}
+
+AssetData AssetPack::Open(const string &name) const
+{
+	const Entry *pEntry = Find(name);
+	ASSERT(pEntry, "Asset pack " + pFile->GetPath() + " has no " + name);
+
+	if (pEntry->compression == Compression::None)
+	{
+		return { pFile, GetView(*pEntry) };
+	}
+
+	Ref<Vec<u8>> pInflated = make_shared<Vec<u8>>(static_cast<size_t>(pEntry->size));
+	ASSERT(Read(*pEntry, pInflated->data()), "Failed to inflate " + name + " from asset pack " + pFile->GetPath());
+	return { pInflated, span<const u8>(pInflated->data(), pInflated->size()) };
+}
+
+u32 AssetPack::GetEntryCount() const
+{
+	return iEntryCount;
+}
+
+const Ref<MappedFile> &AssetPack::GetFile() const
+{
+	return pFile;
+}
+
+void AssetPack::Write(const string &path, const Vec<Source> &sources, u32 alignment, int compressionLevel, u32 chunkSize)
+{
+	ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0, "Asset pack alignment has to be a power of two");
+	ASSERT(alignment >= MIN_ALIGNMENT, "Asset pack alignment has to be at least " + to_string(MIN_ALIGNMENT) + " bytes");
+	ASSERT(chunkSize > 0, "Asset pack chunks can't be empty");
+
+	Vec<Vec<u8>> stored(sources.size());
+	Vec<Entry> entries(sources.size());
+
+	auto fnPack = [&](u32 begin, u32 end)
+	{
+		for (u32 i = begin; i < end; i++)
+		{
+			MappedFile file(sources[i].path);
+			const u8 *pData = file.GetData();
+			size_t size = file.GetSize();
+
+			entries[i] = {};
+			entries[i].nameHash = HashName(sources[i].name);
+			entries[i].size = size;
+			entries[i].compression = Compression::None;
+
+			if (sources[i].bCompress && size > 0)
+			{
+				bool bChunked = size > chunkSize;
+				if (bChunked)
+				{
+					DeflateChunked(pData, size, chunkSize, compressionLevel, stored[i]);
+				}
+				else
+				{
+					Deflate(pData, size, compressionLevel, stored[i]);
+				}
+
+				if (stored[i].size() <= size - size / 8)
+				{
+					entries[i].compression = bChunked ? Compression::ChunkedDeflate : Compression::Deflate;
+				}
+			}
+
+			if (entries[i].compression == Compression::None)
+			{
+				stored[i].assign(pData, pData + size);
+			}
+			entries[i].storedSize = stored[i].size();
+		}
+	};
+
+	RunRange(static_cast<u32>(sources.size()), fnPack);
+
+	// Sorted for the binary search, data stays in the order it was given
+	Vec<u32> order(sources.size());
+	for (u32 i = 0; i < order.size(); i++)
+	{
+		order[i] = i;
+	}
+	sort(order.begin(), order.end(), [&](u32 a, u32 b) { return entries[a].nameHash < entries[b].nameHash; });
+
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		ASSERT(entries[order[i - 1]].nameHash != entries[order[i]].nameHash, "Asset pack names " + sources[order[i - 1]].name + " and " + sources[order[i]].name + " hash the same");
+	}
+
+	u64 offset = sizeof(Header) + entries.size() * sizeof(Entry);
+	for (Entry &entry : entries)
+	{
+		offset = (offset + alignment - 1) & ~static_cast<u64>(alignment - 1);
+		entry.offset = offset;
+		offset += entry.storedSize;
+	}
+
+	Vec<Entry> table(entries.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		table[i] = entries[order[i]];
+	}
+
+	ofstream file(path, ios::binary | ios::trunc);
+	ASSERT(file.is_open(), "Failed to create asset pack: " + path);
+
+	Header header = { MAGIC, VERSION, static_cast<u32>(table.size()), alignment };
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(Entry));
+
+	Vec<char> padding(alignment, 0);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		u64 position = static_cast<u64>(file.tellp());
+		file.write(padding.data(), static_cast<streamsize>(entries[i].offset - position));
+		file.write(reinterpret_cast<const char *>(stored[i].data()), static_cast<streamsize>(stored[i].size()));
+	}
+
+	ASSERT(file.good(), "Failed to write asset pack: " + path);
+}
+
+bool AssetPack::ReadChunkIndex(const Entry &entry, ChunkIndex &index, Vec<u64> &offsets) const
+{
+	const u8 *pStored = pFile->GetData() + entry.offset;
+	if (entry.storedSize < sizeof(ChunkIndex))
+	{
+		return false;
+	}
+	memcpy(&index, pStored, sizeof(index));
+
+	if (index.chunkSize == 0 || index.chunkCount != (entry.size + index.chunkSize - 1) / index.chunkSize ||
+		sizeof(ChunkIndex) + (static_cast<u64>(index.chunkCount) + 1) * sizeof(u64) > entry.storedSize)
+	{
+		return false;
+	}
+
+	offsets.resize(static_cast<size_t>(index.chunkCount) + 1);
+	memcpy(offsets.data(), pStored + sizeof(ChunkIndex), offsets.size() * sizeof(u64));
+
+	for (u32 c = 0; c < index.chunkCount; c++)
+	{
+		if (offsets[c] > offsets[c + 1])
+		{
+			return false;
+		}
+	}
+	return offsets.back() == entry.storedSize;
+}
+
+bool AssetPack::ReadChunks(const Entry &entry, u64 offset, u64 size, u8 *pOut) const
+{
+	ChunkIndex index;
+	Vec<u64> offsets;
+	if (!ReadChunkIndex(entry, index, offsets))
+	{
+		return false;
+	}
+
+	if (size == 0)
+	{
+		return true;
+	}
+
+	const u8 *pStored = pFile->GetData() + entry.offset;
+	u32 first = static_cast<u32>(offset / index.chunkSize);
+	u32 last = static_cast<u32>((offset + size - 1) / index.chunkSize);
+	atomic<bool> bFailed = false;
+
+	RunRange(last - first + 1, [&](u32 begin, u32 end)
+	{
+		Vec<u8> partial;
+		for (u32 c = first + begin; c < first + end; c++)
+		{
+			u64 chunkStart = static_cast<u64>(c) * index.chunkSize;
+			u64 chunkBytes = min<u64>(index.chunkSize, entry.size - chunkStart);
+			const u8 *pChunk = pStored + offsets[c];
+			u64 chunkStored = offsets[c + 1] - offsets[c];
+
+			// Whole chunks inflate right where they go, the ones the range cuts go through a copy
+			if (chunkStart >= offset && chunkStart + chunkBytes <= offset + size)
+			{
+				if (!Inflate(pChunk, chunkStored, pOut + (chunkStart - offset), chunkBytes))
+				{
+					bFailed = true;
+				}
+				continue;
+			}
+
+			partial.resize(static_cast<size_t>(chunkBytes));
+			if (!Inflate(pChunk, chunkStored, partial.data(), chunkBytes))
+			{
+				bFailed = true;
+				continue;
+			}
+
+			u64 from = max(offset, chunkStart);
+			u64 to = min(offset + size, chunkStart + chunkBytes);
+			memcpy(pOut + (from - offset), partial.data() + (from - chunkStart), static_cast<size_t>(to - from));
+		}
+	});
+
+	return !bFailed;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+class MappedFile;
+
+// Bytes of an asset and whatever keeps them alive: the pack's mapping for a view in place,
+// the inflated copy for a deflated entry
+struct AssetData
+{
+	Ref<const void> owner;
+	span<const u8> data;
+};
+
+// Many assets in one memory mapped file, so loading them costs no file opens and the OS page cache
+// brings in what is touched. The table of contents is sorted by the Hash64 of each name, a lookup is
+// a binary search and names themselves aren't kept. Every entry starts aligned, so entries stored as
+// they are can be used in place, as SPIR-V, vertex data or a cooked texture, without a copy. Entries
+// deflated with zlib have to be inflated first. Big ones are split into chunks deflated on their own,
+// found through an index at the start of the entry, so workers inflate them side by side and a range
+// can be read without inflating what comes before it.
+// File layout: header, entryCount entries sorted by nameHash, then the data of every entry.
+class AssetPack : public NonCopyable
+{
+public:
+
+	// "CPAK"
+	static constexpr u32 MAGIC = 0x4B415043;
+	static constexpr u32 VERSION = 2;
+	static constexpr u32 DEFAULT_ALIGNMENT = 16;
+
+	// SPIR-V is used in place, which needs 4 byte alignment
+	static constexpr u32 MIN_ALIGNMENT = 4;
+
+	// Big enough for deflate to find its matches, small enough that a big entry makes work for every core
+	static constexpr u32 DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+	enum class Compression : u32
+	{
+		None,
+		Deflate,
+		ChunkedDeflate
+	};
+
+	struct Header
+	{
+		u32 magic;
+		u32 version;
+		u32 entryCount;
+		u32 alignment;
+	};
+
+	struct Entry
+	{
+		u64 nameHash;
+
+		// From the start of the file
+		u64 offset;
+		u64 storedSize;
+
+		// Once inflated
+		u64 size;
+		Compression compression;
+		u32 reserved;
+	};
+
+	// Starts the stored data of a ChunkedDeflate entry, followed by chunkCount + 1 u64 offsets of the
+	// deflated chunks from the start of the stored data, the last one being storedSize. Every chunk
+	// inflates to chunkSize bytes but the last, which gets what is left.
+	struct ChunkIndex
+	{
+		u32 chunkCount;
+		u32 chunkSize;
+	};
+
+	// A file for Write() to pack under name
+	struct Source
+	{
+		string name;
+		string path;
+		bool bCompress = false;
+	};
+
+private:
+
+	Ref<MappedFile> pFile;
+	const Entry *pEntries;
+	u32 iEntryCount;
+
+public:
+
+	// Maps the file and checks every entry, throws if it isn't a pack or anything reaches past its end
+	AssetPack(const string &path);
+
+public:
+
+	// Names are hashed with backslashes taken as forward slashes, otherwise as they are
+	static u64 HashName(const string &name);
+
+	// Null if the pack has no such entry
+	const Entry *Find(const string &name) const;
+	const Entry *Find(u64 nameHash) const;
+	bool Contains(const string &name) const;
+
+	// Valid as long as the pack or GetFile() lives. The entry has to be stored without compression.
+	span<const u8> GetView(const Entry &entry) const;
+
+	// Writes entry.size bytes to pOut, inflating if needed, the chunks of a chunked entry spread over the
+	// job system if it's running. False if it doesn't inflate to exactly that.
+	bool Read(const Entry &entry, u8 *pOut) const;
+
+	// Writes size bytes from offset into the entry to pOut. Only the chunks overlapping the range are
+	// inflated, an entry deflated in one piece is inflated whole. Throws if the range is past the end.
+	bool ReadRange(const Entry &entry, u64 offset, u64 size, u8 *pOut) const;
+
+	// A view in place when the entry is stored as is, an inflated copy otherwise.
+	// Throws if the pack has no such entry or it fails to inflate.
+	AssetData Open(const string &name) const;
+
+	u32 GetEntryCount() const;
+	const Ref<MappedFile> &GetFile() const;
+
+	// Sources asking for compression are deflated at zlib's compressionLevel on the job system if it's
+	// running, and stay deflated only if that saves at least an eighth, since stored entries are read in place.
+	// Those bigger than chunkSize are deflated in chunks of that size. Throws if two names hash the same,
+	// or if alignment isn't a power of two of at least MIN_ALIGNMENT.
+	static void Write(const string &path, const Vec<Source> &sources, u32 alignment = DEFAULT_ALIGNMENT, int compressionLevel = 6, u32 chunkSize = DEFAULT_CHUNK_SIZE);
+
+private:
+
+	// Offsets of the chunks of a ChunkedDeflate entry, false if the index doesn't fit the entry
+	bool ReadChunkIndex(const Entry &entry, ChunkIndex &index, Vec<u64> &offsets) const;
+
+	// Inflate the chunks overlapping [offset, offset + size) and copy the range to pOut
+	bool ReadChunks(const Entry &entry, u64 offset, u64 size, u8 *pOut) const;
+};
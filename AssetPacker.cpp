@@ -0,0 +1,142 @@
+#pragma once
+
+#include "AssetPack.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+
+// Builds an AssetPack out of files and directories, built as its own target. Entries are named by their
+// path as given on the command line, with forward slashes, which is what the runtime looks them up by.
+namespace
+{
+	void PrintUsage()
+	{
+		cout << "Usage: AssetPacker [options] <output> <file or directory>..." << endl;
+		cout << "Packs the files, and everything under the directories given, into one asset pack" << endl;
+		cout << "  --compress         deflate entries that get at least an eighth smaller from it" << endl;
+		cout << "  --level N          zlib compression level from 0 to 9, 6 by default" << endl;
+		cout << "  --chunk-size KB    entries bigger than this are deflated in chunks that inflate in parallel, " << AssetPack::DEFAULT_CHUNK_SIZE / 1024 << " by default" << endl;
+		cout << "  --align N          alignment of every entry, a power of two of at least " << AssetPack::MIN_ALIGNMENT << ", " << AssetPack::DEFAULT_ALIGNMENT << " by default" << endl;
+		cout << "  --job-workers N    job system workers next to the main thread, 0 picks one per core" << endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	bool bCompress = false;
+	int iLevel = 6;
+	u32 iAlignment = AssetPack::DEFAULT_ALIGNMENT;
+	u32 iChunkSize = AssetPack::DEFAULT_CHUNK_SIZE;
+	u32 iJobWorkers = 0;
+	string sOutput;
+	Vec<filesystem::path> inputs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--compress")
+		{
+			bCompress = true;
+		}
+		else if (arg == "--level" && i + 1 < argc)
+		{
+			iLevel = clamp(stoi(argv[++i]), 0, 9);
+		}
+		else if (arg == "--chunk-size" && i + 1 < argc)
+		{
+			iChunkSize = static_cast<u32>(stoul(argv[++i])) * 1024;
+		}
+		else if (arg == "--align" && i + 1 < argc)
+		{
+			iAlignment = static_cast<u32>(stoul(argv[++i]));
+		}
+		else if (arg == "--job-workers" && i + 1 < argc)
+		{
+			iJobWorkers = static_cast<u32>(stoul(argv[++i]));
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			PrintUsage();
+			return 0;
+		}
+		else if (sOutput.empty())
+		{
+			sOutput = arg;
+		}
+		else
+		{
+			inputs.push_back(arg);
+		}
+	}
+
+	if (sOutput.empty() || inputs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	Vec<AssetPack::Source> sources;
+	auto fnAdd = [&](const filesystem::path &path)
+	{
+		// Packing a directory the pack is written into would pick up the last one
+		if (filesystem::exists(sOutput) && filesystem::equivalent(path, sOutput))
+		{
+			return;
+		}
+		sources.push_back({ path.generic_string(), path.string(), bCompress });
+	};
+
+	for (const filesystem::path &input : inputs)
+	{
+		if (filesystem::is_directory(input))
+		{
+			for (const auto &entry : filesystem::recursive_directory_iterator(input))
+			{
+				if (entry.is_regular_file())
+				{
+					fnAdd(entry.path());
+				}
+			}
+		}
+		else
+		{
+			fnAdd(input);
+		}
+	}
+
+	// Files are read and deflated across every core
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	jobSystem.SetWorkerCount(iJobWorkers);
+	jobSystem.Create();
+
+	int result = 0;
+	try
+	{
+		auto tStart = chrono::steady_clock::now();
+		AssetPack::Write(sOutput, sources, iAlignment, iLevel, iChunkSize);
+
+		// Read back, which checks the pack the same way the runtime does
+		AssetPack pack(sOutput);
+		u64 iInputBytes = 0;
+		u32 iDeflated = 0;
+		u32 iChunked = 0;
+		for (const AssetPack::Source &source : sources)
+		{
+			const AssetPack::Entry *pEntry = pack.Find(source.name);
+			iInputBytes += pEntry->size;
+			iDeflated += pEntry->compression == AssetPack::Compression::Deflate ? 1 : 0;
+			iChunked += pEntry->compression == AssetPack::Compression::ChunkedDeflate ? 1 : 0;
+		}
+
+		auto tEnd = chrono::steady_clock::now();
+		cout << "Packed " << pack.GetEntryCount() << " files, " << iInputBytes / 1024 << " KB into " << pack.GetFile()->GetSize() / 1024
+			<< " KB (" << iDeflated << " deflated, " << iChunked << " in chunks) in " << chrono::duration<f64, milli>(tEnd - tStart).count() << " ms: " << sOutput << endl;
+	}
+	catch (const exception &e)
+	{
+		cout << "ERROR: " << e.what() << endl;
+		result = 1;
+	}
+
+	jobSystem.Destroy();
+	return result;
+}
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "BindlessHeap.h"
+#include "Device.h"
+#include "PhysicalDevice.h"
+#include "DeferredDestroyQueue.h"
+
+BindlessHeap::BindlessHeap(Device &device) :
+	pDevice(device),
+	pSetLayout(VK_NULL_HANDLE),
+	pUniformSetLayout(VK_NULL_HANDLE),
+	pPipelineLayout(VK_NULL_HANDLE),
+	pPool(VK_NULL_HANDLE),
+	pSet(VK_NULL_HANDLE),
+	sSampledImages({ 0, 0, {} }),
+	sSamplers({ 0, 0, {} }),
+	sStorageBuffers({ 0, 0, {} })
+{
+}
+
+BindlessHeap::~BindlessHeap()
+{
+	Destroy();
+}
+
+void BindlessHeap::Create()
+{
+	// Per stage limits are the tighter ones, every binding is visible to all stages
+	VkPhysicalDeviceVulkan12Properties limits = pDevice.GetPhysicalDevice().GetVulkan12Properties();
+	sSampledImages.iCapacity = min({ MAX_SAMPLED_IMAGES, limits.maxPerStageDescriptorUpdateAfterBindSampledImages, limits.maxDescriptorSetUpdateAfterBindSampledImages });
+	sSamplers.iCapacity = min({ MAX_SAMPLERS, limits.maxPerStageDescriptorUpdateAfterBindSamplers, limits.maxDescriptorSetUpdateAfterBindSamplers });
+	sStorageBuffers.iCapacity = min({ MAX_STORAGE_BUFFERS, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+	VkDescriptorSetLayoutBinding bindings[3] = {};
+	bindings[0] = { SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, sSampledImages.iCapacity, VK_SHADER_STAGE_ALL, nullptr };
+	bindings[1] = { SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, sSamplers.iCapacity, VK_SHADER_STAGE_ALL, nullptr };
+	bindings[2] = { STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, sStorageBuffers.iCapacity, VK_SHADER_STAGE_ALL, nullptr };
+
+	// Slots can be written while the set is bound, and nobody has to fill the ones shaders don't read
+	VkDescriptorBindingFlags bindingFlags[3] = {};
+	for (VkDescriptorBindingFlags &flags : bindingFlags)
+	{
+		flags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = 3;
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+	setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	setLayoutCreateInfo.bindingCount = 3;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(pDevice.GetVkNative(), &setLayoutCreateInfo, nullptr, &pSetLayout));
+
+	// Written once, only the dynamic offset changes from draw to draw
+	VkDescriptorSetLayoutBinding uniformBinding = { UNIFORM_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL, nullptr };
+
+	VkDescriptorSetLayoutCreateInfo uniformLayoutCreateInfo = {};
+	uniformLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	uniformLayoutCreateInfo.bindingCount = 1;
+	uniformLayoutCreateInfo.pBindings = &uniformBinding;
+
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(pDevice.GetVkNative(), &uniformLayoutCreateInfo, nullptr, &pUniformSetLayout));
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = MAX_PUSH_CONSTANT_SIZE;
+
+	VkDescriptorSetLayout setLayouts[2] = { pSetLayout, pUniformSetLayout };
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = 2;
+	layoutCreateInfo.pSetLayouts = setLayouts;
+	layoutCreateInfo.pushConstantRangeCount = 1;
+	layoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	VK_CHECK_RESULT(vkCreatePipelineLayout(pDevice.GetVkNative(), &layoutCreateInfo, nullptr, &pPipelineLayout));
+
+	VkDescriptorPoolSize poolSizes[3] = {};
+	poolSizes[0] = { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, sSampledImages.iCapacity };
+	poolSizes[1] = { VK_DESCRIPTOR_TYPE_SAMPLER, sSamplers.iCapacity };
+	poolSizes[2] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, sStorageBuffers.iCapacity };
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 3;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	VK_CHECK_RESULT(vkCreateDescriptorPool(pDevice.GetVkNative(), &poolCreateInfo, nullptr, &pPool));
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = pPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &pSetLayout;
+
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(pDevice.GetVkNative(), &allocateInfo, &pSet));
+}
+
+void BindlessHeap::Destroy()
+{
+	// The set goes with the pool
+	if (pPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(pDevice.GetVkNative(), pPool, nullptr);
+		pPool = VK_NULL_HANDLE;
+		pSet = VK_NULL_HANDLE;
+	}
+
+	if (pPipelineLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyPipelineLayout(pDevice.GetVkNative(), pPipelineLayout, nullptr);
+		pPipelineLayout = VK_NULL_HANDLE;
+	}
+
+	if (pUniformSetLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(pDevice.GetVkNative(), pUniformSetLayout, nullptr);
+		pUniformSetLayout = VK_NULL_HANDLE;
+	}
+
+	if (pSetLayout != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorSetLayout(pDevice.GetVkNative(), pSetLayout, nullptr);
+		pSetLayout = VK_NULL_HANDLE;
+	}
+}
+
+bool BindlessHeap::IsValid() const
+{
+	return pSet != VK_NULL_HANDLE;
+}
+
+u32 BindlessHeap::AddSampledImage(VkImageView view, VkImageLayout layout)
+{
+	u32 index = Allocate(sSampledImages, "sampled images");
+	UpdateSampledImage(index, view, layout);
+	return index;
+}
+
+u32 BindlessHeap::AddSampler(VkSampler sampler)
+{
+	u32 index = Allocate(sSamplers, "samplers");
+
+	VkDescriptorImageInfo imageInfo = { sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED };
+	Write(SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, &imageInfo, nullptr);
+	return index;
+}
+
+u32 BindlessHeap::AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	u32 index = Allocate(sStorageBuffers, "storage buffers");
+	UpdateStorageBuffer(index, buffer, offset, range);
+	return index;
+}
+
+void BindlessHeap::UpdateSampledImage(u32 index, VkImageView view, VkImageLayout layout)
+{
+	VkDescriptorImageInfo imageInfo = { VK_NULL_HANDLE, view, layout };
+	Write(SAMPLED_IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &imageInfo, nullptr);
+}
+
+void BindlessHeap::UpdateStorageBuffer(u32 index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo bufferInfo = { buffer, offset, range };
+	Write(STORAGE_BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo);
+}
+
+void BindlessHeap::FreeSampledImage(u32 index)
+{
+	Free(sSampledImages, index);
+}
+
+void BindlessHeap::FreeSampler(u32 index)
+{
+	Free(sSamplers, index);
+}
+
+void BindlessHeap::FreeStorageBuffer(u32 index)
+{
+	Free(sStorageBuffers, index);
+}
+
+void BindlessHeap::Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pPipelineLayout, 0, 1, &pSet, 0, nullptr);
+}
+
+VkDescriptorSetLayout BindlessHeap::GetSetLayout() const
+{
+	return pSetLayout;
+}
+
+VkDescriptorSetLayout BindlessHeap::GetUniformSetLayout() const
+{
+	return pUniformSetLayout;
+}
+
+VkPipelineLayout BindlessHeap::GetPipelineLayout() const
+{
+	return pPipelineLayout;
+}
+
+VkDescriptorSet BindlessHeap::GetVkNative() const
+{
+	return pSet;
+}
+
+u32 BindlessHeap::GetSampledImageCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return sSampledImages.iHighWater - static_cast<u32>(sSampledImages.pArrFree.size());
+}
+
+u32 BindlessHeap::GetSamplerCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return sSamplers.iHighWater - static_cast<u32>(sSamplers.pArrFree.size());
+}
+
+u32 BindlessHeap::GetStorageBufferCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return sStorageBuffers.iHighWater - static_cast<u32>(sStorageBuffers.pArrFree.size());
+}
+
+u32 BindlessHeap::Allocate(Slots &slots, const char *name)
+{
+	lock_guard<mutex> lock(mLock);
+
+	// Reuse freed slots first, keeps the used part of the array small
+	if (!slots.pArrFree.empty())
+	{
+		u32 index = slots.pArrFree.back();
+		slots.pArrFree.pop_back();
+		return index;
+	}
+
+	ASSERT(slots.iHighWater < slots.iCapacity, string("Bindless heap is out of ") + name);
+	return slots.iHighWater++;
+}
+
+void BindlessHeap::Free(Slots &slots, u32 index)
+{
+	if (index == INVALID_INDEX)
+	{
+		return;
+	}
+
+	// Frames in flight may still index it, so it can't be handed out until they are done
+	pDevice.GetDeferredDestroyQueue().Defer([this, &slots, index]()
+	{
+		lock_guard<mutex> lock(mLock);
+		slots.pArrFree.push_back(index);
+	});
+}
+
+void BindlessHeap::Write(u32 binding, u32 index, VkDescriptorType type, const VkDescriptorImageInfo *pImageInfo, const VkDescriptorBufferInfo *pBufferInfo)
+{
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = pSet;
+	write.dstBinding = binding;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = type;
+	write.pImageInfo = pImageInfo;
+	write.pBufferInfo = pBufferInfo;
+
+	lock_guard<mutex> lock(mLock);
+	vkUpdateDescriptorSets(pDevice.GetVkNative(), 1, &write, 0, nullptr);
+}
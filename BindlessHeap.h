@@ -0,0 +1,111 @@
+#pragma once
+
+class Device;
+
+// One global descriptor set with big update after bind arrays of sampled images, samplers and
+// storage buffers. Resources are registered once and get a stable index, shaders index the
+// arrays with it (passed through push constants or buffers), so the set is bound once per
+// command buffer instead of allocating and binding sets per draw.
+// Freed indices are only handed out again once the GPU is past every frame that could read them.
+//
+// Set 0 of GetPipelineLayout(), which pipelines use when their desc doesn't bring a layout:
+//   binding 0: texture2D  textures[]
+//   binding 1: sampler    samplers[]
+//   binding 2: buffer     buffers[] (storage)
+// Set 1 is a single dynamic uniform buffer, the UniformRing binds it with a new offset per draw.
+// Plus MAX_PUSH_CONSTANT_SIZE bytes of push constants for all stages.
+class BindlessHeap : public IVkResource, public NonCopyable
+{
+public:
+
+	static constexpr u32 SAMPLED_IMAGE_BINDING = 0;
+	static constexpr u32 SAMPLER_BINDING = 1;
+	static constexpr u32 STORAGE_BUFFER_BINDING = 2;
+
+	// Set and binding of the dynamic uniform buffer
+	static constexpr u32 UNIFORM_SET = 1;
+	static constexpr u32 UNIFORM_BINDING = 0;
+
+	// Wanted array sizes, clamped to what the device allows
+	static constexpr u32 MAX_SAMPLED_IMAGES = 16384;
+	static constexpr u32 MAX_SAMPLERS = 256;
+	static constexpr u32 MAX_STORAGE_BUFFERS = 16384;
+
+	// The minimum every device supports
+	static constexpr u32 MAX_PUSH_CONSTANT_SIZE = 128;
+
+	static constexpr u32 INVALID_INDEX = UINT32_MAX;
+
+private:
+
+	// Free list over one binding's array, indices below iHighWater were handed out at some point
+	struct Slots
+	{
+		u32 iCapacity;
+		u32 iHighWater;
+		Vec<u32> pArrFree;
+	};
+
+	Device &pDevice;
+
+	VkDescriptorSetLayout pSetLayout;
+	VkDescriptorSetLayout pUniformSetLayout;
+	VkPipelineLayout pPipelineLayout;
+	VkDescriptorPool pPool;
+	VkDescriptorSet pSet;
+
+	Slots sSampledImages;
+	Slots sSamplers;
+	Slots sStorageBuffers;
+
+	// Guards the free lists and vkUpdateDescriptorSets, the set has to be externally synchronized
+	mutex mLock;
+
+public:
+
+	BindlessHeap(Device &device);
+	~BindlessHeap();
+
+public:
+
+	void Create() override;
+
+	// The GPU must not be using the set anymore
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Register a resource and get the index shaders see it at
+	u32 AddSampledImage(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	u32 AddSampler(VkSampler sampler);
+	u32 AddStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+	// Point an existing index at something else, e.g. a texture whose streamed in mips replaced the placeholder.
+	// Frames in flight may see either, the slot is update unused while pending.
+	void UpdateSampledImage(u32 index, VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void UpdateStorageBuffer(u32 index, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+
+	// The index goes back to the free list once the frames that may still read it are done
+	void FreeSampledImage(u32 index);
+	void FreeSampler(u32 index);
+	void FreeStorageBuffer(u32 index);
+
+	// Bind the set as set 0, once per command buffer and bind point is enough
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+	VkDescriptorSetLayout GetSetLayout() const;
+	VkDescriptorSetLayout GetUniformSetLayout() const;
+	VkPipelineLayout GetPipelineLayout() const;
+	VkDescriptorSet GetVkNative() const;
+
+	u32 GetSampledImageCount();
+	u32 GetSamplerCount();
+	u32 GetStorageBufferCount();
+
+private:
+
+	u32 Allocate(Slots &slots, const char *name);
+	void Free(Slots &slots, u32 index);
+	void Write(u32 binding, u32 index, VkDescriptorType type, const VkDescriptorImageInfo *pImageInfo, const VkDescriptorBufferInfo *pBufferInfo);
+};
@@ -0,0 +1,613 @@
+#pragma once
+
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	constexpr u32 BLOCK_DIM = 4;
+	constexpr u32 BLOCK_PIXELS = BLOCK_DIM * BLOCK_DIM;
+
+	// Interpolation weights of BC7's 4 bit indices, out of 64
+	constexpr i32 BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Weight of the second endpoint for each BC1 index, in palette order
+	constexpr f32 BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	using BlockFunc = void (*)(const u8 *, u8 *);
+
+	// Writes fields into a zeroed block from the lowest bit up
+	struct BitWriter
+	{
+		u8 *pOut;
+		u32 bit;
+
+		void Write(u32 value, u32 bits)
+		{
+			for (u32 i = 0; i < bits; i++, bit++)
+			{
+				if ((value >> i) & 1)
+				{
+					pOut[bit / 8] |= static_cast<u8>(1u << (bit % 8));
+				}
+			}
+		}
+	};
+
+	void ToFloat(const u8 *pPixels, f32 pixels[BLOCK_PIXELS][4])
+	{
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			for (u32 c = 0; c < 4; c++)
+			{
+				pixels[i][c] = pPixels[i * 4 + c];
+			}
+		}
+	}
+
+	f32 Clamp255(f32 value)
+	{
+		return clamp(value, 0.0f, 255.0f);
+	}
+
+	// Endpoints at either end of the pixels projected on their principal axis, found by power iteration
+	// on the covariance of the first `channels` channels
+	void FitPrincipalAxis(const f32 pixels[BLOCK_PIXELS][4], u32 channels, f32 e0[4], f32 e1[4])
+	{
+		f32 mean[4] = {};
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			for (u32 c = 0; c < channels; c++)
+			{
+				mean[c] += pixels[i][c] / BLOCK_PIXELS;
+			}
+		}
+
+		f32 covariance[4][4] = {};
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			for (u32 a = 0; a < channels; a++)
+			{
+				for (u32 b = 0; b < channels; b++)
+				{
+					covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+				}
+			}
+		}
+
+		// Starting from the column of the widest channel can't be orthogonal to the axis
+		u32 widest = 0;
+		for (u32 c = 1; c < channels; c++)
+		{
+			if (covariance[c][c] > covariance[widest][widest])
+			{
+				widest = c;
+			}
+		}
+
+		f32 axis[4] = {};
+		for (u32 c = 0; c < channels; c++)
+		{
+			axis[c] = covariance[c][widest];
+		}
+
+		for (u32 iteration = 0; iteration < 8; iteration++)
+		{
+			f32 next[4] = {};
+			f32 largest = 0.0f;
+			for (u32 a = 0; a < channels; a++)
+			{
+				for (u32 b = 0; b < channels; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				largest = max(largest, fabs(next[a]));
+			}
+
+			if (largest < 1e-6f)
+			{
+				break;
+			}
+			for (u32 c = 0; c < channels; c++)
+			{
+				axis[c] = next[c] / largest;
+			}
+		}
+
+		f32 lengthSquared = 0.0f;
+		for (u32 c = 0; c < channels; c++)
+		{
+			lengthSquared += axis[c] * axis[c];
+		}
+
+		// A flat block, both endpoints are its color
+		if (lengthSquared < 1e-6f)
+		{
+			for (u32 c = 0; c < channels; c++)
+			{
+				e0[c] = e1[c] = mean[c];
+			}
+			return;
+		}
+
+		f32 tMin = FLT_MAX;
+		f32 tMax = -FLT_MAX;
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			f32 t = 0.0f;
+			for (u32 c = 0; c < channels; c++)
+			{
+				t += (pixels[i][c] - mean[c]) * axis[c];
+			}
+			tMin = min(tMin, t / lengthSquared);
+			tMax = max(tMax, t / lengthSquared);
+		}
+
+		for (u32 c = 0; c < channels; c++)
+		{
+			e0[c] = Clamp255(mean[c] + axis[c] * tMin);
+			e1[c] = Clamp255(mean[c] + axis[c] * tMax);
+		}
+	}
+
+	// Least squares endpoints for pixels reconstructed as (1 - weight) * e0 + weight * e1.
+	// False if the weights don't tell the endpoints apart, all pixels on the same index.
+	bool SolveEndpoints(const f32 pixels[BLOCK_PIXELS][4], const f32 weights[BLOCK_PIXELS], u32 channels, f32 e0[4], f32 e1[4])
+	{
+		f32 aa = 0.0f;
+		f32 ab = 0.0f;
+		f32 bb = 0.0f;
+		f32 ap[4] = {};
+		f32 bp[4] = {};
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			f32 a = 1.0f - weights[i];
+			f32 b = weights[i];
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (u32 c = 0; c < channels; c++)
+			{
+				ap[c] += a * pixels[i][c];
+				bp[c] += b * pixels[i][c];
+			}
+		}
+
+		f32 determinant = aa * bb - ab * ab;
+		if (fabs(determinant) < 1e-4f)
+		{
+			return false;
+		}
+
+		for (u32 c = 0; c < channels; c++)
+		{
+			e0[c] = Clamp255((ap[c] * bb - bp[c] * ab) / determinant);
+			e1[c] = Clamp255((bp[c] * aa - ap[c] * ab) / determinant);
+		}
+		return true;
+	}
+
+	u16 PackRgb565(const f32 color[4])
+	{
+		u32 r = static_cast<u32>(color[0] * 31.0f / 255.0f + 0.5f);
+		u32 g = static_cast<u32>(color[1] * 63.0f / 255.0f + 0.5f);
+		u32 b = static_cast<u32>(color[2] * 31.0f / 255.0f + 0.5f);
+		return static_cast<u16>((r << 11) | (g << 5) | b);
+	}
+
+	void UnpackRgb565(u16 packed, i32 color[3])
+	{
+		i32 r = (packed >> 11) & 31;
+		i32 g = (packed >> 5) & 63;
+		i32 b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// BC1 color block in four color mode, which needs c0 > c1. Equal endpoints only ever use index 0,
+	// so it decodes the same in the three color mode that makes. Returns the squared error.
+	u32 WriteColorBlock(const u8 *pPixels, u16 c0, u16 c1, u8 *pOut, u8 indices[BLOCK_PIXELS])
+	{
+		if (c0 < c1)
+		{
+			swap(c0, c1);
+		}
+
+		i32 palette[4][3];
+		UnpackRgb565(c0, palette[0]);
+		UnpackRgb565(c1, palette[1]);
+		for (u32 c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		u32 bits = 0;
+		u32 error = 0;
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			u32 best = 0;
+			u32 bestError = UINT32_MAX;
+			for (u32 k = 0; k < 4; k++)
+			{
+				u32 distance = 0;
+				for (u32 c = 0; c < 3; c++)
+				{
+					i32 delta = pPixels[i * 4 + c] - palette[k][c];
+					distance += static_cast<u32>(delta * delta);
+				}
+				if (distance < bestError)
+				{
+					best = k;
+					bestError = distance;
+				}
+			}
+
+			indices[i] = static_cast<u8>(best);
+			bits |= best << (i * 2);
+			error += bestError;
+		}
+
+		pOut[0] = static_cast<u8>(c0);
+		pOut[1] = static_cast<u8>(c0 >> 8);
+		pOut[2] = static_cast<u8>(c1);
+		pOut[3] = static_cast<u8>(c1 >> 8);
+		for (u32 i = 0; i < 4; i++)
+		{
+			pOut[4 + i] = static_cast<u8>(bits >> (i * 8));
+		}
+		return error;
+	}
+
+	// One channel, a pair of 8 bit endpoints and 3 bit indices, as both halves of BC5 and the alpha of BC3.
+	// Always the eight value mode, the endpoints are the channel's extremes.
+	void CompressChannelBC4(const u8 *pPixels, u32 channel, u8 *pOut)
+	{
+		u8 low = 255;
+		u8 high = 0;
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			low = min(low, pPixels[i * 4 + channel]);
+			high = max(high, pPixels[i * 4 + channel]);
+		}
+
+		memset(pOut, 0, 8);
+		pOut[0] = high;
+		pOut[1] = low;
+		if (high == low)
+		{
+			return;
+		}
+
+		i32 palette[8] = { high, low };
+		for (i32 k = 2; k < 8; k++)
+		{
+			palette[k] = ((8 - k) * high + (k - 1) * low + 3) / 7;
+		}
+
+		u64 bits = 0;
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			i32 value = pPixels[i * 4 + channel];
+			u64 best = 0;
+			i32 bestError = INT32_MAX;
+			for (u32 k = 0; k < 8; k++)
+			{
+				i32 distance = abs(value - palette[k]);
+				if (distance < bestError)
+				{
+					best = k;
+					bestError = distance;
+				}
+			}
+			bits |= best << (i * 3);
+		}
+
+		for (u32 i = 0; i < 6; i++)
+		{
+			pOut[2 + i] = static_cast<u8>(bits >> (i * 8));
+		}
+	}
+
+	// 7 bits per channel, shifted up past the p-bit the channels of the endpoint share
+	void QuantizeBC7Endpoint(const f32 color[4], u8 pBit, u8 quantized[4])
+	{
+		for (u32 c = 0; c < 4; c++)
+		{
+			i32 q = static_cast<i32>((color[c] - pBit) / 2.0f + 0.5f);
+			quantized[c] = static_cast<u8>(clamp(q, 0, 127));
+		}
+	}
+
+	// Closest of the 16 interpolated colors for every pixel. Returns the squared error.
+	u32 FindBC7Indices(const u8 *pPixels, const u8 quantized[2][4], const u8 pBits[2], u8 indices[BLOCK_PIXELS])
+	{
+		i32 palette[16][4];
+		for (u32 k = 0; k < 16; k++)
+		{
+			for (u32 c = 0; c < 4; c++)
+			{
+				i32 e0 = (quantized[0][c] << 1) | pBits[0];
+				i32 e1 = (quantized[1][c] << 1) | pBits[1];
+				palette[k][c] = ((64 - BC7_WEIGHTS[k]) * e0 + BC7_WEIGHTS[k] * e1 + 32) >> 6;
+			}
+		}
+
+		u32 error = 0;
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			u32 best = 0;
+			u32 bestError = UINT32_MAX;
+			for (u32 k = 0; k < 16; k++)
+			{
+				u32 distance = 0;
+				for (u32 c = 0; c < 4; c++)
+				{
+					i32 delta = pPixels[i * 4 + c] - palette[k][c];
+					distance += static_cast<u32>(delta * delta);
+				}
+				if (distance < bestError)
+				{
+					best = k;
+					bestError = distance;
+				}
+			}
+			indices[i] = static_cast<u8>(best);
+			error += bestError;
+		}
+		return error;
+	}
+
+	// Mode 6 block from unquantized endpoints, with whichever p-bits decode closest to the pixels.
+	// Returns the squared error.
+	u32 WriteBC7Mode6(const u8 *pPixels, const f32 e0[4], const f32 e1[4], u8 *pOut, u8 indices[BLOCK_PIXELS])
+	{
+		// Opaque blocks have to stay exactly opaque, which only alpha 127 with p-bit 1 decodes to
+		bool bOpaque = true;
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			bOpaque = bOpaque && pPixels[i * 4 + 3] == 255;
+		}
+
+		u8 quantized[2][4];
+		u8 pBits[2];
+		u32 error = UINT32_MAX;
+		for (u8 p = bOpaque ? 3 : 0; p < 4; p++)
+		{
+			u8 candidate[2][4];
+			u8 candidatePBits[2] = { static_cast<u8>(p & 1), static_cast<u8>(p >> 1) };
+			QuantizeBC7Endpoint(e0, candidatePBits[0], candidate[0]);
+			QuantizeBC7Endpoint(e1, candidatePBits[1], candidate[1]);
+			if (bOpaque)
+			{
+				candidate[0][3] = candidate[1][3] = 127;
+			}
+
+			u8 candidateIndices[BLOCK_PIXELS];
+			u32 candidateError = FindBC7Indices(pPixels, candidate, candidatePBits, candidateIndices);
+			if (candidateError < error)
+			{
+				error = candidateError;
+				memcpy(quantized, candidate, sizeof(quantized));
+				memcpy(pBits, candidatePBits, sizeof(pBits));
+				memcpy(indices, candidateIndices, sizeof(candidateIndices));
+			}
+		}
+
+		// The first index is stored without its top bit, which has to be zero. The weights are symmetric,
+		// so swapping the endpoints and flipping every index decodes to the same colors.
+		if (indices[0] & 8)
+		{
+			swap(quantized[0], quantized[1]);
+			swap(pBits[0], pBits[1]);
+			for (u32 i = 0; i < BLOCK_PIXELS; i++)
+			{
+				indices[i] = static_cast<u8>(15 - indices[i]);
+			}
+		}
+
+		memset(pOut, 0, 16);
+		BitWriter writer = { pOut, 0 };
+		writer.Write(1u << 6, 7);
+		for (u32 c = 0; c < 4; c++)
+		{
+			writer.Write(quantized[0][c], 7);
+			writer.Write(quantized[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		for (u32 i = 0; i < BLOCK_PIXELS; i++)
+		{
+			writer.Write(indices[i], i == 0 ? 3 : 4);
+		}
+		return error;
+	}
+
+	BlockFunc GetBlockFunction(BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			return CompressBlockBC1;
+		case BlockFormat::BC3:
+			return CompressBlockBC3;
+		case BlockFormat::BC5:
+			return CompressBlockBC5;
+		default:
+			return CompressBlockBC7;
+		}
+	}
+}
+
+optional<BlockFormat> ParseBlockFormat(const string &name)
+{
+	string lower = name;
+	transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+
+	for (BlockFormat format : { BlockFormat::BC1, BlockFormat::BC3, BlockFormat::BC5, BlockFormat::BC7 })
+	{
+		if (lower == GetBlockFormatName(format))
+		{
+			return format;
+		}
+	}
+	return nullopt;
+}
+
+const char *GetBlockFormatName(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		return "bc1";
+	case BlockFormat::BC3:
+		return "bc3";
+	case BlockFormat::BC5:
+		return "bc5";
+	default:
+		return "bc7";
+	}
+}
+
+VkFormat GetBlockVkFormat(BlockFormat format, bool bSrgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		return bSrgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case BlockFormat::BC3:
+		return bSrgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+	case BlockFormat::BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	default:
+		return bSrgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+}
+
+u32 GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+void CompressImage(BlockFormat format, const u8 *pRgba, VkExtent2D extent, u8 *pOut)
+{
+	u32 blocksX = (extent.width + BLOCK_DIM - 1) / BLOCK_DIM;
+	u32 blocksY = (extent.height + BLOCK_DIM - 1) / BLOCK_DIM;
+	u32 blockBytes = GetBlockBytes(format);
+	BlockFunc fnBlock = GetBlockFunction(format);
+
+	auto fnRows = [&](u32 begin, u32 end)
+	{
+		u8 pixels[BLOCK_PIXELS * 4];
+		for (u32 by = begin; by < end; by++)
+		{
+			for (u32 bx = 0; bx < blocksX; bx++)
+			{
+				for (u32 y = 0; y < BLOCK_DIM; y++)
+				{
+					u32 sy = min(by * BLOCK_DIM + y, extent.height - 1);
+					for (u32 x = 0; x < BLOCK_DIM; x++)
+					{
+						u32 sx = min(bx * BLOCK_DIM + x, extent.width - 1);
+						memcpy(pixels + (y * BLOCK_DIM + x) * 4, pRgba + (static_cast<size_t>(sy) * extent.width + sx) * 4, 4);
+					}
+				}
+				fnBlock(pixels, pOut + (static_cast<size_t>(by) * blocksX + bx) * blockBytes);
+			}
+		}
+	};
+
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	if (jobSystem.IsValid())
+	{
+		jobSystem.ParallelFor(blocksY, 1, fnRows);
+	}
+	else
+	{
+		fnRows(0, blocksY);
+	}
+}
+
+void CompressBlockBC1(const u8 *pPixels, u8 *pOut)
+{
+	f32 pixels[BLOCK_PIXELS][4];
+	ToFloat(pPixels, pixels);
+
+	f32 e0[4] = {};
+	f32 e1[4] = {};
+	FitPrincipalAxis(pixels, 3, e0, e1);
+
+	u8 indices[BLOCK_PIXELS];
+	u32 error = WriteColorBlock(pPixels, PackRgb565(e0), PackRgb565(e1), pOut, indices);
+	if (error == 0)
+	{
+		return;
+	}
+
+	// Refit to the indices the first try gave, in the order the block stored the endpoints
+	f32 weights[BLOCK_PIXELS];
+	for (u32 i = 0; i < BLOCK_PIXELS; i++)
+	{
+		weights[i] = BC1_WEIGHTS[indices[i]];
+	}
+	if (!SolveEndpoints(pixels, weights, 3, e0, e1))
+	{
+		return;
+	}
+
+	u8 refined[8];
+	if (WriteColorBlock(pPixels, PackRgb565(e0), PackRgb565(e1), refined, indices) < error)
+	{
+		memcpy(pOut, refined, sizeof(refined));
+	}
+}
+
+void CompressBlockBC3(const u8 *pPixels, u8 *pOut)
+{
+	CompressChannelBC4(pPixels, 3, pOut);
+	CompressBlockBC1(pPixels, pOut + 8);
+}
+
+void CompressBlockBC5(const u8 *pPixels, u8 *pOut)
+{
+	CompressChannelBC4(pPixels, 0, pOut);
+	CompressChannelBC4(pPixels, 1, pOut + 8);
+}
+
+void CompressBlockBC7(const u8 *pPixels, u8 *pOut)
+{
+	f32 pixels[BLOCK_PIXELS][4];
+	ToFloat(pPixels, pixels);
+
+	f32 e0[4] = {};
+	f32 e1[4] = {};
+	FitPrincipalAxis(pixels, 4, e0, e1);
+
+	u8 indices[BLOCK_PIXELS];
+	u32 error = WriteBC7Mode6(pPixels, e0, e1, pOut, indices);
+	if (error == 0)
+	{
+		return;
+	}
+
+	// Indices may have been flipped along with the endpoints, the refit only cares that they agree
+	f32 weights[BLOCK_PIXELS];
+	for (u32 i = 0; i < BLOCK_PIXELS; i++)
+	{
+		weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+	}
+	if (!SolveEndpoints(pixels, weights, 4, e0, e1))
+	{
+		return;
+	}
+
+	u8 refined[16];
+	if (WriteBC7Mode6(pPixels, e0, e1, refined, indices) < error)
+	{
+		memcpy(pOut, refined, sizeof(refined));
+	}
+}
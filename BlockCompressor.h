@@ -0,0 +1,34 @@
+#pragma once
+
+// Block compression of RGBA8 images for the TextureCooker. Every format works on 4x4 blocks:
+//	BC1 - opaque RGB, 8 bytes a block
+//	BC3 - RGB plus a separately interpolated alpha, 16 bytes a block
+//	BC5 - red and green only, each interpolated on its own, for normal maps, 16 bytes a block
+//	BC7 - RGBA in mode 6, one pair of 7 bit endpoints with 4 bit indices, 16 bytes a block
+// Endpoints are fit along the principal axis of each block's colors, then refined once by least squares
+// against the indices they gave. Nowhere near what a full BC7 search gets, but fast and free of artifacts.
+enum class BlockFormat
+{
+	BC1,
+	BC3,
+	BC5,
+	BC7
+};
+
+// Case insensitive "bc1", "bc3", "bc5" or "bc7"
+optional<BlockFormat> ParseBlockFormat(const string &name);
+const char *GetBlockFormatName(BlockFormat format);
+
+// BC5 has no sRGB variant, it always comes out UNORM
+VkFormat GetBlockVkFormat(BlockFormat format, bool bSrgb);
+u32 GetBlockBytes(BlockFormat format);
+
+// Compress a tightly packed RGBA8 image into pOut, one block per started 4x4 of pixels. Rows of blocks are spread
+// over the job system if it's running. Blocks past the edge of the image repeat its last row and column.
+void CompressImage(BlockFormat format, const u8 *pRgba, VkExtent2D extent, u8 *pOut);
+
+// pPixels is one 4x4 block of RGBA8, row by row
+void CompressBlockBC1(const u8 *pPixels, u8 *pOut);
+void CompressBlockBC3(const u8 *pPixels, u8 *pOut);
+void CompressBlockBC5(const u8 *pPixels, u8 *pOut);
+void CompressBlockBC7(const u8 *pPixels, u8 *pOut);
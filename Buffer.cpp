@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Buffer.h"
+#include "Device.h"
+#include "DeferredDestroyQueue.h"
+
+Buffer::Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage) :
+	pVkBuffer(VK_NULL_HANDLE),
+	sAllocation(),
+	pDevice(device),
+	iSize(size),
+	eUsage(usage),
+	eMemoryUsage(memoryUsage)
+{
+}
+
+Buffer::~Buffer()
+{
+	if (pVkBuffer != VK_NULL_HANDLE)
+	{
+		Destroy();
+	}
+}
+
+void Buffer::Create()
+{
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = iSize;
+	bufferCreateInfo.usage = eUsage;
+	// Written by the transfer queue and read by the graphics queue, without ownership transfers
+	Vec<u32> queueFamilies = pDevice.GetResourceQueueFamilies();
+	bufferCreateInfo.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	bufferCreateInfo.queueFamilyIndexCount = queueFamilies.size() > 1 ? static_cast<u32>(queueFamilies.size()) : 0;
+	bufferCreateInfo.pQueueFamilyIndices = queueFamilies.size() > 1 ? queueFamilies.data() : nullptr;
+
+	VK_CHECK_RESULT(vkCreateBuffer(pDevice.GetVkNative(), &bufferCreateInfo, nullptr, &pVkBuffer));
+
+	sAllocation = pDevice.GetAllocator().AllocateForBuffer(pVkBuffer, eMemoryUsage);
+}
+
+void Buffer::Destroy()
+{
+	if (pVkBuffer != VK_NULL_HANDLE)
+	{
+		// The memory goes back together with the buffer once the GPU is done with it
+		pDevice.GetDeferredDestroyQueue().DestroyBuffer(pVkBuffer, sAllocation);
+		pVkBuffer = VK_NULL_HANDLE;
+	}
+
+	pDevice.GetAllocator().Free(sAllocation);
+}
+
+bool Buffer::IsValid() const
+{
+	return pVkBuffer != VK_NULL_HANDLE;
+}
+
+VkBuffer Buffer::GetVkNative() const
+{
+	return pVkBuffer;
+}
+
+VkDeviceSize Buffer::GetSize() const
+{
+	return iSize;
+}
+
+const MemoryAllocation &Buffer::GetAllocation() const
+{
+	return sAllocation;
+}
+
+void *Buffer::GetMapped() const
+{
+	return sAllocation.pMapped;
+}
+
+void Buffer::Write(const void *pData, VkDeviceSize size, VkDeviceSize offset)
+{
+	ASSERT(sAllocation.pMapped != nullptr, "Buffer is not host visible");
+	ASSERT(offset + size <= iSize, "Buffer write out of range");
+
+	memcpy(static_cast<u8 *>(sAllocation.pMapped) + offset, pData, static_cast<size_t>(size));
+	pDevice.GetAllocator().Flush(sAllocation, offset, size);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+class Device;
+
+class Buffer : public IVkResource, public NonCopyable
+{
+private:
+	VkBuffer pVkBuffer;
+	MemoryAllocation sAllocation;
+
+	Device &pDevice;
+	VkDeviceSize iSize;
+	VkBufferUsageFlags eUsage;
+	MemoryUsage eMemoryUsage;
+
+public:
+
+	Buffer(Device &device, VkDeviceSize size, VkBufferUsageFlags usage, MemoryUsage memoryUsage);
+	~Buffer();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+	VkBuffer GetVkNative() const;
+
+public:
+
+	VkDeviceSize GetSize() const;
+	const MemoryAllocation &GetAllocation() const;
+
+	// Persistently mapped pointer, null for GPU only buffers
+	void *GetMapped() const;
+
+	// Copy into a host visible buffer and flush if needed
+	void Write(const void *pData, VkDeviceSize size, VkDeviceSize offset = 0);
+};
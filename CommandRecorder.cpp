@@ -0,0 +1,104 @@
+#pragma once
+
+#include "CommandRecorder.h"
+#include "FrameContext.h"
+#include "ThreadCommandPool.h"
+#include "JobSystem.h"
+#include "Device.h"
+
+CommandRecorder::CommandRecorder(Device &device) :
+	pDevice(device),
+	bCreated(false)
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void CommandRecorder::Create()
+{
+	ASSERT(Singleton<JobSystem>::GetInstance().IsValid(), "CommandRecorder needs the job system to be created first");
+	bCreated = true;
+}
+
+void CommandRecorder::Destroy()
+{
+	bCreated = false;
+}
+
+bool CommandRecorder::IsValid() const
+{
+	return bCreated;
+}
+
+Vec<VkCommandBuffer> CommandRecorder::RecordSecondaries(FrameContext &frame, u32 itemCount, const RecordFunc &fnRecord, const VkCommandBufferInheritanceInfo *pInheritance)
+{
+	if (itemCount == 0)
+	{
+		return {};
+	}
+
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	ASSERT(frame.GetThreadPoolCount() >= jobSystem.GetThreadCount(), "Frame has fewer thread command pools than the job system has threads");
+
+	// One slice per thread, unless there isn't enough work to go around
+	u32 maxSlices = max(1u, itemCount / MIN_ITEMS_PER_SLICE);
+	u32 sliceCount = min(jobSystem.GetThreadCount(), maxSlices);
+	u32 sliceSize = (itemCount + sliceCount - 1) / sliceCount;
+
+	// Secondaries always need inheritance info, even outside a render pass where it's all empty
+	VkCommandBufferInheritanceInfo emptyInheritance = {};
+	emptyInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &emptyInheritance;
+	if (pInheritance != nullptr)
+	{
+		beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = pInheritance;
+	}
+
+	// In slice order, so the stitched result is the same as recording on one thread
+	Vec<VkCommandBuffer> secondaries(sliceCount, VK_NULL_HANDLE);
+
+	Ref<JobCounter> counter = make_shared<JobCounter>();
+	for (u32 slice = 0; slice < sliceCount; slice++)
+	{
+		jobSystem.Submit([&, slice]()
+		{
+			u32 begin = slice * sliceSize;
+			u32 end = min(begin + sliceSize, itemCount);
+
+			// Whichever thread picks the slice up records with its own pool
+			VkCommandBuffer commandBuffer = frame.GetThreadPool(JobSystem::GetThreadIndex()).AcquireSecondary();
+			VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+			fnRecord(commandBuffer, begin, end);
+			VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+			secondaries[slice] = commandBuffer;
+		}, counter);
+	}
+
+	jobSystem.Wait(counter);
+	return secondaries;
+}
+
+void CommandRecorder::Record(VkCommandBuffer primary, FrameContext &frame, u32 itemCount, const RecordFunc &fnRecord, const VkCommandBufferInheritanceInfo *pInheritance)
+{
+	Vec<VkCommandBuffer> secondaries = RecordSecondaries(frame, itemCount, fnRecord, pInheritance);
+	if (!secondaries.empty())
+	{
+		vkCmdExecuteCommands(primary, static_cast<u32>(secondaries.size()), secondaries.data());
+	}
+}
+
+u32 CommandRecorder::GetThreadCount() const
+{
+	return Singleton<JobSystem>::GetInstance().GetThreadCount();
+}
\ No newline at end of file
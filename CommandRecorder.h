@@ -0,0 +1,49 @@
+#pragma once
+
+class Device;
+class FrameContext;
+
+// Spreads command recording over the job system.
+// A range of items (draws, objects, whatever the caller splits on) is cut into slices, each slice
+// is recorded as a job into a secondary command buffer from the ThreadCommandPool the frame keeps
+// for the job thread it runs on, and the calling thread stitches them into its primary with
+// vkCmdExecuteCommands. The calling thread records slices too while it waits.
+class CommandRecorder : public IVkResource, public NonCopyable
+{
+public:
+
+	// Record items [begin, end) into a command buffer that is already recording
+	using RecordFunc = Func<void(VkCommandBuffer commandBuffer, u32 begin, u32 end)>;
+
+	// Below this a slice costs more to hand out than to record
+	static constexpr u32 MIN_ITEMS_PER_SLICE = 256;
+
+private:
+
+	Device &pDevice;
+	bool bCreated;
+
+public:
+
+	CommandRecorder(Device &device);
+	~CommandRecorder();
+
+public:
+
+	// The job system has to be created first
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Record itemCount items into secondaries from the frame's thread pools, in item order.
+	// Pass pInheritance when they get executed inside a render pass, it needs the render pass continue bit.
+	Vec<VkCommandBuffer> RecordSecondaries(FrameContext &frame, u32 itemCount, const RecordFunc &fnRecord, const VkCommandBufferInheritanceInfo *pInheritance = nullptr);
+
+	// Same, then execute them into primary
+	void Record(VkCommandBuffer primary, FrameContext &frame, u32 itemCount, const RecordFunc &fnRecord, const VkCommandBufferInheritanceInfo *pInheritance = nullptr);
+
+	// Threads recording at once, the renderer needs a command pool per thread for each frame
+	u32 GetThreadCount() const;
+};
\ No newline at end of file
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "CookedTexture.h"
+#include "JobSystem.h"
+
+#include <zlib/zlib.h>
+
+static_assert(sizeof(CookedTexture::Header) == 32 && sizeof(CookedTexture::Mip) == 32, "The cooked texture layout is part of the file format");
+
+namespace
+{
+	constexpr u32 BLOCK_DIM = 4;
+
+	u64 AlignUp(u64 value, u64 alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+CookedTexture::CookedTexture(const u8 *pData, size_t size) :
+	pData(pData),
+	iSize(size),
+	sHeader(),
+	pArrMips()
+{
+	ASSERT(IsCooked(pData, size) && size >= sizeof(Header), "Not a cooked texture");
+	memcpy(&sHeader, pData, sizeof(Header));
+
+	ASSERT(sHeader.version == VERSION, "Cooked texture version " + to_string(sHeader.version) + ", expected " + to_string(VERSION));
+	ASSERT(GetBlockBytes(GetFormat()) != 0, "Cooked texture has a format that isn't block compressed: " + to_string(sHeader.format));
+	ASSERT(sHeader.width > 0 && sHeader.height > 0, "Cooked texture has no pixels");
+	ASSERT(sHeader.mipLevels > 0 && sHeader.mipLevels <= GetMipLevelCount(GetExtent()), "Cooked texture has " + to_string(sHeader.mipLevels) + " mips");
+	ASSERT(size >= sizeof(Header) + sHeader.mipLevels * sizeof(Mip), "Cooked texture is cut off in its mip table");
+
+	pArrMips.resize(sHeader.mipLevels);
+	memcpy(pArrMips.data(), pData + sizeof(Header), pArrMips.size() * sizeof(Mip));
+
+	for (u32 level = 0; level < sHeader.mipLevels; level++)
+	{
+		const Mip &mip = pArrMips[level];
+		ASSERT(mip.size == GetLevelSize(GetFormat(), GetExtent(), level), "Cooked texture mip " + to_string(level) + " has the wrong size");
+		ASSERT(mip.compression == Compression::None || mip.compression == Compression::Deflate, "Cooked texture mip " + to_string(level) + " has an unknown compression");
+		ASSERT(mip.compression != Compression::None || mip.storedSize == mip.size, "Cooked texture mip " + to_string(level) + " is stored with the wrong size");
+		ASSERT(mip.offset <= size && mip.storedSize <= size - mip.offset, "Cooked texture mip " + to_string(level) + " reaches past the end of the file");
+	}
+}
+
+bool CookedTexture::IsCooked(const u8 *pData, size_t size)
+{
+	u32 magic = 0;
+	if (size < sizeof(magic))
+	{
+		return false;
+	}
+	memcpy(&magic, pData, sizeof(magic));
+	return magic == MAGIC;
+}
+
+VkFormat CookedTexture::GetFormat() const
+{
+	return static_cast<VkFormat>(sHeader.format);
+}
+
+VkExtent2D CookedTexture::GetExtent() const
+{
+	return { sHeader.width, sHeader.height };
+}
+
+u32 CookedTexture::GetMipLevels() const
+{
+	return sHeader.mipLevels;
+}
+
+const CookedTexture::Mip &CookedTexture::GetMip(u32 level) const
+{
+	return pArrMips[level];
+}
+
+VkDeviceSize CookedTexture::GetTotalSize() const
+{
+	VkDeviceSize total = 0;
+	for (const Mip &mip : pArrMips)
+	{
+		total += mip.size;
+	}
+	return total;
+}
+
+bool CookedTexture::ReadMip(u32 level, u8 *pOut) const
+{
+	const Mip &mip = pArrMips[level];
+	const u8 *pStored = pData + mip.offset;
+
+	if (mip.compression == Compression::None)
+	{
+		memcpy(pOut, pStored, static_cast<size_t>(mip.size));
+		return true;
+	}
+
+	uLongf inflatedSize = static_cast<uLongf>(mip.size);
+	int result = uncompress(pOut, &inflatedSize, pStored, static_cast<uLong>(mip.storedSize));
+	return result == Z_OK && inflatedSize == mip.size;
+}
+
+void CookedTexture::Write(const string &path, VkFormat format, VkExtent2D extent, const Vec<Vec<u8>> &mips, int compressionLevel)
+{
+	ASSERT(GetBlockBytes(format) != 0, "Only block compressed formats can be cooked");
+	ASSERT(!mips.empty() && mips.size() <= GetMipLevelCount(extent), "Cooked texture needs between one mip and a full chain");
+
+	Vec<Vec<u8>> deflated(mips.size());
+	auto fnDeflate = [&](u32 begin, u32 end)
+	{
+		for (u32 level = begin; level < end; level++)
+		{
+			ASSERT(mips[level].size() == GetLevelSize(format, extent, level), "Mip " + to_string(level) + " has the wrong size");
+			ASSERT(mips[level].size() <= UINT32_MAX, "Mip " + to_string(level) + " is too big for zlib");
+
+			uLongf deflatedSize = compressBound(static_cast<uLong>(mips[level].size()));
+			deflated[level].resize(deflatedSize);
+			int result = compress2(deflated[level].data(), &deflatedSize, mips[level].data(), static_cast<uLong>(mips[level].size()), compressionLevel);
+			ASSERT(result == Z_OK, "Deflating mip " + to_string(level) + " failed: " + to_string(result));
+			deflated[level].resize(deflatedSize);
+		}
+	};
+
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	if (jobSystem.IsValid())
+	{
+		jobSystem.ParallelFor(static_cast<u32>(mips.size()), 1, fnDeflate);
+	}
+	else
+	{
+		fnDeflate(0, static_cast<u32>(mips.size()));
+	}
+
+	Header header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.format = static_cast<u32>(format);
+	header.width = extent.width;
+	header.height = extent.height;
+	header.mipLevels = static_cast<u32>(mips.size());
+
+	Vec<Mip> table(mips.size());
+	Vec<const Vec<u8> *> stored(mips.size());
+	u64 offset = sizeof(Header) + table.size() * sizeof(Mip);
+	for (size_t level = 0; level < mips.size(); level++)
+	{
+		bool bDeflate = deflated[level].size() < mips[level].size();
+		stored[level] = bDeflate ? &deflated[level] : &mips[level];
+
+		offset = AlignUp(offset, DATA_ALIGNMENT);
+		table[level] = {};
+		table[level].offset = offset;
+		table[level].storedSize = stored[level]->size();
+		table[level].size = mips[level].size();
+		table[level].compression = bDeflate ? Compression::Deflate : Compression::None;
+		offset += table[level].storedSize;
+	}
+
+	ofstream file(path, ios::binary | ios::trunc);
+	ASSERT(file.is_open(), "Failed to open " + path + " for writing");
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(Mip));
+
+	const char padding[DATA_ALIGNMENT] = {};
+	for (size_t level = 0; level < mips.size(); level++)
+	{
+		u64 position = static_cast<u64>(file.tellp());
+		file.write(padding, static_cast<streamsize>(table[level].offset - position));
+		file.write(reinterpret_cast<const char *>(stored[level]->data()), static_cast<streamsize>(stored[level]->size()));
+	}
+
+	ASSERT(file.good(), "Failed to write " + path);
+}
+
+u32 CookedTexture::GetBlockBytes(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		return 8;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+VkDeviceSize CookedTexture::GetLevelSize(VkFormat format, VkExtent2D extent, u32 level)
+{
+	VkDeviceSize width = GetMipSize(extent.width, level);
+	VkDeviceSize height = GetMipSize(extent.height, level);
+	return ((width + BLOCK_DIM - 1) / BLOCK_DIM) * ((height + BLOCK_DIM - 1) / BLOCK_DIM) * GetBlockBytes(format);
+}
+
+u32 GetMipLevelCount(VkExtent2D extent)
+{
+	u32 levels = 1;
+	for (u32 size = max(extent.width, extent.height); size > 1; size >>= 1)
+	{
+		levels++;
+	}
+	return levels;
+}
+
+u32 GetMipSize(u32 size, u32 level)
+{
+	return max(1u, size >> level);
+}
+
+u32 GetDownsampleTap(u32 dst, u32 tap, u32 srcSize)
+{
+	return min(dst * 2 + tap, srcSize - 1);
+}
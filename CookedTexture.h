@@ -0,0 +1,97 @@
+#pragma once
+
+// A texture cooked offline by the TextureCooker, mips and all, already in the format it's sampled in.
+// The file is a header, a table with one entry per mip, then the mips, each DATA_ALIGNMENT aligned
+// and either stored as is or deflated with zlib if that made it smaller. A mip holds its tightly packed
+// blocks, exactly what a buffer to image copy of the level reads, so loading one is a single write
+// into staging memory: a memcpy, or the inflate straight into it.
+// Reading works on memory the caller keeps alive, usually a MappedFile.
+class CookedTexture : public NonCopyable
+{
+public:
+
+	static constexpr u32 MAGIC = 0x58455443; // "CTEX"
+	static constexpr u32 VERSION = 1;
+	static constexpr u64 DATA_ALIGNMENT = 16;
+	static constexpr const char *EXTENSION = ".ctex";
+
+	enum class Compression : u32
+	{
+		None,
+		Deflate
+	};
+
+	// On disk, little endian
+	struct Header
+	{
+		u32 magic;
+		u32 version;
+		u32 format;
+		u32 width;
+		u32 height;
+		u32 mipLevels;
+		u32 reserved[2];
+	};
+
+	struct Mip
+	{
+		// From the start of the file
+		u64 offset;
+		u64 storedSize;
+
+		// Once inflated
+		u64 size;
+		Compression compression;
+		u32 reserved;
+	};
+
+private:
+
+	const u8 *pData;
+	size_t iSize;
+	Header sHeader;
+	Vec<Mip> pArrMips;
+
+public:
+
+	// Throws if the header or the mip table don't add up, or reach past size
+	CookedTexture(const u8 *pData, size_t size);
+
+public:
+
+	// Only looks at the magic
+	static bool IsCooked(const u8 *pData, size_t size);
+
+	VkFormat GetFormat() const;
+	VkExtent2D GetExtent() const;
+	u32 GetMipLevels() const;
+	const Mip &GetMip(u32 level) const;
+
+	// All mips, inflated
+	VkDeviceSize GetTotalSize() const;
+
+	// Write the level's GetMip(level).size bytes to pOut. False if it doesn't inflate to exactly that.
+	bool ReadMip(u32 level, u8 *pOut) const;
+
+	// Deflates every level at zlib's compressionLevel, spread over the job system if it's running,
+	// and keeps whichever is smaller. mips are tightly packed blocks of format, from level 0 down.
+	static void Write(const string &path, VkFormat format, VkExtent2D extent, const Vec<Vec<u8>> &mips, int compressionLevel);
+
+	// 8 or 16 for the BC formats, 0 for anything that can't be cooked
+	static u32 GetBlockBytes(VkFormat format);
+
+	// Bytes of a level of format, partial blocks at the edges count whole
+	static VkDeviceSize GetLevelSize(VkFormat format, VkExtent2D extent, u32 level);
+};
+
+// Mip chain rules shared by the TextureCooker and the MipGenerator, so cooked and generated mips match
+
+// Levels down to 1x1
+u32 GetMipLevelCount(VkExtent2D extent);
+
+// Texels of a level along one axis, never less than 1
+u32 GetMipSize(u32 size, u32 level);
+
+// Texel of the level above that tap 0 or 1 of the 2x2 box filter reads for texel dst, along one axis.
+// An odd sized level has no texel past its last one and clamps to it, like Shaders/Downsample.comp.
+u32 GetDownsampleTap(u32 dst, u32 tap, u32 srcSize);
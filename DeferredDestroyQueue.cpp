@@ -0,0 +1,217 @@
+#pragma once
+
+#include "DeferredDestroyQueue.h"
+#include "Device.h"
+#include "GpuTimeline.h"
+#include "UploadQueue.h"
+#include "RenderPassCache.h"
+#include "DescriptorSetCache.h"
+
+DeferredDestroyQueue::DeferredDestroyQueue(Device &device) :
+	pDevice(device),
+	pArrEntries(),
+	bClosed(true)
+{
+}
+
+DeferredDestroyQueue::~DeferredDestroyQueue()
+{
+	Destroy();
+}
+
+void DeferredDestroyQueue::Create()
+{
+	lock_guard<mutex> lock(mLock);
+	bClosed = false;
+}
+
+void DeferredDestroyQueue::Destroy()
+{
+	deque<Entry> entries;
+	{
+		lock_guard<mutex> lock(mLock);
+		if (bClosed && pArrEntries.empty())
+		{
+			return;
+		}
+		bClosed = true;
+		entries.swap(pArrEntries);
+	}
+
+	pDevice.WaitIdle();
+
+	for (auto &entry : entries)
+	{
+		DestroyEntry(entry);
+	}
+}
+
+bool DeferredDestroyQueue::IsValid() const
+{
+	return !bClosed;
+}
+
+void DeferredDestroyQueue::DestroyBuffer(VkBuffer buffer, MemoryAllocation &allocation)
+{
+	pDevice.GetDescriptorSetCache().Release(reinterpret_cast<u64>(buffer));
+	Push(VK_OBJECT_TYPE_BUFFER, reinterpret_cast<u64>(buffer), allocation);
+	allocation = {};
+}
+
+void DeferredDestroyQueue::DestroyImage(VkImage image, MemoryAllocation &allocation)
+{
+	Push(VK_OBJECT_TYPE_IMAGE, reinterpret_cast<u64>(image), allocation);
+	allocation = {};
+}
+
+void DeferredDestroyQueue::DestroyImageView(VkImageView imageView)
+{
+	pDevice.GetRenderPassCache().ReleaseImageView(imageView);
+	pDevice.GetDescriptorSetCache().Release(reinterpret_cast<u64>(imageView));
+	Push(VK_OBJECT_TYPE_IMAGE_VIEW, reinterpret_cast<u64>(imageView));
+}
+
+void DeferredDestroyQueue::DestroyFramebuffer(VkFramebuffer framebuffer)
+{
+	Push(VK_OBJECT_TYPE_FRAMEBUFFER, reinterpret_cast<u64>(framebuffer));
+}
+
+void DeferredDestroyQueue::DestroyPipeline(VkPipeline pipeline)
+{
+	Push(VK_OBJECT_TYPE_PIPELINE, reinterpret_cast<u64>(pipeline));
+}
+
+void DeferredDestroyQueue::DestroyPipelineLayout(VkPipelineLayout layout)
+{
+	Push(VK_OBJECT_TYPE_PIPELINE_LAYOUT, reinterpret_cast<u64>(layout));
+}
+
+void DeferredDestroyQueue::DestroyShaderModule(VkShaderModule shaderModule)
+{
+	Push(VK_OBJECT_TYPE_SHADER_MODULE, reinterpret_cast<u64>(shaderModule));
+}
+
+void DeferredDestroyQueue::DestroySwapchain(VkSwapchainKHR swapchain)
+{
+	Push(VK_OBJECT_TYPE_SWAPCHAIN_KHR, reinterpret_cast<u64>(swapchain));
+}
+
+void DeferredDestroyQueue::DestroySemaphore(VkSemaphore semaphore)
+{
+	Push(VK_OBJECT_TYPE_SEMAPHORE, reinterpret_cast<u64>(semaphore));
+}
+
+void DeferredDestroyQueue::DestroySampler(VkSampler sampler)
+{
+	pDevice.GetDescriptorSetCache().Release(reinterpret_cast<u64>(sampler));
+	Push(VK_OBJECT_TYPE_SAMPLER, reinterpret_cast<u64>(sampler));
+}
+
+void DeferredDestroyQueue::Defer(Func<void()> fnDestroy)
+{
+	Push(VK_OBJECT_TYPE_UNKNOWN, 0, {}, move(fnDestroy));
+}
+
+u32 DeferredDestroyQueue::Collect()
+{
+	GpuTimeline &graphicsTimeline = pDevice.GetGraphicsTimeline();
+	GpuTimeline &transferTimeline = pDevice.GetUploadQueue().GetTimeline();
+
+	// Values only go up along the queue, so the first entry that isn't done ends the batch
+	Vec<Entry> retired;
+	{
+		lock_guard<mutex> lock(mLock);
+		while (!pArrEntries.empty())
+		{
+			const Entry &entry = pArrEntries.front();
+			if (!graphicsTimeline.IsComplete(entry.iGraphicsValue) || !transferTimeline.IsComplete(entry.iTransferValue))
+			{
+				break;
+			}
+
+			retired.push_back(move(pArrEntries.front()));
+			pArrEntries.pop_front();
+		}
+	}
+
+	for (auto &entry : retired)
+	{
+		DestroyEntry(entry);
+	}
+
+	return static_cast<u32>(retired.size());
+}
+
+u32 DeferredDestroyQueue::GetPendingCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return static_cast<u32>(pArrEntries.size());
+}
+
+void DeferredDestroyQueue::Push(VkObjectType type, u64 handle, MemoryAllocation allocation, Func<void()> fnDestroy)
+{
+	Entry entry = { type, handle, allocation, move(fnDestroy), 0, 0 };
+
+	{
+		lock_guard<mutex> lock(mLock);
+		if (!bClosed)
+		{
+			// The frame being recorded right now may still use it, so the next submission has to finish too
+			entry.iGraphicsValue = pDevice.GetGraphicsTimeline().GetSubmittedValue() + 1;
+			entry.iTransferValue = pDevice.GetUploadQueue().GetTimeline().GetSubmittedValue();
+			pArrEntries.push_back(move(entry));
+			return;
+		}
+	}
+
+	DestroyEntry(entry);
+}
+
+void DeferredDestroyQueue::DestroyEntry(Entry &entry)
+{
+	VkDevice device = pDevice.GetVkNative();
+
+	switch (entry.eType)
+	{
+	case VK_OBJECT_TYPE_BUFFER:
+		vkDestroyBuffer(device, reinterpret_cast<VkBuffer>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_IMAGE:
+		vkDestroyImage(device, reinterpret_cast<VkImage>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_IMAGE_VIEW:
+		vkDestroyImageView(device, reinterpret_cast<VkImageView>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_FRAMEBUFFER:
+		vkDestroyFramebuffer(device, reinterpret_cast<VkFramebuffer>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE:
+		vkDestroyPipeline(device, reinterpret_cast<VkPipeline>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+		vkDestroyPipelineLayout(device, reinterpret_cast<VkPipelineLayout>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SHADER_MODULE:
+		vkDestroyShaderModule(device, reinterpret_cast<VkShaderModule>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+		vkDestroySwapchainKHR(device, reinterpret_cast<VkSwapchainKHR>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SEMAPHORE:
+		vkDestroySemaphore(device, reinterpret_cast<VkSemaphore>(entry.iHandle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SAMPLER:
+		vkDestroySampler(device, reinterpret_cast<VkSampler>(entry.iHandle), nullptr);
+		break;
+	default:
+		break;
+	}
+
+	// Memory goes back after the object bound to it
+	pDevice.GetAllocator().Free(entry.sAllocation);
+
+	if (entry.fnDestroy)
+	{
+		entry.fnDestroy();
+	}
+}
\ No newline at end of file
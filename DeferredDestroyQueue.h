@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+class Device;
+
+// Holds on to Vulkan objects until the GPU is done with them, so they can be released while
+// frames are in flight instead of behind a vkDeviceWaitIdle. Everything queued is tagged with
+// the next graphics timeline value and the transfer timeline value submitted so far, and is
+// destroyed in bulk by Collect() once both timelines got there.
+class DeferredDestroyQueue : public IVkResource, public NonCopyable
+{
+private:
+
+	struct Entry
+	{
+		VkObjectType eType;
+		u64 iHandle;
+		MemoryAllocation sAllocation;
+		Func<void()> fnDestroy;
+
+		u64 iGraphicsValue;
+		u64 iTransferValue;
+	};
+
+	Device &pDevice;
+
+	// In the order things were queued, which is also the order the values go up in
+	deque<Entry> pArrEntries;
+	mutex mLock;
+
+	// After Destroy() nothing is in flight anymore, so anything queued is destroyed right away
+	bool bClosed;
+
+public:
+
+	DeferredDestroyQueue(Device &device);
+	~DeferredDestroyQueue();
+
+public:
+
+	void Create() override;
+
+	// Waits for the device and destroys everything still queued
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Named per type rather than overloaded, non-dispatchable handles are all u64 on 32 bit
+	void DestroyBuffer(VkBuffer buffer, MemoryAllocation &allocation);
+	void DestroyImage(VkImage image, MemoryAllocation &allocation);
+	// Framebuffers and cached descriptor sets using the object are released along with it
+	void DestroyImageView(VkImageView imageView);
+	void DestroyFramebuffer(VkFramebuffer framebuffer);
+	void DestroyPipeline(VkPipeline pipeline);
+	void DestroyPipelineLayout(VkPipelineLayout layout);
+	void DestroyShaderModule(VkShaderModule shaderModule);
+	void DestroySwapchain(VkSwapchainKHR swapchain);
+	void DestroySemaphore(VkSemaphore semaphore);
+	void DestroySampler(VkSampler sampler);
+
+	// Anything else, fnDestroy runs once the GPU got past everything submitted so far
+	void Defer(Func<void()> fnDestroy);
+
+	// Destroy everything the GPU is done with, returns how many objects went
+	u32 Collect();
+
+	u32 GetPendingCount();
+
+private:
+
+	void Push(VkObjectType type, u64 handle, MemoryAllocation allocation = {}, Func<void()> fnDestroy = nullptr);
+	void DestroyEntry(Entry &entry);
+};
\ No newline at end of file
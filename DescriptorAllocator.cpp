@@ -0,0 +1,234 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+#include "Device.h"
+
+DescriptorWrite DescriptorWrite::Buffer(u32 binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorWrite write;
+	write.binding = binding;
+	write.type = type;
+	write.buffer = { buffer, offset, range };
+	return write;
+}
+
+DescriptorWrite DescriptorWrite::Image(u32 binding, VkDescriptorType type, VkImageView view, VkSampler sampler, VkImageLayout layout)
+{
+	DescriptorWrite write;
+	write.binding = binding;
+	write.type = type;
+	write.image = { sampler, view, layout };
+	return write;
+}
+
+bool DescriptorWrite::IsImage() const
+{
+	switch (type)
+	{
+	case VK_DESCRIPTOR_TYPE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+	case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+	case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool DescriptorWrite::operator==(const DescriptorWrite &other) const
+{
+	if (binding != other.binding || arrayElement != other.arrayElement || type != other.type)
+	{
+		return false;
+	}
+
+	if (IsImage())
+	{
+		return image.sampler == other.image.sampler && image.imageView == other.image.imageView && image.imageLayout == other.image.imageLayout;
+	}
+	return buffer.buffer == other.buffer.buffer && buffer.offset == other.buffer.offset && buffer.range == other.buffer.range;
+}
+
+bool DescriptorWrite::operator!=(const DescriptorWrite &other) const
+{
+	return !(*this == other);
+}
+
+DescriptorAllocator::DescriptorAllocator(Device &device) :
+	DescriptorAllocator(device, GetDefaultRatios())
+{
+}
+
+DescriptorAllocator::DescriptorAllocator(Device &device, const Vec<PoolRatio> &ratios) :
+	pDevice(device),
+	pArrPools(),
+	pArrRatios(ratios),
+	iCurrentPool(0),
+	iNextPoolSets(INITIAL_SETS_PER_POOL),
+	iAllocatedSets(0)
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+	Destroy();
+}
+
+void DescriptorAllocator::Create()
+{
+	lock_guard<mutex> lock(mLock);
+
+	// One pool up front, most frames never need a second
+	pArrPools.push_back(CreatePool(iNextPoolSets));
+	iNextPoolSets = min(iNextPoolSets * 2, MAX_SETS_PER_POOL);
+}
+
+void DescriptorAllocator::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (VkDescriptorPool pool : pArrPools)
+	{
+		vkDestroyDescriptorPool(pDevice.GetVkNative(), pool, nullptr);
+	}
+	pArrPools.clear();
+	iCurrentPool = 0;
+	iAllocatedSets = 0;
+}
+
+bool DescriptorAllocator::IsValid() const
+{
+	return !pArrPools.empty();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	lock_guard<mutex> lock(mLock);
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &layout;
+
+	while (true)
+	{
+		bool bNewPool = false;
+		if (iCurrentPool == pArrPools.size())
+		{
+			pArrPools.push_back(CreatePool(iNextPoolSets));
+			iNextPoolSets = min(iNextPoolSets * 2, MAX_SETS_PER_POOL);
+			bNewPool = true;
+		}
+
+		allocateInfo.descriptorPool = pArrPools[iCurrentPool];
+
+		VkDescriptorSet set = VK_NULL_HANDLE;
+		VkResult result = vkAllocateDescriptorSets(pDevice.GetVkNative(), &allocateInfo, &set);
+		if (result == VK_SUCCESS)
+		{
+			iAllocatedSets++;
+			return set;
+		}
+
+		// Full, or too fragmented for this layout, either way the next pool gets a go
+		if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+		{
+			VK_CHECK_RESULT(result);
+		}
+
+		// An empty pool that can't fit it means the layout needs more of a type than the ratios give
+		ASSERT(!bNewPool, "Descriptor set layout doesn't fit into an empty pool, check the pool ratios");
+		iCurrentPool++;
+	}
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const Vec<DescriptorWrite> &writes)
+{
+	VkDescriptorSet set = Allocate(layout);
+	Write(pDevice, set, writes);
+	return set;
+}
+
+void DescriptorAllocator::Reset()
+{
+	lock_guard<mutex> lock(mLock);
+
+	// Only the pools that were touched have anything to reset
+	for (u32 i = 0; i <= iCurrentPool && i < pArrPools.size(); i++)
+	{
+		VK_CHECK_RESULT(vkResetDescriptorPool(pDevice.GetVkNative(), pArrPools[i], 0));
+	}
+	iCurrentPool = 0;
+	iAllocatedSets = 0;
+}
+
+u32 DescriptorAllocator::GetPoolCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return static_cast<u32>(pArrPools.size());
+}
+
+u32 DescriptorAllocator::GetAllocatedSetCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return iAllocatedSets;
+}
+
+void DescriptorAllocator::Write(const Device &device, VkDescriptorSet set, const Vec<DescriptorWrite> &writes)
+{
+	Vec<VkWriteDescriptorSet> vkWrites(writes.size());
+	for (size_t i = 0; i < writes.size(); i++)
+	{
+		const DescriptorWrite &write = writes[i];
+		vkWrites[i] = {};
+		vkWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		vkWrites[i].dstSet = set;
+		vkWrites[i].dstBinding = write.binding;
+		vkWrites[i].dstArrayElement = write.arrayElement;
+		vkWrites[i].descriptorCount = 1;
+		vkWrites[i].descriptorType = write.type;
+		vkWrites[i].pImageInfo = write.IsImage() ? &write.image : nullptr;
+		vkWrites[i].pBufferInfo = write.IsImage() ? nullptr : &write.buffer;
+	}
+
+	if (!vkWrites.empty())
+	{
+		vkUpdateDescriptorSets(device.GetVkNative(), static_cast<u32>(vkWrites.size()), vkWrites.data(), 0, nullptr);
+	}
+}
+
+const Vec<DescriptorAllocator::PoolRatio> &DescriptorAllocator::GetDefaultRatios()
+{
+	static const Vec<PoolRatio> ratios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 2.0f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+	};
+	return ratios;
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(u32 setCount) const
+{
+	Vec<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(pArrRatios.size());
+	for (const PoolRatio &ratio : pArrRatios)
+	{
+		poolSizes.push_back({ ratio.type, max(1u, static_cast<u32>(ratio.ratio * setCount)) });
+	}
+
+	// No FREE_DESCRIPTOR_SET_BIT, sets only ever go back all at once
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = setCount;
+	poolCreateInfo.poolSizeCount = static_cast<u32>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateDescriptorPool(pDevice.GetVkNative(), &poolCreateInfo, nullptr, &pool));
+	return pool;
+}
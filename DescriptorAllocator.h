@@ -0,0 +1,94 @@
+#pragma once
+
+class Device;
+
+// One descriptor of a set, as plain data so it can be hashed. Only the info matching type is used.
+struct DescriptorWrite
+{
+	u32 binding = 0;
+	u32 arrayElement = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	VkDescriptorImageInfo image = {};
+	VkDescriptorBufferInfo buffer = {};
+
+	static DescriptorWrite Buffer(u32 binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	static DescriptorWrite Image(u32 binding, VkDescriptorType type, VkImageView view, VkSampler sampler = VK_NULL_HANDLE,
+		VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	bool IsImage() const;
+
+	// Only the image or the buffer info counts, whichever the type uses
+	bool operator==(const DescriptorWrite &other) const;
+	bool operator!=(const DescriptorWrite &other) const;
+};
+
+// Linear descriptor set allocator over a chain of pools, for sets that live as long as a frame.
+// Sets are never freed one by one, Reset() hands every pool back with vkResetDescriptorPool,
+// which is about as cheap as it gets. A pool that runs dry moves on to the next one in the chain,
+// new pools are only created the first time a frame needs more than before, each twice as big
+// as the last. Every frame in flight has its own, reset once the frame retired.
+class DescriptorAllocator : public IVkResource, public NonCopyable
+{
+public:
+
+	static constexpr u32 INITIAL_SETS_PER_POOL = 64;
+	static constexpr u32 MAX_SETS_PER_POOL = 4096;
+
+	// Descriptors of each type per set a pool is sized for
+	struct PoolRatio
+	{
+		VkDescriptorType type;
+		f32 ratio;
+	};
+
+private:
+
+	Device &pDevice;
+
+	Vec<VkDescriptorPool> pArrPools;
+	Vec<PoolRatio> pArrRatios;
+
+	// Pools before this one are full until the next Reset()
+	u32 iCurrentPool;
+	u32 iNextPoolSets;
+	u32 iAllocatedSets;
+
+	// Recording threads allocate from the same frame
+	mutex mLock;
+
+public:
+
+	DescriptorAllocator(Device &device);
+	DescriptorAllocator(Device &device, const Vec<PoolRatio> &ratios);
+	~DescriptorAllocator();
+
+public:
+
+	void Create() override;
+
+	// The GPU must not be using any of the sets anymore
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+	// Allocate and fill in one go
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout, const Vec<DescriptorWrite> &writes);
+
+	// Every set allocated so far becomes invalid, only once the GPU is done with them
+	void Reset();
+
+	u32 GetPoolCount();
+	u32 GetAllocatedSetCount();
+
+	static void Write(const Device &device, VkDescriptorSet set, const Vec<DescriptorWrite> &writes);
+
+	// A mix that fits most material and pass sets
+	static const Vec<PoolRatio> &GetDefaultRatios();
+
+private:
+
+	VkDescriptorPool CreatePool(u32 setCount) const;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "DescriptorSetCache.h"
+#include "Device.h"
+#include "Hash.h"
+
+DescriptorSetCache::DescriptorSetCache(Device &device) :
+	pDevice(device),
+	pAllocator(),
+	pArrSets(),
+	iHits(0),
+	iMisses(0)
+{
+}
+
+DescriptorSetCache::~DescriptorSetCache()
+{
+	Destroy();
+}
+
+void DescriptorSetCache::Create()
+{
+	pAllocator = make_shared<DescriptorAllocator>(pDevice);
+	pAllocator->Create();
+}
+
+void DescriptorSetCache::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+	pArrSets.clear();
+	pAllocator.reset();
+}
+
+bool DescriptorSetCache::IsValid() const
+{
+	return pAllocator != nullptr;
+}
+
+VkDescriptorSet DescriptorSetCache::GetOrCreate(VkDescriptorSetLayout layout, const Vec<DescriptorWrite> &writes)
+{
+	u64 hash = Hash(layout, writes);
+
+	lock_guard<mutex> lock(mLock);
+
+	auto it = pArrSets.find(hash);
+	if (it != pArrSets.end())
+	{
+		// A 64-bit collision is unlikely but would bind the wrong descriptors, so check. The new
+		// contents replace the entry, the set it had is reclaimed by the next Clear().
+		if (it->second.pLayout == layout && it->second.pArrWrites == writes)
+		{
+			iHits++;
+			return it->second.pSet;
+		}
+		cout << "WARNING: Descriptor set hash collision on " << hex << hash << dec << endl;
+	}
+	iMisses++;
+
+	Entry entry;
+	entry.pSet = pAllocator->Allocate(layout, writes);
+	entry.pLayout = layout;
+	entry.pArrWrites = writes;
+	for (const DescriptorWrite &write : writes)
+	{
+		if (write.IsImage())
+		{
+			if (write.image.imageView != VK_NULL_HANDLE)
+			{
+				entry.pArrHandles.push_back(reinterpret_cast<u64>(write.image.imageView));
+			}
+			if (write.image.sampler != VK_NULL_HANDLE)
+			{
+				entry.pArrHandles.push_back(reinterpret_cast<u64>(write.image.sampler));
+			}
+		}
+		else if (write.buffer.buffer != VK_NULL_HANDLE)
+		{
+			entry.pArrHandles.push_back(reinterpret_cast<u64>(write.buffer.buffer));
+		}
+	}
+
+	VkDescriptorSet set = entry.pSet;
+	pArrSets[hash] = move(entry);
+	return set;
+}
+
+void DescriptorSetCache::Release(u64 handle)
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (auto it = pArrSets.begin(); it != pArrSets.end();)
+	{
+		const Vec<u64> &handles = it->second.pArrHandles;
+		if (find(handles.begin(), handles.end(), handle) != handles.end())
+		{
+			it = pArrSets.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void DescriptorSetCache::Clear()
+{
+	lock_guard<mutex> lock(mLock);
+	pArrSets.clear();
+	if (pAllocator)
+	{
+		pAllocator->Reset();
+	}
+}
+
+size_t DescriptorSetCache::GetCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return pArrSets.size();
+}
+
+u64 DescriptorSetCache::GetHitCount() const
+{
+	return iHits;
+}
+
+u64 DescriptorSetCache::GetMissCount() const
+{
+	return iMisses;
+}
+
+u64 DescriptorSetCache::Hash(VkDescriptorSetLayout layout, const Vec<DescriptorWrite> &writes)
+{
+	Hasher hasher;
+	hasher.Add(layout);
+	hasher.Add(writes.size());
+	for (const DescriptorWrite &write : writes)
+	{
+		hasher.Add(write.binding).Add(write.arrayElement).Add(write.type);
+		if (write.IsImage())
+		{
+			hasher.Add(write.image.sampler).Add(write.image.imageView).Add(write.image.imageLayout);
+		}
+		else
+		{
+			hasher.Add(write.buffer.buffer).Add(write.buffer.offset).Add(write.buffer.range);
+		}
+	}
+	return hasher.Get();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+
+class Device;
+
+// Descriptor sets whose contents never change once written, e.g. a material's textures and
+// constants, keyed by a hash of the layout and every descriptor. Asking for the same contents
+// again hands back the set that was written the first time instead of allocating a new one.
+// Sets come from a DescriptorAllocator that is never reset, so they stay valid until Clear().
+// An entry goes when a view, buffer or sampler in it is destroyed through the deferred destroy
+// queue, its set is only reclaimed by the next Clear().
+class DescriptorSetCache : public IVkResource, public NonCopyable
+{
+private:
+
+	struct Entry
+	{
+		VkDescriptorSet pSet;
+
+		// What the set was written with, a hash match with anything else is a collision
+		VkDescriptorSetLayout pLayout;
+		Vec<DescriptorWrite> pArrWrites;
+
+		// Views, buffers and samplers the set points at
+		Vec<u64> pArrHandles;
+	};
+
+	Device &pDevice;
+	Ref<DescriptorAllocator> pAllocator;
+
+	unordered_map<u64, Entry> pArrSets;
+	mutex mLock;
+
+	u64 iHits;
+	u64 iMisses;
+
+public:
+
+	DescriptorSetCache(Device &device);
+	~DescriptorSetCache();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	VkDescriptorSet GetOrCreate(VkDescriptorSetLayout layout, const Vec<DescriptorWrite> &writes);
+
+	// Forget every set using the handle, called when the object is destroyed
+	void Release(u64 handle);
+
+	// Drop every set and reset the pools, the GPU must not be using any of them
+	void Clear();
+
+	size_t GetCount();
+	u64 GetHitCount() const;
+	u64 GetMissCount() const;
+
+private:
+
+	static u64 Hash(VkDescriptorSetLayout layout, const Vec<DescriptorWrite> &writes);
+};
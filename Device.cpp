@@ -3,18 +3,89 @@
 #include "PhysicalDevice.h"
 #include "Device.h"
 #include "Instance.h"
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+#include "MipGenerator.h"
+#include "UploadQueue.h"
+#include "GpuTimeline.h"
+#include "DeferredDestroyQueue.h"
+#include "RenderPassCache.h"
+#include "BindlessHeap.h"
+#include "DescriptorSetCache.h"
+#include "PipelineLayoutCache.h"
+#include "Image.h"
 
 Device::Device(PhysicalDevice &physicalDevice) :
 	pVkDevice(VK_NULL_HANDLE),
 	pGraphicsQueue(VK_NULL_HANDLE),
 	pPresentQueue(VK_NULL_HANDLE),
+	pTransferQueue(VK_NULL_HANDLE),
+	fnCmdPipelineBarrier2(nullptr),
+	fnCmdBeginRendering(nullptr),
+	fnCmdEndRendering(nullptr),
+	fnWaitForPresent(nullptr),
+	bStorageImageWriteWithoutFormat(false),
+	bTextureCompressionBC(false),
 	pPhysicalDevice(physicalDevice),
-	sQueueFamilyIndices(physicalDevice.GetQueueFamilyIndices())
+	sQueueFamilyIndices(physicalDevice.GetQueueFamilyIndices()),
+	pArrExtensions({ VK_KHR_SWAPCHAIN_EXTENSION_NAME }),
+	sPipelineCachePath("PipelineCache.bin")
 {
 }
 
 Device::~Device()
 {
+	// Waits for its submissions, its views and shader go through the deferred destroy queue
+	if (pMipGenerator)
+	{
+		pMipGenerator->Destroy();
+	}
+	pMipGenerator.reset();
+
+	pPipelineRegistry.reset();
+
+	// Writes the pipeline cache back to disk
+	pPipelineCache.reset();
+
+	// Waits for the device and releases everything still queued, anything destroyed later goes right away
+	if (pDeferredDestroyQueue)
+	{
+		pDeferredDestroyQueue->Destroy();
+	}
+
+	// Waits for pending uploads and releases the staging ring
+	pUploadQueue.reset();
+
+	// Runs whatever callbacks are still parked on the graphics queue
+	pGraphicsTimeline.reset();
+
+	// Nothing is in flight anymore, the cached render passes and framebuffers can go right away
+	if (pRenderPassCache)
+	{
+		pRenderPassCache->Destroy();
+	}
+	if (pBindlessHeap)
+	{
+		pBindlessHeap->Destroy();
+	}
+	if (pDescriptorSetCache)
+	{
+		pDescriptorSetCache->Destroy();
+	}
+	if (pPipelineLayoutCache)
+	{
+		pPipelineLayoutCache->Destroy();
+	}
+
+	// Device memory has to go before the device does
+	pAllocator.reset();
+	pDeferredDestroyQueue.reset();
+	pRenderPassCache.reset();
+	pBindlessHeap.reset();
+	pDescriptorSetCache.reset();
+	pPipelineLayoutCache.reset();
+
 	if (pVkDevice != VK_NULL_HANDLE)
 	{
 		vkDestroyDevice(pVkDevice, nullptr);
@@ -26,7 +97,7 @@ void Device::Create()
 	const QueueFamilyIndices &queueFamilyIndices = sQueueFamilyIndices;
 
 	Vec<VkDeviceQueueCreateInfo> queueCreateInfos{};
-	Set<u32> uniqueQueueFamilies = { queueFamilyIndices.graphicsFamily, queueFamilyIndices.presentFamily };
+	Set<u32> uniqueQueueFamilies = { queueFamilyIndices.graphicsFamily, queueFamilyIndices.presentFamily, queueFamilyIndices.transferFamily };
 
 	// The queue priority is a floating point value between 0.0 and 1.0
 	f32 queuePriority = 1.0f;
@@ -44,24 +115,127 @@ void Device::Create()
 
 	VkPhysicalDeviceFeatures deviceFeatures = {};// pPhysicalDevice.GetFeatures();
 
+	// Uploads (and later frame sync) signal completion through timeline semaphores
+	VkPhysicalDeviceVulkan12Features supported12 = {};
+	supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedFeatures = {};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &supported12;
+	vkGetPhysicalDeviceFeatures2(pPhysicalDevice.GetVkNative(), &supportedFeatures);
+	ASSERT(supported12.timelineSemaphore == VK_TRUE, "Device doesn't support timeline semaphores");
+
+	// The bindless heap indexes big partially filled arrays that are written while bound
+	ASSERT(supported12.descriptorIndexing == VK_TRUE &&
+		supported12.runtimeDescriptorArray == VK_TRUE &&
+		supported12.descriptorBindingPartiallyBound == VK_TRUE &&
+		supported12.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+		supported12.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+		supported12.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+		supported12.shaderSampledImageArrayNonUniformIndexing == VK_TRUE &&
+		supported12.shaderStorageBufferArrayNonUniformIndexing == VK_TRUE,
+		"Device doesn't support the descriptor indexing features the bindless heap needs");
+
+	// Lets one compute shader write mips of every storage format
+	deviceFeatures.shaderStorageImageWriteWithoutFormat = supportedFeatures.features.shaderStorageImageWriteWithoutFormat;
+	bStorageImageWriteWithoutFormat = deviceFeatures.shaderStorageImageWriteWithoutFormat == VK_TRUE;
+
+	// Cooked textures are block compressed
+	deviceFeatures.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+	bTextureCompressionBC = deviceFeatures.textureCompressionBC == VK_TRUE;
+
+	VkPhysicalDeviceVulkan12Features features12 = {};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.timelineSemaphore = VK_TRUE;
+	features12.descriptorIndexing = VK_TRUE;
+	features12.runtimeDescriptorArray = VK_TRUE;
+	features12.descriptorBindingPartiallyBound = VK_TRUE;
+	features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
+	// Optional, the render graph falls back to vkCmdPipelineBarrier without it
+	VkPhysicalDeviceSynchronization2Features sync2Features = {};
+	sync2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+	if (pPhysicalDevice.SupportsExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceSynchronization2Features supportedSync2 = {};
+		supportedSync2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+		supportedFeatures.pNext = &supportedSync2;
+		vkGetPhysicalDeviceFeatures2(pPhysicalDevice.GetVkNative(), &supportedFeatures);
+
+		if (supportedSync2.synchronization2 == VK_TRUE)
+		{
+			pArrExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+			sync2Features.synchronization2 = VK_TRUE;
+			sync2Features.pNext = features12.pNext;
+			features12.pNext = &sync2Features;
+		}
+	}
+
+	// Optional too, pipelines and passes use cached VkRenderPass objects without it
+	VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+	if (pPhysicalDevice.SupportsExtension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceDynamicRenderingFeatures supportedDynamicRendering = {};
+		supportedDynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+		supportedFeatures.pNext = &supportedDynamicRendering;
+		vkGetPhysicalDeviceFeatures2(pPhysicalDevice.GetVkNative(), &supportedFeatures);
+
+		if (supportedDynamicRendering.dynamicRendering == VK_TRUE)
+		{
+			pArrExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+			dynamicRenderingFeatures.pNext = features12.pNext;
+			features12.pNext = &dynamicRenderingFeatures;
+		}
+	}
+
+	// Optional, lets the frame pacer wait for a present to hit the screen instead of guessing from the GPU
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	if (pPhysicalDevice.SupportsExtension(VK_KHR_PRESENT_ID_EXTENSION_NAME) && pPhysicalDevice.SupportsExtension(VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		VkPhysicalDevicePresentIdFeaturesKHR supportedPresentId = {};
+		supportedPresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		VkPhysicalDevicePresentWaitFeaturesKHR supportedPresentWait = {};
+		supportedPresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+		supportedPresentId.pNext = &supportedPresentWait;
+		supportedFeatures.pNext = &supportedPresentId;
+		vkGetPhysicalDeviceFeatures2(pPhysicalDevice.GetVkNative(), &supportedFeatures);
+
+		if (supportedPresentId.presentId == VK_TRUE && supportedPresentWait.presentWait == VK_TRUE)
+		{
+			pArrExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+			pArrExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+			presentIdFeatures.presentId = VK_TRUE;
+			presentWaitFeatures.presentWait = VK_TRUE;
+			presentWaitFeatures.pNext = features12.pNext;
+			presentIdFeatures.pNext = &presentWaitFeatures;
+			features12.pNext = &presentIdFeatures;
+		}
+	}
+
 	Instance &instance = Singleton<Instance>::GetInstance();
-	const Vec<const char *> &deviceExtensions = instance.GetDeviceExtensions();
 
+	// Instance extensions (surface, debug utils) are not valid here, the device has its own list
+	const Vec<const char *> &deviceExtensions = pArrExtensions;
+	const Vec<const char *> &deviceLayers = instance.GetDeviceLayers();
 
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	
-	const char *layers[] = {
-		"VK_LAYER_KHRONOS_validation"
-	};
+	deviceCreateInfo.pNext = &features12;
 
-	deviceCreateInfo.enabledLayerCount = 1;
-	deviceCreateInfo.ppEnabledLayerNames = layers;
+	deviceCreateInfo.enabledLayerCount = static_cast<u32>(deviceLayers.size());
+	deviceCreateInfo.ppEnabledLayerNames = deviceLayers.data();
 
-	deviceCreateInfo.queueCreateInfoCount = 2;
+	deviceCreateInfo.queueCreateInfoCount = static_cast<u32>(queueCreateInfos.size());
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-	//deviceCreateInfo.queueCreateInfoCount = static_cast<u32>(queueCreateInfos.size());
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 	deviceCreateInfo.enabledExtensionCount = static_cast<u32>(deviceExtensions.size());
 	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -71,12 +245,60 @@ void Device::Create()
 	}
 	vkGetDeviceQueue(pVkDevice, queueFamilyIndices.graphicsFamily, 0, &pGraphicsQueue);
 	vkGetDeviceQueue(pVkDevice, queueFamilyIndices.presentFamily, 0, &pPresentQueue);
+	vkGetDeviceQueue(pVkDevice, queueFamilyIndices.transferFamily, 0, &pTransferQueue);
 
-	if (pGraphicsQueue == VK_NULL_HANDLE || pPresentQueue == VK_NULL_HANDLE)
+	if (pGraphicsQueue == VK_NULL_HANDLE || pPresentQueue == VK_NULL_HANDLE || pTransferQueue == VK_NULL_HANDLE)
 	{
 		throw runtime_error("Failed to get device queue");
 	}
 
+	if (sync2Features.synchronization2 == VK_TRUE)
+	{
+		fnCmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(vkGetDeviceProcAddr(pVkDevice, "vkCmdPipelineBarrier2KHR"));
+	}
+
+	if (dynamicRenderingFeatures.dynamicRendering == VK_TRUE)
+	{
+		fnCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(pVkDevice, "vkCmdBeginRenderingKHR"));
+		fnCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(pVkDevice, "vkCmdEndRenderingKHR"));
+	}
+
+	if (presentWaitFeatures.presentWait == VK_TRUE)
+	{
+		fnWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(pVkDevice, "vkWaitForPresentKHR"));
+	}
+
+	pGraphicsTimeline = make_shared<GpuTimeline>(*this, pGraphicsQueue);
+	pGraphicsTimeline->Create();
+
+	pAllocator = make_shared<MemoryAllocator>(*this);
+	pAllocator->Create();
+
+	pUploadQueue = make_shared<UploadQueue>(*this);
+	pUploadQueue->Create();
+
+	pDeferredDestroyQueue = make_shared<DeferredDestroyQueue>(*this);
+	pDeferredDestroyQueue->Create();
+
+	pRenderPassCache = make_shared<RenderPassCache>(*this);
+	pRenderPassCache->Create();
+
+	pBindlessHeap = make_shared<BindlessHeap>(*this);
+	pBindlessHeap->Create();
+
+	pDescriptorSetCache = make_shared<DescriptorSetCache>(*this);
+	pDescriptorSetCache->Create();
+
+	pPipelineLayoutCache = make_shared<PipelineLayoutCache>(*this);
+	pPipelineLayoutCache->Create();
+
+	pPipelineCache = make_shared<PipelineCache>(*this, sPipelineCachePath);
+	pPipelineCache->Create();
+
+	pPipelineRegistry = make_shared<PipelineRegistry>(*this);
+
+	pMipGenerator = make_shared<MipGenerator>(*this);
+	pMipGenerator->Create();
 }
 
 void Device::Destroy()
@@ -85,7 +307,7 @@ void Device::Destroy()
 
 bool Device::IsValid() const
 {
-	return false;
+	return pVkDevice != VK_NULL_HANDLE;
 }
 
 const VkDevice &Device::GetVkNative() const
@@ -106,4 +328,218 @@ const VkQueue &Device::GetGraphicsQueue() const
 const VkQueue &Device::GetPresentQueue() const
 {
 	return pPresentQueue;
+}
+
+const VkQueue &Device::GetTransferQueue() const
+{
+	return pTransferQueue;
+}
+
+bool Device::HasDedicatedTransferQueue() const
+{
+	return sQueueFamilyIndices.transferFamily != sQueueFamilyIndices.graphicsFamily;
+}
+
+Vec<u32> Device::GetResourceQueueFamilies() const
+{
+	Vec<u32> families = { sQueueFamilyIndices.graphicsFamily };
+	if (HasDedicatedTransferQueue())
+	{
+		families.push_back(sQueueFamilyIndices.transferFamily);
+	}
+	return families;
+}
+
+const QueueFamilyIndices &Device::GetQueueFamilyIndices() const
+{
+	return sQueueFamilyIndices;
+}
+
+bool Device::HasSynchronization2() const
+{
+	return fnCmdPipelineBarrier2 != nullptr;
+}
+
+void Device::CmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo &dependencyInfo) const
+{
+	fnCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
+
+bool Device::HasDynamicRendering() const
+{
+	return fnCmdBeginRendering != nullptr;
+}
+
+void Device::CmdBeginRendering(VkCommandBuffer commandBuffer, const RenderingDesc &desc) const
+{
+	VkRect2D renderArea = { { 0, 0 }, desc.extent };
+
+	if (HasDynamicRendering())
+	{
+		VkRenderingAttachmentInfo colorAttachments[RenderingDesc::MAX_COLOR_ATTACHMENTS] = {};
+		for (u32 i = 0; i < desc.colorAttachmentCount; i++)
+		{
+			const RenderingAttachment &attachment = desc.colorAttachments[i];
+			colorAttachments[i].sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colorAttachments[i].imageView = attachment.view;
+			colorAttachments[i].imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachments[i].loadOp = attachment.loadOp;
+			colorAttachments[i].storeOp = attachment.storeOp;
+			colorAttachments[i].clearValue = attachment.clearValue;
+		}
+
+		VkRenderingAttachmentInfo depthAttachment = {};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = desc.depthAttachment.view;
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.loadOp = desc.depthAttachment.loadOp;
+		depthAttachment.storeOp = desc.depthAttachment.storeOp;
+		depthAttachment.clearValue = desc.depthAttachment.clearValue;
+
+		bool bDepth = desc.HasDepthAttachment();
+		bool bStencil = bDepth && (Image::GetAspectMask(desc.depthAttachment.format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+		VkRenderingInfo renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea = renderArea;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = desc.colorAttachmentCount;
+		renderingInfo.pColorAttachments = colorAttachments;
+		renderingInfo.pDepthAttachment = bDepth ? &depthAttachment : nullptr;
+		renderingInfo.pStencilAttachment = bStencil ? &depthAttachment : nullptr;
+
+		fnCmdBeginRendering(commandBuffer, &renderingInfo);
+		return;
+	}
+
+	VkClearValue clearValues[RenderingDesc::MAX_COLOR_ATTACHMENTS + 1] = {};
+	for (u32 i = 0; i < desc.colorAttachmentCount; i++)
+	{
+		clearValues[i] = desc.colorAttachments[i].clearValue;
+	}
+	clearValues[desc.colorAttachmentCount] = desc.depthAttachment.clearValue;
+
+	VkRenderPass renderPass = pRenderPassCache->GetRenderPass(desc);
+
+	VkRenderPassBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	beginInfo.renderPass = renderPass;
+	beginInfo.framebuffer = pRenderPassCache->GetFramebuffer(renderPass, desc);
+	beginInfo.renderArea = renderArea;
+	beginInfo.clearValueCount = desc.colorAttachmentCount + (desc.HasDepthAttachment() ? 1 : 0);
+	beginInfo.pClearValues = clearValues;
+
+	vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void Device::CmdEndRendering(VkCommandBuffer commandBuffer) const
+{
+	if (HasDynamicRendering())
+	{
+		fnCmdEndRendering(commandBuffer);
+	}
+	else
+	{
+		vkCmdEndRenderPass(commandBuffer);
+	}
+}
+
+bool Device::HasPresentWait() const
+{
+	return fnWaitForPresent != nullptr;
+}
+
+VkResult Device::WaitForPresent(VkSwapchainKHR swapChain, u64 presentId, u64 timeout) const
+{
+	return fnWaitForPresent(pVkDevice, swapChain, presentId, timeout);
+}
+
+bool Device::HasStorageImageWriteWithoutFormat() const
+{
+	return bStorageImageWriteWithoutFormat;
+}
+
+bool Device::HasTextureCompressionBC() const
+{
+	return bTextureCompressionBC;
+}
+
+MemoryAllocator &Device::GetAllocator() const
+{
+	return *pAllocator;
+}
+
+GpuTimeline &Device::GetGraphicsTimeline() const
+{
+	return *pGraphicsTimeline;
+}
+
+UploadQueue &Device::GetUploadQueue() const
+{
+	return *pUploadQueue;
+}
+
+DeferredDestroyQueue &Device::GetDeferredDestroyQueue() const
+{
+	return *pDeferredDestroyQueue;
+}
+
+RenderPassCache &Device::GetRenderPassCache() const
+{
+	return *pRenderPassCache;
+}
+
+BindlessHeap &Device::GetBindlessHeap() const
+{
+	return *pBindlessHeap;
+}
+
+DescriptorSetCache &Device::GetDescriptorSetCache() const
+{
+	return *pDescriptorSetCache;
+}
+
+PipelineLayoutCache &Device::GetPipelineLayoutCache() const
+{
+	return *pPipelineLayoutCache;
+}
+
+PipelineCache &Device::GetPipelineCache() const
+{
+	return *pPipelineCache;
+}
+
+PipelineRegistry &Device::GetPipelineRegistry() const
+{
+	return *pPipelineRegistry;
+}
+
+MipGenerator &Device::GetMipGenerator() const
+{
+	return *pMipGenerator;
+}
+
+void Device::SetPipelineCachePath(const string &path)
+{
+	sPipelineCachePath = path;
+}
+
+void Device::WaitIdle() const
+{
+	if (pVkDevice != VK_NULL_HANDLE)
+	{
+		VK_CHECK_RESULT(vkDeviceWaitIdle(pVkDevice));
+	}
+}
+
+void Device::Submit(VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence)
+{
+	lock_guard<mutex> lock(mQueueLock);
+	VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, fence));
+}
+
+VkResult Device::Present(const VkPresentInfoKHR &presentInfo)
+{
+	lock_guard<mutex> lock(mQueueLock);
+	return vkQueuePresentKHR(pPresentQueue, &presentInfo);
 }
\ No newline at end of file
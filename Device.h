@@ -1,6 +1,18 @@
 #pragma once
 
 class PhysicalDevice;
+class MemoryAllocator;
+class PipelineCache;
+class PipelineRegistry;
+class UploadQueue;
+class GpuTimeline;
+class DeferredDestroyQueue;
+class RenderPassCache;
+class BindlessHeap;
+class DescriptorSetCache;
+class PipelineLayoutCache;
+class MipGenerator;
+struct RenderingDesc;
 
 class Device : public IVkResource, public NonCopyable
 {
@@ -8,10 +20,45 @@ private:
 	VkDevice pVkDevice;
 	VkQueue pGraphicsQueue;
 	VkQueue pPresentQueue;
+	VkQueue pTransferQueue;
+
+	// Loaded when VK_KHR_synchronization2 is enabled
+	PFN_vkCmdPipelineBarrier2KHR fnCmdPipelineBarrier2;
+
+	// Loaded when VK_KHR_dynamic_rendering is enabled, render passes come from the cache otherwise
+	PFN_vkCmdBeginRenderingKHR fnCmdBeginRendering;
+	PFN_vkCmdEndRenderingKHR fnCmdEndRendering;
+
+	// Loaded when VK_KHR_present_id and VK_KHR_present_wait are both enabled
+	PFN_vkWaitForPresentKHR fnWaitForPresent;
+
+	// shaderStorageImageWriteWithoutFormat, enabled when supported
+	bool bStorageImageWriteWithoutFormat;
+
+	// textureCompressionBC, enabled when supported
+	bool bTextureCompressionBC;
 
 	PhysicalDevice &pPhysicalDevice;
 	const QueueFamilyIndices &sQueueFamilyIndices;
 
+	Vec<const char *> pArrExtensions;
+
+	// Queues are externally synchronized, every submit and present goes through this
+	mutex mQueueLock;
+
+	Ref<GpuTimeline> pGraphicsTimeline;
+	Ref<MemoryAllocator> pAllocator;
+	Ref<UploadQueue> pUploadQueue;
+	Ref<DeferredDestroyQueue> pDeferredDestroyQueue;
+	Ref<RenderPassCache> pRenderPassCache;
+	Ref<BindlessHeap> pBindlessHeap;
+	Ref<DescriptorSetCache> pDescriptorSetCache;
+	Ref<PipelineLayoutCache> pPipelineLayoutCache;
+	Ref<PipelineCache> pPipelineCache;
+	string sPipelineCachePath;
+	Ref<PipelineRegistry> pPipelineRegistry;
+	Ref<MipGenerator> pMipGenerator;
+
 public:
 
 	Device(PhysicalDevice &physicalDevice);
@@ -25,4 +72,62 @@ public:
 	const PhysicalDevice &GetPhysicalDevice() const;
 	const VkQueue &GetGraphicsQueue() const;
 	const VkQueue &GetPresentQueue() const;
+	const VkQueue &GetTransferQueue() const;
+
+	// True if uploads run on their own queue family instead of the graphics one
+	bool HasDedicatedTransferQueue() const;
+
+	// Families a buffer or image may be used from, more than one means concurrent sharing
+	Vec<u32> GetResourceQueueFamilies() const;
+	const QueueFamilyIndices &GetQueueFamilyIndices() const;
+
+	// VK_KHR_synchronization2, CmdPipelineBarrier2 is only valid if this is true
+	bool HasSynchronization2() const;
+	void CmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo &dependencyInfo) const;
+
+	// VK_KHR_dynamic_rendering. Without it CmdBeginRendering goes through a cached render pass and framebuffer.
+	bool HasDynamicRendering() const;
+	void CmdBeginRendering(VkCommandBuffer commandBuffer, const RenderingDesc &desc) const;
+	void CmdEndRendering(VkCommandBuffer commandBuffer) const;
+
+	// VK_KHR_present_wait, presents can carry an id that WaitForPresent blocks on until it's on screen
+	bool HasPresentWait() const;
+	VkResult WaitForPresent(VkSwapchainKHR swapChain, u64 presentId, u64 timeout) const;
+
+	// Storage images can be written from shaders that don't declare their format
+	bool HasStorageImageWriteWithoutFormat() const;
+	bool HasTextureCompressionBC() const;
+	MemoryAllocator &GetAllocator() const;
+
+	// Signaled by every graphics queue submission
+	GpuTimeline &GetGraphicsTimeline() const;
+	UploadQueue &GetUploadQueue() const;
+
+	// Release objects here instead of destroying them, they go once the GPU stopped using them
+	DeferredDestroyQueue &GetDeferredDestroyQueue() const;
+	RenderPassCache &GetRenderPassCache() const;
+
+	// The global descriptor set every pipeline without its own layout binds as set 0
+	BindlessHeap &GetBindlessHeap() const;
+
+	// Sets that are written once and never change, shared by everyone asking for the same contents
+	DescriptorSetCache &GetDescriptorSetCache() const;
+
+	// Layouts derived from shader reflection, shared by every pipeline declaring the same bindings
+	PipelineLayoutCache &GetPipelineLayoutCache() const;
+	PipelineCache &GetPipelineCache() const;
+	PipelineRegistry &GetPipelineRegistry() const;
+
+	// Fills mip chains of uploaded images on the graphics queue
+	MipGenerator &GetMipGenerator() const;
+
+	// Where the pipeline cache is loaded from and saved to, set before Create()
+	void SetPipelineCachePath(const string &path);
+
+	// Block until all queues on the device are idle
+	void WaitIdle() const;
+
+	// vkQueueSubmit and vkQueuePresentKHR, safe to call from any thread
+	void Submit(VkQueue queue, const VkSubmitInfo &submitInfo, VkFence fence = VK_NULL_HANDLE);
+	VkResult Present(const VkPresentInfoKHR &presentInfo);
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "FrameContext.h"
+#include "Device.h"
+#include "GpuTimeline.h"
+#include "ThreadCommandPool.h"
+#include "DescriptorAllocator.h"
+
+FrameContext::FrameContext(Device &device, u32 threadPoolCount) :
+	pCommandPool(VK_NULL_HANDLE),
+	pCommandBuffer(VK_NULL_HANDLE),
+	pImageAvailable(VK_NULL_HANDLE),
+	pArrThreadPools(),
+	iThreadPoolCount(max(threadPoolCount, 1u)),
+	pDescriptorAllocator(),
+	iSubmitValue(0),
+	pDevice(device)
+{
+}
+
+FrameContext::~FrameContext()
+{
+	if (pCommandPool != VK_NULL_HANDLE)
+	{
+		Destroy();
+	}
+}
+
+void FrameContext::Create()
+{
+	VkDevice vkDevice = pDevice.GetVkNative();
+
+	// Transient because the pool is reset every time this frame comes around again
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = pDevice.GetQueueFamilyIndices().graphicsFamily;
+
+	VK_CHECK_RESULT(vkCreateCommandPool(vkDevice, &commandPoolCreateInfo, nullptr, &pCommandPool));
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.commandPool = pCommandPool;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(vkDevice, &commandBufferAllocateInfo, &pCommandBuffer));
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VK_CHECK_RESULT(vkCreateSemaphore(vkDevice, &semaphoreCreateInfo, nullptr, &pImageAvailable));
+
+	pArrThreadPools.reserve(iThreadPoolCount);
+	for (u32 i = 0; i < iThreadPoolCount; i++)
+	{
+		Ref<ThreadCommandPool> pThreadPool = make_shared<ThreadCommandPool>(pDevice, pDevice.GetQueueFamilyIndices().graphicsFamily);
+		pThreadPool->Create();
+		pArrThreadPools.push_back(pThreadPool);
+	}
+
+	pDescriptorAllocator = make_shared<DescriptorAllocator>(pDevice);
+	pDescriptorAllocator->Create();
+
+	// Value 0 is always reached, so the first Wait() on a fresh frame returns immediately
+	iSubmitValue = 0;
+}
+
+void FrameContext::Destroy()
+{
+	VkDevice vkDevice = pDevice.GetVkNative();
+
+	pArrThreadPools.clear();
+	pDescriptorAllocator.reset();
+
+	if (pImageAvailable != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(vkDevice, pImageAvailable, nullptr);
+		pImageAvailable = VK_NULL_HANDLE;
+	}
+
+	// Freeing the pool frees the command buffer with it
+	if (pCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(vkDevice, pCommandPool, nullptr);
+		pCommandPool = VK_NULL_HANDLE;
+		pCommandBuffer = VK_NULL_HANDLE;
+	}
+}
+
+bool FrameContext::IsValid() const
+{
+	return pCommandPool != VK_NULL_HANDLE;
+}
+
+void FrameContext::Wait() const
+{
+	pDevice.GetGraphicsTimeline().Wait(iSubmitValue);
+}
+
+void FrameContext::Reset()
+{
+	VK_CHECK_RESULT(vkResetCommandPool(pDevice.GetVkNative(), pCommandPool, 0));
+
+	for (const Ref<ThreadCommandPool> &pThreadPool : pArrThreadPools)
+	{
+		pThreadPool->Reset();
+	}
+
+	pDescriptorAllocator->Reset();
+}
+
+VkCommandBuffer FrameContext::GetCommandBuffer() const
+{
+	return pCommandBuffer;
+}
+
+VkSemaphore FrameContext::GetImageAvailableSemaphore() const
+{
+	return pImageAvailable;
+}
+
+ThreadCommandPool &FrameContext::GetThreadPool(u32 threadIndex) const
+{
+	return *pArrThreadPools[threadIndex];
+}
+
+u32 FrameContext::GetThreadPoolCount() const
+{
+	return iThreadPoolCount;
+}
+
+DescriptorAllocator &FrameContext::GetDescriptorAllocator() const
+{
+	return *pDescriptorAllocator;
+}
+
+void FrameContext::SetSubmitValue(u64 value)
+{
+	iSubmitValue = value;
+}
+
+u64 FrameContext::GetSubmitValue() const
+{
+	return iSubmitValue;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+class Device;
+class ThreadCommandPool;
+class DescriptorAllocator;
+
+// Everything a single frame in flight owns.
+// While the GPU executes one frame context the CPU records into another,
+// so none of these objects are shared between frames.
+class FrameContext : public IVkResource, public NonCopyable
+{
+private:
+	VkCommandPool pCommandPool;
+	VkCommandBuffer pCommandBuffer;
+	VkSemaphore pImageAvailable;
+
+	// One pool per recording thread, index 0 is the thread that submits
+	Vec<Ref<ThreadCommandPool>> pArrThreadPools;
+	u32 iThreadPoolCount;
+
+	// Sets that only live for this frame, reset in bulk along with the command pools
+	Ref<DescriptorAllocator> pDescriptorAllocator;
+
+	// Graphics timeline value of this frame's last submission
+	u64 iSubmitValue;
+
+	Device &pDevice;
+
+public:
+
+	FrameContext(Device &device, u32 threadPoolCount = 1);
+	~FrameContext();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Block until the GPU has finished the last submission of this frame
+	void Wait() const;
+
+	// Recycle the command pool, every thread pool and the descriptor pools, only valid after Wait()
+	void Reset();
+
+	VkCommandBuffer GetCommandBuffer() const;
+	VkSemaphore GetImageAvailableSemaphore() const;
+
+	// Only ever touched by the recording thread with that index
+	ThreadCommandPool &GetThreadPool(u32 threadIndex) const;
+	u32 GetThreadPoolCount() const;
+
+	DescriptorAllocator &GetDescriptorAllocator() const;
+
+	void SetSubmitValue(u64 value);
+	u64 GetSubmitValue() const;
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "FramePacer.h"
+#include "Device.h"
+#include "SwapChain.h"
+#include "GpuTimeline.h"
+
+FramePacer::FramePacer(Device &device, SwapChain &swapChain) :
+	pDevice(device),
+	pSwapChain(swapChain),
+	pArrPresents(),
+	iNextPresentId(1),
+	iPresentIdStorage(0),
+	sPresentId({}),
+	fThrottleMs(0.0),
+	iThrottledFrames(0)
+{
+}
+
+FramePacer::~FramePacer()
+{
+	Destroy();
+}
+
+void FramePacer::Create()
+{
+}
+
+void FramePacer::Destroy()
+{
+	pArrPresents.clear();
+}
+
+bool FramePacer::IsValid() const
+{
+	return pSwapChain.IsValid();
+}
+
+VkPresentModeKHR FramePacer::ChoosePresentMode(PresentPolicy policy, const Vec<VkPresentModeKHR> &presentModes)
+{
+	Vec<VkPresentModeKHR> preferred;
+	switch (policy)
+	{
+	case PresentPolicy::LowLatency:
+		// Mailbox swaps in the newest image at vblank, the throttle keeps it from rendering frames nobody sees
+		preferred = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR };
+		break;
+	case PresentPolicy::VsyncStable:
+		// A late frame tears instead of waiting for the next vblank and halving the frame rate
+		preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+		break;
+	case PresentPolicy::MaxThroughput:
+		preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR };
+		break;
+	}
+
+	for (VkPresentModeKHR presentMode : preferred)
+	{
+		if (find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end())
+		{
+			return presentMode;
+		}
+	}
+
+	// The only one every surface has to support
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+u32 FramePacer::ChooseImageCount(PresentPolicy policy, VkPresentModeKHR presentMode, const VkSurfaceCapabilitiesKHR &capabilities)
+{
+	u32 imageCount = capabilities.minImageCount + 1;
+	switch (policy)
+	{
+	case PresentPolicy::LowLatency:
+		// Every extra image in a FIFO queue is a frame of latency, mailbox needs a spare to swap in
+		imageCount = presentMode == VK_PRESENT_MODE_MAILBOX_KHR ? capabilities.minImageCount + 1 : capabilities.minImageCount;
+		break;
+	case PresentPolicy::VsyncStable:
+		// Triple buffering, so one slow frame doesn't stall the queue
+		imageCount = max(capabilities.minImageCount + 1, 3u);
+		break;
+	case PresentPolicy::MaxThroughput:
+		break;
+	}
+
+	imageCount = max(imageCount, 2u);
+	if (capabilities.maxImageCount > 0)
+	{
+		imageCount = min(imageCount, capabilities.maxImageCount);
+	}
+	return imageCount;
+}
+
+u32 FramePacer::GetMaxQueuedFrames(PresentPolicy policy)
+{
+	switch (policy)
+	{
+	case PresentPolicy::LowLatency:
+		return 1;
+	case PresentPolicy::VsyncStable:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+void FramePacer::Throttle()
+{
+	u32 maxQueued = GetMaxQueuedFrames(pSwapChain.GetPresentPolicy());
+	if (maxQueued == 0 || pArrPresents.size() < maxQueued)
+	{
+		return;
+	}
+
+	// The present that has to be done before another frame may start, everything older is done by then too
+	size_t index = pArrPresents.size() - maxQueued;
+	const PresentRecord &record = pArrPresents[index];
+
+	auto tStart = chrono::steady_clock::now();
+	if (UsesPresentWait())
+	{
+		// Out of date and lost surfaces show up again on the next acquire, a timeout just lets the frame through
+		VkResult result = pDevice.WaitForPresent(pSwapChain.GetVkNative(), record.iPresentId, THROTTLE_TIMEOUT_NS);
+		if (result != VK_SUCCESS && result != VK_TIMEOUT && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			throw runtime_error("Failed to wait for present: " + to_string(result));
+		}
+	}
+	else if (!pDevice.GetGraphicsTimeline().IsComplete(record.iTimelineValue))
+	{
+		pDevice.GetGraphicsTimeline().Wait(record.iTimelineValue, THROTTLE_TIMEOUT_NS);
+	}
+	fThrottleMs += chrono::duration<f64, milli>(chrono::steady_clock::now() - tStart).count();
+	iThrottledFrames++;
+
+	pArrPresents.erase(pArrPresents.begin(), pArrPresents.begin() + index + 1);
+}
+
+void FramePacer::OnPresent(VkPresentInfoKHR &presentInfo, u64 timelineValue)
+{
+	u64 presentId = iNextPresentId++;
+	if (UsesPresentWait())
+	{
+		iPresentIdStorage = presentId;
+
+		sPresentId = {};
+		sPresentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+		sPresentId.pNext = presentInfo.pNext;
+		sPresentId.swapchainCount = 1;
+		sPresentId.pPresentIds = &iPresentIdStorage;
+		presentInfo.pNext = &sPresentId;
+	}
+
+	pArrPresents.push_back({ presentId, timelineValue });
+}
+
+void FramePacer::OnSwapChainRecreated()
+{
+	pArrPresents.clear();
+}
+
+bool FramePacer::UsesPresentWait() const
+{
+	return pDevice.HasPresentWait();
+}
+
+f64 FramePacer::GetAverageThrottleMs() const
+{
+	return iThrottledFrames > 0 ? fThrottleMs / static_cast<f64>(iThrottledFrames) : 0.0;
+}
+
+u64 FramePacer::GetThrottledFrameCount() const
+{
+	return iThrottledFrames;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+class Device;
+class SwapChain;
+
+// What the swap chain and the frame pacer optimize for
+enum class PresentPolicy
+{
+	LowLatency,		// No tearing, at most one frame queued for display, the CPU waits before it samples input
+	VsyncStable,	// FIFO, a couple of frames queued to ride out hitches
+	MaxThroughput,	// Render as fast as possible, tearing allowed
+};
+
+// Picks present mode and image count for a policy and keeps the CPU from running too far ahead
+// of the display. With VK_KHR_present_id and VK_KHR_present_wait every present gets an id and
+// Throttle() waits until the present that many frames back was actually shown, which bounds the
+// time from sampling input to the image hitting the screen. Without them it falls back to waiting
+// on the graphics timeline, which only bounds how far ahead of the GPU the CPU gets.
+class FramePacer : public IVkResource, public NonCopyable
+{
+public:
+
+	// Longest Throttle() blocks, so a present that never completes (e.g. a hidden window) can't hang the loop
+	static constexpr u64 THROTTLE_TIMEOUT_NS = 100'000'000;
+
+private:
+
+	struct PresentRecord
+	{
+		u64 iPresentId;
+		u64 iTimelineValue;
+	};
+
+	Device &pDevice;
+	SwapChain &pSwapChain;
+
+	// Presents since the last swap chain change, oldest first
+	deque<PresentRecord> pArrPresents;
+
+	// Present ids only have to go up per swap chain, but never resetting them is simpler
+	u64 iNextPresentId;
+	u64 iPresentIdStorage;
+	VkPresentIdKHR sPresentId;
+
+	f64 fThrottleMs;
+	u64 iThrottledFrames;
+
+public:
+
+	FramePacer(Device &device, SwapChain &swapChain);
+	~FramePacer();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	static VkPresentModeKHR ChoosePresentMode(PresentPolicy policy, const Vec<VkPresentModeKHR> &presentModes);
+	static u32 ChooseImageCount(PresentPolicy policy, VkPresentModeKHR presentMode, const VkSurfaceCapabilitiesKHR &capabilities);
+
+	// Frames that may be queued for display before Throttle() blocks, 0 for no limit
+	static u32 GetMaxQueuedFrames(PresentPolicy policy);
+
+	// Call before acquiring, blocks while too many frames are waiting to be shown
+	void Throttle();
+
+	// Tag a present that signals timelineValue on the graphics timeline. Chains a present id into
+	// presentInfo when present wait is available, it has to stay alive until the present went out.
+	void OnPresent(VkPresentInfoKHR &presentInfo, u64 timelineValue);
+
+	// Old presents can't be waited on through a new swap chain
+	void OnSwapChainRecreated();
+
+	bool UsesPresentWait() const;
+
+	// Average time Throttle() blocked, over the frames it blocked at all
+	f64 GetAverageThrottleMs() const;
+	u64 GetThrottledFrameCount() const;
+};
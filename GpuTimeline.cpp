@@ -0,0 +1,207 @@
+#pragma once
+
+#include "GpuTimeline.h"
+#include "Device.h"
+
+GpuTimeline::GpuTimeline(Device &device, VkQueue queue) :
+	pVkSemaphore(VK_NULL_HANDLE),
+	pDevice(device),
+	pQueue(queue),
+	iSubmittedValue(0),
+	iCompletedValue(0),
+	pArrCallbacks()
+{
+}
+
+GpuTimeline::~GpuTimeline()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void GpuTimeline::Create()
+{
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {};
+	semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+	VK_CHECK_RESULT(vkCreateSemaphore(pDevice.GetVkNative(), &semaphoreCreateInfo, nullptr, &pVkSemaphore));
+}
+
+void GpuTimeline::Destroy()
+{
+	if (pVkSemaphore == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	WaitIdle();
+	Poll();
+
+	vkDestroySemaphore(pDevice.GetVkNative(), pVkSemaphore, nullptr);
+	pVkSemaphore = VK_NULL_HANDLE;
+}
+
+bool GpuTimeline::IsValid() const
+{
+	return pVkSemaphore != VK_NULL_HANDLE;
+}
+
+VkSemaphore GpuTimeline::GetVkNative() const
+{
+	return pVkSemaphore;
+}
+
+u64 GpuTimeline::Submit(const Vec<VkCommandBuffer> &commandBuffers, const Vec<SemaphoreWait> &waits, const Vec<VkSemaphore> &signals)
+{
+	Vec<VkSemaphore> waitSemaphores;
+	Vec<u64> waitValues;
+	Vec<VkPipelineStageFlags> waitStages;
+	for (const auto &wait : waits)
+	{
+		waitSemaphores.push_back(wait.semaphore);
+		waitValues.push_back(wait.value);
+		waitStages.push_back(wait.stage);
+	}
+
+	// Our own semaphore goes last, the binary ones ignore their value
+	Vec<VkSemaphore> signalSemaphores = signals;
+	signalSemaphores.push_back(pVkSemaphore);
+	Vec<u64> signalValues(signalSemaphores.size(), 0);
+
+	lock_guard<mutex> lock(mSubmitLock);
+
+	u64 value = iSubmittedValue.load() + 1;
+	signalValues.back() = value;
+
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.waitSemaphoreValueCount = static_cast<u32>(waitValues.size());
+	timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineSubmitInfo.signalSemaphoreValueCount = static_cast<u32>(signalValues.size());
+	timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineSubmitInfo;
+	submitInfo.waitSemaphoreCount = static_cast<u32>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = static_cast<u32>(commandBuffers.size());
+	submitInfo.pCommandBuffers = commandBuffers.data();
+	submitInfo.signalSemaphoreCount = static_cast<u32>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	pDevice.Submit(pQueue, submitInfo);
+
+	iSubmittedValue.store(value);
+	return value;
+}
+
+bool GpuTimeline::IsComplete(u64 value) const
+{
+	if (iCompletedValue.load() >= value)
+	{
+		return true;
+	}
+
+	return GetCompletedValue() >= value;
+}
+
+bool GpuTimeline::Wait(u64 value, u64 timeout) const
+{
+	if (IsComplete(value))
+	{
+		return true;
+	}
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &pVkSemaphore;
+	waitInfo.pValues = &value;
+
+	VkResult result = vkWaitSemaphores(pDevice.GetVkNative(), &waitInfo, timeout);
+	if (result == VK_TIMEOUT)
+	{
+		return false;
+	}
+	VK_CHECK_RESULT(result);
+
+	// Someone else may have seen a later value meanwhile, never move backwards
+	u64 seen = iCompletedValue.load();
+	while (seen < value && !iCompletedValue.compare_exchange_weak(seen, value))
+	{
+	}
+	return true;
+}
+
+void GpuTimeline::WaitIdle() const
+{
+	Wait(iSubmittedValue.load());
+}
+
+u64 GpuTimeline::GetSubmittedValue() const
+{
+	return iSubmittedValue.load();
+}
+
+u64 GpuTimeline::GetCompletedValue() const
+{
+	u64 value = 0;
+	VK_CHECK_RESULT(vkGetSemaphoreCounterValue(pDevice.GetVkNative(), pVkSemaphore, &value));
+
+	u64 seen = iCompletedValue.load();
+	while (seen < value && !iCompletedValue.compare_exchange_weak(seen, value))
+	{
+	}
+	return max(seen, value);
+}
+
+void GpuTimeline::OnComplete(u64 value, Func<void()> fnCallback)
+{
+	lock_guard<mutex> lock(mCallbackLock);
+
+	// Kept sorted so Poll() only ever looks at the front
+	auto it = pArrCallbacks.end();
+	while (it != pArrCallbacks.begin() && prev(it)->iValue > value)
+	{
+		--it;
+	}
+	pArrCallbacks.insert(it, { value, move(fnCallback) });
+}
+
+u32 GpuTimeline::Poll()
+{
+	u64 completed = GetCompletedValue();
+
+	// Callbacks run outside the lock so they can park new callbacks
+	Vec<Func<void()>> ready;
+	{
+		lock_guard<mutex> lock(mCallbackLock);
+		while (!pArrCallbacks.empty() && pArrCallbacks.front().iValue <= completed)
+		{
+			ready.push_back(move(pArrCallbacks.front().fnCallback));
+			pArrCallbacks.pop_front();
+		}
+	}
+
+	for (auto &fnCallback : ready)
+	{
+		fnCallback();
+	}
+
+	return static_cast<u32>(ready.size());
+}
+
+VkQueue GpuTimeline::GetQueue() const
+{
+	return pQueue;
+}
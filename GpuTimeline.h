@@ -0,0 +1,76 @@
+#pragma once
+
+class Device;
+
+// A semaphore to wait on in a submission, the value is ignored for binary semaphores
+struct SemaphoreWait
+{
+	VkSemaphore semaphore = VK_NULL_HANDLE;
+	u64 value = 0;
+	VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+};
+
+// One timeline semaphore for one queue. Every submission through Submit() signals the next value,
+// so "has the GPU got past submission X" is a single integer compare against the completed value.
+// Callbacks can be parked on a value and run from Poll() once the GPU gets there.
+class GpuTimeline : public IVkResource, public NonCopyable
+{
+private:
+
+	struct Callback
+	{
+		u64 iValue;
+		Func<void()> fnCallback;
+	};
+
+	VkSemaphore pVkSemaphore;
+	Device &pDevice;
+	VkQueue pQueue;
+
+	// Last value handed to a submission and the last value the GPU was seen to reach
+	atomic<u64> iSubmittedValue;
+	mutable atomic<u64> iCompletedValue;
+
+	// Values have to reach the queue in order, so reserving one and submitting happen under one lock
+	mutex mSubmitLock;
+
+	deque<Callback> pArrCallbacks;
+	mutex mCallbackLock;
+
+public:
+
+	GpuTimeline(Device &device, VkQueue queue);
+	~GpuTimeline();
+
+public:
+
+	void Create() override;
+
+	// Waits for everything submitted and runs the callbacks that are left
+	void Destroy() override;
+	bool IsValid() const override;
+	VkSemaphore GetVkNative() const;
+
+public:
+
+	// Submit and signal the next value, which is returned. Binary semaphores in signals are signaled as well.
+	u64 Submit(const Vec<VkCommandBuffer> &commandBuffers, const Vec<SemaphoreWait> &waits = {}, const Vec<VkSemaphore> &signals = {});
+
+	// Cheap check against the last value seen, only asks the driver if that isn't far enough
+	bool IsComplete(u64 value) const;
+
+	// Returns false on timeout
+	bool Wait(u64 value, u64 timeout = UINT64_MAX) const;
+	void WaitIdle() const;
+
+	u64 GetSubmittedValue() const;
+	u64 GetCompletedValue() const;
+
+	// Run fnCallback once the GPU has reached value, from the next Poll() after that
+	void OnComplete(u64 value, Func<void()> fnCallback);
+
+	// Run every callback whose value was reached, returns how many ran
+	u32 Poll();
+
+	VkQueue GetQueue() const;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+// 64-bit FNV-1a. Stable across runs and platforms, so hashes can be written to disk.
+constexpr u64 HASH_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr u64 HASH_PRIME = 0x100000001b3ull;
+
+inline u64 Hash64(const void *pData, size_t size, u64 seed = HASH_OFFSET_BASIS)
+{
+	const u8 *pBytes = static_cast<const u8 *>(pData);
+	u64 hash = seed;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= HASH_PRIME;
+	}
+	return hash;
+}
+
+inline u64 Hash64(const string &str, u64 seed = HASH_OFFSET_BASIS)
+{
+	return Hash64(str.data(), str.size(), seed);
+}
+
+// Feed values in field by field, so struct padding never ends up in the hash
+class Hasher
+{
+private:
+	u64 iHash;
+
+public:
+	Hasher(u64 seed = HASH_OFFSET_BASIS) :
+		iHash(seed)
+	{
+	}
+
+	template <typename T>
+	Hasher &Add(const T &value)
+	{
+		static_assert(is_trivially_copyable_v<T>, "Only plain values can be hashed directly");
+		iHash = Hash64(&value, sizeof(T), iHash);
+		return *this;
+	}
+
+	Hasher &AddBytes(const void *pData, size_t size)
+	{
+		iHash = Hash64(pData, size, iHash);
+		return *this;
+	}
+
+	u64 Get() const
+	{
+		return iHash;
+	}
+};
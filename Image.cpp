@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Image.h"
+#include "Device.h"
+#include "DeferredDestroyQueue.h"
+
+Image::Image(Device &device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, u32 mipLevels, u32 arrayLayers) :
+	pVkImage(VK_NULL_HANDLE),
+	pVkImageView(VK_NULL_HANDLE),
+	sAllocation(),
+	pDevice(device),
+	sExtent(extent),
+	eFormat(format),
+	eUsage(usage),
+	iMipLevels(mipLevels),
+	iArrayLayers(arrayLayers)
+{
+}
+
+Image::~Image()
+{
+	if (pVkImage != VK_NULL_HANDLE)
+	{
+		Destroy();
+	}
+}
+
+void Image::Create()
+{
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = eFormat;
+	imageCreateInfo.extent = { sExtent.width, sExtent.height, 1 };
+	imageCreateInfo.mipLevels = iMipLevels;
+	imageCreateInfo.arrayLayers = iArrayLayers;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = eUsage;
+	// Written by the transfer queue and read by the graphics queue, without ownership transfers
+	Vec<u32> queueFamilies = pDevice.GetResourceQueueFamilies();
+	imageCreateInfo.sharingMode = queueFamilies.size() > 1 ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.queueFamilyIndexCount = queueFamilies.size() > 1 ? static_cast<u32>(queueFamilies.size()) : 0;
+	imageCreateInfo.pQueueFamilyIndices = queueFamilies.size() > 1 ? queueFamilies.data() : nullptr;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VK_CHECK_RESULT(vkCreateImage(pDevice.GetVkNative(), &imageCreateInfo, nullptr, &pVkImage));
+
+	sAllocation = pDevice.GetAllocator().AllocateForImage(pVkImage, MemoryUsage::GpuOnly);
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = pVkImage;
+	viewCreateInfo.viewType = iArrayLayers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = eFormat;
+	viewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+	viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+	viewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+	viewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	viewCreateInfo.subresourceRange.aspectMask = GetAspectMask();
+	viewCreateInfo.subresourceRange.baseMipLevel = 0;
+	viewCreateInfo.subresourceRange.levelCount = iMipLevels;
+	viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	viewCreateInfo.subresourceRange.layerCount = iArrayLayers;
+
+	VK_CHECK_RESULT(vkCreateImageView(pDevice.GetVkNative(), &viewCreateInfo, nullptr, &pVkImageView));
+}
+
+void Image::Destroy()
+{
+	if (pVkImageView != VK_NULL_HANDLE)
+	{
+		pDevice.GetDeferredDestroyQueue().DestroyImageView(pVkImageView);
+		pVkImageView = VK_NULL_HANDLE;
+	}
+
+	// The memory goes back together with the image once the GPU is done with it
+	if (pVkImage != VK_NULL_HANDLE)
+	{
+		pDevice.GetDeferredDestroyQueue().DestroyImage(pVkImage, sAllocation);
+		pVkImage = VK_NULL_HANDLE;
+	}
+
+	pDevice.GetAllocator().Free(sAllocation);
+}
+
+bool Image::IsValid() const
+{
+	return pVkImage != VK_NULL_HANDLE;
+}
+
+VkImage Image::GetVkNative() const
+{
+	return pVkImage;
+}
+
+VkImageView Image::GetView() const
+{
+	return pVkImageView;
+}
+
+VkExtent2D Image::GetExtent() const
+{
+	return sExtent;
+}
+
+VkFormat Image::GetFormat() const
+{
+	return eFormat;
+}
+
+u32 Image::GetMipLevels() const
+{
+	return iMipLevels;
+}
+
+u32 Image::GetArrayLayers() const
+{
+	return iArrayLayers;
+}
+
+VkImageAspectFlags Image::GetAspectMask() const
+{
+	return GetAspectMask(eFormat);
+}
+
+const MemoryAllocation &Image::GetAllocation() const
+{
+	return sAllocation;
+}
+
+VkImageAspectFlags Image::GetAspectMask(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_S8_UINT:
+			return VK_IMAGE_ASPECT_STENCIL_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+class Device;
+
+// A 2D image with its memory and a default view over every mip level and layer
+class Image : public IVkResource, public NonCopyable
+{
+private:
+	VkImage pVkImage;
+	VkImageView pVkImageView;
+	MemoryAllocation sAllocation;
+
+	Device &pDevice;
+	VkExtent2D sExtent;
+	VkFormat eFormat;
+	VkImageUsageFlags eUsage;
+	u32 iMipLevels;
+	u32 iArrayLayers;
+
+public:
+
+	Image(Device &device, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage, u32 mipLevels = 1, u32 arrayLayers = 1);
+	~Image();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+	VkImage GetVkNative() const;
+
+public:
+
+	VkImageView GetView() const;
+	VkExtent2D GetExtent() const;
+	VkFormat GetFormat() const;
+	u32 GetMipLevels() const;
+	u32 GetArrayLayers() const;
+	VkImageAspectFlags GetAspectMask() const;
+	const MemoryAllocation &GetAllocation() const;
+
+	static VkImageAspectFlags GetAspectMask(VkFormat format);
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "ImageDecoder.h"
+
+#include <libpng/png.h>
+#include <libwebp/src/webp/decode.h>
+
+namespace
+{
+	constexpr u8 PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	// Signature, then the IHDR chunk's length and type, then width and height
+	constexpr size_t PNG_HEADER_SIZE = 24;
+
+	constexpr u32 CHECKER_SIZE = 8;
+
+	struct PngSource
+	{
+		const u8 *pData;
+		size_t size;
+		size_t offset;
+	};
+
+	u32 ReadBigEndian(const u8 *pData)
+	{
+		return (static_cast<u32>(pData[0]) << 24) | (static_cast<u32>(pData[1]) << 16) | (static_cast<u32>(pData[2]) << 8) | pData[3];
+	}
+
+	void ReadPngData(png_structp png, png_bytep pOut, png_size_t length)
+	{
+		PngSource *pSource = static_cast<PngSource *>(png_get_io_ptr(png));
+		if (length > pSource->size - pSource->offset)
+		{
+			png_error(png, "Read past the end of the file");
+		}
+		memcpy(pOut, pSource->pData + pSource->offset, length);
+		pSource->offset += length;
+	}
+
+	// libpng reports errors with longjmp, so nothing in here may need a destructor.
+	// Rows are read one at a time straight into pOut instead of through an array of row pointers.
+	bool DecodePng(const u8 *pData, size_t size, u8 *pOut, VkExtent2D extent)
+	{
+		png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+		png_infop info = png ? png_create_info_struct(png) : nullptr;
+		if (!info)
+		{
+			png_destroy_read_struct(&png, nullptr, nullptr);
+			return false;
+		}
+
+		PngSource source = { pData, size, 0 };
+
+		if (setjmp(png_jmpbuf(png)))
+		{
+			png_destroy_read_struct(&png, &info, nullptr);
+			return false;
+		}
+
+		png_set_read_fn(png, &source, ReadPngData);
+		png_read_info(png, info);
+
+		// Whatever the file holds comes out as 8 bit RGBA
+		png_set_expand(png);
+		png_set_strip_16(png);
+		png_set_gray_to_rgb(png);
+		png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+		int passes = png_set_interlace_handling(png);
+		png_read_update_info(png, info);
+
+		size_t stride = static_cast<size_t>(extent.width) * 4;
+		if (png_get_image_width(png, info) != extent.width || png_get_image_height(png, info) != extent.height || png_get_rowbytes(png, info) != stride)
+		{
+			png_destroy_read_struct(&png, &info, nullptr);
+			return false;
+		}
+
+		// Later passes of an interlaced image fill in the rows read before
+		for (int pass = 0; pass < passes; pass++)
+		{
+			for (u32 y = 0; y < extent.height; y++)
+			{
+				png_read_row(png, pOut + y * stride, nullptr);
+			}
+		}
+
+		png_read_end(png, nullptr);
+		png_destroy_read_struct(&png, &info, nullptr);
+		return true;
+	}
+
+	bool DecodeWebP(const u8 *pData, size_t size, u8 *pOut, VkExtent2D extent)
+	{
+		size_t stride = static_cast<size_t>(extent.width) * 4;
+		return WebPDecodeRGBAInto(pData, size, pOut, stride * extent.height, static_cast<int>(stride)) != nullptr;
+	}
+}
+
+bool ReadImageInfo(const u8 *pData, size_t size, ImageFileInfo &info)
+{
+	if (size >= PNG_HEADER_SIZE && memcmp(pData, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) == 0 && memcmp(pData + 12, "IHDR", 4) == 0)
+	{
+		info.format = ImageFileFormat::Png;
+		info.extent = { ReadBigEndian(pData + 16), ReadBigEndian(pData + 20) };
+		return true;
+	}
+
+	int width = 0;
+	int height = 0;
+	if (size == 0 || !WebPGetInfo(pData, size, &width, &height))
+	{
+		return false;
+	}
+
+	info.format = ImageFileFormat::WebP;
+	info.extent = { static_cast<u32>(width), static_cast<u32>(height) };
+	return true;
+}
+
+bool DecodeImage(const u8 *pData, size_t size, const ImageFileInfo &info, u8 *pOut)
+{
+	return info.format == ImageFileFormat::Png ?
+		DecodePng(pData, size, pOut, info.extent) :
+		DecodeWebP(pData, size, pOut, info.extent);
+}
+
+void FillCheckerboard(u8 *pOut, VkExtent2D extent)
+{
+	for (u32 y = 0; y < extent.height; y++)
+	{
+		for (u32 x = 0; x < extent.width; x++)
+		{
+			bool bMagenta = ((x / CHECKER_SIZE) + (y / CHECKER_SIZE)) % 2 == 0;
+			u8 *pPixel = pOut + (static_cast<size_t>(y) * extent.width + x) * 4;
+			pPixel[0] = bMagenta ? 0xFF : 0x00;
+			pPixel[1] = 0x00;
+			pPixel[2] = bMagenta ? 0xFF : 0x00;
+			pPixel[3] = 0xFF;
+		}
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+// PNG and WebP decoding through the vendored libpng and libwebp, shared by the runtime TextureLoader
+// and the offline TextureCooker. Everything comes out as tightly packed 8 bit RGBA.
+
+enum class ImageFileFormat
+{
+	Png,
+	WebP
+};
+
+struct ImageFileInfo
+{
+	ImageFileFormat format = ImageFileFormat::Png;
+	VkExtent2D extent = {};
+};
+
+// Reads no further than the header, false if the data is neither PNG nor WebP
+bool ReadImageInfo(const u8 *pData, size_t size, ImageFileInfo &info);
+
+// pOut has to hold extent.width * extent.height * 4 bytes. False if the file turns out broken,
+// pOut may be partly written then.
+bool DecodeImage(const u8 *pData, size_t size, const ImageFileInfo &info, u8 *pOut);
+
+// Stands in for a file that couldn't be decoded, hard to miss on screen
+void FillCheckerboard(u8 *pOut, VkExtent2D extent);
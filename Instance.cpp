@@ -8,10 +8,20 @@ Instance::Instance() :
 	pVkInstance(VK_NULL_HANDLE),
 	pWindow(nullptr),
 	sAppName("Vulkan Application"),
+	bHeadless(HEADLESS_ONLY),
+	bGlfwInitialized(false),
+	iWindowWidth(800),
+	iWindowHeight(600),
+	bResized(false),
+	sLayerNames(),
+	sExtensionNames(),
 	pArrLayers(),
 	pArrExtensions(0),
 	pPhysicalDevices()
 {
+#ifdef _DEBUG
+	pDebugMessenger = VK_NULL_HANDLE;
+#endif
 }
 
 Instance::~Instance()
@@ -29,12 +39,17 @@ Instance::~Instance()
 		vkDestroyInstance(pVkInstance, nullptr);
 	}
 
+#ifndef CULKAN_HEADLESS
 	if (pWindow != nullptr)
 	{
 		glfwDestroyWindow(pWindow);
 	}
 
-	glfwTerminate();
+	if (bGlfwInitialized)
+	{
+		glfwTerminate();
+	}
+#endif
 }
 
 VkBool32 Instance::DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData)
@@ -61,14 +76,44 @@ VkBool32 Instance::DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageS
 	return VK_FALSE;
 }
 
+void Instance::FramebufferSizeCallback(GLFWwindow *window, int width, int height)
+{
+#ifndef CULKAN_HEADLESS
+	Instance *pInstance = static_cast<Instance *>(glfwGetWindowUserPointer(window));
+	pInstance->iWindowWidth = static_cast<u32>(width);
+	pInstance->iWindowHeight = static_cast<u32>(height);
+	pInstance->bResized = true;
+#endif
+}
+
 void Instance::Create()
 {
-	ASSERT(glfwInit() == GLFW_TRUE, "GLFW failed to initialize");
+	if (bHeadless)
+	{
+		AddExtension(VK_KHR_SURFACE_EXTENSION_NAME);
+		AddExtension(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+	}
+	else
+	{
+#ifdef CULKAN_HEADLESS
+		throw runtime_error("Built without GLFW, only headless rendering is available");
+#else
+		ASSERT(glfwInit() == GLFW_TRUE, "GLFW failed to initialize");
+		bGlfwInitialized = true;
+
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+		pWindow = glfwCreateWindow(static_cast<int>(iWindowWidth), static_cast<int>(iWindowHeight), sAppName.c_str(), nullptr, nullptr);
+		ASSERT(pWindow != nullptr, "Failed to create window");
 
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwSetWindowUserPointer(pWindow, this);
+		glfwSetFramebufferSizeCallback(pWindow, FramebufferSizeCallback);
 
-	pWindow = glfwCreateWindow(800, 600, sAppName.c_str(), nullptr, nullptr);
+		// Whatever surface extensions this platform needs, not just Win32
+		AddRequiredExtensions();
+#endif
+	}
 
 	VkApplicationInfo appInfo = {};
 	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -88,7 +133,8 @@ void Instance::Create()
 	vkInstanceCreateInfo.pApplicationInfo = &appInfo;
 
 #if defined(_DEBUG)
-	pArrLayers.push_back("VK_LAYER_KHRONOS_validation");
+	AddLayer("VK_LAYER_KHRONOS_validation");
+	AddExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	// only khronos
 
 
@@ -102,11 +148,42 @@ void Instance::Create()
 
 #endif
 
-	pArrExtensions = {
-		VK_KHR_SURFACE_EXTENSION_NAME,
-		VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
-		VK_EXT_DEBUG_UTILS_EXTENSION_NAME
-	};
+	// Drop what this loader doesn't have instead of failing instance creation over it
+	Set<string> sAvailableExtensions;
+	for (auto &properties : EnumerateInstanceExtensionProperties())
+	{
+		sAvailableExtensions.insert(properties.extensionName);
+	}
+
+	pArrExtensions.clear();
+	for (auto &name : sExtensionNames)
+	{
+		if (sAvailableExtensions.count(name) == 0)
+		{
+			ASSERT(!bHeadless || name != VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME, "Headless mode needs " VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+			cout << "WARNING: Instance extension " << name << " not available" << endl;
+			continue;
+		}
+		pArrExtensions.push_back(name.c_str());
+	}
+
+	// Build servers usually don't have the validation layers installed
+	Set<string> sAvailableLayers;
+	for (auto &properties : EnumerateInstanceLayerProperties())
+	{
+		sAvailableLayers.insert(properties.layerName);
+	}
+
+	pArrLayers.clear();
+	for (auto &name : sLayerNames)
+	{
+		if (sAvailableLayers.count(name) == 0)
+		{
+			cout << "WARNING: Layer " << name << " not available" << endl;
+			continue;
+		}
+		pArrLayers.push_back(name.c_str());
+	}
 
 	for (auto *ext : pArrExtensions)
 	{
@@ -128,6 +205,10 @@ void Instance::Create()
 #if defined(_DEBUG) && 1
 
 	auto _vkCreateDebugUtilsMessengerEXT = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(pVkInstance, "vkCreateDebugUtilsMessengerEXT");
+	if (_vkCreateDebugUtilsMessengerEXT == nullptr)
+	{
+		return;
+	}
 
 	VkDebugUtilsMessengerCreateInfoEXT debugUtilsMessengerCreateInfo = {};
 	debugUtilsMessengerCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -148,16 +229,17 @@ void Instance::Create()
 
 void Instance::AddLayer(string layer)
 {
-	pArrLayers.push_back(layer.c_str());
+	sLayerNames.insert(layer);
 }
 
 void Instance::AddExtension(string extension)
 {
-	pArrExtensions.push_back(extension.c_str());
+	sExtensionNames.insert(extension);
 }
 
 void Instance::AddRequiredExtensions()
 {
+#ifndef CULKAN_HEADLESS
 	u32 glfwExtensionCount = 0;
 	const char **glfwExtensions;
 	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
@@ -166,8 +248,9 @@ void Instance::AddRequiredExtensions()
 
 	for (u32 i = 0; i < glfwExtensionCount; i++)
 	{
-		pArrExtensions.push_back(string(glfwExtensions[i]).c_str());
+		AddExtension(glfwExtensions[i]);
 	}
+#endif
 }
 
 void Instance::AddAllExtensions()
@@ -175,7 +258,7 @@ void Instance::AddAllExtensions()
 	Vec<VkExtensionProperties> vExtensionData = EnumerateInstanceExtensionProperties();
 	for (VkExtensionProperties &vkExtension : vExtensionData)
 	{
-		pArrExtensions.push_back(vkExtension.extensionName);
+		AddExtension(vkExtension.extensionName);
 	}
 }
 
@@ -184,6 +267,77 @@ void Instance::SetAppName(string appName)
 	sAppName = appName;
 }
 
+void Instance::SetHeadless(bool headless)
+{
+	bHeadless = headless;
+}
+
+bool Instance::IsHeadless() const
+{
+	return bHeadless;
+}
+
+void Instance::SetWindowSize(u32 width, u32 height)
+{
+	iWindowWidth = width;
+	iWindowHeight = height;
+}
+
+VkExtent2D Instance::GetWindowSize() const
+{
+	return { iWindowWidth, iWindowHeight };
+}
+
+bool Instance::ConsumeResize()
+{
+	return bResized.exchange(false);
+}
+
+bool Instance::IsMinimized() const
+{
+	if (bHeadless)
+	{
+		return false;
+	}
+
+#ifdef CULKAN_HEADLESS
+	return false;
+#else
+	int width, height;
+	glfwGetFramebufferSize(pWindow, &width, &height);
+	return width == 0 || height == 0;
+#endif
+}
+
+void Instance::PollEvents() const
+{
+#ifndef CULKAN_HEADLESS
+	if (!bHeadless)
+	{
+		glfwPollEvents();
+	}
+#endif
+}
+
+void Instance::WaitEvents() const
+{
+#ifndef CULKAN_HEADLESS
+	if (!bHeadless)
+	{
+		glfwWaitEvents();
+	}
+#endif
+}
+
+bool Instance::ShouldClose() const
+{
+#ifdef CULKAN_HEADLESS
+	return false;
+#else
+	return !bHeadless && glfwWindowShouldClose(pWindow);
+#endif
+}
+
 vector<shared_ptr<PhysicalDevice>> Instance::GetPhysicalDevices()
 {
 	Vec<VkPhysicalDevice> vPhysicalDevices = EnumeratePhysicalDevices(pVkInstance);
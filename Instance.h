@@ -6,6 +6,14 @@ class PhysicalDevice;
 
 class Instance : public NonCopyable
 {
+public:
+
+#ifdef CULKAN_HEADLESS
+	static constexpr bool HEADLESS_ONLY = true;
+#else
+	static constexpr bool HEADLESS_ONLY = false;
+#endif
+
 private:
 
 	VkInstance pVkInstance;
@@ -17,6 +25,19 @@ private:
 
 	string sAppName;
 
+	// No window, the surface comes from VK_EXT_headless_surface
+	bool bHeadless;
+	bool bGlfwInitialized;
+	u32 iWindowWidth;
+	u32 iWindowHeight;
+
+	// Set from the GLFW callback, cleared by ConsumeResize
+	atomic<bool> bResized;
+
+	// Owns the names, the pointer arrays below point into these
+	Set<string> sLayerNames;
+	Set<string> sExtensionNames;
+
 	Vec<const char *> pArrLayers;
 	Vec<const char *> pArrExtensions;
 	Vec<Ref<PhysicalDevice>> pPhysicalDevices;
@@ -29,6 +50,7 @@ public:
 
 	// PFN_vkDebugUtilsMessengerCallbackEXT pfnUserCallback;
 	static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData);
+	static void FramebufferSizeCallback(GLFWwindow *window, int width, int height);
 	
 	// Create the Vulkan instance
 	void Create();
@@ -44,6 +66,26 @@ public:
 	void AddAllExtensions();
 	void SetAppName(string appName);
 
+	// Render without a window or display through VK_EXT_headless_surface, e.g. on lavapipe. Set before Create().
+	// HEADLESS_ONLY builds have no GLFW and can't do anything else.
+	void SetHeadless(bool headless);
+	bool IsHeadless() const;
+
+	// Size of the window, or of the swap chain when headless. Set before Create()
+	void SetWindowSize(u32 width, u32 height);
+	VkExtent2D GetWindowSize() const;
+
+	// True once after the window was resized, the swap chain has to be recreated
+	bool ConsumeResize();
+
+	// A minimized window has no framebuffer, nothing can be presented to it
+	bool IsMinimized() const;
+
+	// Window events, nothing to do when headless, which never closes on its own
+	void PollEvents() const;
+	void WaitEvents() const;
+	bool ShouldClose() const;
+
 	Vec<Ref<PhysicalDevice>> GetPhysicalDevices();
 
 
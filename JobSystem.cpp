@@ -0,0 +1,424 @@
+#pragma once
+
+#include "JobSystem.h"
+
+thread_local u32 JobSystem::tThreadIndex = JobSystem::INVALID_THREAD;
+
+JobCounter::JobCounter() :
+	iValue(0),
+	pArrWaiting()
+{
+}
+
+bool JobCounter::IsDone() const
+{
+	return iValue.load() == 0;
+}
+
+u32 JobCounter::GetValue() const
+{
+	return iValue.load();
+}
+
+void JobCounter::Increment()
+{
+	iValue.fetch_add(1);
+}
+
+Vec<Func<void()>> JobCounter::Decrement()
+{
+	Vec<Func<void()>> ready;
+	if (iValue.fetch_sub(1) == 1)
+	{
+		lock_guard<mutex> lock(mLock);
+		ready.swap(pArrWaiting);
+	}
+	return ready;
+}
+
+void JobCounter::AddWaiter(Func<void()> fnSchedule)
+{
+	{
+		lock_guard<mutex> lock(mLock);
+		if (iValue.load() != 0)
+		{
+			pArrWaiting.push_back(move(fnSchedule));
+			return;
+		}
+	}
+
+	fnSchedule();
+}
+
+void JobCounter::SetException(exception_ptr exception)
+{
+	lock_guard<mutex> lock(mLock);
+	if (!pException)
+	{
+		pException = exception;
+	}
+}
+
+JobSystem::JobSystem() :
+	pArrQueues(),
+	pArrWorkers(),
+	iQueuedJobs(0),
+	iWorkerCount(0),
+	bStopping(false)
+{
+}
+
+JobSystem::~JobSystem()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void JobSystem::Create()
+{
+	if (iWorkerCount == 0)
+	{
+		iWorkerCount = max(2u, thread::hardware_concurrency()) - 1;
+	}
+
+	sMainThread = this_thread::get_id();
+	tThreadIndex = 0;
+	bStopping = false;
+
+	for (u32 i = 0; i < GetThreadCount(); i++)
+	{
+		pArrQueues.push_back(make_unique<WorkerQueue>());
+	}
+
+	pArrWorkers.reserve(iWorkerCount);
+	for (u32 i = 1; i <= iWorkerCount; i++)
+	{
+		pArrWorkers.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+}
+
+void JobSystem::Destroy()
+{
+	{
+		lock_guard<mutex> lock(mSleepLock);
+		bStopping = true;
+	}
+	cvWork.notify_all();
+
+	// Workers drain the queues before they exit
+	for (auto &worker : pArrWorkers)
+	{
+		worker.join();
+	}
+	pArrWorkers.clear();
+
+	while (PumpMainThread() > 0)
+	{
+	}
+
+	pArrQueues.clear();
+	tThreadIndex = INVALID_THREAD;
+}
+
+bool JobSystem::IsValid() const
+{
+	return !pArrQueues.empty();
+}
+
+void JobSystem::SetWorkerCount(u32 workerCount)
+{
+	ASSERT(!IsValid(), "Worker count has to be set before the job system is created");
+	iWorkerCount = workerCount;
+}
+
+void JobSystem::Submit(JobFunc fnJob, const Ref<JobCounter> &counter, const Ref<JobCounter> &dependency)
+{
+	Job job;
+	job.fnJob = move(fnJob);
+	job.pCounter = counter;
+	Enqueue(move(job), dependency);
+}
+
+void JobSystem::SubmitMain(JobFunc fnJob, const Ref<JobCounter> &counter, const Ref<JobCounter> &dependency)
+{
+	Job job;
+	job.fnJob = move(fnJob);
+	job.pCounter = counter;
+	job.bMainThread = true;
+	Enqueue(move(job), dependency);
+}
+
+u32 JobSystem::PumpMainThread()
+{
+	ASSERT(IsMainThread(), "PumpMainThread called off the main thread");
+
+	// Only what was queued up to now, jobs queued by these run next time
+	u32 count = 0;
+	{
+		lock_guard<mutex> lock(mMainLock);
+		count = static_cast<u32>(pArrMainJobs.size());
+	}
+
+	u32 ran = 0;
+	Job job;
+	while (ran < count && PopMainJob(job))
+	{
+		Run(job);
+		ran++;
+	}
+	return ran;
+}
+
+void JobSystem::Wait(const Ref<JobCounter> &counter)
+{
+	if (!counter)
+	{
+		return;
+	}
+
+	u32 threadIndex = GetThreadIndex();
+	bool bMainThread = threadIndex == 0;
+
+	while (!counter->IsDone())
+	{
+		Job job;
+		if (threadIndex != INVALID_THREAD && FindJob(threadIndex, job))
+		{
+			Run(job);
+			continue;
+		}
+
+		if (bMainThread && PopMainJob(job))
+		{
+			Run(job);
+			continue;
+		}
+
+		// Nothing to help with, sleep until a job shows up or some counter reaches zero.
+		// The timeout covers main thread jobs, which don't wake anyone.
+		unique_lock<mutex> lock(mSleepLock);
+		cvWork.wait_for(lock, chrono::milliseconds(1), [&]() {
+			return counter->IsDone() || (threadIndex != INVALID_THREAD && iQueuedJobs.load() > 0);
+		});
+	}
+
+	exception_ptr exception;
+	{
+		lock_guard<mutex> lock(counter->mLock);
+		exception = counter->pException;
+	}
+	if (exception)
+	{
+		rethrow_exception(exception);
+	}
+}
+
+void JobSystem::ParallelFor(u32 count, u32 minBatch, const RangeFunc &fnRange)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// A few batches per thread so a slow one doesn't hold everyone up
+	u32 maxBatches = max(1u, count / max(minBatch, 1u));
+	u32 batchCount = min(GetThreadCount() * 4, maxBatches);
+	u32 batchSize = (count + batchCount - 1) / batchCount;
+
+	Ref<JobCounter> counter = make_shared<JobCounter>();
+	for (u32 begin = 0; begin < count; begin += batchSize)
+	{
+		u32 end = min(begin + batchSize, count);
+		Submit([&fnRange, begin, end]() { fnRange(begin, end); }, counter);
+	}
+
+	Wait(counter);
+}
+
+u32 JobSystem::GetThreadCount() const
+{
+	return iWorkerCount + 1;
+}
+
+u32 JobSystem::GetWorkerCount() const
+{
+	return iWorkerCount;
+}
+
+bool JobSystem::IsMainThread() const
+{
+	return this_thread::get_id() == sMainThread;
+}
+
+u32 JobSystem::GetThreadIndex()
+{
+	return tThreadIndex;
+}
+
+void JobSystem::Enqueue(Job job, const Ref<JobCounter> &dependency)
+{
+	ASSERT(IsValid(), "JobSystem used before Create");
+
+	if (job.pCounter)
+	{
+		job.pCounter->Increment();
+	}
+
+	if (dependency)
+	{
+		dependency->AddWaiter([this, job]() { Schedule(job); });
+		return;
+	}
+
+	Schedule(move(job));
+}
+
+void JobSystem::Schedule(Job job)
+{
+	if (job.bMainThread)
+	{
+		lock_guard<mutex> lock(mMainLock);
+		pArrMainJobs.push_back(move(job));
+		return;
+	}
+
+	// Counted before it's pushed so the count can't drop below zero when it's taken right away
+	iQueuedJobs.fetch_add(1);
+
+	u32 threadIndex = GetThreadIndex();
+	if (threadIndex != INVALID_THREAD)
+	{
+		WorkerQueue &queue = *pArrQueues[threadIndex];
+		lock_guard<mutex> lock(queue.mLock);
+		queue.pArrJobs.push_back(move(job));
+	}
+	else
+	{
+		lock_guard<mutex> lock(mInjectLock);
+		pArrInjected.push_back(move(job));
+	}
+
+	// Taking the lock keeps a worker from missing the wake between checking and sleeping
+	{
+		lock_guard<mutex> lock(mSleepLock);
+	}
+	cvWork.notify_one();
+}
+
+bool JobSystem::FindJob(u32 threadIndex, Job &job)
+{
+	// Own jobs newest first, they're the most likely to still be in cache
+	{
+		WorkerQueue &queue = *pArrQueues[threadIndex];
+		lock_guard<mutex> lock(queue.mLock);
+		if (!queue.pArrJobs.empty())
+		{
+			job = move(queue.pArrJobs.back());
+			queue.pArrJobs.pop_back();
+			iQueuedJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	{
+		lock_guard<mutex> lock(mInjectLock);
+		if (!pArrInjected.empty())
+		{
+			job = move(pArrInjected.front());
+			pArrInjected.pop_front();
+			iQueuedJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// Steal the oldest job of someone else, starting next to us so thieves spread out
+	u32 threadCount = static_cast<u32>(pArrQueues.size());
+	for (u32 i = 1; i < threadCount; i++)
+	{
+		WorkerQueue &victim = *pArrQueues[(threadIndex + i) % threadCount];
+		lock_guard<mutex> lock(victim.mLock);
+		if (!victim.pArrJobs.empty())
+		{
+			job = move(victim.pArrJobs.front());
+			victim.pArrJobs.pop_front();
+			iQueuedJobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool JobSystem::PopMainJob(Job &job)
+{
+	lock_guard<mutex> lock(mMainLock);
+	if (pArrMainJobs.empty())
+	{
+		return false;
+	}
+
+	job = move(pArrMainJobs.front());
+	pArrMainJobs.pop_front();
+	return true;
+}
+
+void JobSystem::Run(Job &job)
+{
+	try
+	{
+		job.fnJob();
+	}
+	catch (...)
+	{
+		if (job.pCounter)
+		{
+			job.pCounter->SetException(current_exception());
+		}
+		else
+		{
+			cout << "WARNING: Job threw with nobody waiting on it" << endl;
+		}
+	}
+
+	if (!job.pCounter)
+	{
+		return;
+	}
+
+	Vec<Func<void()>> ready = job.pCounter->Decrement();
+	for (auto &fnSchedule : ready)
+	{
+		fnSchedule();
+	}
+
+	// Someone may be sleeping in Wait() on this counter
+	if (job.pCounter->IsDone())
+	{
+		lock_guard<mutex> lock(mSleepLock);
+		cvWork.notify_all();
+	}
+}
+
+void JobSystem::WorkerMain(u32 threadIndex)
+{
+	tThreadIndex = threadIndex;
+
+	while (true)
+	{
+		Job job;
+		if (FindJob(threadIndex, job))
+		{
+			Run(job);
+			continue;
+		}
+
+		unique_lock<mutex> lock(mSleepLock);
+		cvWork.wait(lock, [this]() { return bStopping || iQueuedJobs.load() > 0; });
+		if (bStopping && iQueuedJobs.load() == 0)
+		{
+			return;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+// Counts jobs that haven't finished yet. Waiting on it, or making other jobs depend on it,
+// is how work is joined. The first exception thrown by one of its jobs is kept for Wait().
+class JobCounter : public NonCopyable
+{
+private:
+	atomic<u32> iValue;
+	mutex mLock;
+
+	// Jobs held back until this reaches zero
+	Vec<Func<void()>> pArrWaiting;
+	exception_ptr pException;
+
+	friend class JobSystem;
+
+public:
+
+	JobCounter();
+
+public:
+
+	bool IsDone() const;
+	u32 GetValue() const;
+
+private:
+
+	void Increment();
+
+	// Returns the jobs that were waiting if this was the last one
+	Vec<Func<void()>> Decrement();
+
+	// Runs fnSchedule right away if already at zero, otherwise once it gets there
+	void AddWaiter(Func<void()> fnSchedule);
+	void SetException(exception_ptr exception);
+};
+
+// One scheduler for every subsystem so all cores stay busy instead of each one spinning up its own threads.
+// Every worker owns a deque, it pushes and pops its own jobs at the back and steals from the front
+// of the others when it runs dry. Jobs submitted from threads outside the system go through a shared
+// queue. Waiting threads run other jobs meanwhile, so jobs can wait on jobs without running out of threads.
+// Jobs submitted with SubmitMain() only ever run on the main thread, for GLFW and the like.
+class JobSystem : public IVkResource, public NonCopyable
+{
+public:
+
+	using JobFunc = Func<void()>;
+	using RangeFunc = Func<void(u32 begin, u32 end)>;
+
+	// Thread index of threads that aren't part of the system
+	static constexpr u32 INVALID_THREAD = UINT32_MAX;
+
+private:
+
+	struct Job
+	{
+		JobFunc fnJob;
+		Ref<JobCounter> pCounter;
+		bool bMainThread = false;
+	};
+
+	struct WorkerQueue
+	{
+		deque<Job> pArrJobs;
+		mutex mLock;
+	};
+
+	// Index 0 belongs to the main thread, which can be stolen from like any worker
+	Vec<unique_ptr<WorkerQueue>> pArrQueues;
+	Vec<thread> pArrWorkers;
+
+	deque<Job> pArrInjected;
+	mutex mInjectLock;
+
+	deque<Job> pArrMainJobs;
+	mutex mMainLock;
+
+	// Queued jobs any worker can run, main thread jobs aren't counted so they don't wake anyone
+	atomic<u32> iQueuedJobs;
+	mutex mSleepLock;
+	condition_variable cvWork;
+
+	thread::id sMainThread;
+	u32 iWorkerCount;
+	bool bStopping;
+
+	static thread_local u32 tThreadIndex;
+
+public:
+
+	JobSystem();
+	~JobSystem();
+
+public:
+
+	// The thread calling Create() becomes the main thread
+	void Create() override;
+
+	// Runs what's left and joins the workers
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// 0 picks one per hardware thread minus the main thread, set before Create()
+	void SetWorkerCount(u32 workerCount);
+
+	// Run fnJob on any thread. counter goes up now and down once fnJob returned,
+	// the job isn't started before dependency reached zero.
+	void Submit(JobFunc fnJob, const Ref<JobCounter> &counter = nullptr, const Ref<JobCounter> &dependency = nullptr);
+
+	// Same, but only ever runs on the main thread from PumpMainThread() or a Wait() there
+	void SubmitMain(JobFunc fnJob, const Ref<JobCounter> &counter = nullptr, const Ref<JobCounter> &dependency = nullptr);
+
+	// Run the main thread jobs queued so far, returns how many ran
+	u32 PumpMainThread();
+
+	// Block until counter reaches zero, running other jobs meanwhile. Rethrows the first exception of its jobs.
+	void Wait(const Ref<JobCounter> &counter);
+
+	// Split [0, count) into batches of at least minBatch items and run them across the system
+	void ParallelFor(u32 count, u32 minBatch, const RangeFunc &fnRange);
+
+	// Workers plus the main thread, the highest thread index is one less
+	u32 GetThreadCount() const;
+	u32 GetWorkerCount() const;
+	bool IsMainThread() const;
+
+	// 0 on the main thread, 1 and up on workers, INVALID_THREAD anywhere else
+	static u32 GetThreadIndex();
+
+private:
+
+	void Enqueue(Job job, const Ref<JobCounter> &dependency);
+	void Schedule(Job job);
+	bool FindJob(u32 threadIndex, Job &job);
+	bool PopMainJob(Job &job);
+	void Run(Job &job);
+	void WorkerMain(u32 threadIndex);
+};
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string &path) :
+	sPath(path),
+	pData(nullptr),
+	iSize(0),
+	pFile(INVALID_HANDLE_VALUE),
+	pMapping(nullptr)
+{
+	pFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (pFile == INVALID_HANDLE_VALUE)
+	{
+		throw runtime_error("Failed to open file: " + path);
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(pFile, &size))
+	{
+		CloseHandle(pFile);
+		throw runtime_error("Failed to get the size of file: " + path);
+	}
+	iSize = static_cast<size_t>(size.QuadPart);
+
+	// Empty files can't be mapped, there's nothing to read anyway
+	if (iSize == 0)
+	{
+		return;
+	}
+
+	pMapping = CreateFileMappingA(pFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void *pView = pMapping ? MapViewOfFile(pMapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!pView)
+	{
+		if (pMapping)
+		{
+			CloseHandle(pMapping);
+		}
+		CloseHandle(pFile);
+		throw runtime_error("Failed to map file: " + path);
+	}
+
+	pData = static_cast<const u8 *>(pView);
+}
+
+MappedFile::~MappedFile()
+{
+	if (pData)
+	{
+		UnmapViewOfFile(pData);
+	}
+	if (pMapping)
+	{
+		CloseHandle(pMapping);
+	}
+	if (pFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(pFile);
+	}
+}
+
+#else
+
+MappedFile::MappedFile(const string &path) :
+	sPath(path),
+	pData(nullptr),
+	iSize(0),
+	iFile(-1)
+{
+	iFile = open(path.c_str(), O_RDONLY);
+	if (iFile < 0)
+	{
+		throw runtime_error("Failed to open file: " + path);
+	}
+
+	struct stat info = {};
+	if (fstat(iFile, &info) != 0)
+	{
+		close(iFile);
+		throw runtime_error("Failed to get the size of file: " + path);
+	}
+	iSize = static_cast<size_t>(info.st_size);
+
+	// Empty files can't be mapped, there's nothing to read anyway
+	if (iSize == 0)
+	{
+		return;
+	}
+
+	void *pView = mmap(nullptr, iSize, PROT_READ, MAP_PRIVATE, iFile, 0);
+	if (pView == MAP_FAILED)
+	{
+		close(iFile);
+		throw runtime_error("Failed to map file: " + path);
+	}
+
+	// Mostly read front to back, start reading ahead right away
+	madvise(pView, iSize, MADV_WILLNEED);
+	pData = static_cast<const u8 *>(pView);
+}
+
+MappedFile::~MappedFile()
+{
+	if (pData)
+	{
+		munmap(const_cast<u8 *>(pData), iSize);
+	}
+	if (iFile >= 0)
+	{
+		close(iFile);
+	}
+}
+
+#endif
+
+const u8 *MappedFile::GetData() const
+{
+	return pData;
+}
+
+size_t MappedFile::GetSize() const
+{
+	return iSize;
+}
+
+const string &MappedFile::GetPath() const
+{
+	return sPath;
+}
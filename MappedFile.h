@@ -0,0 +1,32 @@
+#pragma once
+
+// Read only memory mapping of a whole file. Nothing is read up front, pages come in from the
+// file cache the first time they are touched and several mappings of a file share them.
+// The data starts page aligned and stays valid as long as the object lives.
+class MappedFile : public NonCopyable
+{
+private:
+	string sPath;
+	const u8 *pData;
+	size_t iSize;
+
+#ifdef _WIN32
+	void *pFile;
+	void *pMapping;
+#else
+	int iFile;
+#endif
+
+public:
+
+	// Throws if the file can't be opened or mapped
+	MappedFile(const string &path);
+	~MappedFile();
+
+public:
+
+	// Null for an empty file
+	const u8 *GetData() const;
+	size_t GetSize() const;
+	const string &GetPath() const;
+};
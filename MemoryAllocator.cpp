@@ -0,0 +1,751 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+#include "Device.h"
+#include "PhysicalDevice.h"
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static u32 BitScanForward(u64 mask)
+{
+	u32 index = 0;
+	while ((mask & 1ull) == 0)
+	{
+		mask >>= 1;
+		index++;
+	}
+	return index;
+}
+
+static u32 BitScanReverse(u64 mask)
+{
+	u32 index = 0;
+	while (mask >>= 1)
+	{
+		index++;
+	}
+	return index;
+}
+
+// One VkDeviceMemory block managed with a TLSF allocator.
+// Free ranges are bucketed by size into a first level (power of two) and second level
+// (linear subdivision of that power of two), with a bitmap per level so the smallest
+// bucket that can satisfy a request is found with two bit scans.
+class MemoryBlock : public NonCopyable
+{
+public:
+
+	static constexpr u32 INVALID = UINT32_MAX;
+	static constexpr u32 SL_LOG2 = 4;
+	static constexpr u32 SL_COUNT = 1 << SL_LOG2;
+	static constexpr u32 FL_SHIFT = 8;
+	static constexpr VkDeviceSize SMALL_SIZE = 1ull << FL_SHIFT;
+	static constexpr u32 FL_COUNT = 64 - FL_SHIFT + 1;
+
+	// Remainders smaller than this are left attached to the allocation
+	static constexpr VkDeviceSize MIN_SPLIT_SIZE = 64;
+
+	struct Node
+	{
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		u32 prevPhysical = INVALID;
+		u32 nextPhysical = INVALID;
+		u32 prevFree = INVALID;
+		u32 nextFree = INVALID;
+		bool bFree = false;
+	};
+
+	VkDeviceMemory pMemory;
+	u8 *pMapped;
+	VkDeviceSize iSize;
+	VkDeviceSize iUsed;
+	u32 iAllocationCount;
+
+private:
+	Vec<Node> vNodes;
+	Vec<u32> vUnusedNodes;
+
+	u64 iFlBitmap;
+	u32 iArrSlBitmap[FL_COUNT];
+	u32 iArrFreeHeads[FL_COUNT][SL_COUNT];
+
+public:
+
+	MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void *pMappedData) :
+		pMemory(memory),
+		pMapped(static_cast<u8 *>(pMappedData)),
+		iSize(size),
+		iUsed(0),
+		iAllocationCount(0),
+		iFlBitmap(0)
+	{
+		memset(iArrSlBitmap, 0, sizeof(iArrSlBitmap));
+		for (u32 fl = 0; fl < FL_COUNT; fl++)
+		{
+			for (u32 sl = 0; sl < SL_COUNT; sl++)
+			{
+				iArrFreeHeads[fl][sl] = INVALID;
+			}
+		}
+
+		u32 root = NewNode();
+		vNodes[root].offset = 0;
+		vNodes[root].size = size;
+		InsertFree(root);
+	}
+
+	// Returns the node index, or INVALID if nothing fits
+	u32 Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		// Searching for size + alignment - 1 guarantees the aligned range fits in whatever we find
+		VkDeviceSize searchSize = size + (alignment > 1 ? alignment - 1 : 0);
+		u32 node = FindFree(searchSize);
+		if (node == INVALID)
+		{
+			return INVALID;
+		}
+
+		RemoveFree(node);
+
+		// Split off the padding in front so it can be reused
+		VkDeviceSize alignedOffset = AlignUp(vNodes[node].offset, alignment);
+		VkDeviceSize padding = alignedOffset - vNodes[node].offset;
+		if (padding > 0)
+		{
+			u32 front = NewNode();
+			Node &frontNode = vNodes[front];
+			Node &current = vNodes[node];
+			frontNode.offset = current.offset;
+			frontNode.size = padding;
+			frontNode.prevPhysical = current.prevPhysical;
+			frontNode.nextPhysical = node;
+			if (current.prevPhysical != INVALID)
+			{
+				vNodes[current.prevPhysical].nextPhysical = front;
+			}
+			current.prevPhysical = front;
+			current.offset = alignedOffset;
+			current.size -= padding;
+			InsertFree(front);
+		}
+
+		// Give the tail back if it is worth tracking
+		if (vNodes[node].size - size >= MIN_SPLIT_SIZE)
+		{
+			u32 back = NewNode();
+			Node &backNode = vNodes[back];
+			Node &current = vNodes[node];
+			backNode.offset = current.offset + size;
+			backNode.size = current.size - size;
+			backNode.prevPhysical = node;
+			backNode.nextPhysical = current.nextPhysical;
+			if (current.nextPhysical != INVALID)
+			{
+				vNodes[current.nextPhysical].prevPhysical = back;
+			}
+			current.nextPhysical = back;
+			current.size = size;
+			InsertFree(back);
+		}
+
+		iUsed += vNodes[node].size;
+		iAllocationCount++;
+		return node;
+	}
+
+	void Free(u32 node)
+	{
+		iUsed -= vNodes[node].size;
+		iAllocationCount--;
+
+		// Merge with free neighbours so free ranges never sit next to each other
+		u32 prev = vNodes[node].prevPhysical;
+		if (prev != INVALID && vNodes[prev].bFree)
+		{
+			RemoveFree(prev);
+			vNodes[prev].size += vNodes[node].size;
+			Unlink(node);
+			node = prev;
+		}
+
+		u32 next = vNodes[node].nextPhysical;
+		if (next != INVALID && vNodes[next].bFree)
+		{
+			RemoveFree(next);
+			vNodes[node].size += vNodes[next].size;
+			Unlink(next);
+		}
+
+		InsertFree(node);
+	}
+
+	const Node &GetNode(u32 node) const
+	{
+		return vNodes[node];
+	}
+
+	bool IsEmpty() const
+	{
+		return iAllocationCount == 0;
+	}
+
+	VkDeviceSize GetLargestFree() const
+	{
+		if (iFlBitmap == 0)
+		{
+			return 0;
+		}
+
+		u32 fl = BitScanReverse(iFlBitmap);
+		u32 sl = BitScanReverse(iArrSlBitmap[fl]);
+
+		VkDeviceSize largest = 0;
+		for (u32 node = iArrFreeHeads[fl][sl]; node != INVALID; node = vNodes[node].nextFree)
+		{
+			largest = max(largest, vNodes[node].size);
+		}
+		return largest;
+	}
+
+private:
+
+	static void Mapping(VkDeviceSize size, u32 &fl, u32 &sl)
+	{
+		if (size < SMALL_SIZE)
+		{
+			fl = 0;
+			sl = static_cast<u32>(size / (SMALL_SIZE / SL_COUNT));
+		}
+		else
+		{
+			u32 log2 = BitScanReverse(size);
+			sl = static_cast<u32>(size >> (log2 - SL_LOG2)) ^ SL_COUNT;
+			fl = log2 - FL_SHIFT + 1;
+		}
+	}
+
+	u32 FindFree(VkDeviceSize size) const
+	{
+		// Round up to the next bucket so every range in it is large enough
+		if (size >= SMALL_SIZE)
+		{
+			size += (1ull << (BitScanReverse(size) - SL_LOG2)) - 1;
+		}
+		else
+		{
+			size = AlignUp(size, SMALL_SIZE / SL_COUNT);
+		}
+
+		u32 fl, sl;
+		Mapping(size, fl, sl);
+		if (fl >= FL_COUNT)
+		{
+			return INVALID;
+		}
+
+		u32 slMap = iArrSlBitmap[fl] & (~0u << sl);
+		if (slMap == 0)
+		{
+			u64 flMap = fl + 1 < 64 ? (iFlBitmap & (~0ull << (fl + 1))) : 0;
+			if (flMap == 0)
+			{
+				return INVALID;
+			}
+			fl = BitScanForward(flMap);
+			slMap = iArrSlBitmap[fl];
+		}
+		sl = BitScanForward(slMap);
+
+		return iArrFreeHeads[fl][sl];
+	}
+
+	void InsertFree(u32 node)
+	{
+		u32 fl, sl;
+		Mapping(vNodes[node].size, fl, sl);
+
+		Node &n = vNodes[node];
+		n.bFree = true;
+		n.prevFree = INVALID;
+		n.nextFree = iArrFreeHeads[fl][sl];
+		if (n.nextFree != INVALID)
+		{
+			vNodes[n.nextFree].prevFree = node;
+		}
+		iArrFreeHeads[fl][sl] = node;
+		iFlBitmap |= 1ull << fl;
+		iArrSlBitmap[fl] |= 1u << sl;
+	}
+
+	void RemoveFree(u32 node)
+	{
+		u32 fl, sl;
+		Mapping(vNodes[node].size, fl, sl);
+
+		Node &n = vNodes[node];
+		if (n.prevFree != INVALID)
+		{
+			vNodes[n.prevFree].nextFree = n.nextFree;
+		}
+		else
+		{
+			iArrFreeHeads[fl][sl] = n.nextFree;
+		}
+		if (n.nextFree != INVALID)
+		{
+			vNodes[n.nextFree].prevFree = n.prevFree;
+		}
+
+		if (iArrFreeHeads[fl][sl] == INVALID)
+		{
+			iArrSlBitmap[fl] &= ~(1u << sl);
+			if (iArrSlBitmap[fl] == 0)
+			{
+				iFlBitmap &= ~(1ull << fl);
+			}
+		}
+
+		n.bFree = false;
+		n.prevFree = INVALID;
+		n.nextFree = INVALID;
+	}
+
+	// Drop a node that was merged into its physical predecessor
+	void Unlink(u32 node)
+	{
+		Node &n = vNodes[node];
+		if (n.prevPhysical != INVALID)
+		{
+			vNodes[n.prevPhysical].nextPhysical = n.nextPhysical;
+		}
+		if (n.nextPhysical != INVALID)
+		{
+			vNodes[n.nextPhysical].prevPhysical = n.prevPhysical;
+		}
+		n = Node{};
+		vUnusedNodes.push_back(node);
+	}
+
+	u32 NewNode()
+	{
+		if (!vUnusedNodes.empty())
+		{
+			u32 node = vUnusedNodes.back();
+			vUnusedNodes.pop_back();
+			return node;
+		}
+		vNodes.emplace_back();
+		return static_cast<u32>(vNodes.size() - 1);
+	}
+};
+
+MemoryAllocator::MemoryAllocator(Device &device) :
+	pDevice(device),
+	sMemoryProperties({}),
+	iBufferImageGranularity(1),
+	iNonCoherentAtomSize(1),
+	iMaxAllocationCount(UINT32_MAX),
+	iDeviceMemoryCount(0)
+{
+	memset(iArrDedicatedBytes, 0, sizeof(iArrDedicatedBytes));
+	memset(iArrDedicatedCount, 0, sizeof(iArrDedicatedCount));
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	Destroy();
+}
+
+void MemoryAllocator::Create()
+{
+	const PhysicalDevice &physicalDevice = pDevice.GetPhysicalDevice();
+	VkPhysicalDeviceProperties properties = physicalDevice.GetProperties();
+
+	sMemoryProperties = physicalDevice.GetMemoryProperties();
+	iBufferImageGranularity = max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+	iNonCoherentAtomSize = max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	iMaxAllocationCount = properties.limits.maxMemoryAllocationCount;
+}
+
+void MemoryAllocator::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (u32 type = 0; type < VK_MAX_MEMORY_TYPES; type++)
+	{
+		for (unique_ptr<MemoryBlock> &pBlock : pArrBlocks[type])
+		{
+			if (pBlock)
+			{
+				if (!pBlock->IsEmpty())
+				{
+					cout << "WARNING: Memory block of type " << type << " destroyed with " << pBlock->iAllocationCount << " live allocations" << endl;
+				}
+				FreeDeviceMemory(pBlock->pMemory, pBlock->pMapped != nullptr);
+			}
+		}
+		pArrBlocks[type].clear();
+	}
+}
+
+bool MemoryAllocator::IsValid() const
+{
+	return sMemoryProperties.memoryTypeCount > 0;
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements &requirements, MemoryUsage usage, bool bLinear)
+{
+	VkMemoryPropertyFlags required = 0;
+	VkMemoryPropertyFlags preferred = 0;
+	VkMemoryPropertyFlags avoided = 0;
+	switch (usage)
+	{
+		case MemoryUsage::GpuOnly:
+			preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			break;
+		case MemoryUsage::CpuToGpu:
+			required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			break;
+		case MemoryUsage::CpuOnly:
+			required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+			break;
+		case MemoryUsage::GpuToCpu:
+			required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+			preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+			break;
+	}
+
+	u32 memoryType = FindMemoryType(requirements.memoryTypeBits, required, preferred, avoided);
+	if (memoryType == UINT32_MAX)
+	{
+		throw runtime_error("No suitable memory type for allocation");
+	}
+
+	VkDeviceSize size = requirements.size;
+	VkDeviceSize alignment = max<VkDeviceSize>(requirements.alignment, 1);
+
+	// Optimal images take whole granularity pages, so a linear neighbour can never share one
+	if (!bLinear && iBufferImageGranularity > 1)
+	{
+		alignment = max(alignment, iBufferImageGranularity);
+		size = AlignUp(size, iBufferImageGranularity);
+	}
+
+	MemoryAllocation allocation = {};
+	allocation.memoryType = memoryType;
+	allocation.size = size;
+
+	lock_guard<mutex> lock(mLock);
+
+	VkDeviceSize blockSize = GetBlockSize(memoryType);
+
+	// Big resources get their own memory, they would only fragment the blocks
+	if (size > blockSize / 2)
+	{
+		allocation.memory = AllocateDeviceMemory(memoryType, size, &allocation.pMapped);
+		allocation.offset = 0;
+		allocation.block = MemoryAllocation::DEDICATED;
+
+		u32 heap = sMemoryProperties.memoryTypes[memoryType].heapIndex;
+		iArrDedicatedBytes[heap] += size;
+		iArrDedicatedCount[heap]++;
+		return allocation;
+	}
+
+	Vec<unique_ptr<MemoryBlock>> &blocks = pArrBlocks[memoryType];
+
+	auto TryBlock = [&](u32 index) -> bool
+	{
+		MemoryBlock &block = *blocks[index];
+		u32 node = block.Allocate(size, alignment);
+		if (node == MemoryBlock::INVALID)
+		{
+			return false;
+		}
+
+		allocation.memory = block.pMemory;
+		allocation.offset = block.GetNode(node).offset;
+		allocation.size = block.GetNode(node).size;
+		allocation.pMapped = block.pMapped ? block.pMapped + allocation.offset : nullptr;
+		allocation.block = index;
+		allocation.node = node;
+		return true;
+	};
+
+	for (u32 i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i] && TryBlock(i))
+		{
+			return allocation;
+		}
+	}
+
+	// Nothing fits, grab a new block and reuse an empty slot if there is one
+	void *pMapped = nullptr;
+	VkDeviceMemory memory = AllocateDeviceMemory(memoryType, blockSize, &pMapped);
+
+	u32 index = static_cast<u32>(blocks.size());
+	for (u32 i = 0; i < blocks.size(); i++)
+	{
+		if (!blocks[i])
+		{
+			index = i;
+			break;
+		}
+	}
+
+	if (index == blocks.size())
+	{
+		blocks.emplace_back();
+	}
+	blocks[index] = make_unique<MemoryBlock>(memory, blockSize, pMapped);
+
+	ASSERT(TryBlock(index), "Allocation does not fit in a fresh memory block");
+	return allocation;
+}
+
+void MemoryAllocator::Free(MemoryAllocation &allocation)
+{
+	if (!allocation.IsValid())
+	{
+		return;
+	}
+
+	lock_guard<mutex> lock(mLock);
+
+	if (allocation.block == MemoryAllocation::DEDICATED)
+	{
+		u32 heap = sMemoryProperties.memoryTypes[allocation.memoryType].heapIndex;
+		iArrDedicatedBytes[heap] -= allocation.size;
+		iArrDedicatedCount[heap]--;
+		FreeDeviceMemory(allocation.memory, allocation.pMapped != nullptr);
+	}
+	else
+	{
+		Vec<unique_ptr<MemoryBlock>> &blocks = pArrBlocks[allocation.memoryType];
+		unique_ptr<MemoryBlock> &pBlock = blocks[allocation.block];
+		pBlock->Free(allocation.node);
+
+		// Keep one empty block around per type so alloc/free churn doesn't hit vkAllocateMemory
+		if (pBlock->IsEmpty())
+		{
+			u32 emptyBlocks = 0;
+			for (const unique_ptr<MemoryBlock> &pOther : blocks)
+			{
+				if (pOther && pOther->IsEmpty())
+				{
+					emptyBlocks++;
+				}
+			}
+
+			if (emptyBlocks > 1)
+			{
+				FreeDeviceMemory(pBlock->pMemory, pBlock->pMapped != nullptr);
+				pBlock.reset();
+			}
+		}
+	}
+
+	allocation = MemoryAllocation{};
+}
+
+MemoryAllocation MemoryAllocator::AllocateForBuffer(VkBuffer buffer, MemoryUsage usage)
+{
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(pDevice.GetVkNative(), buffer, &requirements);
+
+	MemoryAllocation allocation = Allocate(requirements, usage, true);
+	VK_CHECK_RESULT(vkBindBufferMemory(pDevice.GetVkNative(), buffer, allocation.memory, allocation.offset));
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::AllocateForImage(VkImage image, MemoryUsage usage)
+{
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(pDevice.GetVkNative(), image, &requirements);
+
+	MemoryAllocation allocation = Allocate(requirements, usage, false);
+	VK_CHECK_RESULT(vkBindImageMemory(pDevice.GetVkNative(), image, allocation.memory, allocation.offset));
+	return allocation;
+}
+
+void MemoryAllocator::Flush(const MemoryAllocation &allocation, VkDeviceSize offset, VkDeviceSize size) const
+{
+	VkMemoryPropertyFlags flags = sMemoryProperties.memoryTypes[allocation.memoryType].propertyFlags;
+	if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+	{
+		return;
+	}
+
+	// Flushed ranges have to be aligned to nonCoherentAtomSize
+	VkDeviceSize atomSize = iNonCoherentAtomSize;
+	VkDeviceSize start = allocation.offset + offset;
+	VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : start + size;
+
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = allocation.memory;
+	range.offset = start & ~(atomSize - 1);
+	range.size = AlignUp(end, atomSize) - range.offset;
+
+	VK_CHECK_RESULT(vkFlushMappedMemoryRanges(pDevice.GetVkNative(), 1, &range));
+}
+
+u32 MemoryAllocator::FindMemoryType(u32 typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, VkMemoryPropertyFlags avoided) const
+{
+	// Preferred without avoided wins right away, then either one of them, then neither
+	u32 fallback = UINT32_MAX;
+	u32 lastResort = UINT32_MAX;
+	for (u32 i = 0; i < sMemoryProperties.memoryTypeCount; i++)
+	{
+		VkMemoryPropertyFlags flags = sMemoryProperties.memoryTypes[i].propertyFlags;
+		if (!(typeBits & (1u << i)) || (flags & required) != required)
+		{
+			continue;
+		}
+
+		bool bPreferred = (flags & preferred) == preferred;
+		bool bAvoided = (flags & avoided) != 0;
+		if (bPreferred && !bAvoided)
+		{
+			return i;
+		}
+
+		u32 &candidate = bPreferred || !bAvoided ? fallback : lastResort;
+		if (candidate == UINT32_MAX)
+		{
+			candidate = i;
+		}
+	}
+	return fallback != UINT32_MAX ? fallback : lastResort;
+}
+
+MemoryStats MemoryAllocator::GetStats() const
+{
+	lock_guard<mutex> lock(mLock);
+
+	MemoryStats stats;
+	stats.heaps.resize(sMemoryProperties.memoryHeapCount);
+	stats.deviceMemoryCount = iDeviceMemoryCount;
+
+	for (u32 heap = 0; heap < sMemoryProperties.memoryHeapCount; heap++)
+	{
+		stats.heaps[heap].heapSize = sMemoryProperties.memoryHeaps[heap].size;
+		stats.heaps[heap].reservedBytes = iArrDedicatedBytes[heap];
+		stats.heaps[heap].usedBytes = iArrDedicatedBytes[heap];
+		stats.heaps[heap].allocationCount = iArrDedicatedCount[heap];
+	}
+
+	for (u32 type = 0; type < sMemoryProperties.memoryTypeCount; type++)
+	{
+		MemoryHeapStats &heapStats = stats.heaps[sMemoryProperties.memoryTypes[type].heapIndex];
+		for (const unique_ptr<MemoryBlock> &pBlock : pArrBlocks[type])
+		{
+			if (!pBlock)
+			{
+				continue;
+			}
+
+			heapStats.blockCount++;
+			heapStats.reservedBytes += pBlock->iSize;
+			heapStats.usedBytes += pBlock->iUsed;
+			heapStats.allocationCount += pBlock->iAllocationCount;
+
+			stats.totalFreeBytes += pBlock->iSize - pBlock->iUsed;
+			stats.largestFreeRange = max(stats.largestFreeRange, pBlock->GetLargestFree());
+		}
+	}
+
+	if (stats.totalFreeBytes > 0)
+	{
+		stats.fragmentation = 1.0f - static_cast<f32>(stats.largestFreeRange) / static_cast<f32>(stats.totalFreeBytes);
+	}
+
+	return stats;
+}
+
+void MemoryAllocator::PrintStats() const
+{
+	MemoryStats stats = GetStats();
+
+	constexpr f64 MiB = 1024.0 * 1024.0;
+	for (u32 heap = 0; heap < stats.heaps.size(); heap++)
+	{
+		const MemoryHeapStats &heapStats = stats.heaps[heap];
+		cout << "Heap " << heap << ": "
+			<< fixed << setprecision(1)
+			<< heapStats.usedBytes / MiB << " / " << heapStats.reservedBytes / MiB << " MiB used, "
+			<< heapStats.heapSize / MiB << " MiB total, "
+			<< heapStats.blockCount << " blocks, "
+			<< heapStats.allocationCount << " allocations" << endl;
+	}
+
+	cout << "Device memory objects: " << stats.deviceMemoryCount << "/" << iMaxAllocationCount
+		<< ", fragmentation: " << setprecision(2) << stats.fragmentation << endl;
+}
+
+VkDeviceSize MemoryAllocator::GetBlockSize(u32 memoryType) const
+{
+	const VkMemoryType &type = sMemoryProperties.memoryTypes[memoryType];
+	VkDeviceSize heapSize = sMemoryProperties.memoryHeaps[type.heapIndex].size;
+
+	// Small heaps (e.g. the 256 MiB BAR window) would be eaten by a couple of blocks
+	if (heapSize <= SMALL_HEAP_THRESHOLD)
+	{
+		return AlignUp(heapSize / 8, 32);
+	}
+
+	if (!(type.propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+	{
+		return HOST_BLOCK_SIZE;
+	}
+
+	return LARGE_HEAP_BLOCK_SIZE;
+}
+
+VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(u32 memoryType, VkDeviceSize size, void **ppMapped)
+{
+	if (iDeviceMemoryCount >= iMaxAllocationCount)
+	{
+		throw runtime_error("maxMemoryAllocationCount reached");
+	}
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkAllocateMemory(pDevice.GetVkNative(), &allocateInfo, nullptr, &memory));
+	iDeviceMemoryCount++;
+
+	// Host visible memory stays mapped for its whole lifetime
+	*ppMapped = nullptr;
+	if (IsHostVisible(memoryType))
+	{
+		VK_CHECK_RESULT(vkMapMemory(pDevice.GetVkNative(), memory, 0, VK_WHOLE_SIZE, 0, ppMapped));
+	}
+
+	return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, bool bMapped)
+{
+	if (bMapped)
+	{
+		vkUnmapMemory(pDevice.GetVkNative(), memory);
+	}
+	vkFreeMemory(pDevice.GetVkNative(), memory, nullptr);
+	iDeviceMemoryCount--;
+}
+
+bool MemoryAllocator::IsHostVisible(u32 memoryType) const
+{
+	return (sMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+class Device;
+class MemoryBlock;
+
+// Where a resource lives and who touches it
+enum class MemoryUsage
+{
+	GpuOnly,	// Device local, never mapped
+	CpuToGpu,	// Host visible, written by the CPU every frame and read by shaders, device local if there is such memory
+	CpuOnly,	// Host visible and coherent system memory, staging for copies, keeps out of the small BAR heap
+	GpuToCpu,	// Host visible and cached, read back by the CPU
+};
+
+// A sub-range of a VkDeviceMemory block handed out by the MemoryAllocator.
+// Dedicated allocations own their VkDeviceMemory outright and have no block.
+struct MemoryAllocation
+{
+	static constexpr u32 DEDICATED = UINT32_MAX;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void *pMapped = nullptr;
+	u32 memoryType = 0;
+	u32 block = DEDICATED;
+	u32 node = 0;
+
+	bool IsValid() const
+	{
+		return memory != VK_NULL_HANDLE;
+	}
+};
+
+struct MemoryHeapStats
+{
+	VkDeviceSize heapSize = 0;
+	VkDeviceSize reservedBytes = 0;	// Bytes held in VkDeviceMemory blocks
+	VkDeviceSize usedBytes = 0;		// Bytes handed out to resources
+	u32 blockCount = 0;
+	u32 allocationCount = 0;
+};
+
+struct MemoryStats
+{
+	Vec<MemoryHeapStats> heaps;
+	VkDeviceSize totalFreeBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+	u32 deviceMemoryCount = 0;
+
+	// 0 means all free memory is in one range, close to 1 means it is scattered in tiny pieces
+	f32 fragmentation = 0.0f;
+};
+
+// Sub-allocates buffers and images out of large VkDeviceMemory blocks.
+// Each memory type keeps its own list of blocks, each block is managed by a TLSF
+// (two level segregated fit) allocator so allocating and freeing are O(1).
+class MemoryAllocator : public IVkResource, public NonCopyable
+{
+public:
+
+	static constexpr VkDeviceSize LARGE_HEAP_BLOCK_SIZE = 256ull * 1024 * 1024;
+	static constexpr VkDeviceSize HOST_BLOCK_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize SMALL_HEAP_THRESHOLD = 1024ull * 1024 * 1024;
+
+private:
+	Device &pDevice;
+
+	VkPhysicalDeviceMemoryProperties sMemoryProperties;
+	VkDeviceSize iBufferImageGranularity;
+	VkDeviceSize iNonCoherentAtomSize;
+	u32 iMaxAllocationCount;
+	u32 iDeviceMemoryCount;
+
+	// Blocks per memory type, null entries are blocks that were released
+	Vec<unique_ptr<MemoryBlock>> pArrBlocks[VK_MAX_MEMORY_TYPES];
+
+	// Bytes held by dedicated allocations per heap
+	VkDeviceSize iArrDedicatedBytes[VK_MAX_MEMORY_HEAPS];
+	u32 iArrDedicatedCount[VK_MAX_MEMORY_HEAPS];
+
+	mutable mutex mLock;
+
+public:
+
+	MemoryAllocator(Device &device);
+	~MemoryAllocator();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Allocate memory that satisfies the requirements.
+	// bLinear is false for optimally tiled images, which are kept apart from linear
+	// resources so the two never share a bufferImageGranularity page.
+	MemoryAllocation Allocate(const VkMemoryRequirements &requirements, MemoryUsage usage, bool bLinear);
+	void Free(MemoryAllocation &allocation);
+
+	// Allocate and bind in one go
+	MemoryAllocation AllocateForBuffer(VkBuffer buffer, MemoryUsage usage);
+	MemoryAllocation AllocateForImage(VkImage image, MemoryUsage usage);
+
+	// Make CPU writes visible on memory types that are not host coherent
+	void Flush(const MemoryAllocation &allocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+
+	// Returns UINT32_MAX if no memory type matches. Types with none of the avoided flags come before
+	// those with some, e.g. on integrated GPUs every type is device local.
+	u32 FindMemoryType(u32 typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0, VkMemoryPropertyFlags avoided = 0) const;
+
+	MemoryStats GetStats() const;
+	void PrintStats() const;
+
+private:
+
+	VkDeviceSize GetBlockSize(u32 memoryType) const;
+	VkDeviceMemory AllocateDeviceMemory(u32 memoryType, VkDeviceSize size, void **ppMapped);
+	void FreeDeviceMemory(VkDeviceMemory memory, bool bMapped);
+	bool IsHostVisible(u32 memoryType) const;
+};
@@ -0,0 +1,506 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include "Device.h"
+#include "PhysicalDevice.h"
+#include "Image.h"
+#include "Shader.h"
+#include "UploadQueue.h"
+#include "GpuTimeline.h"
+#include "DescriptorAllocator.h"
+#include "DeferredDestroyQueue.h"
+#include "PipelineCache.h"
+#include "PipelineLayoutCache.h"
+#include "CookedTexture.h"
+
+namespace
+{
+	// The downsample shader reads and writes floats, integer texels can't go through it
+	bool IsIntegerFormat(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8_UINT:
+		case VK_FORMAT_R8_SINT:
+		case VK_FORMAT_R8G8_UINT:
+		case VK_FORMAT_R8G8_SINT:
+		case VK_FORMAT_R8G8B8A8_UINT:
+		case VK_FORMAT_R8G8B8A8_SINT:
+		case VK_FORMAT_B8G8R8A8_UINT:
+		case VK_FORMAT_B8G8R8A8_SINT:
+		case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+		case VK_FORMAT_R16_UINT:
+		case VK_FORMAT_R16_SINT:
+		case VK_FORMAT_R16G16_UINT:
+		case VK_FORMAT_R16G16_SINT:
+		case VK_FORMAT_R16G16B16A16_UINT:
+		case VK_FORMAT_R16G16B16A16_SINT:
+		case VK_FORMAT_R32_UINT:
+		case VK_FORMAT_R32_SINT:
+		case VK_FORMAT_R32G32_UINT:
+		case VK_FORMAT_R32G32_SINT:
+		case VK_FORMAT_R32G32B32A32_UINT:
+		case VK_FORMAT_R32G32B32A32_SINT:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	VkImageMemoryBarrier LevelBarrier(VkImage image, VkImageAspectFlags aspect, u32 baseLevel, u32 levelCount, u32 layerCount,
+		VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = aspect;
+		barrier.subresourceRange.baseMipLevel = baseLevel;
+		barrier.subresourceRange.levelCount = levelCount;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = layerCount;
+		return barrier;
+	}
+}
+
+MipGenerator::MipGenerator(Device &device) :
+	pDevice(device),
+	pCommandPool(VK_NULL_HANDLE),
+	pArrSubmissions(),
+	pArrRequests(),
+	iUploadValue(0),
+	pDownsampleShader(),
+	pDownsampleSetLayout(VK_NULL_HANDLE),
+	pDownsampleLayout(VK_NULL_HANDLE),
+	pDownsamplePipeline(VK_NULL_HANDLE),
+	bDownsampleMissing(false),
+	iLastValue(0),
+	iImageCount(0),
+	iSubmissionCount(0)
+{
+}
+
+MipGenerator::~MipGenerator()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void MipGenerator::Create()
+{
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = pDevice.GetQueueFamilyIndices().graphicsFamily;
+
+	VK_CHECK_RESULT(vkCreateCommandPool(pDevice.GetVkNative(), &commandPoolCreateInfo, nullptr, &pCommandPool));
+}
+
+void MipGenerator::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+
+	pDevice.GetGraphicsTimeline().Wait(iLastValue);
+
+	for (Submission &submission : pArrSubmissions)
+	{
+		submission.pDescriptors->Destroy();
+	}
+	pArrSubmissions.clear();
+	pArrRequests.clear();
+
+	if (pDownsamplePipeline != VK_NULL_HANDLE)
+	{
+		vkDestroyPipeline(pDevice.GetVkNative(), pDownsamplePipeline, nullptr);
+		pDownsamplePipeline = VK_NULL_HANDLE;
+	}
+	if (pDownsampleShader)
+	{
+		pDownsampleShader->Destroy();
+		pDownsampleShader.reset();
+	}
+
+	if (pCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(pDevice.GetVkNative(), pCommandPool, nullptr);
+		pCommandPool = VK_NULL_HANDLE;
+	}
+}
+
+bool MipGenerator::IsValid() const
+{
+	return pCommandPool != VK_NULL_HANDLE;
+}
+
+MipGenerator::Method MipGenerator::GetMethod(VkFormat format)
+{
+	VkFormatFeatureFlags features = pDevice.GetPhysicalDevice().GetFormatProperties(format).optimalTilingFeatures;
+
+	const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((features & blitFeatures) == blitFeatures)
+	{
+		return Method::Blit;
+	}
+
+	// The shader writes without a format qualifier so one pipeline covers every format
+	const VkFormatFeatureFlags computeFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+	if ((features & computeFeatures) != computeFeatures || IsIntegerFormat(format) || !pDevice.HasStorageImageWriteWithoutFormat())
+	{
+		return Method::None;
+	}
+
+	lock_guard<mutex> lock(mLock);
+	return CreateDownsamplePipeline() ? Method::Compute : Method::None;
+}
+
+VkImageUsageFlags MipGenerator::GetRequiredUsage(Method method)
+{
+	switch (method)
+	{
+	case Method::Blit:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	case Method::Compute:
+		return VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+	default:
+		return 0;
+	}
+}
+
+u32 MipGenerator::GetMipLevelCount(VkExtent2D extent)
+{
+	return ::GetMipLevelCount(extent);
+}
+
+void MipGenerator::Generate(const Image &image, u64 uploadValue)
+{
+	if (image.GetMipLevels() <= 1)
+	{
+		return;
+	}
+
+	Method method = GetMethod(image.GetFormat());
+	ASSERT(method != Method::None, "Mips of this format can't be generated on this device");
+
+	lock_guard<mutex> lock(mLock);
+
+	Request request = {};
+	request.pImage = image.GetVkNative();
+	request.sExtent = image.GetExtent();
+	request.eFormat = image.GetFormat();
+	request.iMipLevels = image.GetMipLevels();
+	request.iArrayLayers = image.GetArrayLayers();
+	request.eMethod = method;
+	pArrRequests.push_back(request);
+
+	iUploadValue = max(iUploadValue, uploadValue);
+}
+
+u64 MipGenerator::Flush()
+{
+	lock_guard<mutex> lock(mLock);
+
+	if (pArrRequests.empty())
+	{
+		return iLastValue;
+	}
+
+	// The graphics queue is going to wait on these copies, they have to be on their way
+	UploadQueue &uploadQueue = pDevice.GetUploadQueue();
+	if (iUploadValue > uploadQueue.GetTimeline().GetSubmittedValue())
+	{
+		uploadQueue.Flush();
+	}
+
+	Vec<const Request *> blits;
+	Vec<const Request *> downsamples;
+	for (const Request &request : pArrRequests)
+	{
+		(request.eMethod == Method::Blit ? blits : downsamples).push_back(&request);
+	}
+
+	Submission &submission = AcquireSubmission();
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK_RESULT(vkBeginCommandBuffer(submission.pCommandBuffer, &beginInfo));
+
+	Vec<VkImageView> views;
+	RecordBlits(submission.pCommandBuffer, blits);
+	RecordDownsamples(submission.pCommandBuffer, downsamples, *submission.pDescriptors, views);
+
+	VK_CHECK_RESULT(vkEndCommandBuffer(submission.pCommandBuffer));
+
+	SemaphoreWait uploadWait;
+	uploadWait.semaphore = uploadQueue.GetTimeline().GetVkNative();
+	uploadWait.value = iUploadValue;
+	uploadWait.stage = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	iLastValue = pDevice.GetGraphicsTimeline().Submit({ submission.pCommandBuffer }, { uploadWait });
+	submission.iValue = iLastValue;
+
+	// Only now, released any earlier they could go before the submission that uses them completed
+	for (VkImageView view : views)
+	{
+		pDevice.GetDeferredDestroyQueue().DestroyImageView(view);
+	}
+
+	iImageCount += pArrRequests.size();
+	iSubmissionCount++;
+	pArrRequests.clear();
+	iUploadValue = 0;
+
+	return iLastValue;
+}
+
+u64 MipGenerator::GetImageCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return iImageCount;
+}
+
+u64 MipGenerator::GetSubmissionCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return iSubmissionCount;
+}
+
+void MipGenerator::RecordBlits(VkCommandBuffer commandBuffer, const Vec<const Request *> &requests) const
+{
+	if (requests.empty())
+	{
+		return;
+	}
+
+	u32 maxLevels = 0;
+	for (const Request *pRequest : requests)
+	{
+		maxLevels = max(maxLevels, pRequest->iMipLevels);
+	}
+
+	Vec<VkImageMemoryBarrier> barriers;
+	for (u32 level = 1; level < maxLevels; level++)
+	{
+		// The level above becomes the source, the level itself the destination, for every image at once
+		barriers.clear();
+		for (const Request *pRequest : requests)
+		{
+			if (level >= pRequest->iMipLevels)
+			{
+				continue;
+			}
+
+			VkImageAspectFlags aspect = Image::GetAspectMask(pRequest->eFormat);
+			bool bFirst = level == 1;
+			barriers.push_back(LevelBarrier(pRequest->pImage, aspect, level - 1, 1, pRequest->iArrayLayers,
+				bFirst ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				bFirst ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT));
+			barriers.push_back(LevelBarrier(pRequest->pImage, aspect, level, 1, pRequest->iArrayLayers,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<u32>(barriers.size()), barriers.data());
+
+		for (const Request *pRequest : requests)
+		{
+			if (level >= pRequest->iMipLevels)
+			{
+				continue;
+			}
+
+			VkImageAspectFlags aspect = Image::GetAspectMask(pRequest->eFormat);
+
+			VkImageBlit blit = {};
+			blit.srcSubresource = { aspect, level - 1, 0, pRequest->iArrayLayers };
+			blit.srcOffsets[1] = { static_cast<i32>(GetMipSize(pRequest->sExtent.width, level - 1)), static_cast<i32>(GetMipSize(pRequest->sExtent.height, level - 1)), 1 };
+			blit.dstSubresource = { aspect, level, 0, pRequest->iArrayLayers };
+			blit.dstOffsets[1] = { static_cast<i32>(GetMipSize(pRequest->sExtent.width, level)), static_cast<i32>(GetMipSize(pRequest->sExtent.height, level)), 1 };
+
+			vkCmdBlitImage(commandBuffer, pRequest->pImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pRequest->pImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+		}
+	}
+
+	// Every level was a source except the last, which was only written.
+	// Visibility for whoever samples them comes from waiting on the timeline semaphore.
+	barriers.clear();
+	for (const Request *pRequest : requests)
+	{
+		VkImageAspectFlags aspect = Image::GetAspectMask(pRequest->eFormat);
+		u32 last = pRequest->iMipLevels - 1;
+		barriers.push_back(LevelBarrier(pRequest->pImage, aspect, 0, last, pRequest->iArrayLayers,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, 0));
+		barriers.push_back(LevelBarrier(pRequest->pImage, aspect, last, 1, pRequest->iArrayLayers,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+		static_cast<u32>(barriers.size()), barriers.data());
+}
+
+void MipGenerator::RecordDownsamples(VkCommandBuffer commandBuffer, const Vec<const Request *> &requests, DescriptorAllocator &descriptors, Vec<VkImageView> &views) const
+{
+	if (requests.empty())
+	{
+		return;
+	}
+
+	// Everything stays in GENERAL while the chain is built, it is sampled and written level by level
+	u32 maxLevels = 0;
+	Vec<VkImageMemoryBarrier> barriers;
+	Vec<size_t> firstViews;
+	for (const Request *pRequest : requests)
+	{
+		maxLevels = max(maxLevels, pRequest->iMipLevels);
+
+		VkImageAspectFlags aspect = Image::GetAspectMask(pRequest->eFormat);
+		barriers.push_back(LevelBarrier(pRequest->pImage, aspect, 0, 1, pRequest->iArrayLayers,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_READ_BIT));
+		barriers.push_back(LevelBarrier(pRequest->pImage, aspect, 1, pRequest->iMipLevels - 1, pRequest->iArrayLayers,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT));
+
+		// One view per level and layer, [layer * levels + level]
+		firstViews.push_back(views.size());
+		for (u32 layer = 0; layer < pRequest->iArrayLayers; layer++)
+		{
+			for (u32 level = 0; level < pRequest->iMipLevels; level++)
+			{
+				VkImageViewCreateInfo viewCreateInfo = {};
+				viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+				viewCreateInfo.image = pRequest->pImage;
+				viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewCreateInfo.format = pRequest->eFormat;
+				viewCreateInfo.subresourceRange = { aspect, level, 1, layer, 1 };
+
+				VkImageView view;
+				VK_CHECK_RESULT(vkCreateImageView(pDevice.GetVkNative(), &viewCreateInfo, nullptr, &view));
+				views.push_back(view);
+			}
+		}
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+		static_cast<u32>(barriers.size()), barriers.data());
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pDownsamplePipeline);
+
+	for (u32 level = 1; level < maxLevels; level++)
+	{
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			const Request &request = *requests[i];
+			if (level >= request.iMipLevels)
+			{
+				continue;
+			}
+
+			DownsampleConstants constants = {};
+			constants.srcSize[0] = GetMipSize(request.sExtent.width, level - 1);
+			constants.srcSize[1] = GetMipSize(request.sExtent.height, level - 1);
+			constants.dstSize[0] = GetMipSize(request.sExtent.width, level);
+			constants.dstSize[1] = GetMipSize(request.sExtent.height, level);
+			vkCmdPushConstants(commandBuffer, pDownsampleLayout, VK_SHADER_STAGE_ALL, 0, sizeof(constants), &constants);
+
+			for (u32 layer = 0; layer < request.iArrayLayers; layer++)
+			{
+				size_t first = firstViews[i] + static_cast<size_t>(layer) * request.iMipLevels;
+				VkDescriptorSet set = descriptors.Allocate(pDownsampleSetLayout, {
+					DescriptorWrite::Image(0, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, views[first + level - 1], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL),
+					DescriptorWrite::Image(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, views[first + level], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL)
+				});
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pDownsampleLayout, 0, 1, &set, 0, nullptr);
+
+				vkCmdDispatch(commandBuffer, (constants.dstSize[0] + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE,
+					(constants.dstSize[1] + DOWNSAMPLE_GROUP_SIZE - 1) / DOWNSAMPLE_GROUP_SIZE, 1);
+			}
+		}
+
+		// The next level reads what this one wrote, one global barrier covers every image
+		VkMemoryBarrier memoryBarrier = {};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	barriers.clear();
+	for (const Request *pRequest : requests)
+	{
+		barriers.push_back(LevelBarrier(pRequest->pImage, Image::GetAspectMask(pRequest->eFormat), 0, pRequest->iMipLevels, pRequest->iArrayLayers,
+			VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, 0));
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+		static_cast<u32>(barriers.size()), barriers.data());
+}
+
+bool MipGenerator::CreateDownsamplePipeline()
+{
+	if (pDownsamplePipeline != VK_NULL_HANDLE || bDownsampleMissing)
+	{
+		return pDownsamplePipeline != VK_NULL_HANDLE;
+	}
+
+	if (!filesystem::exists(DOWNSAMPLE_SHADER))
+	{
+		cout << "WARNING: " << DOWNSAMPLE_SHADER << " missing, mips of formats that can't be blitted won't be generated" << endl;
+		bDownsampleMissing = true;
+		return false;
+	}
+
+	pDownsampleShader = make_shared<Shader>(pDevice, DOWNSAMPLE_SHADER);
+	pDownsampleShader->Create();
+
+	// Sampled image and storage image at set 0, never bindless compatible, so this gets its own layout
+	PipelineLayoutDesc layoutDesc;
+	layoutDesc.Merge(pDownsampleShader->GetReflection());
+	PipelineLayoutCache &layoutCache = pDevice.GetPipelineLayoutCache();
+	pDownsampleSetLayout = layoutCache.GetSetLayout(layoutDesc.sets[0]);
+	pDownsampleLayout = layoutCache.GetPipelineLayout(layoutDesc);
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage = pDownsampleShader->GetStageCreateInfo();
+	pipelineCreateInfo.layout = pDownsampleLayout;
+
+	VK_CHECK_RESULT(vkCreateComputePipelines(pDevice.GetVkNative(), pDevice.GetPipelineCache().GetVkNative(), 1, &pipelineCreateInfo, nullptr, &pDownsamplePipeline));
+	return true;
+}
+
+MipGenerator::Submission &MipGenerator::AcquireSubmission()
+{
+	// Oldest submission first, reuse its command buffer and descriptor pools if it's done
+	if (!pArrSubmissions.empty() && pArrSubmissions.front().iValue <= pDevice.GetGraphicsTimeline().GetCompletedValue())
+	{
+		Submission reused = pArrSubmissions.front();
+		pArrSubmissions.pop_front();
+
+		VK_CHECK_RESULT(vkResetCommandBuffer(reused.pCommandBuffer, 0));
+		reused.pDescriptors->Reset();
+		reused.iValue = UINT64_MAX;
+		pArrSubmissions.push_back(reused);
+		return pArrSubmissions.back();
+	}
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = pCommandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	// Not reusable before it was submitted and completed
+	Submission submission = { VK_NULL_HANDLE, nullptr, UINT64_MAX };
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(pDevice.GetVkNative(), &allocateInfo, &submission.pCommandBuffer));
+
+	submission.pDescriptors = make_shared<DescriptorAllocator>(pDevice, Vec<DescriptorAllocator::PoolRatio>{
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f }
+	});
+	submission.pDescriptors->Create();
+
+	pArrSubmissions.push_back(submission);
+	return pArrSubmissions.back();
+}
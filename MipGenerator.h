@@ -0,0 +1,123 @@
+#pragma once
+
+class Device;
+class Image;
+class Shader;
+class DescriptorAllocator;
+
+// Fills the mip chain of images whose top level was uploaded, on the GPU.
+// Formats that can be blitted with linear filtering get a chain of vkCmdBlitImage, each level from
+// the one above. Anything else that can be written as a storage image goes through a compute
+// downsample instead (Shaders/Downsample.comp). Everything queued is recorded into one command buffer
+// on the graphics queue, level by level across all images, so there is one barrier batch per level
+// rather than one per level per image. The submission waits on the upload timeline for the top levels.
+class MipGenerator : public IVkResource, public NonCopyable
+{
+public:
+
+	static constexpr const char *DOWNSAMPLE_SHADER = "Shaders/Downsample.comp.spv";
+
+	// Has to match local_size_x and local_size_y of the shader
+	static constexpr u32 DOWNSAMPLE_GROUP_SIZE = 8;
+
+	enum class Method
+	{
+		None,
+		Blit,
+		Compute
+	};
+
+private:
+
+	struct Request
+	{
+		VkImage pImage;
+		VkExtent2D sExtent;
+		VkFormat eFormat;
+		u32 iMipLevels;
+		u32 iArrayLayers;
+		Method eMethod;
+	};
+
+	struct Submission
+	{
+		VkCommandBuffer pCommandBuffer;
+		Ref<DescriptorAllocator> pDescriptors;
+		u64 iValue;
+	};
+
+	// Push constants of the downsample shader
+	struct DownsampleConstants
+	{
+		u32 srcSize[2];
+		u32 dstSize[2];
+	};
+
+	Device &pDevice;
+
+	VkCommandPool pCommandPool;
+	deque<Submission> pArrSubmissions;
+
+	Vec<Request> pArrRequests;
+	u64 iUploadValue;
+
+	// Compute path, set up the first time an image needs it
+	Ref<Shader> pDownsampleShader;
+	VkDescriptorSetLayout pDownsampleSetLayout;
+	VkPipelineLayout pDownsampleLayout;
+	VkPipeline pDownsamplePipeline;
+	bool bDownsampleMissing;
+
+	// Graphics timeline value of the last submission
+	u64 iLastValue;
+
+	u64 iImageCount;
+	u64 iSubmissionCount;
+
+	mutex mLock;
+
+public:
+
+	MipGenerator(Device &device);
+	~MipGenerator();
+
+public:
+
+	void Create() override;
+
+	// Waits for what was submitted
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// How mips of the format would be generated, None if neither way works on this device
+	Method GetMethod(VkFormat format);
+
+	// Usage an image needs on top of its own for the method to work on it
+	static VkImageUsageFlags GetRequiredUsage(Method method);
+
+	// Levels down to 1x1
+	static u32 GetMipLevelCount(VkExtent2D extent);
+
+	// Queue filling levels 1 and up from level 0, which the upload timeline finishes writing at uploadValue
+	// and leaves in SHADER_READ_ONLY_OPTIMAL. Every level is SHADER_READ_ONLY_OPTIMAL afterwards. The image
+	// has to be alive until the submission has completed.
+	void Generate(const Image &image, u64 uploadValue);
+
+	// Record and submit everything queued. Returns the graphics timeline value it is all done at,
+	// the last one submitted if nothing was queued.
+	u64 Flush();
+
+	u64 GetImageCount();
+	u64 GetSubmissionCount();
+
+private:
+
+	void RecordBlits(VkCommandBuffer commandBuffer, const Vec<const Request *> &requests) const;
+
+	// Creates a view per level and layer, which have to be released once the submission is out
+	void RecordDownsamples(VkCommandBuffer commandBuffer, const Vec<const Request *> &requests, DescriptorAllocator &descriptors, Vec<VkImageView> &views) const;
+	bool CreateDownsamplePipeline();
+	Submission &AcquireSubmission();
+};
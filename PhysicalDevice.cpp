@@ -21,7 +21,7 @@ PhysicalDevice::~PhysicalDevice()
 
 VkPhysicalDevice PhysicalDevice::GetVkNative() const
 {
-	return VkPhysicalDevice();
+	return pPhysicalDevice;
 }
 
 VkPhysicalDeviceProperties PhysicalDevice::GetProperties() const
@@ -31,6 +31,20 @@ VkPhysicalDeviceProperties PhysicalDevice::GetProperties() const
 	return properties;
 }
 
+VkPhysicalDeviceVulkan12Properties PhysicalDevice::GetVulkan12Properties() const
+{
+	VkPhysicalDeviceVulkan12Properties properties12 = {};
+	properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &properties12;
+	vkGetPhysicalDeviceProperties2(pPhysicalDevice, &properties);
+
+	properties12.pNext = nullptr;
+	return properties12;
+}
+
 VkPhysicalDeviceFeatures PhysicalDevice::GetFeatures() const
 {
 	VkPhysicalDeviceFeatures features;
@@ -56,6 +70,18 @@ Vec<VkQueueFamilyProperties> PhysicalDevice::GetQueueFamilyProperties() const
 	return queueFamilyProperties;
 }
 
+bool PhysicalDevice::SupportsExtension(const char *name) const
+{
+	for (const VkExtensionProperties &extension : EnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr))
+	{
+		if (strcmp(extension.extensionName, name) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 VkFormatProperties PhysicalDevice::GetFormatProperties(VkFormat format) const
 {
 	VkFormatProperties formatProperties;
@@ -79,7 +105,7 @@ Vec<VkSparseImageFormatProperties> PhysicalDevice::GetSparseImageFormatPropertie
 	return sparseImageFormatProperties;
 }
 
-void PhysicalDevice::FindQueueFamilies()
+void PhysicalDevice::FindQueueFamilies(VkSurfaceKHR surface)
 {
 	sQueueFamilyIndices = QueueFamilyIndices{};
 
@@ -89,21 +115,85 @@ void PhysicalDevice::FindQueueFamilies()
 	Vec<VkQueueFamilyProperties> queueFamilyProperties(iArrQueueFamilyPropertyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &iArrQueueFamilyPropertyCount, queueFamilyProperties.data());
 
-	for (auto &queueFamilyProperty : queueFamilyProperties)
+	bool bFoundGraphics = false;
+	bool bFoundPresent = false;
+	bool bFoundCombined = false;
+
+	for (u32 i = 0; i < iArrQueueFamilyPropertyCount && !bFoundCombined; i++)
 	{
-		if (queueFamilyProperty.queueCount > 0 && queueFamilyProperty.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		const VkQueueFamilyProperties &queueFamilyProperty = queueFamilyProperties[i];
+		if (queueFamilyProperty.queueCount == 0)
+		{
+			continue;
+		}
+
+		bool bGraphics = (queueFamilyProperty.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+
+		VkBool32 presentSupport = VK_FALSE;
+		if (surface != VK_NULL_HANDLE)
 		{
-			sQueueFamilyIndices.graphicsFamily = &queueFamilyProperty - queueFamilyProperties.data();
+			vkGetPhysicalDeviceSurfaceSupportKHR(pPhysicalDevice, i, surface, &presentSupport);
 		}
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(pPhysicalDevice, sQueueFamilyIndices.graphicsFamily, nullptr, &presentSupport);
-		if (queueFamilyProperty.queueCount > 0 && presentSupport)
+
+		// Prefer a single family that can do both, it avoids concurrent sharing on the swap chain images
+		if (bGraphics && presentSupport)
 		{
-			sQueueFamilyIndices.presentFamily = &queueFamilyProperty - queueFamilyProperties.data();
+			sQueueFamilyIndices.graphicsFamily = i;
+			sQueueFamilyIndices.presentFamily = i;
+			bFoundGraphics = true;
+			bFoundPresent = true;
+			bFoundCombined = true;
+			continue;
 		}
-		if (sQueueFamilyIndices.IsComplete())
+
+		if (bGraphics && !bFoundGraphics)
+		{
+			sQueueFamilyIndices.graphicsFamily = i;
+			bFoundGraphics = true;
+		}
+
+		if (presentSupport && !bFoundPresent)
+		{
+			sQueueFamilyIndices.presentFamily = i;
+			bFoundPresent = true;
+		}
+	}
+
+	// Without a surface there is nothing to present to, so present through the graphics queue
+	if (!bFoundPresent)
+	{
+		sQueueFamilyIndices.presentFamily = sQueueFamilyIndices.graphicsFamily;
+	}
+
+	// A family with transfer but no graphics or compute is usually a DMA engine that copies
+	// while the graphics queue keeps rendering. Take one without graphics as second best.
+	sQueueFamilyIndices.transferFamily = sQueueFamilyIndices.graphicsFamily;
+	u32 bestTransferScore = 0;
+	for (u32 i = 0; i < iArrQueueFamilyPropertyCount; i++)
+	{
+		VkQueueFlags flags = queueFamilyProperties[i].queueFlags;
+		if (queueFamilyProperties[i].queueCount == 0 || (flags & VK_QUEUE_TRANSFER_BIT) == 0)
+		{
+			continue;
+		}
+
+		// Coarser granularity would rule out copying small mip levels
+		VkExtent3D granularity = queueFamilyProperties[i].minImageTransferGranularity;
+		if (granularity.width != 1 || granularity.height != 1 || granularity.depth != 1)
+		{
+			continue;
+		}
+
+		u32 score = 0;
+		if ((flags & VK_QUEUE_GRAPHICS_BIT) == 0)
+		{
+			score = (flags & VK_QUEUE_COMPUTE_BIT) == 0 ? 2 : 1;
+		}
+
+		if (score > bestTransferScore)
 		{
-			break;
+			sQueueFamilyIndices.transferFamily = i;
+			bestTransferScore = score;
 		}
 	}
 }
@@ -25,6 +25,9 @@ public:
 	// Get the properties of the physical device
 	VkPhysicalDeviceProperties GetProperties() const;
 
+	// Vulkan 1.2 limits, e.g. how big update after bind descriptor arrays may get
+	VkPhysicalDeviceVulkan12Properties GetVulkan12Properties() const;
+
 	// Get the features of the physical device
 	VkPhysicalDeviceFeatures GetFeatures() const;
 
@@ -34,6 +37,9 @@ public:
 	// Get the queue family properties of the physical device
 	Vec<VkQueueFamilyProperties> GetQueueFamilyProperties() const;
 
+	// True if the device exposes the extension, e.g. VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME
+	bool SupportsExtension(const char *name) const;
+
 	// Get the format properties of the physical device
 	VkFormatProperties GetFormatProperties(VkFormat format) const;
 
@@ -43,7 +49,9 @@ public:
 	// Get the sparse image format properties of the physical device
 	Vec<VkSparseImageFormatProperties> GetSparseImageFormatProperties(VkFormat format, VkImageType type, VkSampleCountFlagBits samples, VkImageUsageFlags usage, VkImageTiling tiling) const;
 
-	void FindQueueFamilies();
+	// Find the graphics and present queue families.
+	// The surface is used to check for present support, pass VK_NULL_HANDLE to skip the check.
+	void FindQueueFamilies(VkSurfaceKHR surface);
 
 	// Get the queue family indices of the physical device
 	const QueueFamilyIndices &GetQueueFamilyIndices() const;
@@ -1,26 +1,32 @@
 #pragma once
 
 #include "Pipeline.h"
-#include "Surface.h"
 #include "Device.h"
-#include "PhysicalDevice.h"
-#include "Shader.h"
+#include "PipelineCache.h"
+#include "DeferredDestroyQueue.h"
+#include "RenderPassCache.h"
+#include "Image.h"
+#include "PipelineLayoutCache.h"
 
-Pipeline::Pipeline(Device &rDevice, Surface &rSurface) :
-	pDevice(rDevice),
-	pSurface(rSurface),
+Pipeline::Pipeline(Device &rDevice, const PipelineStateDesc &desc) :
 	pPipeline(VK_NULL_HANDLE),
 	pLayout(VK_NULL_HANDLE),
-	pPipelineInfo(make_shared<VkPipelineInputAssemblyStateCreateInfo>())
+	pVkPipelineCache(VK_NULL_HANDLE),
+	pDevice(rDevice),
+	sDesc(desc),
+	iHash(desc.Hash())
 {
 }
 
 Pipeline::~Pipeline()
 {
+	Destroy();
 }
 
 void Pipeline::Create()
 {
+	ASSERT(sDesc.shaderStageCount > 0, "Pipeline desc has no shader stages");
+
 	Vec<VkDynamicState> dynamicStates = {
 		VK_DYNAMIC_STATE_VIEWPORT,
 		VK_DYNAMIC_STATE_SCISSOR
@@ -33,113 +39,160 @@ void Pipeline::Create()
 
 	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
 	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
+	vertexInputCreateInfo.vertexBindingDescriptionCount = sDesc.vertexBindingCount;
+	vertexInputCreateInfo.pVertexBindingDescriptions = sDesc.vertexBindings;
+	vertexInputCreateInfo.vertexAttributeDescriptionCount = sDesc.vertexAttributeCount;
+	vertexInputCreateInfo.pVertexAttributeDescriptions = sDesc.vertexAttributes;
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
 	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
-
-	auto &swapChainDetails = pSurface.GetSwapChainSupportDetails(pDevice.GetPhysicalDevice());
-	auto extent = pSurface.ChooseSwapExtent(swapChainDetails.capabilities);
-
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<f32>(extent.width);
-	viewport.height = static_cast<f32>(extent.height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = extent;
+	inputAssemblyCreateInfo.topology = sDesc.topology;
+	inputAssemblyCreateInfo.primitiveRestartEnable = sDesc.primitiveRestartEnable;
 
+	// Viewport and scissor are dynamic, only the count matters here
 	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
 	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewport;
 	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
 
 	VkPipelineRasterizationStateCreateInfo rasterizationCreateInfo = {};
 	rasterizationCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	rasterizationCreateInfo.depthClampEnable = VK_FALSE;
+	rasterizationCreateInfo.depthClampEnable = sDesc.depthClampEnable;
 	rasterizationCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-	rasterizationCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-	rasterizationCreateInfo.lineWidth = 1.0f;
-	rasterizationCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-	rasterizationCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	rasterizationCreateInfo.depthBiasEnable = VK_FALSE;
+	rasterizationCreateInfo.polygonMode = sDesc.polygonMode;
+	rasterizationCreateInfo.lineWidth = sDesc.lineWidth;
+	rasterizationCreateInfo.cullMode = sDesc.cullMode;
+	rasterizationCreateInfo.frontFace = sDesc.frontFace;
+	rasterizationCreateInfo.depthBiasEnable = sDesc.depthBiasEnable;
 
 	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
 	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
-	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	
-	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+	multisampleCreateInfo.rasterizationSamples = sDesc.samples;
 
-	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = sDesc.depthTestEnable;
+	depthStencilCreateInfo.depthWriteEnable = sDesc.depthWriteEnable;
+	depthStencilCreateInfo.depthCompareOp = sDesc.depthCompareOp;
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
 
 	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo = {};
 	colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlendCreateInfo.logicOpEnable = VK_FALSE;
 	colorBlendCreateInfo.logicOp = VK_LOGIC_OP_COPY;
-	colorBlendCreateInfo.attachmentCount = 1;
-	colorBlendCreateInfo.pAttachments = &colorBlendAttachment;
+	colorBlendCreateInfo.attachmentCount = sDesc.colorTargetCount;
+	colorBlendCreateInfo.pAttachments = sDesc.blendStates;
 
-	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
-	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.setLayoutCount = 0;
-	layoutCreateInfo.pSetLayouts = nullptr;
-	layoutCreateInfo.pushConstantRangeCount = 0;
-	layoutCreateInfo.pPushConstantRanges = nullptr;
-
-	VK_CHECK_RESULT(
-		vkCreatePipelineLayout(
-			pDevice.GetVkNative(),
-			&layoutCreateInfo,
-			nullptr,
-			&pLayout
-		)
-	);
+	// Without a layout of its own it gets one merged from what its stages declare, shared by every pipeline
+	// declaring the same. Stages that only use the bindless set and push constants get the bindless layout.
+	pLayout = sDesc.layout;
+	if (pLayout == VK_NULL_HANDLE)
+	{
+		PipelineLayoutDesc layoutDesc;
+		for (u32 i = 0; i < sDesc.shaderStageCount; i++)
+		{
+			if (sDesc.shaderStages[i].reflection)
+			{
+				layoutDesc.Merge(*sDesc.shaderStages[i].reflection);
+			}
+		}
+		pLayout = pDevice.GetPipelineLayoutCache().GetPipelineLayout(layoutDesc);
+	}
 
-	VkPipelineShaderStageCreateInfo shaderStages = {};
-	shaderStages.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shaderStages.stage = VK_SHADER_STAGE_VERTEX_BIT;
+	// Inputs without an attribute read undefined values, almost always a mistake in the desc
+	for (u32 i = 0; i < sDesc.shaderStageCount; i++)
+	{
+		const ShaderReflection *pReflection = sDesc.shaderStages[i].reflection;
+		if (!pReflection || sDesc.shaderStages[i].stage != VK_SHADER_STAGE_VERTEX_BIT)
+		{
+			continue;
+		}
+
+		for (const ShaderVertexInput &input : pReflection->vertexInputs)
+		{
+			bool bFound = false;
+			for (u32 j = 0; j < sDesc.vertexAttributeCount && !bFound; j++)
+			{
+				bFound = sDesc.vertexAttributes[j].location == input.location;
+			}
+
+			if (!bFound)
+			{
+				cout << "WARNING: Vertex shader input at location " << input.location << " has no vertex attribute" << endl;
+			}
+		}
+	}
 
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
-	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	Vec<VkPipelineShaderStageCreateInfo> vecShaderStages(sDesc.shaderStageCount);
+	for (u32 i = 0; i < sDesc.shaderStageCount; i++)
+	{
+		vecShaderStages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		vecShaderStages[i].stage = sDesc.shaderStages[i].stage;
+		vecShaderStages[i].module = sDesc.shaderStages[i].module;
+		vecShaderStages[i].pName = sDesc.shaderStages[i].reflection ? sDesc.shaderStages[i].reflection->GetEntryPointName() : "main";
+	}
 
-	// Get stages
-	Vec<VkPipelineShaderStageCreateInfo> vecShaderStages(vShaderStages.size());
-	for (auto *shader : vShaderStages) {
-		vecShaderStages.push_back(shader->GetStageCreateInfo());
+	// Without a render pass the pipeline is built against the target formats, and can be used in any
+	// dynamic rendering scope or cached render pass with the same formats
+	VkPipelineRenderingCreateInfo renderingCreateInfo = {};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingCreateInfo.colorAttachmentCount = sDesc.colorTargetCount;
+	renderingCreateInfo.pColorAttachmentFormats = sDesc.colorFormats;
+	renderingCreateInfo.depthAttachmentFormat = sDesc.depthFormat;
+	renderingCreateInfo.stencilAttachmentFormat = (Image::GetAspectMask(sDesc.depthFormat) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0 ? sDesc.depthFormat : VK_FORMAT_UNDEFINED;
+
+	VkRenderPass renderPass = sDesc.renderPass;
+	bool bDynamicRendering = renderPass == VK_NULL_HANDLE && pDevice.HasDynamicRendering();
+	if (renderPass == VK_NULL_HANDLE && !bDynamicRendering)
+	{
+		renderPass = pDevice.GetRenderPassCache().GetCompatibleRenderPass(sDesc);
 	}
 
-	pipelineCreateInfo.stageCount = vecShaderStages.size();
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = bDynamicRendering ? &renderingCreateInfo : nullptr;
+	pipelineCreateInfo.stageCount = static_cast<u32>(vecShaderStages.size());
 	pipelineCreateInfo.pStages = vecShaderStages.data();
 	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
 	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
 	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
 	pipelineCreateInfo.pRasterizationState = &rasterizationCreateInfo;
 	pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = sDesc.depthFormat != VK_FORMAT_UNDEFINED ? &depthStencilCreateInfo : nullptr;
 	pipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
 	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+	pipelineCreateInfo.layout = pLayout;
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.subpass = sDesc.subpass;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	// A warm cache turns this from a full compile into a lookup
+	VkPipelineCache cache = pVkPipelineCache != VK_NULL_HANDLE ? pVkPipelineCache : pDevice.GetPipelineCache().GetVkNative();
+	VK_CHECK_RESULT(
+		vkCreateGraphicsPipelines(
+			pDevice.GetVkNative(),
+			cache,
+			1,
+			&pipelineCreateInfo,
+			nullptr,
+			&pPipeline
+		)
+	);
 }
 
 void Pipeline::Destroy()
 {
-	if (pLayout != VK_NULL_HANDLE)
-	{
-		vkDestroyPipelineLayout(pDevice.GetVkNative(), pLayout, nullptr);
-	}
+	// The layout belongs to the desc or the layout cache
+	pLayout = VK_NULL_HANDLE;
 
+	// Frames in flight may still be bound to it
 	if (pPipeline != VK_NULL_HANDLE)
 	{
-		vkDestroyPipeline(pDevice.GetVkNative(), pPipeline, nullptr);
+		pDevice.GetDeferredDestroyQueue().DestroyPipeline(pPipeline);
+		pPipeline = VK_NULL_HANDLE;
 	}
 }
 
@@ -148,7 +201,27 @@ bool Pipeline::IsValid() const
 	return pPipeline != VK_NULL_HANDLE;
 }
 
-void Pipeline::AddShaderStage(Shader *stage)
+VkPipeline Pipeline::GetVkNative() const
+{
+	return pPipeline;
+}
+
+void Pipeline::SetPipelineCache(VkPipelineCache cache)
 {
-	vShaderStages.push_back(stage);
-}
\ No newline at end of file
+	pVkPipelineCache = cache;
+}
+
+const PipelineStateDesc &Pipeline::GetDesc() const
+{
+	return sDesc;
+}
+
+u64 Pipeline::GetHash() const
+{
+	return iHash;
+}
+
+VkPipelineLayout Pipeline::GetLayout() const
+{
+	return pLayout;
+}
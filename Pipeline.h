@@ -1,8 +1,8 @@
 #pragma once
 
+#include "PipelineStateDesc.h"
+
 class Device;
-class Surface;
-class Shader;
 
 // This shit is gonna make me hurt someone
 class Pipeline : public IVkResource, public NonCopyable
@@ -11,14 +11,15 @@ private:
 	VkPipeline pPipeline;
 	VkPipelineLayout pLayout;
 
-	Device &pDevice;
-	Surface &pSurface;
-	Vec<Shader *> vShaderStages;
+	// Cache to build against, the device cache if not set
+	VkPipelineCache pVkPipelineCache;
 
-	Ref<VkPipelineInputAssemblyStateCreateInfo> pPipelineInfo;
+	Device &pDevice;
+	PipelineStateDesc sDesc;
+	u64 iHash;
 
 public:
-	Pipeline(Device &rDevice, Surface &rSurface);
+	Pipeline(Device &rDevice, const PipelineStateDesc &desc);
 	~Pipeline();
 
 public:
@@ -26,8 +27,15 @@ public:
 	void Create() override;
 	void Destroy() override;
 	bool IsValid() const override;
+	VkPipeline GetVkNative() const;
 
 public:
 
-	void AddShaderStage(Shader *stage);
-};
\ No newline at end of file
+	// Build against another cache than the device one, e.g. a worker thread's own
+	void SetPipelineCache(VkPipelineCache cache);
+
+	const PipelineStateDesc &GetDesc() const;
+	u64 GetHash() const;
+
+	VkPipelineLayout GetLayout() const;
+};
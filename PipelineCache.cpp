@@ -0,0 +1,224 @@
+#pragma once
+
+#include "PipelineCache.h"
+#include "Device.h"
+#include "PhysicalDevice.h"
+#include "Hash.h"
+
+PipelineCache::PipelineCache(Device &device, const string &path) :
+	pVkPipelineCache(VK_NULL_HANDLE),
+	pDevice(device),
+	sPath(path),
+	bLoadedFromDisk(false)
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+	if (pVkPipelineCache != VK_NULL_HANDLE)
+	{
+		Destroy();
+	}
+}
+
+void PipelineCache::Create()
+{
+	Vec<u8> vInitialData = Load();
+	bLoadedFromDisk = !vInitialData.empty();
+
+	VkPipelineCacheCreateInfo cacheCreateInfo = {};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheCreateInfo.initialDataSize = vInitialData.size();
+	cacheCreateInfo.pInitialData = vInitialData.empty() ? nullptr : vInitialData.data();
+
+	VkResult result = vkCreatePipelineCache(pDevice.GetVkNative(), &cacheCreateInfo, nullptr, &pVkPipelineCache);
+
+	// The driver is allowed to reject data we thought was fine, start cold in that case
+	if (result != VK_SUCCESS && bLoadedFromDisk)
+	{
+		cout << "WARNING: Driver rejected pipeline cache " << sPath << ", starting cold" << endl;
+		bLoadedFromDisk = false;
+		cacheCreateInfo.initialDataSize = 0;
+		cacheCreateInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(pDevice.GetVkNative(), &cacheCreateInfo, nullptr, &pVkPipelineCache);
+	}
+
+	VK_CHECK_RESULT(result);
+}
+
+void PipelineCache::Destroy()
+{
+	if (pVkPipelineCache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	try
+	{
+		Save();
+	}
+	catch (const exception &e)
+	{
+		// Losing the cache only costs compile time next run, never fail shutdown over it
+		cout << "WARNING: Failed to save pipeline cache: " << e.what() << endl;
+	}
+
+	vkDestroyPipelineCache(pDevice.GetVkNative(), pVkPipelineCache, nullptr);
+	pVkPipelineCache = VK_NULL_HANDLE;
+}
+
+bool PipelineCache::IsValid() const
+{
+	return pVkPipelineCache != VK_NULL_HANDLE;
+}
+
+VkPipelineCache PipelineCache::GetVkNative() const
+{
+	return pVkPipelineCache;
+}
+
+void PipelineCache::Merge(const Vec<VkPipelineCache> &sources)
+{
+	if (sources.empty())
+	{
+		return;
+	}
+
+	lock_guard<mutex> lock(mLock);
+	VK_CHECK_RESULT(vkMergePipelineCaches(pDevice.GetVkNative(), pVkPipelineCache, static_cast<u32>(sources.size()), sources.data()));
+}
+
+void PipelineCache::Save()
+{
+	Vec<u8> vData = GetData();
+	if (vData.empty())
+	{
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties = pDevice.GetPhysicalDevice().GetProperties();
+
+	FileHeader header = {};
+	header.magic = FILE_MAGIC;
+	header.version = FILE_VERSION;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = vData.size();
+	header.dataHash = Hash64(vData.data(), vData.size());
+
+	// Write next to the real file and swap it in, a crash mid-write never leaves a torn cache behind
+	string sTempPath = sPath + ".tmp";
+	{
+		ofstream file(sTempPath, ios::binary | ios::trunc);
+		if (!file.is_open())
+		{
+			throw runtime_error("Failed to open file: " + sTempPath);
+		}
+
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char *>(vData.data()), vData.size());
+		file.flush();
+		if (!file.good())
+		{
+			throw runtime_error("Failed to write file: " + sTempPath);
+		}
+	}
+
+	filesystem::rename(sTempPath, sPath);
+}
+
+Vec<u8> PipelineCache::GetData() const
+{
+	size_t dataSize = 0;
+	VK_CHECK_RESULT(vkGetPipelineCacheData(pDevice.GetVkNative(), pVkPipelineCache, &dataSize, nullptr));
+
+	Vec<u8> vData(dataSize);
+	if (dataSize > 0)
+	{
+		VK_CHECK_RESULT(vkGetPipelineCacheData(pDevice.GetVkNative(), pVkPipelineCache, &dataSize, vData.data()));
+		vData.resize(dataSize);
+	}
+	return vData;
+}
+
+bool PipelineCache::WasLoadedFromDisk() const
+{
+	return bLoadedFromDisk;
+}
+
+Vec<u8> PipelineCache::Load() const
+{
+	ifstream file(sPath, ios::ate | ios::binary);
+	if (!file.is_open())
+	{
+		return {};
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	if (fileSize < sizeof(FileHeader))
+	{
+		return {};
+	}
+
+	FileHeader header = {};
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+	if (header.dataSize != fileSize - sizeof(FileHeader))
+	{
+		cout << "WARNING: Pipeline cache " << sPath << " is truncated, ignoring it" << endl;
+		return {};
+	}
+
+	Vec<u8> vData(static_cast<size_t>(header.dataSize));
+	file.read(reinterpret_cast<char *>(vData.data()), vData.size());
+	if (!file.good() || !Validate(header, vData))
+	{
+		return {};
+	}
+
+	return vData;
+}
+
+bool PipelineCache::Validate(const FileHeader &header, const Vec<u8> &data) const
+{
+	if (header.magic != FILE_MAGIC || header.version != FILE_VERSION)
+	{
+		cout << "WARNING: Pipeline cache " << sPath << " has an unknown format, ignoring it" << endl;
+		return false;
+	}
+
+	if (Hash64(data.data(), data.size()) != header.dataHash)
+	{
+		cout << "WARNING: Pipeline cache " << sPath << " is corrupt, ignoring it" << endl;
+		return false;
+	}
+
+	VkPhysicalDeviceProperties properties = pDevice.GetPhysicalDevice().GetProperties();
+
+	if (header.vendorID != properties.vendorID ||
+		header.deviceID != properties.deviceID ||
+		header.driverVersion != properties.driverVersion ||
+		memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		cout << "Pipeline cache " << sPath << " was written by a different device or driver, ignoring it" << endl;
+		return false;
+	}
+
+	// The driver's own header has to agree as well
+	if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		return false;
+	}
+
+	VkPipelineCacheHeaderVersionOne vkHeader = {};
+	memcpy(&vkHeader, data.data(), sizeof(vkHeader));
+
+	return vkHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+		vkHeader.headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) &&
+		vkHeader.vendorID == properties.vendorID &&
+		vkHeader.deviceID == properties.deviceID &&
+		memcmp(vkHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
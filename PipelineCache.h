@@ -0,0 +1,70 @@
+#pragma once
+
+class Device;
+
+// Owns the device wide VkPipelineCache and keeps it on disk between runs.
+// The file is only accepted if it was written by the same driver for the same device,
+// anything else is thrown away and the cache starts cold.
+class PipelineCache : public IVkResource, public NonCopyable
+{
+public:
+
+	// Bump whenever the layout of the file header changes
+	static constexpr u32 FILE_VERSION = 1;
+	static constexpr u32 FILE_MAGIC = 0x43504c43; // "CLPC"
+
+	struct FileHeader
+	{
+		u32 magic;
+		u32 version;
+		u32 vendorID;
+		u32 deviceID;
+		u32 driverVersion;
+		u32 reserved;
+		u8 pipelineCacheUUID[VK_UUID_SIZE];
+		u64 dataSize;
+		u64 dataHash;
+	};
+
+private:
+	VkPipelineCache pVkPipelineCache;
+	Device &pDevice;
+	string sPath;
+	bool bLoadedFromDisk;
+
+	// vkMergePipelineCaches needs the destination externally synchronized
+	mutex mLock;
+
+public:
+
+	PipelineCache(Device &device, const string &path);
+	~PipelineCache();
+
+public:
+
+	// Create the cache, seeded from disk if a valid file exists
+	void Create() override;
+
+	// Write the cache back to disk and destroy it
+	void Destroy() override;
+	bool IsValid() const override;
+	VkPipelineCache GetVkNative() const;
+
+public:
+
+	// Fold caches filled by other threads into this one
+	void Merge(const Vec<VkPipelineCache> &sources);
+
+	// Write the current contents to disk, atomically replacing the old file
+	void Save();
+
+	// Current contents, e.g. to seed a worker thread's cache
+	Vec<u8> GetData() const;
+
+	bool WasLoadedFromDisk() const;
+
+private:
+
+	Vec<u8> Load() const;
+	bool Validate(const FileHeader &header, const Vec<u8> &data) const;
+};
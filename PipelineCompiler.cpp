@@ -0,0 +1,190 @@
+#pragma once
+
+#include "PipelineCompiler.h"
+#include "PipelineCache.h"
+#include "Pipeline.h"
+#include "PipelineRegistry.h"
+#include "Device.h"
+#include "JobSystem.h"
+
+PipelineCompiler::PipelineCompiler(Device &device) :
+	pDevice(device),
+	pArrThreadCaches(),
+	pCounter(make_shared<JobCounter>()),
+	pArrInFlight()
+{
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void PipelineCompiler::Create()
+{
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	ASSERT(jobSystem.IsValid(), "PipelineCompiler needs the job system to be created first");
+
+	// Seed every thread with what's already known so warm starts stay warm
+	Vec<u8> seed = pDevice.GetPipelineCache().GetData();
+
+	VkPipelineCacheCreateInfo cacheCreateInfo = {};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheCreateInfo.initialDataSize = seed.size();
+	cacheCreateInfo.pInitialData = seed.empty() ? nullptr : seed.data();
+
+	pArrThreadCaches.resize(jobSystem.GetThreadCount(), VK_NULL_HANDLE);
+	for (auto &cache : pArrThreadCaches)
+	{
+		VK_CHECK_RESULT(vkCreatePipelineCache(pDevice.GetVkNative(), &cacheCreateInfo, nullptr, &cache));
+	}
+}
+
+void PipelineCompiler::Destroy()
+{
+	WaitIdle();
+
+	for (auto cache : pArrThreadCaches)
+	{
+		vkDestroyPipelineCache(pDevice.GetVkNative(), cache, nullptr);
+	}
+	pArrThreadCaches.clear();
+}
+
+bool PipelineCompiler::IsValid() const
+{
+	return !pArrThreadCaches.empty();
+}
+
+PipelineCompiler::PipelineFuture PipelineCompiler::Submit(Ref<Pipeline> pipeline)
+{
+	return Enqueue(pipeline, false);
+}
+
+PipelineCompiler::PipelineFuture PipelineCompiler::Submit(const PipelineStateDesc &desc)
+{
+	if (Ref<Pipeline> existing = pDevice.GetPipelineRegistry().Find(desc))
+	{
+		promise<Ref<Pipeline>> ready;
+		ready.set_value(existing);
+		return ready.get_future().share();
+	}
+
+	u64 hash = desc.Hash();
+	{
+		lock_guard<mutex> lock(mLock);
+		auto it = pArrInFlight.find(hash);
+		if (it != pArrInFlight.end())
+		{
+			return it->second;
+		}
+	}
+
+	return Enqueue(make_shared<Pipeline>(pDevice, desc), true);
+}
+
+Vec<PipelineCompiler::PipelineFuture> PipelineCompiler::Submit(const Vec<PipelineStateDesc> &descs)
+{
+	Vec<PipelineFuture> futures;
+	futures.reserve(descs.size());
+	for (auto &desc : descs)
+	{
+		futures.push_back(Submit(desc));
+	}
+	return futures;
+}
+
+PipelineCompiler::PipelineFuture PipelineCompiler::Enqueue(Ref<Pipeline> pipeline, bool bRegister)
+{
+	ASSERT(IsValid(), "PipelineCompiler used before Create");
+
+	// Shared so the job function stays copyable, promises aren't
+	Ref<Job> job = make_shared<Job>();
+	job->pPipeline = pipeline;
+	job->bRegister = bRegister;
+	PipelineFuture future = job->sPromise.get_future().share();
+
+	if (bRegister)
+	{
+		// Lost a race against another thread submitting the same desc
+		lock_guard<mutex> lock(mLock);
+		auto [it, bInserted] = pArrInFlight.emplace(pipeline->GetHash(), future);
+		if (!bInserted)
+		{
+			return it->second;
+		}
+	}
+
+	Singleton<JobSystem>::GetInstance().Submit([this, job]() { Compile(*job); }, pCounter);
+
+	return future;
+}
+
+void PipelineCompiler::WaitIdle()
+{
+	Singleton<JobSystem>::GetInstance().Wait(pCounter);
+
+	MergeCaches();
+}
+
+u32 PipelineCompiler::GetWorkerCount() const
+{
+	return Singleton<JobSystem>::GetInstance().GetThreadCount();
+}
+
+u32 PipelineCompiler::GetPendingCount()
+{
+	return pCounter->GetValue();
+}
+
+bool PipelineCompiler::IsReady(const PipelineFuture &future)
+{
+	return future.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+void PipelineCompiler::Compile(Job &job)
+{
+	VkPipelineCache cache = pArrThreadCaches[JobSystem::GetThreadIndex()];
+
+	try
+	{
+		job.pPipeline->SetPipelineCache(cache);
+		job.pPipeline->Create();
+		job.pPipeline->SetPipelineCache(VK_NULL_HANDLE);
+
+		Ref<Pipeline> result = job.pPipeline;
+		if (job.bRegister)
+		{
+			// Someone may have built it on their own thread meanwhile, prefer theirs
+			Ref<Pipeline> registered = pDevice.GetPipelineRegistry().Insert(result);
+			if (registered->GetDesc() == result->GetDesc())
+			{
+				result = registered;
+			}
+		}
+		job.sPromise.set_value(result);
+	}
+	catch (...)
+	{
+		job.pPipeline->SetPipelineCache(VK_NULL_HANDLE);
+		job.sPromise.set_exception(current_exception());
+	}
+
+	if (job.bRegister)
+	{
+		lock_guard<mutex> lock(mLock);
+		pArrInFlight.erase(job.pPipeline->GetHash());
+	}
+}
+
+void PipelineCompiler::MergeCaches()
+{
+	// Pipeline caches are internally synchronized, a pipeline still compiling just misses this merge
+	if (!pArrThreadCaches.empty())
+	{
+		pDevice.GetPipelineCache().Merge(pArrThreadCaches);
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+class Device;
+class Pipeline;
+struct PipelineStateDesc;
+class JobCounter;
+
+// Builds pipelines as jobs on the JobSystem so load time isn't bound to one core.
+// Every job system thread compiles against its own VkPipelineCache, seeded from the device cache,
+// and those caches are merged back into the device cache once everything submitted is built.
+class PipelineCompiler : public IVkResource, public NonCopyable
+{
+public:
+
+	using PipelineFuture = shared_future<Ref<Pipeline>>;
+
+private:
+
+	struct Job
+	{
+		Ref<Pipeline> pPipeline;
+		promise<Ref<Pipeline>> sPromise;
+
+		// Built from a desc, goes into the device's pipeline registry when done
+		bool bRegister = false;
+	};
+
+	Device &pDevice;
+
+	// Indexed by job system thread index
+	Vec<VkPipelineCache> pArrThreadCaches;
+
+	// Counts the compiles that haven't finished
+	Ref<JobCounter> pCounter;
+	mutex mLock;
+
+	// Descs currently queued or compiling, so the same desc submitted twice compiles once
+	unordered_map<u64, PipelineFuture> pArrInFlight;
+
+public:
+
+	PipelineCompiler(Device &device);
+	~PipelineCompiler();
+
+public:
+
+	// The job system has to be created first
+	void Create() override;
+
+	// Finish what was submitted, merge the thread caches into the device cache and release them
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Queue a pipeline that wasn't created yet.
+	// The future becomes ready once Create() ran on a job thread, or holds its exception.
+	PipelineFuture Submit(Ref<Pipeline> pipeline);
+
+	// Same, but goes through the device's pipeline registry. A desc that was built before
+	// comes back as an already ready future, one still in flight shares its future.
+	PipelineFuture Submit(const PipelineStateDesc &desc);
+	Vec<PipelineFuture> Submit(const Vec<PipelineStateDesc> &descs);
+
+	// Block until everything submitted so far is built, then merge the thread caches.
+	// Helps compiling meanwhile.
+	void WaitIdle();
+
+	// Threads that may be compiling at once
+	u32 GetWorkerCount() const;
+	u32 GetPendingCount();
+
+	static bool IsReady(const PipelineFuture &future);
+
+private:
+
+	PipelineFuture Enqueue(Ref<Pipeline> pipeline, bool bRegister);
+	void Compile(Job &job);
+	void MergeCaches();
+};
\ No newline at end of file
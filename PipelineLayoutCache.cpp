@@ -0,0 +1,315 @@
+#pragma once
+
+#include "PipelineLayoutCache.h"
+#include "Device.h"
+#include "BindlessHeap.h"
+#include "Hash.h"
+
+namespace
+{
+	u64 HashBindings(Hasher &hasher, const Vec<ShaderBinding> &bindings)
+	{
+		// Stages aren't hashed, every binding is created for all of them
+		hasher.Add(static_cast<u32>(bindings.size()));
+		for (const ShaderBinding &binding : bindings)
+		{
+			hasher.Add(binding.binding);
+			hasher.Add(binding.type);
+			hasher.Add(binding.count);
+		}
+		return hasher.Get();
+	}
+
+	bool SameBindings(const Vec<ShaderBinding> &a, const Vec<ShaderBinding> &b)
+	{
+		return equal(a.begin(), a.end(), b.begin(), b.end(), [](const ShaderBinding &x, const ShaderBinding &y)
+		{
+			return x.binding == y.binding && x.type == y.type && x.count == y.count;
+		});
+	}
+}
+
+void PipelineLayoutDesc::Merge(const ShaderReflection &reflection)
+{
+	for (const ShaderBinding &binding : reflection.bindings)
+	{
+		ASSERT(binding.set < MAX_SETS, "Shader uses more descriptor sets than a pipeline layout can have");
+
+		Vec<ShaderBinding> &set = sets[binding.set];
+		auto it = lower_bound(set.begin(), set.end(), binding.binding, [](const ShaderBinding &a, u32 b)
+		{
+			return a.binding < b;
+		});
+
+		if (it != set.end() && it->binding == binding.binding)
+		{
+			ASSERT(it->type == binding.type, "Shader stages disagree on the type of a descriptor binding");
+			it->count = (it->count == 0 || binding.count == 0) ? 0 : max(it->count, binding.count);
+			it->stages |= binding.stages;
+		}
+		else
+		{
+			set.insert(it, binding);
+		}
+
+		setCount = max(setCount, binding.set + 1);
+	}
+
+	if (reflection.HasPushConstants())
+	{
+		pushConstantSize = max(pushConstantSize, reflection.pushConstants.offset + reflection.pushConstants.size);
+	}
+}
+
+u64 PipelineLayoutDesc::Hash() const
+{
+	Hasher hasher;
+	hasher.Add(setCount);
+	for (u32 i = 0; i < setCount; i++)
+	{
+		HashBindings(hasher, sets[i]);
+	}
+	hasher.Add(pushConstantSize);
+	return hasher.Get();
+}
+
+bool PipelineLayoutDesc::operator==(const PipelineLayoutDesc &other) const
+{
+	if (setCount != other.setCount || pushConstantSize != other.pushConstantSize)
+	{
+		return false;
+	}
+
+	for (u32 i = 0; i < setCount; i++)
+	{
+		if (!SameBindings(sets[i], other.sets[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool PipelineLayoutDesc::operator!=(const PipelineLayoutDesc &other) const
+{
+	return !(*this == other);
+}
+
+PipelineLayoutCache::PipelineLayoutCache(Device &device) :
+	pDevice(device),
+	pArrSetLayouts(),
+	pArrPipelineLayouts()
+{
+}
+
+PipelineLayoutCache::~PipelineLayoutCache()
+{
+	Destroy();
+}
+
+void PipelineLayoutCache::Create()
+{
+}
+
+void PipelineLayoutCache::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (auto &[hash, bucket] : pArrPipelineLayouts)
+	{
+		for (PipelineLayoutEntry &entry : bucket)
+		{
+			vkDestroyPipelineLayout(pDevice.GetVkNative(), entry.pLayout, nullptr);
+		}
+	}
+	pArrPipelineLayouts.clear();
+
+	for (auto &[hash, bucket] : pArrSetLayouts)
+	{
+		for (SetLayoutEntry &entry : bucket)
+		{
+			vkDestroyDescriptorSetLayout(pDevice.GetVkNative(), entry.pLayout, nullptr);
+		}
+	}
+	pArrSetLayouts.clear();
+}
+
+bool PipelineLayoutCache::IsValid() const
+{
+	return pDevice.IsValid();
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::GetSetLayout(const Vec<ShaderBinding> &bindings)
+{
+	lock_guard<mutex> lock(mLock);
+	return GetSetLayoutLocked(bindings);
+}
+
+VkPipelineLayout PipelineLayoutCache::GetPipelineLayout(const PipelineLayoutDesc &desc)
+{
+	if (IsBindlessCompatible(desc))
+	{
+		return pDevice.GetBindlessHeap().GetPipelineLayout();
+	}
+
+	u64 hash = desc.Hash();
+
+	lock_guard<mutex> lock(mLock);
+
+	Vec<PipelineLayoutEntry> &bucket = pArrPipelineLayouts[hash];
+	for (const PipelineLayoutEntry &entry : bucket)
+	{
+		if (entry.sDesc == desc)
+		{
+			return entry.pLayout;
+		}
+	}
+
+	if (!bucket.empty())
+	{
+		cout << "WARNING: Pipeline layout hash collision on " << hex << hash << dec << endl;
+	}
+
+	// Sets nobody uses in between still need a layout, an empty one
+	Vec<VkDescriptorSetLayout> setLayouts(desc.setCount);
+	for (u32 i = 0; i < desc.setCount; i++)
+	{
+		setLayouts[i] = GetSetLayoutLocked(desc.sets[i]);
+	}
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = desc.pushConstantSize;
+
+	VkPipelineLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.setLayoutCount = desc.setCount;
+	layoutCreateInfo.pSetLayouts = setLayouts.data();
+	layoutCreateInfo.pushConstantRangeCount = desc.pushConstantSize > 0 ? 1 : 0;
+	layoutCreateInfo.pPushConstantRanges = desc.pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	VkPipelineLayout layout;
+	VK_CHECK_RESULT(vkCreatePipelineLayout(pDevice.GetVkNative(), &layoutCreateInfo, nullptr, &layout));
+
+	bucket.push_back({ layout, desc });
+	return layout;
+}
+
+size_t PipelineLayoutCache::GetSetLayoutCount() const
+{
+	lock_guard<mutex> lock(mLock);
+
+	size_t count = 0;
+	for (auto &[hash, bucket] : pArrSetLayouts)
+	{
+		count += bucket.size();
+	}
+	return count;
+}
+
+size_t PipelineLayoutCache::GetPipelineLayoutCount() const
+{
+	lock_guard<mutex> lock(mLock);
+
+	size_t count = 0;
+	for (auto &[hash, bucket] : pArrPipelineLayouts)
+	{
+		count += bucket.size();
+	}
+	return count;
+}
+
+bool PipelineLayoutCache::IsBindlessCompatible(const PipelineLayoutDesc &desc)
+{
+	if (desc.setCount > BindlessHeap::UNIFORM_SET + 1 || desc.pushConstantSize > BindlessHeap::MAX_PUSH_CONSTANT_SIZE)
+	{
+		return false;
+	}
+
+	// Sized arrays fit in the bindless arrays too, as long as the shader stays below the capacity
+	for (const ShaderBinding &binding : desc.sets[0])
+	{
+		bool bMatches =
+			(binding.binding == BindlessHeap::SAMPLED_IMAGE_BINDING && binding.type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE) ||
+			(binding.binding == BindlessHeap::SAMPLER_BINDING && binding.type == VK_DESCRIPTOR_TYPE_SAMPLER) ||
+			(binding.binding == BindlessHeap::STORAGE_BUFFER_BINDING && binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+		if (!bMatches)
+		{
+			return false;
+		}
+	}
+
+	// Shaders can't tell a dynamic uniform buffer from a plain one
+	for (const ShaderBinding &binding : desc.sets[BindlessHeap::UNIFORM_SET])
+	{
+		if (binding.binding != BindlessHeap::UNIFORM_BINDING || binding.type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || binding.count != 1)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::GetSetLayoutLocked(const Vec<ShaderBinding> &bindings)
+{
+	Hasher hasher;
+	u64 hash = HashBindings(hasher, bindings);
+
+	Vec<SetLayoutEntry> &bucket = pArrSetLayouts[hash];
+	for (const SetLayoutEntry &entry : bucket)
+	{
+		if (SameBindings(entry.pArrBindings, bindings))
+		{
+			return entry.pLayout;
+		}
+	}
+
+	if (!bucket.empty())
+	{
+		cout << "WARNING: Descriptor set layout hash collision on " << hex << hash << dec << endl;
+	}
+
+	VkDescriptorSetLayout layout = CreateSetLayout(bindings);
+	bucket.push_back({ layout, bindings });
+	return layout;
+}
+
+VkDescriptorSetLayout PipelineLayoutCache::CreateSetLayout(const Vec<ShaderBinding> &bindings) const
+{
+	Vec<VkDescriptorSetLayoutBinding> layoutBindings(bindings.size());
+	Vec<VkDescriptorBindingFlags> bindingFlags(bindings.size(), 0);
+	bool bPartiallyBound = false;
+
+	for (size_t i = 0; i < bindings.size(); i++)
+	{
+		layoutBindings[i].binding = bindings[i].binding;
+		layoutBindings[i].descriptorType = bindings[i].type;
+		layoutBindings[i].descriptorCount = bindings[i].count != 0 ? bindings[i].count : MAX_UNSIZED_DESCRIPTORS;
+		layoutBindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+		layoutBindings[i].pImmutableSamplers = nullptr;
+
+		// Nobody has to fill a runtime sized array all the way
+		if (bindings[i].count == 0)
+		{
+			bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+			bPartiallyBound = true;
+		}
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = static_cast<u32>(bindingFlags.size());
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = bPartiallyBound ? &bindingFlagsCreateInfo : nullptr;
+	setLayoutCreateInfo.bindingCount = static_cast<u32>(layoutBindings.size());
+	setLayoutCreateInfo.pBindings = layoutBindings.data();
+
+	VkDescriptorSetLayout layout;
+	VK_CHECK_RESULT(vkCreateDescriptorSetLayout(pDevice.GetVkNative(), &setLayoutCreateInfo, nullptr, &layout));
+	return layout;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "SpirvReflection.h"
+
+class Device;
+
+// Descriptor bindings and push constants of a pipeline, merged over its shader stages
+struct PipelineLayoutDesc
+{
+	static constexpr u32 MAX_SETS = 4;
+
+	// Sorted by binding, sets past setCount are empty
+	Vec<ShaderBinding> sets[MAX_SETS];
+	u32 setCount = 0;
+
+	// Push constants always start at 0 and are visible to all stages
+	u32 pushConstantSize = 0;
+
+public:
+
+	// Stages declaring the same binding have to agree on its type
+	void Merge(const ShaderReflection &reflection);
+
+	u64 Hash() const;
+
+	// Compares what Hash covers, stages aside
+	bool operator==(const PipelineLayoutDesc &other) const;
+	bool operator!=(const PipelineLayoutDesc &other) const;
+};
+
+// Set and pipeline layouts built from what the shaders declare, deduplicated by hash, and by
+// comparing the bindings on a hash match.
+// Pipelines with the same bindings end up with the very same VkPipelineLayout, so sets bound
+// once stay bound across pipeline switches. Like the bindless layout every binding is visible
+// to all stages, a binding only some pipelines read in the fragment shader doesn't split the layouts.
+// Pipelines that only use what the bindless layout has get the bindless layout itself.
+class PipelineLayoutCache : public IVkResource, public NonCopyable
+{
+public:
+
+	// Runtime sized arrays outside the bindless set get this many descriptors, partially bound
+	static constexpr u32 MAX_UNSIZED_DESCRIPTORS = 1024;
+
+private:
+
+	// What each layout was built from, a hash match with anything else is a collision. Layouts are
+	// handed out for good, so a collision keeps both in the bucket.
+	struct SetLayoutEntry
+	{
+		VkDescriptorSetLayout pLayout;
+		Vec<ShaderBinding> pArrBindings;
+	};
+
+	struct PipelineLayoutEntry
+	{
+		VkPipelineLayout pLayout;
+		PipelineLayoutDesc sDesc;
+	};
+
+	Device &pDevice;
+
+	unordered_map<u64, Vec<SetLayoutEntry>> pArrSetLayouts;
+	unordered_map<u64, Vec<PipelineLayoutEntry>> pArrPipelineLayouts;
+	mutable mutex mLock;
+
+public:
+
+	PipelineLayoutCache(Device &device);
+	~PipelineLayoutCache();
+
+public:
+
+	void Create() override;
+
+	// The GPU must not be using any of the layouts anymore
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	VkDescriptorSetLayout GetSetLayout(const Vec<ShaderBinding> &bindings);
+	VkPipelineLayout GetPipelineLayout(const PipelineLayoutDesc &desc);
+
+	size_t GetSetLayoutCount() const;
+	size_t GetPipelineLayoutCount() const;
+
+	// Every binding is one of the bindless heap's or the uniform ring's, and the push constants fit
+	static bool IsBindlessCompatible(const PipelineLayoutDesc &desc);
+
+private:
+
+	VkDescriptorSetLayout GetSetLayoutLocked(const Vec<ShaderBinding> &bindings);
+	VkDescriptorSetLayout CreateSetLayout(const Vec<ShaderBinding> &bindings) const;
+};
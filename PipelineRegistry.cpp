@@ -0,0 +1,106 @@
+#pragma once
+
+#include "PipelineRegistry.h"
+#include "Pipeline.h"
+#include "Device.h"
+
+PipelineRegistry::PipelineRegistry(Device &device) :
+	pDevice(device),
+	pArrPipelines(),
+	iHits(0),
+	iMisses(0)
+{
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+	Clear();
+}
+
+Ref<Pipeline> PipelineRegistry::GetOrCreate(const PipelineStateDesc &desc)
+{
+	if (Ref<Pipeline> existing = Find(desc))
+	{
+		return existing;
+	}
+
+	// Compile without holding the lock, other threads can keep looking things up meanwhile
+	Ref<Pipeline> pipeline = make_shared<Pipeline>(pDevice, desc);
+	pipeline->Create();
+
+	Ref<Pipeline> registered = Insert(pipeline);
+	return registered->GetDesc() == desc ? registered : pipeline;
+}
+
+Ref<Pipeline> PipelineRegistry::Find(const PipelineStateDesc &desc) const
+{
+	u64 hash = desc.Hash();
+
+	lock_guard<mutex> lock(mLock);
+
+	auto it = pArrPipelines.find(hash);
+	if (it == pArrPipelines.end())
+	{
+		iMisses++;
+		return nullptr;
+	}
+
+	// A 64-bit collision is unlikely but would hand out the wrong pipeline, so check, and count it as a miss
+	if (it->second->GetDesc() != desc)
+	{
+		cout << "WARNING: Pipeline desc hash collision on " << hex << hash << dec << endl;
+		iMisses++;
+		return nullptr;
+	}
+
+	iHits++;
+	return it->second;
+}
+
+Ref<Pipeline> PipelineRegistry::Find(u64 hash) const
+{
+	lock_guard<mutex> lock(mLock);
+
+	auto it = pArrPipelines.find(hash);
+	if (it == pArrPipelines.end())
+	{
+		iMisses++;
+		return nullptr;
+	}
+
+	iHits++;
+	return it->second;
+}
+
+Ref<Pipeline> PipelineRegistry::Insert(Ref<Pipeline> pipeline)
+{
+	lock_guard<mutex> lock(mLock);
+
+	// Two threads built the same desc at once, keep the first
+	auto [it, bInserted] = pArrPipelines.emplace(pipeline->GetHash(), pipeline);
+	return it->second;
+}
+
+void PipelineRegistry::Clear()
+{
+	lock_guard<mutex> lock(mLock);
+	pArrPipelines.clear();
+}
+
+size_t PipelineRegistry::GetCount() const
+{
+	lock_guard<mutex> lock(mLock);
+	return pArrPipelines.size();
+}
+
+u64 PipelineRegistry::GetHitCount() const
+{
+	lock_guard<mutex> lock(mLock);
+	return iHits;
+}
+
+u64 PipelineRegistry::GetMissCount() const
+{
+	lock_guard<mutex> lock(mLock);
+	return iMisses;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+class Device;
+class Pipeline;
+struct PipelineStateDesc;
+
+// Every pipeline built from a PipelineStateDesc, keyed by the desc's hash.
+// Asking for a desc that was built before hands back the existing pipeline instead of compiling it again.
+class PipelineRegistry : public NonCopyable
+{
+private:
+	Device &pDevice;
+
+	unordered_map<u64, Ref<Pipeline>> pArrPipelines;
+	mutable mutex mLock;
+
+	// Lookups are const but still counted
+	mutable u64 iHits;
+	mutable u64 iMisses;
+
+public:
+
+	PipelineRegistry(Device &device);
+	~PipelineRegistry();
+
+public:
+
+	// The pipeline for this desc, built on the calling thread if there isn't one yet
+	Ref<Pipeline> GetOrCreate(const PipelineStateDesc &desc);
+
+	// Lookup only, nullptr if the desc was never built
+	Ref<Pipeline> Find(const PipelineStateDesc &desc) const;
+
+	// By hash alone, which can't tell a collision apart from a hit
+	Ref<Pipeline> Find(u64 hash) const;
+
+	// Register a pipeline built elsewhere. If an identical one got in first, that one is returned
+	// and the caller's pipeline should be dropped.
+	Ref<Pipeline> Insert(Ref<Pipeline> pipeline);
+
+	// Destroy every pipeline, the GPU must not be using any of them
+	void Clear();
+
+	size_t GetCount() const;
+	u64 GetHitCount() const;
+	u64 GetMissCount() const;
+};
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "PipelineStateDesc.h"
+#include "Shader.h"
+#include "Hash.h"
+
+void PipelineStateDesc::AddShaderStage(const Shader &shader)
+{
+	ASSERT(shaderStageCount < MAX_SHADER_STAGES, "Too many shader stages");
+	ASSERT(shader.IsValid(), "Shader module has to be created before it goes into a pipeline desc");
+
+	PipelineShaderStage &stage = shaderStages[shaderStageCount++];
+	stage.stage = shader.GetStage();
+	stage.module = shader.GetVkNative();
+	stage.codeHash = shader.GetCodeHash();
+	stage.reflection = &shader.GetReflection();
+}
+
+void PipelineStateDesc::AddVertexBinding(u32 binding, u32 stride, VkVertexInputRate inputRate)
+{
+	ASSERT(vertexBindingCount < MAX_VERTEX_BINDINGS, "Too many vertex bindings");
+
+	VkVertexInputBindingDescription &description = vertexBindings[vertexBindingCount++];
+	description.binding = binding;
+	description.stride = stride;
+	description.inputRate = inputRate;
+}
+
+void PipelineStateDesc::AddVertexAttribute(u32 location, u32 binding, VkFormat format, u32 offset)
+{
+	ASSERT(vertexAttributeCount < MAX_VERTEX_ATTRIBUTES, "Too many vertex attributes");
+
+	VkVertexInputAttributeDescription &description = vertexAttributes[vertexAttributeCount++];
+	description.location = location;
+	description.binding = binding;
+	description.format = format;
+	description.offset = offset;
+}
+
+void PipelineStateDesc::AddColorTarget(VkFormat format, const VkPipelineColorBlendAttachmentState &blend)
+{
+	ASSERT(colorTargetCount < MAX_COLOR_TARGETS, "Too many color targets");
+
+	colorFormats[colorTargetCount] = format;
+	blendStates[colorTargetCount] = blend;
+	colorTargetCount++;
+}
+
+u64 PipelineStateDesc::Hash() const
+{
+	Hasher hasher;
+
+	// Stages go in by content, not by module handle
+	hasher.Add(shaderStageCount);
+	for (u32 i = 0; i < shaderStageCount; i++)
+	{
+		hasher.Add(shaderStages[i].stage);
+		hasher.Add(shaderStages[i].codeHash);
+	}
+
+	// The Vulkan structs below have no padding, their bytes can go in as they are
+	hasher.Add(vertexBindingCount);
+	hasher.AddBytes(vertexBindings, vertexBindingCount * sizeof(VkVertexInputBindingDescription));
+	hasher.Add(vertexAttributeCount);
+	hasher.AddBytes(vertexAttributes, vertexAttributeCount * sizeof(VkVertexInputAttributeDescription));
+
+	hasher.Add(topology);
+	hasher.Add(primitiveRestartEnable);
+
+	hasher.Add(polygonMode);
+	hasher.Add(cullMode);
+	hasher.Add(frontFace);
+	hasher.Add(depthClampEnable);
+	hasher.Add(depthBiasEnable);
+	hasher.Add(lineWidth);
+
+	hasher.Add(samples);
+
+	hasher.Add(depthTestEnable);
+	hasher.Add(depthWriteEnable);
+	hasher.Add(depthCompareOp);
+
+	hasher.Add(colorTargetCount);
+	hasher.AddBytes(colorFormats, colorTargetCount * sizeof(VkFormat));
+	hasher.AddBytes(blendStates, colorTargetCount * sizeof(VkPipelineColorBlendAttachmentState));
+	hasher.Add(depthFormat);
+
+	hasher.Add(renderPass);
+	hasher.Add(subpass);
+	hasher.Add(layout);
+
+	return hasher.Get();
+}
+
+bool PipelineStateDesc::operator==(const PipelineStateDesc &other) const
+{
+	if (shaderStageCount != other.shaderStageCount ||
+		vertexBindingCount != other.vertexBindingCount ||
+		vertexAttributeCount != other.vertexAttributeCount ||
+		colorTargetCount != other.colorTargetCount)
+	{
+		return false;
+	}
+
+	for (u32 i = 0; i < shaderStageCount; i++)
+	{
+		if (shaderStages[i].stage != other.shaderStages[i].stage ||
+			shaderStages[i].codeHash != other.shaderStages[i].codeHash)
+		{
+			return false;
+		}
+	}
+
+	return
+		memcmp(vertexBindings, other.vertexBindings, vertexBindingCount * sizeof(VkVertexInputBindingDescription)) == 0 &&
+		memcmp(vertexAttributes, other.vertexAttributes, vertexAttributeCount * sizeof(VkVertexInputAttributeDescription)) == 0 &&
+		topology == other.topology &&
+		primitiveRestartEnable == other.primitiveRestartEnable &&
+		polygonMode == other.polygonMode &&
+		cullMode == other.cullMode &&
+		frontFace == other.frontFace &&
+		depthClampEnable == other.depthClampEnable &&
+		depthBiasEnable == other.depthBiasEnable &&
+		lineWidth == other.lineWidth &&
+		samples == other.samples &&
+		depthTestEnable == other.depthTestEnable &&
+		depthWriteEnable == other.depthWriteEnable &&
+		depthCompareOp == other.depthCompareOp &&
+		memcmp(colorFormats, other.colorFormats, colorTargetCount * sizeof(VkFormat)) == 0 &&
+		memcmp(blendStates, other.blendStates, colorTargetCount * sizeof(VkPipelineColorBlendAttachmentState)) == 0 &&
+		depthFormat == other.depthFormat &&
+		renderPass == other.renderPass &&
+		subpass == other.subpass &&
+		layout == other.layout;
+}
+
+bool PipelineStateDesc::operator!=(const PipelineStateDesc &other) const
+{
+	return !(*this == other);
+}
+
+VkPipelineColorBlendAttachmentState PipelineStateDesc::BlendOpaque()
+{
+	VkPipelineColorBlendAttachmentState blend = {};
+	blend.blendEnable = VK_FALSE;
+	blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	return blend;
+}
+
+VkPipelineColorBlendAttachmentState PipelineStateDesc::BlendAlpha()
+{
+	VkPipelineColorBlendAttachmentState blend = BlendOpaque();
+	blend.blendEnable = VK_TRUE;
+	blend.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	blend.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blend.colorBlendOp = VK_BLEND_OP_ADD;
+	blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blend.alphaBlendOp = VK_BLEND_OP_ADD;
+	return blend;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+class Shader;
+struct ShaderReflection;
+
+struct PipelineShaderStage
+{
+	VkShaderStageFlagBits stage;
+	VkShaderModule module;
+
+	// Identifies the module by its SPIR-V, handles get recycled
+	u64 codeHash;
+
+	// Owned by the shader, which has to outlive the pipeline build like its module. Not hashed, the code hash covers it.
+	const ShaderReflection *reflection;
+};
+
+// Everything that goes into a graphics pipeline, as plain data.
+// Two descs with the same Hash() build the same pipeline, so it can be used as a cache key.
+// Viewport and scissor are always dynamic and not part of the desc.
+struct PipelineStateDesc
+{
+	static constexpr u32 MAX_SHADER_STAGES = 5;
+	static constexpr u32 MAX_VERTEX_BINDINGS = 8;
+	static constexpr u32 MAX_VERTEX_ATTRIBUTES = 16;
+	static constexpr u32 MAX_COLOR_TARGETS = 8;
+
+	u32 shaderStageCount = 0;
+	PipelineShaderStage shaderStages[MAX_SHADER_STAGES] = {};
+
+	u32 vertexBindingCount = 0;
+	VkVertexInputBindingDescription vertexBindings[MAX_VERTEX_BINDINGS] = {};
+	u32 vertexAttributeCount = 0;
+	VkVertexInputAttributeDescription vertexAttributes[MAX_VERTEX_ATTRIBUTES] = {};
+
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	VkBool32 primitiveRestartEnable = VK_FALSE;
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+	VkBool32 depthClampEnable = VK_FALSE;
+	VkBool32 depthBiasEnable = VK_FALSE;
+	f32 lineWidth = 1.0f;
+
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkBool32 depthTestEnable = VK_FALSE;
+	VkBool32 depthWriteEnable = VK_FALSE;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	u32 colorTargetCount = 0;
+	VkFormat colorFormats[MAX_COLOR_TARGETS] = {};
+	VkPipelineColorBlendAttachmentState blendStates[MAX_COLOR_TARGETS] = {};
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+	// Left empty the pipeline is built against the target formats above, for dynamic rendering or a
+	// cached render pass with the same formats when the device doesn't have it
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	u32 subpass = 0;
+
+	// Left empty the layout is derived from the stages' reflection, through the device's layout cache
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+
+public:
+
+	// The shader module has to be created already
+	void AddShaderStage(const Shader &shader);
+	void AddVertexBinding(u32 binding, u32 stride, VkVertexInputRate inputRate = VK_VERTEX_INPUT_RATE_VERTEX);
+	void AddVertexAttribute(u32 location, u32 binding, VkFormat format, u32 offset);
+	void AddColorTarget(VkFormat format, const VkPipelineColorBlendAttachmentState &blend = BlendOpaque());
+
+	// Only the used part of each array is hashed and compared
+	u64 Hash() const;
+	bool operator==(const PipelineStateDesc &other) const;
+	bool operator!=(const PipelineStateDesc &other) const;
+
+	static VkPipelineColorBlendAttachmentState BlendOpaque();
+	static VkPipelineColorBlendAttachmentState BlendAlpha();
+};
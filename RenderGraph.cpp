@@ -0,0 +1,717 @@
+#pragma once
+
+#include "RenderGraph.h"
+#include "Device.h"
+#include "DeferredDestroyQueue.h"
+#include "Hash.h"
+
+namespace
+{
+	struct UsageInfo
+	{
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 readAccess;
+		VkAccessFlags2 writeAccess;
+		VkImageLayout layout;
+		VkImageUsageFlags imageUsage;
+	};
+
+	UsageInfo GetUsageInfo(RenderGraphUsage usage)
+	{
+		switch (usage)
+		{
+		case RenderGraphUsage::ColorAttachment:
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		case RenderGraphUsage::DepthStencilAttachment:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case RenderGraphUsage::DepthStencilRead:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		case RenderGraphUsage::Sampled:
+			return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_NONE,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT };
+		case RenderGraphUsage::StorageRead:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraphUsage::StorageWrite:
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+		case RenderGraphUsage::TransferSrc:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		case RenderGraphUsage::TransferDst:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_NONE, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		}
+		return {};
+	}
+
+	VkImageAspectFlags GetAspect(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_D16_UNORM:
+		case VK_FORMAT_X8_D24_UNORM_PACK32:
+		case VK_FORMAT_D32_SFLOAT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT;
+		case VK_FORMAT_S8_UINT:
+			return VK_IMAGE_ASPECT_STENCIL_BIT;
+		case VK_FORMAT_D16_UNORM_S8_UINT:
+		case VK_FORMAT_D24_UNORM_S8_UINT:
+		case VK_FORMAT_D32_SFLOAT_S8_UINT:
+			return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+		default:
+			return VK_IMAGE_ASPECT_COLOR_BIT;
+		}
+	}
+
+	VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
+
+RenderGraphBuilder::RenderGraphBuilder(RenderGraph &graph, u32 pass) :
+	pGraph(graph),
+	iPass(pass)
+{
+}
+
+RenderGraphResource RenderGraphBuilder::CreateImage(const string &name, const RenderGraphImageDesc &desc)
+{
+	RenderGraph::Resource resource;
+	resource.sName = name;
+	resource.sDesc = desc;
+	resource.eUsage = desc.usage;
+	pGraph.pArrResources.push_back(resource);
+
+	return { static_cast<u32>(pGraph.pArrResources.size() - 1) };
+}
+
+RenderGraphResource RenderGraphBuilder::Read(RenderGraphResource resource, RenderGraphUsage usage)
+{
+	ASSERT(resource.IsValid() && resource.index < pGraph.pArrResources.size(), "Render graph pass reads an unknown resource");
+
+	RenderGraph::Pass &pass = pGraph.pArrPasses[iPass];
+	for (auto &access : pass.pArrAccesses)
+	{
+		if (access.iResource == resource.index)
+		{
+			ASSERT(GetUsageInfo(access.eUsage).layout == GetUsageInfo(usage).layout, "Render graph pass uses one image in two layouts");
+			access.bRead = true;
+			return resource;
+		}
+	}
+
+	pass.pArrAccesses.push_back({ resource.index, usage, true, false });
+	pGraph.pArrResources[resource.index].eUsage |= GetUsageInfo(usage).imageUsage;
+	return resource;
+}
+
+RenderGraphResource RenderGraphBuilder::Write(RenderGraphResource resource, RenderGraphUsage usage)
+{
+	ASSERT(resource.IsValid() && resource.index < pGraph.pArrResources.size(), "Render graph pass writes an unknown resource");
+
+	RenderGraph::Pass &pass = pGraph.pArrPasses[iPass];
+	for (auto &access : pass.pArrAccesses)
+	{
+		if (access.iResource == resource.index)
+		{
+			ASSERT(GetUsageInfo(access.eUsage).layout == GetUsageInfo(usage).layout, "Render graph pass uses one image in two layouts");
+			access.eUsage = usage;
+			access.bWrite = true;
+			return resource;
+		}
+	}
+
+	pass.pArrAccesses.push_back({ resource.index, usage, false, true });
+	pGraph.pArrResources[resource.index].eUsage |= GetUsageInfo(usage).imageUsage;
+	return resource;
+}
+
+void RenderGraphBuilder::SetSideEffect()
+{
+	pGraph.pArrPasses[iPass].bSideEffect = true;
+}
+
+RenderGraph::RenderGraph(Device &device) :
+	pDevice(device),
+	pArrPasses(),
+	pArrResources(),
+	pArrHeaps(),
+	pArrTransients(),
+	iLayoutHash(0),
+	iUnaliasedBytes(0),
+	pArrBarriers(),
+	iCulledPasses(0),
+	iBarrierCount(0),
+	bCompiled(false)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	Destroy();
+}
+
+void RenderGraph::Create()
+{
+}
+
+void RenderGraph::Destroy()
+{
+	Reset();
+	DestroyTransients();
+}
+
+bool RenderGraph::IsValid() const
+{
+	return bCompiled;
+}
+
+void RenderGraph::Reset()
+{
+	pArrPasses.clear();
+	pArrResources.clear();
+	pArrBarriers.clear();
+	iCulledPasses = 0;
+	iBarrierCount = 0;
+	bCompiled = false;
+}
+
+RenderGraphResource RenderGraph::ImportImage(const string &name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+	VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags2 initialStages)
+{
+	Resource resource;
+	resource.sName = name;
+	resource.sDesc.extent = extent;
+	resource.sDesc.format = format;
+	resource.bImported = true;
+	resource.pImage = image;
+	resource.pView = view;
+	resource.eInitialLayout = initialLayout;
+	resource.eFinalLayout = finalLayout;
+	resource.eInitialStages = initialStages;
+	pArrResources.push_back(resource);
+
+	return { static_cast<u32>(pArrResources.size() - 1) };
+}
+
+void RenderGraph::AddPass(const string &name, const SetupFunc &fnSetup, ExecuteFunc fnExecute)
+{
+	ASSERT(!bCompiled, "Render graph passes added after Compile, Reset it first");
+
+	Pass pass;
+	pass.sName = name;
+	pass.fnExecute = move(fnExecute);
+	pArrPasses.push_back(move(pass));
+
+	RenderGraphBuilder builder(*this, static_cast<u32>(pArrPasses.size() - 1));
+	fnSetup(builder);
+}
+
+void RenderGraph::Compile()
+{
+	Cull();
+	ComputeLifetimes();
+
+	// Transients, their usage and lifetimes decide the memory layout, same hash means same images
+	Hasher hasher;
+	for (const Resource &resource : pArrResources)
+	{
+		if (resource.bImported || resource.iFirstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		hasher.Add(resource.sDesc.extent.width).Add(resource.sDesc.extent.height).Add(resource.sDesc.format).Add(resource.sDesc.mipLevels);
+		hasher.Add(resource.eUsage).Add(resource.iFirstPass).Add(resource.iLastPass);
+	}
+
+	if (hasher.Get() != iLayoutHash || pArrTransients.empty())
+	{
+		DestroyTransients();
+		CreateTransients();
+		iLayoutHash = hasher.Get();
+	}
+	else
+	{
+		u32 transient = 0;
+		for (Resource &resource : pArrResources)
+		{
+			if (!resource.bImported && resource.iFirstPass != UINT32_MAX)
+			{
+				resource.pImage = pArrTransients[transient].pImage;
+				resource.pView = pArrTransients[transient].pView;
+				transient++;
+			}
+		}
+	}
+
+	BuildBarriers();
+	bCompiled = true;
+}
+
+void RenderGraph::Execute(VkCommandBuffer commandBuffer) const
+{
+	ASSERT(bCompiled, "Render graph executed without Compile");
+
+	for (size_t i = 0; i < pArrPasses.size(); i++)
+	{
+		const Pass &pass = pArrPasses[i];
+		if (!pass.bAlive)
+		{
+			continue;
+		}
+
+		RecordBarriers(commandBuffer, pArrBarriers[i]);
+		if (pass.fnExecute)
+		{
+			pass.fnExecute(commandBuffer, *this);
+		}
+	}
+
+	RecordBarriers(commandBuffer, pArrBarriers.back());
+}
+
+VkImage RenderGraph::GetImage(RenderGraphResource resource) const
+{
+	return pArrResources[resource.index].pImage;
+}
+
+VkImageView RenderGraph::GetImageView(RenderGraphResource resource) const
+{
+	return pArrResources[resource.index].pView;
+}
+
+const RenderGraphImageDesc &RenderGraph::GetDesc(RenderGraphResource resource) const
+{
+	return pArrResources[resource.index].sDesc;
+}
+
+u32 RenderGraph::GetPassCount() const
+{
+	return static_cast<u32>(pArrPasses.size());
+}
+
+u32 RenderGraph::GetCulledPassCount() const
+{
+	return iCulledPasses;
+}
+
+u32 RenderGraph::GetBarrierCount() const
+{
+	return iBarrierCount;
+}
+
+VkDeviceSize RenderGraph::GetTransientBytes() const
+{
+	VkDeviceSize bytes = 0;
+	for (const Heap &heap : pArrHeaps)
+	{
+		bytes += heap.sRequirements.size;
+	}
+	return bytes;
+}
+
+VkDeviceSize RenderGraph::GetUnaliasedBytes() const
+{
+	return iUnaliasedBytes;
+}
+
+void RenderGraph::Cull()
+{
+	// Walk backwards from what leaves the graph. Imported images are read by whoever comes after it.
+	Vec<bool> needed(pArrResources.size(), false);
+	for (size_t i = 0; i < pArrResources.size(); i++)
+	{
+		needed[i] = pArrResources[i].bImported;
+	}
+
+	iCulledPasses = 0;
+	for (size_t i = pArrPasses.size(); i-- > 0;)
+	{
+		Pass &pass = pArrPasses[i];
+
+		pass.bAlive = pass.bSideEffect;
+		for (const Access &access : pass.pArrAccesses)
+		{
+			if (access.bWrite && needed[access.iResource])
+			{
+				pass.bAlive = true;
+			}
+		}
+
+		if (!pass.bAlive)
+		{
+			iCulledPasses++;
+			continue;
+		}
+
+		// A write that doesn't read throws the old contents away, so whoever wrote them before isn't needed for it
+		for (const Access &access : pass.pArrAccesses)
+		{
+			if (access.bWrite && !access.bRead)
+			{
+				needed[access.iResource] = false;
+			}
+		}
+		for (const Access &access : pass.pArrAccesses)
+		{
+			if (access.bRead)
+			{
+				needed[access.iResource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::ComputeLifetimes()
+{
+	for (Resource &resource : pArrResources)
+	{
+		resource.iFirstPass = UINT32_MAX;
+		resource.iLastPass = 0;
+	}
+
+	for (u32 i = 0; i < pArrPasses.size(); i++)
+	{
+		if (!pArrPasses[i].bAlive)
+		{
+			continue;
+		}
+
+		for (const Access &access : pArrPasses[i].pArrAccesses)
+		{
+			Resource &resource = pArrResources[access.iResource];
+			resource.iFirstPass = min(resource.iFirstPass, i);
+			resource.iLastPass = max(resource.iLastPass, i);
+		}
+	}
+}
+
+void RenderGraph::PlaceTransients()
+{
+	// Largest first, each goes into the lowest gap not taken by anything alive at the same time
+	Vec<u32> order;
+	for (u32 i = 0; i < pArrResources.size(); i++)
+	{
+		if (!pArrResources[i].bImported && pArrResources[i].iFirstPass != UINT32_MAX)
+		{
+			order.push_back(i);
+		}
+	}
+	sort(order.begin(), order.end(), [this](u32 a, u32 b) {
+		return pArrResources[a].sRequirements.size > pArrResources[b].sRequirements.size;
+	});
+
+	pArrHeaps.clear();
+	Vec<Vec<u32>> placed;
+
+	for (u32 index : order)
+	{
+		Resource &resource = pArrResources[index];
+		const VkMemoryRequirements &requirements = resource.sRequirements;
+
+		// Images can only share memory if they can live in the same memory type
+		u32 heap = 0;
+		while (heap < pArrHeaps.size() && pArrHeaps[heap].iTypeBits != requirements.memoryTypeBits)
+		{
+			heap++;
+		}
+		if (heap == pArrHeaps.size())
+		{
+			Heap newHeap = {};
+			newHeap.iTypeBits = requirements.memoryTypeBits;
+			newHeap.sRequirements.memoryTypeBits = requirements.memoryTypeBits;
+			newHeap.sRequirements.alignment = 1;
+			pArrHeaps.push_back(newHeap);
+			placed.emplace_back();
+		}
+
+		Vec<u32> overlapping;
+		for (u32 other : placed[heap])
+		{
+			const Resource &placedResource = pArrResources[other];
+			if (placedResource.iFirstPass <= resource.iLastPass && resource.iFirstPass <= placedResource.iLastPass)
+			{
+				overlapping.push_back(other);
+			}
+		}
+		sort(overlapping.begin(), overlapping.end(), [this](u32 a, u32 b) {
+			return pArrResources[a].iOffset < pArrResources[b].iOffset;
+		});
+
+		VkDeviceSize offset = 0;
+		for (u32 other : overlapping)
+		{
+			const Resource &placedResource = pArrResources[other];
+			if (AlignUp(offset, requirements.alignment) + requirements.size <= placedResource.iOffset)
+			{
+				break;
+			}
+			offset = max(offset, placedResource.iOffset + placedResource.sRequirements.size);
+		}
+
+		resource.iHeap = heap;
+		resource.iOffset = AlignUp(offset, requirements.alignment);
+		placed[heap].push_back(index);
+
+		VkMemoryRequirements &heapRequirements = pArrHeaps[heap].sRequirements;
+		heapRequirements.size = max(heapRequirements.size, resource.iOffset + requirements.size);
+		heapRequirements.alignment = max(heapRequirements.alignment, requirements.alignment);
+	}
+}
+
+void RenderGraph::CreateTransients()
+{
+	VkDevice device = pDevice.GetVkNative();
+
+	iUnaliasedBytes = 0;
+	for (Resource &resource : pArrResources)
+	{
+		if (resource.bImported || resource.iFirstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.flags = VK_IMAGE_CREATE_ALIAS_BIT;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = resource.sDesc.format;
+		imageCreateInfo.extent = { resource.sDesc.extent.width, resource.sDesc.extent.height, 1 };
+		imageCreateInfo.mipLevels = resource.sDesc.mipLevels;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = resource.eUsage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VK_CHECK_RESULT(vkCreateImage(device, &imageCreateInfo, nullptr, &resource.pImage));
+		vkGetImageMemoryRequirements(device, resource.pImage, &resource.sRequirements);
+		iUnaliasedBytes += resource.sRequirements.size;
+	}
+
+	PlaceTransients();
+
+	for (Heap &heap : pArrHeaps)
+	{
+		heap.sAllocation = pDevice.GetAllocator().Allocate(heap.sRequirements, MemoryUsage::GpuOnly, false);
+	}
+
+	for (Resource &resource : pArrResources)
+	{
+		if (resource.bImported || resource.iFirstPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		const MemoryAllocation &allocation = pArrHeaps[resource.iHeap].sAllocation;
+		VK_CHECK_RESULT(vkBindImageMemory(device, resource.pImage, allocation.memory, allocation.offset + resource.iOffset));
+
+		VkImageViewCreateInfo viewCreateInfo = {};
+		viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewCreateInfo.image = resource.pImage;
+		viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewCreateInfo.format = resource.sDesc.format;
+		viewCreateInfo.subresourceRange.aspectMask = GetAspect(resource.sDesc.format);
+		viewCreateInfo.subresourceRange.baseMipLevel = 0;
+		viewCreateInfo.subresourceRange.levelCount = resource.sDesc.mipLevels;
+		viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		viewCreateInfo.subresourceRange.layerCount = 1;
+
+		VK_CHECK_RESULT(vkCreateImageView(device, &viewCreateInfo, nullptr, &resource.pView));
+
+		pArrTransients.push_back({ resource.pImage, resource.pView });
+	}
+}
+
+void RenderGraph::DestroyTransients()
+{
+	if (pArrTransients.empty() && pArrHeaps.empty())
+	{
+		return;
+	}
+
+	// Frames still in flight may be using them
+	DeferredDestroyQueue &deferredDestroyQueue = pDevice.GetDeferredDestroyQueue();
+	for (TransientImage &transient : pArrTransients)
+	{
+		// The memory belongs to the heap, not the image
+		MemoryAllocation noAllocation;
+		deferredDestroyQueue.DestroyImageView(transient.pView);
+		deferredDestroyQueue.DestroyImage(transient.pImage, noAllocation);
+	}
+	pArrTransients.clear();
+
+	// Queued after the images, so the memory goes after they do
+	for (Heap &heap : pArrHeaps)
+	{
+		MemoryAllocation allocation = heap.sAllocation;
+		MemoryAllocator &allocator = pDevice.GetAllocator();
+		deferredDestroyQueue.Defer([&allocator, allocation]() mutable { allocator.Free(allocation); });
+	}
+	pArrHeaps.clear();
+
+	iLayoutHash = 0;
+	iUnaliasedBytes = 0;
+}
+
+void RenderGraph::BuildBarriers()
+{
+	Vec<ResourceState> states(pArrResources.size());
+	for (size_t i = 0; i < pArrResources.size(); i++)
+	{
+		const Resource &resource = pArrResources[i];
+		ResourceState &state = states[i];
+
+		// Transients may share memory with something the last frame used last, so their first
+		// barrier waits on everything before it. Imported images wait on what the owner said.
+		state.eLayout = resource.bImported ? resource.eInitialLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+		state.eWriteStages = resource.bImported ? resource.eInitialStages : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		state.eWriteAccess = resource.bImported ? VK_ACCESS_2_MEMORY_WRITE_BIT : VK_ACCESS_2_NONE;
+		state.eVisibleStages = 0;
+		state.eReadStages = 0;
+	}
+
+	auto makeBarrier = [this](u32 resourceIndex, const ResourceState &state, VkPipelineStageFlags2 srcStages, VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess, VkImageLayout newLayout)
+	{
+		const Resource &resource = pArrResources[resourceIndex];
+
+		VkImageMemoryBarrier2 barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = srcStages;
+		barrier.srcAccessMask = state.eWriteAccess;
+		barrier.dstStageMask = dstStages;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = state.eLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.pImage;
+		barrier.subresourceRange.aspectMask = GetAspect(resource.sDesc.format);
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		return barrier;
+	};
+
+	pArrBarriers.assign(pArrPasses.size() + 1, {});
+	iBarrierCount = 0;
+
+	for (size_t i = 0; i < pArrPasses.size(); i++)
+	{
+		const Pass &pass = pArrPasses[i];
+		if (!pass.bAlive)
+		{
+			continue;
+		}
+
+		for (const Access &access : pass.pArrAccesses)
+		{
+			UsageInfo info = GetUsageInfo(access.eUsage);
+			ResourceState &state = states[access.iResource];
+
+			VkAccessFlags2 dstAccess = (access.bRead ? info.readAccess : 0) | (access.bWrite ? info.writeAccess : 0);
+
+			if (state.eLayout != info.layout || access.bWrite)
+			{
+				// Layout changes and writes have to wait for every earlier read and write
+				VkPipelineStageFlags2 srcStages = state.eWriteStages | state.eReadStages;
+				if (state.eLayout != info.layout || srcStages != 0)
+				{
+					pArrBarriers[i].push_back(makeBarrier(access.iResource, state, srcStages, info.stages, dstAccess, info.layout));
+				}
+
+				// A read only transition is still ordered before info.stages, later readers elsewhere wait on those
+				state.eLayout = info.layout;
+				state.eWriteStages = info.stages;
+				state.eWriteAccess = access.bWrite ? info.writeAccess : VK_ACCESS_2_NONE;
+				state.eVisibleStages = info.stages;
+				state.eReadStages = 0;
+			}
+			else if ((info.stages & ~state.eVisibleStages) != 0 && state.eWriteStages != 0)
+			{
+				// Same layout, only the stages that haven't seen the last write yet need it
+				pArrBarriers[i].push_back(makeBarrier(access.iResource, state, state.eWriteStages, info.stages, dstAccess, info.layout));
+				state.eVisibleStages |= info.stages;
+				state.eReadStages |= info.stages;
+			}
+			else
+			{
+				state.eReadStages |= info.stages;
+			}
+		}
+
+		iBarrierCount += static_cast<u32>(pArrBarriers[i].size());
+	}
+
+	// Hand imported images back in the layout their owner expects
+	for (u32 i = 0; i < pArrResources.size(); i++)
+	{
+		const Resource &resource = pArrResources[i];
+		const ResourceState &state = states[i];
+		if (!resource.bImported || resource.eFinalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.eFinalLayout == state.eLayout)
+		{
+			continue;
+		}
+
+		pArrBarriers.back().push_back(makeBarrier(i, state, state.eWriteStages | state.eReadStages, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, VK_ACCESS_2_NONE, resource.eFinalLayout));
+	}
+	iBarrierCount += static_cast<u32>(pArrBarriers.back().size());
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer commandBuffer, const Vec<VkImageMemoryBarrier2> &barriers) const
+{
+	if (barriers.empty())
+	{
+		return;
+	}
+
+	if (pDevice.HasSynchronization2())
+	{
+		VkDependencyInfo dependencyInfo = {};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.imageMemoryBarrierCount = static_cast<u32>(barriers.size());
+		dependencyInfo.pImageMemoryBarriers = barriers.data();
+
+		pDevice.CmdPipelineBarrier2(commandBuffer, dependencyInfo);
+		return;
+	}
+
+	// The old barrier has one stage mask for the whole call, so the batch waits on the union.
+	// Every stage the graph uses has the same bit in both versions.
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	Vec<VkImageMemoryBarrier> legacyBarriers;
+	legacyBarriers.reserve(barriers.size());
+	for (const VkImageMemoryBarrier2 &barrier : barriers)
+	{
+		srcStages |= static_cast<VkPipelineStageFlags>(barrier.srcStageMask);
+		dstStages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+
+		VkImageMemoryBarrier legacyBarrier = {};
+		legacyBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		legacyBarrier.srcAccessMask = static_cast<VkAccessFlags>(barrier.srcAccessMask);
+		legacyBarrier.dstAccessMask = static_cast<VkAccessFlags>(barrier.dstAccessMask);
+		legacyBarrier.oldLayout = barrier.oldLayout;
+		legacyBarrier.newLayout = barrier.newLayout;
+		legacyBarrier.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex;
+		legacyBarrier.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex;
+		legacyBarrier.image = barrier.image;
+		legacyBarrier.subresourceRange = barrier.subresourceRange;
+		legacyBarriers.push_back(legacyBarrier);
+	}
+
+	if (srcStages == 0)
+	{
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	if (dstStages == 0)
+	{
+		dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<u32>(legacyBarriers.size()), legacyBarriers.data());
+}
\ No newline at end of file
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+
+class Device;
+class RenderGraph;
+
+// Handle to an image in the graph, only valid for the graph it came from until the next Reset()
+struct RenderGraphResource
+{
+	static constexpr u32 INVALID = UINT32_MAX;
+
+	u32 index = INVALID;
+
+	bool IsValid() const
+	{
+		return index != INVALID;
+	}
+};
+
+// How a pass touches an image, decides the layout, stages and access of the barrier in front of it
+enum class RenderGraphUsage
+{
+	ColorAttachment,		// Written as a color attachment
+	DepthStencilAttachment,	// Depth tested and written
+	DepthStencilRead,		// Depth tested, read only
+	Sampled,				// Read through a sampler in fragment or compute shaders
+	StorageRead,			// Read as a storage image in compute shaders
+	StorageWrite,			// Written as a storage image in compute shaders
+	TransferSrc,			// Copy or blit source
+	TransferDst,			// Copy, blit or clear destination
+};
+
+// A transient image, created and placed in memory by the graph
+struct RenderGraphImageDesc
+{
+	VkExtent2D extent = { 0, 0 };
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	u32 mipLevels = 1;
+
+	// Added to whatever the passes using it need
+	VkImageUsageFlags usage = 0;
+};
+
+// Handed to a pass while it's being set up, to declare what it reads and writes
+class RenderGraphBuilder
+{
+private:
+	RenderGraph &pGraph;
+	u32 iPass;
+
+public:
+
+	RenderGraphBuilder(RenderGraph &graph, u32 pass);
+
+public:
+
+	// New transient image, its contents are undefined before the first write
+	RenderGraphResource CreateImage(const string &name, const RenderGraphImageDesc &desc);
+
+	RenderGraphResource Read(RenderGraphResource resource, RenderGraphUsage usage);
+
+	// Write only, whatever was in the image before is thrown away. Read and write it to keep the contents.
+	RenderGraphResource Write(RenderGraphResource resource, RenderGraphUsage usage);
+
+	// Keep the pass even if nothing reads what it writes
+	void SetSideEffect();
+};
+
+// Passes declare the images they read and write, and the graph works out the rest every frame:
+// passes nobody depends on are culled, barriers are derived from the declared usages and batched
+// into one barrier call per pass, and transient images whose lifetimes don't overlap share memory.
+// Uses vkCmdPipelineBarrier2 with VK_KHR_synchronization2 and falls back to vkCmdPipelineBarrier.
+// The transient images are kept from frame to frame as long as the memory layout doesn't change.
+class RenderGraph : public IVkResource, public NonCopyable
+{
+public:
+
+	using SetupFunc = Func<void(RenderGraphBuilder &builder)>;
+	using ExecuteFunc = Func<void(VkCommandBuffer commandBuffer, const RenderGraph &graph)>;
+
+private:
+
+	struct Access
+	{
+		u32 iResource;
+		RenderGraphUsage eUsage;
+		bool bRead;
+		bool bWrite;
+	};
+
+	struct Pass
+	{
+		string sName;
+		ExecuteFunc fnExecute;
+		Vec<Access> pArrAccesses;
+		bool bSideEffect = false;
+		bool bAlive = false;
+	};
+
+	struct Resource
+	{
+		string sName;
+		RenderGraphImageDesc sDesc;
+		VkImageUsageFlags eUsage = 0;
+		bool bImported = false;
+
+		VkImage pImage = VK_NULL_HANDLE;
+		VkImageView pView = VK_NULL_HANDLE;
+
+		// State before the first and after the last pass of the graph, imported images only
+		VkImageLayout eInitialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout eFinalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 eInitialStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+		// First and last alive pass touching it, and the memory it was placed in
+		u32 iFirstPass = UINT32_MAX;
+		u32 iLastPass = 0;
+		u32 iHeap = 0;
+		VkDeviceSize iOffset = 0;
+		VkMemoryRequirements sRequirements = {};
+	};
+
+	// What the last barrier left the image in. Reads since the last write only need a barrier
+	// for stages the write wasn't made visible to yet.
+	struct ResourceState
+	{
+		VkImageLayout eLayout;
+		VkPipelineStageFlags2 eWriteStages;
+		VkAccessFlags2 eWriteAccess;
+		VkPipelineStageFlags2 eVisibleStages;
+		VkPipelineStageFlags2 eReadStages;
+	};
+
+	// One memory allocation shared by the transient images with the same memory type bits
+	struct Heap
+	{
+		u32 iTypeBits;
+		VkMemoryRequirements sRequirements;
+		MemoryAllocation sAllocation;
+	};
+
+	// Transient images of the last compile, reused while the layout hash stays the same
+	struct TransientImage
+	{
+		VkImage pImage;
+		VkImageView pView;
+	};
+
+	Device &pDevice;
+
+	Vec<Pass> pArrPasses;
+	Vec<Resource> pArrResources;
+
+	Vec<Heap> pArrHeaps;
+	Vec<TransientImage> pArrTransients;
+	u64 iLayoutHash;
+	VkDeviceSize iUnaliasedBytes;
+
+	// Barriers in front of every pass plus one batch at the end for the imported images
+	Vec<Vec<VkImageMemoryBarrier2>> pArrBarriers;
+
+	u32 iCulledPasses;
+	u32 iBarrierCount;
+	bool bCompiled;
+
+	friend class RenderGraphBuilder;
+
+public:
+
+	RenderGraph(Device &device);
+	~RenderGraph();
+
+public:
+
+	void Create() override;
+
+	// Releases the transient images once the GPU is done with them
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Drop the passes and resources of the last frame, the transient memory stays around
+	void Reset();
+
+	// An image owned elsewhere, like a swap chain image. It is moved to finalLayout at the end.
+	// initialStages are the stages that have to be done with it before the graph may touch it.
+	RenderGraphResource ImportImage(const string &name, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent,
+		VkImageLayout initialLayout, VkImageLayout finalLayout, VkPipelineStageFlags2 initialStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+	// Passes run in the order they are added
+	void AddPass(const string &name, const SetupFunc &fnSetup, ExecuteFunc fnExecute);
+
+	// Cull, place the transient images and work out the barriers
+	void Compile();
+
+	// Record every pass that survived culling with its barriers
+	void Execute(VkCommandBuffer commandBuffer) const;
+
+public:
+
+	VkImage GetImage(RenderGraphResource resource) const;
+	VkImageView GetImageView(RenderGraphResource resource) const;
+	const RenderGraphImageDesc &GetDesc(RenderGraphResource resource) const;
+
+	u32 GetPassCount() const;
+	u32 GetCulledPassCount() const;
+	u32 GetBarrierCount() const;
+
+	// Bytes the transient images take, and what they'd take without aliasing
+	VkDeviceSize GetTransientBytes() const;
+	VkDeviceSize GetUnaliasedBytes() const;
+
+private:
+
+	void Cull();
+	void ComputeLifetimes();
+	void PlaceTransients();
+	void CreateTransients();
+	void DestroyTransients();
+	void BuildBarriers();
+	void RecordBarriers(VkCommandBuffer commandBuffer, const Vec<VkImageMemoryBarrier2> &barriers) const;
+};
\ No newline at end of file
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "RenderPassCache.h"
+#include "Device.h"
+#include "Image.h"
+#include "DeferredDestroyQueue.h"
+#include "Hash.h"
+
+namespace
+{
+	u64 HashAttachment(Hasher &hasher, const RenderingAttachment &attachment)
+	{
+		hasher.Add(attachment.format);
+		hasher.Add(attachment.loadOp);
+		hasher.Add(attachment.storeOp);
+		return hasher.Get();
+	}
+
+	VkAttachmentDescription DescribeAttachment(const RenderingAttachment &attachment, VkSampleCountFlagBits samples, VkImageLayout layout)
+	{
+		bool bStencil = (Image::GetAspectMask(attachment.format) & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+
+		VkAttachmentDescription description = {};
+		description.format = attachment.format;
+		description.samples = samples;
+		description.loadOp = attachment.loadOp;
+		description.storeOp = attachment.storeOp;
+		description.stencilLoadOp = bStencil ? attachment.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		description.stencilStoreOp = bStencil ? attachment.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+		// No layout changes in here, the barriers around the pass take care of that
+		description.initialLayout = layout;
+		description.finalLayout = layout;
+		return description;
+	}
+}
+
+void RenderingDesc::AddColorAttachment(VkImageView view, VkFormat format, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, const VkClearColorValue &clearColor)
+{
+	ASSERT(colorAttachmentCount < MAX_COLOR_ATTACHMENTS, "Too many color attachments");
+
+	RenderingAttachment &attachment = colorAttachments[colorAttachmentCount++];
+	attachment.view = view;
+	attachment.format = format;
+	attachment.loadOp = loadOp;
+	attachment.storeOp = storeOp;
+	attachment.clearValue.color = clearColor;
+}
+
+void RenderingDesc::SetDepthAttachment(VkImageView view, VkFormat format, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp storeOp, f32 clearDepth)
+{
+	depthAttachment.view = view;
+	depthAttachment.format = format;
+	depthAttachment.loadOp = loadOp;
+	depthAttachment.storeOp = storeOp;
+	depthAttachment.clearValue.depthStencil = { clearDepth, 0 };
+}
+
+bool RenderingDesc::HasDepthAttachment() const
+{
+	return depthAttachment.format != VK_FORMAT_UNDEFINED;
+}
+
+RenderPassCache::RenderPassCache(Device &device) :
+	pDevice(device),
+	pArrRenderPasses(),
+	pArrFramebuffers()
+{
+}
+
+RenderPassCache::~RenderPassCache()
+{
+	Destroy();
+}
+
+void RenderPassCache::Create()
+{
+}
+
+void RenderPassCache::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (auto &[hash, framebuffer] : pArrFramebuffers)
+	{
+		vkDestroyFramebuffer(pDevice.GetVkNative(), framebuffer.pFramebuffer, nullptr);
+	}
+	pArrFramebuffers.clear();
+
+	for (auto &[hash, renderPass] : pArrRenderPasses)
+	{
+		vkDestroyRenderPass(pDevice.GetVkNative(), renderPass, nullptr);
+	}
+	pArrRenderPasses.clear();
+}
+
+bool RenderPassCache::IsValid() const
+{
+	return pDevice.IsValid();
+}
+
+VkRenderPass RenderPassCache::GetRenderPass(const RenderingDesc &desc)
+{
+	// Views and clear values don't go into the render pass, only what the attachments look like
+	Hasher hasher;
+	hasher.Add(desc.samples);
+	hasher.Add(desc.colorAttachmentCount);
+	for (u32 i = 0; i < desc.colorAttachmentCount; i++)
+	{
+		HashAttachment(hasher, desc.colorAttachments[i]);
+	}
+	u64 hash = HashAttachment(hasher, desc.depthAttachment);
+
+	lock_guard<mutex> lock(mLock);
+
+	auto it = pArrRenderPasses.find(hash);
+	if (it != pArrRenderPasses.end())
+	{
+		return it->second;
+	}
+
+	VkRenderPass renderPass = CreateRenderPass(desc);
+	pArrRenderPasses[hash] = renderPass;
+	return renderPass;
+}
+
+VkRenderPass RenderPassCache::GetCompatibleRenderPass(const PipelineStateDesc &desc)
+{
+	// Plain load and store, the same signature a pass that just draws on top of its targets has
+	RenderingDesc renderingDesc;
+	renderingDesc.samples = desc.samples;
+	for (u32 i = 0; i < desc.colorTargetCount; i++)
+	{
+		renderingDesc.AddColorAttachment(VK_NULL_HANDLE, desc.colorFormats[i]);
+	}
+	if (desc.depthFormat != VK_FORMAT_UNDEFINED)
+	{
+		renderingDesc.SetDepthAttachment(VK_NULL_HANDLE, desc.depthFormat);
+	}
+
+	return GetRenderPass(renderingDesc);
+}
+
+VkFramebuffer RenderPassCache::GetFramebuffer(VkRenderPass renderPass, const RenderingDesc &desc)
+{
+	Vec<VkImageView> views;
+	views.reserve(desc.colorAttachmentCount + 1);
+	for (u32 i = 0; i < desc.colorAttachmentCount; i++)
+	{
+		views.push_back(desc.colorAttachments[i].view);
+	}
+	if (desc.HasDepthAttachment())
+	{
+		views.push_back(desc.depthAttachment.view);
+	}
+
+	Hasher hasher;
+	hasher.Add(renderPass);
+	hasher.Add(desc.extent.width);
+	hasher.Add(desc.extent.height);
+	hasher.AddBytes(views.data(), views.size() * sizeof(VkImageView));
+	u64 hash = hasher.Get();
+
+	lock_guard<mutex> lock(mLock);
+
+	auto it = pArrFramebuffers.find(hash);
+	if (it != pArrFramebuffers.end())
+	{
+		return it->second.pFramebuffer;
+	}
+
+	VkFramebufferCreateInfo framebufferCreateInfo = {};
+	framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferCreateInfo.renderPass = renderPass;
+	framebufferCreateInfo.attachmentCount = static_cast<u32>(views.size());
+	framebufferCreateInfo.pAttachments = views.data();
+	framebufferCreateInfo.width = desc.extent.width;
+	framebufferCreateInfo.height = desc.extent.height;
+	framebufferCreateInfo.layers = 1;
+
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateFramebuffer(pDevice.GetVkNative(), &framebufferCreateInfo, nullptr, &framebuffer));
+
+	pArrFramebuffers[hash] = { framebuffer, move(views) };
+	return framebuffer;
+}
+
+void RenderPassCache::ReleaseImageView(VkImageView view)
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (auto it = pArrFramebuffers.begin(); it != pArrFramebuffers.end();)
+	{
+		const Vec<VkImageView> &views = it->second.pArrViews;
+		if (find(views.begin(), views.end(), view) != views.end())
+		{
+			// Queued in front of the view, so both go once the frames using them are done
+			pDevice.GetDeferredDestroyQueue().DestroyFramebuffer(it->second.pFramebuffer);
+			it = pArrFramebuffers.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+size_t RenderPassCache::GetRenderPassCount() const
+{
+	lock_guard<mutex> lock(mLock);
+	return pArrRenderPasses.size();
+}
+
+size_t RenderPassCache::GetFramebufferCount() const
+{
+	lock_guard<mutex> lock(mLock);
+	return pArrFramebuffers.size();
+}
+
+VkRenderPass RenderPassCache::CreateRenderPass(const RenderingDesc &desc) const
+{
+	Vec<VkAttachmentDescription> attachments;
+	Vec<VkAttachmentReference> colorReferences;
+	for (u32 i = 0; i < desc.colorAttachmentCount; i++)
+	{
+		attachments.push_back(DescribeAttachment(desc.colorAttachments[i], desc.samples, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+		colorReferences.push_back({ i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+	}
+
+	VkAttachmentReference depthReference = { static_cast<u32>(attachments.size()), VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	if (desc.HasDepthAttachment())
+	{
+		attachments.push_back(DescribeAttachment(desc.depthAttachment, desc.samples, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL));
+	}
+
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = static_cast<u32>(colorReferences.size());
+	subpass.pColorAttachments = colorReferences.data();
+	subpass.pDepthStencilAttachment = desc.HasDepthAttachment() ? &depthReference : nullptr;
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassCreateInfo.attachmentCount = static_cast<u32>(attachments.size());
+	renderPassCreateInfo.pAttachments = attachments.data();
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VK_CHECK_RESULT(vkCreateRenderPass(pDevice.GetVkNative(), &renderPassCreateInfo, nullptr, &renderPass));
+	return renderPass;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "PipelineStateDesc.h"
+
+class Device;
+
+// One attachment of a rendering scope. The image has to be in the attachment layout already
+// (COLOR_ATTACHMENT_OPTIMAL or DEPTH_STENCIL_ATTACHMENT_OPTIMAL) and is left there.
+struct RenderingAttachment
+{
+	VkImageView view = VK_NULL_HANDLE;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	VkClearValue clearValue = {};
+};
+
+// What Device::CmdBeginRendering renders into, as plain data
+struct RenderingDesc
+{
+	static constexpr u32 MAX_COLOR_ATTACHMENTS = PipelineStateDesc::MAX_COLOR_TARGETS;
+
+	VkExtent2D extent = { 0, 0 };
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+	u32 colorAttachmentCount = 0;
+	RenderingAttachment colorAttachments[MAX_COLOR_ATTACHMENTS] = {};
+
+	// Unused while the format is undefined
+	RenderingAttachment depthAttachment = {};
+
+public:
+
+	void AddColorAttachment(VkImageView view, VkFormat format, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE, const VkClearColorValue &clearColor = {});
+	void SetDepthAttachment(VkImageView view, VkFormat format, VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+		VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_STORE, f32 clearDepth = 1.0f);
+
+	bool HasDepthAttachment() const;
+};
+
+// Fallback for devices without VK_KHR_dynamic_rendering. Render passes are keyed by their attachment
+// signature (formats, samples, load and store ops) and framebuffers by render pass, views and extent,
+// so the same handful of objects get reused instead of one per pass and swap chain image.
+// Every attachment stays in its attachment layout for the whole pass, same as with dynamic rendering,
+// so the barriers around it don't care which path is taken.
+// Framebuffers go away together with the image views they use, see ReleaseImageView.
+class RenderPassCache : public IVkResource, public NonCopyable
+{
+private:
+
+	struct Framebuffer
+	{
+		VkFramebuffer pFramebuffer;
+		Vec<VkImageView> pArrViews;
+	};
+
+	Device &pDevice;
+
+	unordered_map<u64, VkRenderPass> pArrRenderPasses;
+	unordered_map<u64, Framebuffer> pArrFramebuffers;
+	mutable mutex mLock;
+
+public:
+
+	RenderPassCache(Device &device);
+	~RenderPassCache();
+
+public:
+
+	void Create() override;
+
+	// The GPU must not be using any of the objects anymore
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Render pass matching the attachments of desc, created on first use
+	VkRenderPass GetRenderPass(const RenderingDesc &desc);
+
+	// Render pass a pipeline with these target formats is compatible with. Load and store ops
+	// don't matter for compatibility, so any pass with the same formats and samples can use the pipeline.
+	VkRenderPass GetCompatibleRenderPass(const PipelineStateDesc &desc);
+
+	VkFramebuffer GetFramebuffer(VkRenderPass renderPass, const RenderingDesc &desc);
+
+	// Drop every framebuffer using view, called when the view is destroyed
+	void ReleaseImageView(VkImageView view);
+
+	size_t GetRenderPassCount() const;
+	size_t GetFramebufferCount() const;
+
+private:
+
+	VkRenderPass CreateRenderPass(const RenderingDesc &desc) const;
+};
@@ -0,0 +1,303 @@
+#pragma once
+
+#include "Renderer.h"
+#include "FrameContext.h"
+#include "Device.h"
+#include "SwapChain.h"
+#include "GpuTimeline.h"
+#include "DeferredDestroyQueue.h"
+#include "FramePacer.h"
+#include "UniformRing.h"
+
+Renderer::Renderer(Device &device, SwapChain &swapChain, u32 framesInFlight, u32 recordThreads) :
+	pDevice(device),
+	pSwapChain(swapChain),
+	pArrFrames(),
+	pFramePacer(),
+	pUniformRing(),
+	pArrImagesInFlight(),
+	pArrPendingWaits(),
+	fnRecord(),
+	fnSwapChainRecreated(),
+	iFramesInFlight(clamp(framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT)),
+	iRecordThreads(max(recordThreads, 1u)),
+	iFrameIndex(0),
+	iImageIndex(0),
+	iFrameCount(0),
+	bFrameStarted(false),
+	bSwapChainDirty(false)
+{
+}
+
+Renderer::~Renderer()
+{
+	if (!pArrFrames.empty())
+	{
+		Destroy();
+	}
+}
+
+void Renderer::Create()
+{
+	pArrFrames.reserve(iFramesInFlight);
+	for (u32 i = 0; i < iFramesInFlight; i++)
+	{
+		Ref<FrameContext> pFrame = make_shared<FrameContext>(pDevice, iRecordThreads);
+		pFrame->Create();
+		pArrFrames.push_back(pFrame);
+	}
+
+	pArrImagesInFlight.assign(pSwapChain.GetImages().size(), 0);
+
+	pFramePacer = make_shared<FramePacer>(pDevice, pSwapChain);
+	pFramePacer->Create();
+
+	pUniformRing = make_shared<UniformRing>(pDevice, iFramesInFlight);
+	pUniformRing->Create();
+}
+
+void Renderer::Destroy()
+{
+	// Frames may still be executing or presenting, their objects can't go away until they are done
+	pDevice.WaitIdle();
+
+	pArrFrames.clear();
+	pArrImagesInFlight.clear();
+	pFramePacer.reset();
+	pUniformRing.reset();
+}
+
+bool Renderer::IsValid() const
+{
+	return !pArrFrames.empty();
+}
+
+void Renderer::SetRecordCallback(RecordCallback callback)
+{
+	fnRecord = callback;
+}
+
+void Renderer::SetSwapChainCallback(SwapChainCallback callback)
+{
+	fnSwapChainRecreated = callback;
+}
+
+void Renderer::InvalidateSwapChain()
+{
+	bSwapChainDirty = true;
+}
+
+bool Renderer::BeginFrame()
+{
+	ASSERT(!bFrameStarted, "BeginFrame called twice without EndFrame");
+
+	FrameContext &frame = GetCurrentFrame();
+
+	if (bSwapChainDirty && !RecreateSwapChain())
+	{
+		return false;
+	}
+
+	// Waits for the display, so whatever the frame samples next is as fresh as the policy allows
+	pFramePacer->Throttle();
+
+	// Only blocks if the GPU is more than iFramesInFlight frames behind
+	frame.Wait();
+
+	VkResult result = vkAcquireNextImageKHR(
+		pDevice.GetVkNative(),
+		pSwapChain.GetVkNative(),
+		UINT64_MAX,
+		frame.GetImageAvailableSemaphore(),
+		VK_NULL_HANDLE,
+		&iImageIndex
+	);
+
+	// Nothing was acquired and the semaphore isn't signaled, try again with a new swap chain next frame
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		bSwapChainDirty = true;
+		return false;
+	}
+
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+	{
+		throw runtime_error("Failed to acquire swap chain image: " + to_string(result));
+	}
+
+	// Still presentable, so render this one and recreate after
+	if (result == VK_SUBOPTIMAL_KHR)
+	{
+		bSwapChainDirty = true;
+	}
+
+	// The swap chain can hand back an image an older frame slot is still rendering into
+	pDevice.GetGraphicsTimeline().Wait(pArrImagesInFlight[iImageIndex]);
+
+	// Whatever was parked on frames that are done by now
+	pDevice.GetGraphicsTimeline().Poll();
+	pDevice.GetDeferredDestroyQueue().Collect();
+
+	frame.Reset();
+	pUniformRing->BeginFrame(iFrameIndex);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VK_CHECK_RESULT(vkBeginCommandBuffer(frame.GetCommandBuffer(), &beginInfo));
+
+	bFrameStarted = true;
+	return true;
+}
+
+void Renderer::EndFrame()
+{
+	ASSERT(bFrameStarted, "EndFrame called without BeginFrame");
+
+	FrameContext &frame = GetCurrentFrame();
+	VkCommandBuffer commandBuffer = frame.GetCommandBuffer();
+
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+	pUniformRing->Flush();
+
+	VkSemaphore signalSemaphore = pSwapChain.GetRenderFinishedSemaphore(iImageIndex);
+
+	// Everything before writing the back buffer can overlap with the acquire
+	SemaphoreWait acquireWait;
+	acquireWait.semaphore = frame.GetImageAvailableSemaphore();
+	acquireWait.stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+	pArrPendingWaits.push_back(acquireWait);
+
+	// The timeline value replaces the per frame fence
+	u64 value = pDevice.GetGraphicsTimeline().Submit({ commandBuffer }, pArrPendingWaits, { signalSemaphore });
+	pArrPendingWaits.clear();
+
+	frame.SetSubmitValue(value);
+	pArrImagesInFlight[iImageIndex] = value;
+
+	VkSwapchainKHR swapChain = pSwapChain.GetVkNative();
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &signalSemaphore;
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &swapChain;
+	presentInfo.pImageIndices = &iImageIndex;
+
+	pFramePacer->OnPresent(presentInfo, value);
+
+	VkResult result = pDevice.Present(presentInfo);
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		throw runtime_error("Failed to present swap chain image: " + to_string(result));
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		bSwapChainDirty = true;
+	}
+
+	bFrameStarted = false;
+	iFrameIndex = (iFrameIndex + 1) % iFramesInFlight;
+	iFrameCount++;
+}
+
+bool Renderer::DrawFrame()
+{
+	if (!BeginFrame())
+	{
+		return false;
+	}
+
+	if (fnRecord)
+	{
+		fnRecord(GetCurrentCommandBuffer(), iImageIndex);
+	}
+
+	EndFrame();
+	return true;
+}
+
+void Renderer::WaitIdle() const
+{
+	for (const Ref<FrameContext> &pFrame : pArrFrames)
+	{
+		pFrame->Wait();
+	}
+}
+
+void Renderer::AddWait(VkSemaphore semaphore, u64 value, VkPipelineStageFlags stage)
+{
+	SemaphoreWait wait;
+	wait.semaphore = semaphore;
+	wait.value = value;
+	wait.stage = stage;
+	pArrPendingWaits.push_back(wait);
+}
+
+FrameContext &Renderer::GetCurrentFrame() const
+{
+	return *pArrFrames[iFrameIndex];
+}
+
+FramePacer &Renderer::GetFramePacer() const
+{
+	return *pFramePacer;
+}
+
+UniformRing &Renderer::GetUniformRing() const
+{
+	return *pUniformRing;
+}
+
+VkCommandBuffer Renderer::GetCurrentCommandBuffer() const
+{
+	return GetCurrentFrame().GetCommandBuffer();
+}
+
+u32 Renderer::GetFrameIndex() const
+{
+	return iFrameIndex;
+}
+
+u32 Renderer::GetImageIndex() const
+{
+	return iImageIndex;
+}
+
+u32 Renderer::GetFramesInFlight() const
+{
+	return iFramesInFlight;
+}
+
+u32 Renderer::GetRecordThreads() const
+{
+	return iRecordThreads;
+}
+
+u64 Renderer::GetFrameCount() const
+{
+	return iFrameCount;
+}
+
+bool Renderer::RecreateSwapChain()
+{
+	if (!pSwapChain.Recreate())
+	{
+		return false;
+	}
+
+	// The new images have never been rendered to
+	pArrImagesInFlight.assign(pSwapChain.GetImages().size(), 0);
+	pFramePacer->OnSwapChainRecreated();
+	bSwapChainDirty = false;
+
+	if (fnSwapChainRecreated)
+	{
+		fnSwapChainRecreated(pSwapChain);
+	}
+	return true;
+}
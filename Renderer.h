@@ -0,0 +1,107 @@
+#pragma once
+
+#include "GpuTimeline.h"
+
+class Device;
+class SwapChain;
+class FrameContext;
+class FramePacer;
+class UniformRing;
+
+// Drives the acquire -> record -> submit -> present loop.
+// Keeps several frames in flight so the CPU can record frame N+1 while the GPU works on frame N.
+class Renderer : public IVkResource, public NonCopyable
+{
+public:
+
+	// Called once per frame with the command buffer already in the recording state
+	using RecordCallback = Func<void(VkCommandBuffer commandBuffer, u32 imageIndex)>;
+
+	// Called after the swap chain was recreated, to rebuild whatever depends on its size
+	using SwapChainCallback = Func<void(SwapChain &swapChain)>;
+
+	static constexpr u32 DEFAULT_FRAMES_IN_FLIGHT = 2;
+	static constexpr u32 MAX_FRAMES_IN_FLIGHT = 3;
+
+private:
+	Device &pDevice;
+	SwapChain &pSwapChain;
+
+	Vec<Ref<FrameContext>> pArrFrames;
+
+	// Holds the CPU back before acquiring so frames don't pile up in the present queue
+	Ref<FramePacer> pFramePacer;
+
+	// Per draw constants, a region per frame in flight
+	Ref<UniformRing> pUniformRing;
+
+	// Graphics timeline value of the frame that last rendered into each swap chain image
+	Vec<u64> pArrImagesInFlight;
+
+	// Extra waits for the next submission, e.g. on uploads the frame reads from
+	Vec<SemaphoreWait> pArrPendingWaits;
+
+	RecordCallback fnRecord;
+	SwapChainCallback fnSwapChainRecreated;
+
+	u32 iFramesInFlight;
+	u32 iRecordThreads;
+	u32 iFrameIndex;
+	u32 iImageIndex;
+	u64 iFrameCount;
+	bool bFrameStarted;
+
+	// Out of date, suboptimal or resized, recreated before the next acquire
+	bool bSwapChainDirty;
+
+public:
+
+	// recordThreads is how many threads record into a frame at once, each frame gets a command pool per thread
+	Renderer(Device &device, SwapChain &swapChain, u32 framesInFlight = DEFAULT_FRAMES_IN_FLIGHT, u32 recordThreads = 1);
+	~Renderer();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	void SetRecordCallback(RecordCallback callback);
+	void SetSwapChainCallback(SwapChainCallback callback);
+
+	// Recreate the swap chain before the next frame, e.g. after the window was resized
+	void InvalidateSwapChain();
+
+	// Wait for the current frame slot, acquire a swap chain image and begin the command buffer.
+	// Returns false if no image could be acquired this frame, e.g. while the swap chain can't be recreated.
+	bool BeginFrame();
+
+	// End the command buffer, submit it and present the acquired image
+	void EndFrame();
+
+	// BeginFrame, record through the callback, EndFrame
+	bool DrawFrame();
+
+	// Wait for every frame in flight to finish
+	void WaitIdle() const;
+
+	// Make the next submitted frame wait for semaphore to reach value before stage
+	void AddWait(VkSemaphore semaphore, u64 value, VkPipelineStageFlags stage);
+
+	FrameContext &GetCurrentFrame() const;
+	FramePacer &GetFramePacer() const;
+	UniformRing &GetUniformRing() const;
+	VkCommandBuffer GetCurrentCommandBuffer() const;
+	u32 GetFrameIndex() const;
+	u32 GetImageIndex() const;
+	u32 GetFramesInFlight() const;
+	u32 GetRecordThreads() const;
+	u64 GetFrameCount() const;
+
+private:
+
+	// Without waiting for the device, the old images go through the deferred destroy queue
+	bool RecreateSwapChain();
+};
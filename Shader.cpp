@@ -2,16 +2,41 @@
 
 #include "Shader.h"
 #include "Device.h"
-
+#include "Hash.h"
+#include "DeferredDestroyQueue.h"
+#include "MappedFile.h"
 
 Shader::Shader(Device &device, const string &filename) :
 	pVkShaderModule(VK_NULL_HANDLE),
-	pDevice(device)
+	eStage(static_cast<VkShaderStageFlagBits>(0)),
+	pDevice(device),
+	pCode(nullptr),
+	iCodeSize(0),
+	pCodeOwner(),
+	iCodeHash(0),
+	sReflection()
 {
-	SetCode(ReadFile(filename));
+	Ref<MappedFile> pFile = make_shared<MappedFile>(filename);
+	SetCodeView(pFile->GetData(), pFile->GetSize(), pFile, 0);
+	eStage = sReflection.stage != 0 ? sReflection.stage : StageFromFilename(filename);
 	// Don't create the shader module here, create it when needed.
 }
 
+Shader::Shader(Device &device, const void *pData, size_t size, Ref<const void> owner, u64 codeHash) :
+	pVkShaderModule(VK_NULL_HANDLE),
+	eStage(static_cast<VkShaderStageFlagBits>(0)),
+	pDevice(device),
+	pCode(nullptr),
+	iCodeSize(0),
+	pCodeOwner(),
+	iCodeHash(0),
+	sReflection()
+{
+	SetCodeView(pData, size, move(owner), codeHash);
+	ASSERT(sReflection.stage != 0, "Can't tell the shader stage from the SPIR-V entry point");
+	eStage = sReflection.stage;
+}
+
 Shader::~Shader()
 {
 	if (pVkShaderModule != VK_NULL_HANDLE)
@@ -24,8 +49,8 @@ void Shader::Create()
 {
 	VkShaderModuleCreateInfo shaderCreateInfo = {};
 	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderCreateInfo.codeSize = pArrCode.size();
-	shaderCreateInfo.pCode = reinterpret_cast<const u32 *>(pArrCode.data());
+	shaderCreateInfo.codeSize = iCodeSize;
+	shaderCreateInfo.pCode = pCode;
 	
 	VK_CHECK_RESULT(
 		vkCreateShaderModule(
@@ -41,7 +66,7 @@ void Shader::Destroy()
 {
 	if (pVkShaderModule != VK_NULL_HANDLE)
 	{
-		vkDestroyShaderModule(pDevice.GetVkNative(), pVkShaderModule, nullptr);
+		pDevice.GetDeferredDestroyQueue().DestroyShaderModule(pVkShaderModule);
 		pVkShaderModule = VK_NULL_HANDLE;
 	}
 }
@@ -58,35 +83,75 @@ VkShaderModule Shader::GetVkNative() const
 
 void Shader::SetCode(const Vec<i8> &code)
 {
-	pArrCode = code;
+	Ref<Vec<i8>> pCopy = make_shared<Vec<i8>>(code);
+	SetCodeView(pCopy->data(), pCopy->size(), pCopy, 0);
+}
+
+const u32 *Shader::GetCode() const
+{
+	return pCode;
+}
+
+size_t Shader::GetCodeSize() const
+{
+	return iCodeSize;
 }
 
-const Vec<i8> &Shader::GetCode() const
+u64 Shader::GetCodeHash() const
 {
-	return pArrCode;
+	return iCodeHash;
 }
 
-const VkPipelineShaderStageCreateInfo &Shader::GetStageCreateInfo()
+const ShaderReflection &Shader::GetReflection() const
+{
+	return sReflection;
+}
+
+VkShaderStageFlagBits Shader::GetStage() const
+{
+	return eStage;
+}
+
+VkPipelineShaderStageCreateInfo Shader::GetStageCreateInfo() const
 {
 	VkPipelineShaderStageCreateInfo stageCreateInfo = {};
 	stageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	stageCreateInfo.stage = eStage;
 	stageCreateInfo.module = pVkShaderModule;
-	stageCreateInfo.pName = "main";
+	stageCreateInfo.pName = sReflection.GetEntryPointName();
 	return stageCreateInfo;
 }
 
-const Vec<i8> &Shader::ReadFile(const string &filename)
+void Shader::SetCodeView(const void *pData, size_t size, Ref<const void> owner, u64 codeHash)
 {
-	ifstream file(filename, ios::ate | ios::binary);
-	if (!file.is_open())
+	// Mappings are page aligned and archives keep their entries aligned, vectors come from the heap
+	ASSERT(reinterpret_cast<uintptr_t>(pData) % sizeof(u32) == 0, "SPIR-V has to be 4 byte aligned");
+
+	pCode = static_cast<const u32 *>(pData);
+	iCodeSize = size;
+	pCodeOwner = move(owner);
+	iCodeHash = codeHash != 0 ? codeHash : Hash64(pData, size);
+	sReflection = ShaderReflection::Parse(pData, size);
+}
+
+VkShaderStageFlagBits Shader::StageFromFilename(const string &filename)
+{
+	static const pair<const char *, VkShaderStageFlagBits> stages[] = {
+		{ ".vert", VK_SHADER_STAGE_VERTEX_BIT },
+		{ ".frag", VK_SHADER_STAGE_FRAGMENT_BIT },
+		{ ".comp", VK_SHADER_STAGE_COMPUTE_BIT },
+		{ ".geom", VK_SHADER_STAGE_GEOMETRY_BIT },
+		{ ".tesc", VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT },
+		{ ".tese", VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT },
+	};
+
+	for (const auto &[extension, stage] : stages)
 	{
-		throw runtime_error("Failed to open file: " + filename);
+		if (filename.find(extension) != string::npos)
+		{
+			return stage;
+		}
 	}
-	size_t fileSize = static_cast<size_t>(file.tellg());
-	Vec<i8> buffer(fileSize);
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-	file.close();
-	return buffer;
+
+	throw runtime_error("Can't tell the shader stage of " + filename);
 }
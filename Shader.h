@@ -1,5 +1,7 @@
 #pragma once
 
+#include "SpirvReflection.h"
+
 class Device;
 
 class Shader : public IVkResource, public NonCopyable
@@ -8,11 +10,24 @@ private:
 	VkShaderModule pVkShaderModule;
 	VkShaderStageFlagBits eStage;
 	Device &pDevice;
-	Vec<i8> pArrCode;
+
+	// Points into a mapped file or archive, or a copy made by SetCode. pCodeOwner keeps it alive.
+	const u32 *pCode;
+	size_t iCodeSize;
+	Ref<const void> pCodeOwner;
+	u64 iCodeHash;
+
+	// Parsed along with the code, before the module is created
+	ShaderReflection sReflection;
 
 public:
 
+	// Maps the file, the code is never copied
 	Shader(Device &device, const string &filename);
+
+	// Code that lives somewhere else, e.g. in a mapped archive, owner keeps it alive as long as the shader.
+	// codeHash is computed if it is 0.
+	Shader(Device &device, const void *pData, size_t size, Ref<const void> owner, u64 codeHash = 0);
 	~Shader();
 
 public:
@@ -24,13 +39,25 @@ public:
 
 public:
 
+	// Copies the code, for SPIR-V built at runtime. Reflects it, throws if it isn't SPIR-V.
 	void SetCode(const Vec<i8> &code);
-	const Vec<i8> &GetCode() const;
 
-	const VkPipelineShaderStageCreateInfo &GetStageCreateInfo();
+	const u32 *GetCode() const;
+	size_t GetCodeSize() const;
+
+	// Hash of the SPIR-V, identifies the shader independent of its module handle
+	u64 GetCodeHash() const;
+
+	// Bindings, push constants, vertex inputs, specialization constants and workgroup size the code declares
+	const ShaderReflection &GetReflection() const;
+
+	VkShaderStageFlagBits GetStage() const;
+	VkPipelineShaderStageCreateInfo GetStageCreateInfo() const;
 
 private:
 
-	static const Vec<i8> &ReadFile(const string &filename);
+	void SetCodeView(const void *pData, size_t size, Ref<const void> owner, u64 codeHash);
 
+	// Guess the stage from the file name, e.g. Test.vert.spv, for modules whose entry point doesn't tell
+	static VkShaderStageFlagBits StageFromFilename(const string &filename);
 };
\ No newline at end of file
@@ -0,0 +1,248 @@
+#pragma once
+
+#include "ShaderLibrary.h"
+#include "Device.h"
+#include "Shader.h"
+#include "MappedFile.h"
+#include "Hash.h"
+#include "AssetPack.h"
+
+ShaderLibrary::ShaderLibrary(Device &device) :
+	pDevice(device),
+	pArrShaders(),
+	pArrNames(),
+	pArrArchiveEntries(),
+	pArrArchives(),
+	pArrPacks(),
+	iDuplicateCount(0),
+	iMappedBytes(0)
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	Destroy();
+}
+
+void ShaderLibrary::Create()
+{
+}
+
+void ShaderLibrary::Destroy()
+{
+	lock_guard<mutex> lock(mLock);
+
+	for (auto &[hash, bucket] : pArrShaders)
+	{
+		for (Ref<Shader> &pShader : bucket)
+		{
+			pShader->Destroy();
+		}
+	}
+
+	pArrShaders.clear();
+	pArrNames.clear();
+	pArrArchiveEntries.clear();
+	pArrArchives.clear();
+	pArrPacks.clear();
+}
+
+bool ShaderLibrary::IsValid() const
+{
+	return pDevice.IsValid();
+}
+
+Ref<Shader> ShaderLibrary::Load(const string &name)
+{
+	lock_guard<mutex> lock(mLock);
+
+	auto it = pArrNames.find(name);
+	if (it != pArrNames.end())
+	{
+		return it->second;
+	}
+
+	auto entry = pArrArchiveEntries.find(name);
+	if (entry != pArrArchiveEntries.end())
+	{
+		const ArchiveCode &code = entry->second;
+		const u8 *pCode = code.pArchive->GetData() + code.pEntry->codeOffset;
+		size_t codeSize = static_cast<size_t>(code.pEntry->codeSize);
+
+		// The hash on disk names the shader from here on, a stale or corrupt one must not get that far
+		ASSERT(Hash64(pCode, codeSize) == code.pEntry->codeHash, "Shader archive entry doesn't match its hash: " + name);
+		return LoadCode(name, pCode, codeSize, code.pArchive, code.pEntry->codeHash);
+	}
+
+	for (auto pack = pArrPacks.rbegin(); pack != pArrPacks.rend(); ++pack)
+	{
+		if ((*pack)->Contains(name))
+		{
+			AssetData asset = (*pack)->Open(name);
+			return LoadCode(name, asset.data.data(), asset.data.size(), move(asset.owner), Hash64(asset.data.data(), asset.data.size()));
+		}
+	}
+
+	// A duplicate lets go of its mapping right away, only the first one is kept
+	Ref<MappedFile> pFile = make_shared<MappedFile>(name);
+	iMappedBytes += pFile->GetSize();
+	return LoadCode(name, pFile->GetData(), pFile->GetSize(), pFile, Hash64(pFile->GetData(), pFile->GetSize()));
+}
+
+void ShaderLibrary::MountArchive(const string &path)
+{
+	Ref<MappedFile> pArchive = make_shared<MappedFile>(path);
+	const u8 *pData = pArchive->GetData();
+	size_t size = pArchive->GetSize();
+
+	ASSERT(size >= sizeof(ArchiveHeader), "Shader archive is too small: " + path);
+
+	const ArchiveHeader *pHeader = reinterpret_cast<const ArchiveHeader *>(pData);
+	ASSERT(pHeader->magic == ARCHIVE_MAGIC && pHeader->version == ARCHIVE_VERSION, "Not a shader archive or the wrong version: " + path);
+
+	size_t entryBytes = static_cast<size_t>(pHeader->entryCount) * sizeof(ArchiveEntry);
+	size_t namesOffset = sizeof(ArchiveHeader) + entryBytes;
+	ASSERT(namesOffset + pHeader->nameBytes <= size, "Shader archive is cut short: " + path);
+
+	const ArchiveEntry *pEntries = reinterpret_cast<const ArchiveEntry *>(pData + sizeof(ArchiveHeader));
+	const char *pNames = reinterpret_cast<const char *>(pData + namesOffset);
+
+	// Check every entry up front, so loading from the archive later can't read out of bounds
+	for (u32 i = 0; i < pHeader->entryCount; i++)
+	{
+		const ArchiveEntry &entry = pEntries[i];
+		ASSERT(static_cast<u64>(entry.nameOffset) + entry.nameLength <= pHeader->nameBytes, "Shader archive entry name out of bounds: " + path);
+		ASSERT(entry.codeOffset <= size && entry.codeSize <= size - entry.codeOffset, "Shader archive entry code out of bounds: " + path);
+		ASSERT(entry.codeOffset % sizeof(u32) == 0, "Shader archive entry code is misaligned: " + path);
+	}
+
+	lock_guard<mutex> lock(mLock);
+
+	for (u32 i = 0; i < pHeader->entryCount; i++)
+	{
+		string name(pNames + pEntries[i].nameOffset, pEntries[i].nameLength);
+		pArrArchiveEntries[name] = { pArchive, &pEntries[i] };
+	}
+
+	pArrArchives.push_back(pArchive);
+	iMappedBytes += size;
+}
+
+void ShaderLibrary::MountPack(const Ref<AssetPack> &pack)
+{
+	lock_guard<mutex> lock(mLock);
+	pArrPacks.push_back(pack);
+	iMappedBytes += pack->GetFile()->GetSize();
+}
+
+void ShaderLibrary::WriteArchive(const string &path, const Vec<string> &files)
+{
+	Vec<Vec<i8>> codes;
+	Vec<ArchiveEntry> entries(files.size());
+	string names;
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		ifstream file(files[i], ios::ate | ios::binary);
+		if (!file.is_open())
+		{
+			throw runtime_error("Failed to open file: " + files[i]);
+		}
+
+		Vec<i8> code(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(code.data(), code.size());
+
+		entries[i].codeHash = Hash64(code.data(), code.size());
+		entries[i].codeSize = code.size();
+		entries[i].nameOffset = static_cast<u32>(names.size());
+		entries[i].nameLength = static_cast<u32>(files[i].size());
+		names += files[i];
+		codes.push_back(move(code));
+	}
+
+	ArchiveHeader header = { ARCHIVE_MAGIC, ARCHIVE_VERSION, static_cast<u32>(files.size()), static_cast<u32>(names.size()) };
+
+	// Code goes after the names, every entry starting aligned
+	u64 offset = sizeof(ArchiveHeader) + entries.size() * sizeof(ArchiveEntry) + names.size();
+	for (ArchiveEntry &entry : entries)
+	{
+		offset = (offset + ARCHIVE_ALIGNMENT - 1) & ~static_cast<u64>(ARCHIVE_ALIGNMENT - 1);
+		entry.codeOffset = offset;
+		offset += entry.codeSize;
+	}
+
+	ofstream file(path, ios::binary | ios::trunc);
+	if (!file.is_open())
+	{
+		throw runtime_error("Failed to create shader archive: " + path);
+	}
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(ArchiveEntry));
+	file.write(names.data(), names.size());
+
+	const char padding[ARCHIVE_ALIGNMENT] = {};
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		u64 position = static_cast<u64>(file.tellp());
+		file.write(padding, static_cast<streamsize>(entries[i].codeOffset - position));
+		file.write(codes[i].data(), codes[i].size());
+	}
+
+	if (!file.good())
+	{
+		throw runtime_error("Failed to write shader archive: " + path);
+	}
+}
+
+size_t ShaderLibrary::GetShaderCount()
+{
+	lock_guard<mutex> lock(mLock);
+
+	size_t count = 0;
+	for (auto &[hash, bucket] : pArrShaders)
+	{
+		count += bucket.size();
+	}
+	return count;
+}
+
+u64 ShaderLibrary::GetDuplicateCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return iDuplicateCount;
+}
+
+u64 ShaderLibrary::GetMappedBytes()
+{
+	lock_guard<mutex> lock(mLock);
+	return iMappedBytes;
+}
+
+Ref<Shader> ShaderLibrary::LoadCode(const string &name, const void *pData, size_t size, Ref<const void> owner, u64 codeHash)
+{
+	Vec<Ref<Shader>> &bucket = pArrShaders[codeHash];
+	for (const Ref<Shader> &pExisting : bucket)
+	{
+		if (pExisting->GetCodeSize() == size && memcmp(pExisting->GetCode(), pData, size) == 0)
+		{
+			iDuplicateCount++;
+			pArrNames[name] = pExisting;
+			return pExisting;
+		}
+	}
+
+	// Same hash, different code, both get a module
+	if (!bucket.empty())
+	{
+		cout << "WARNING: Shader code hash collision on " << hex << codeHash << dec << " for " << name << endl;
+	}
+
+	Ref<Shader> pShader = make_shared<Shader>(pDevice, pData, size, move(owner), codeHash);
+	pShader->Create();
+
+	bucket.push_back(pShader);
+	pArrNames[name] = pShader;
+	return pShader;
+}
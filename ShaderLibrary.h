@@ -0,0 +1,106 @@
+#pragma once
+
+class Device;
+class Shader;
+class MappedFile;
+class AssetPack;
+
+// Loads shaders without copying their SPIR-V: loose files and archives are memory mapped and
+// vkCreateShaderModule reads straight out of the mapping. Shaders are keyed by a hash of their code,
+// so the same SPIR-V reached through different files or archive entries, as permutations often are,
+// ends up as one Shader with one VkShaderModule. Shaders with the same hash are compared byte by byte, a
+// collision gets a module of its own. Archives carry the hashes, which are checked when an entry first loads.
+class ShaderLibrary : public IVkResource, public NonCopyable
+{
+public:
+
+	// "CSPK"
+	static constexpr u32 ARCHIVE_MAGIC = 0x4B505343;
+	static constexpr u32 ARCHIVE_VERSION = 1;
+
+	// Code is placed at this alignment, vkCreateShaderModule wants at least 4
+	static constexpr u32 ARCHIVE_ALIGNMENT = 16;
+
+	// File layout: header, entryCount entries, the names back to back, then the code of every entry
+	struct ArchiveHeader
+	{
+		u32 magic;
+		u32 version;
+		u32 entryCount;
+		u32 nameBytes;
+	};
+
+	struct ArchiveEntry
+	{
+		u64 codeHash;
+		u64 codeOffset;
+		u64 codeSize;
+		u32 nameOffset;
+		u32 nameLength;
+	};
+
+private:
+
+	struct ArchiveCode
+	{
+		Ref<MappedFile> pArchive;
+		const ArchiveEntry *pEntry;
+	};
+
+	Device &pDevice;
+
+	// Usually one shader per hash, more only on a collision
+	unordered_map<u64, Vec<Ref<Shader>>> pArrShaders;
+	unordered_map<string, Ref<Shader>> pArrNames;
+
+	// Entries of every mounted archive by name, loaded on first use
+	unordered_map<string, ArchiveCode> pArrArchiveEntries;
+	Vec<Ref<MappedFile>> pArrArchives;
+
+	// Searched after the archives, the last one mounted first
+	Vec<Ref<AssetPack>> pArrPacks;
+
+	mutex mLock;
+
+	u64 iDuplicateCount;
+	u64 iMappedBytes;
+
+public:
+
+	ShaderLibrary(Device &device);
+	~ShaderLibrary();
+
+public:
+
+	void Create() override;
+
+	// Releases every module through the deferred destroy queue
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// The shader of an archive entry or a file with that name, module created. The same name or
+	// the same code asked for again gives back the same shader.
+	Ref<Shader> Load(const string &name);
+
+	// Makes the entries of the archive loadable by name, they win over loose files with the same name
+	void MountArchive(const string &path);
+
+	// Makes the entries of an asset pack loadable by name, after archives and before loose files.
+	// Stored entries are used in place, deflated ones are inflated once.
+	void MountPack(const Ref<AssetPack> &pack);
+
+	// Pack SPIR-V files into an archive, each entry named by its path as given
+	static void WriteArchive(const string &path, const Vec<string> &files);
+
+	size_t GetShaderCount();
+
+	// Loads that found a shader with identical code under another name
+	u64 GetDuplicateCount();
+	u64 GetMappedBytes();
+
+private:
+
+	Ref<Shader> LoadCode(const string &name, const void *pData, size_t size, Ref<const void> owner, u64 codeHash);
+};
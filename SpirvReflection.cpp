@@ -0,0 +1,564 @@
+#pragma once
+
+#include "SpirvReflection.h"
+
+// The part of the SPIR-V spec the reflection needs
+static constexpr u32 SPV_MAGIC = 0x07230203;
+static constexpr u32 SPV_HEADER_WORDS = 5;
+
+enum SpvOp : u32
+{
+	SpvOpEntryPoint = 15,
+	SpvOpExecutionMode = 16,
+	SpvOpTypeBool = 20,
+	SpvOpTypeInt = 21,
+	SpvOpTypeFloat = 22,
+	SpvOpTypeVector = 23,
+	SpvOpTypeMatrix = 24,
+	SpvOpTypeImage = 25,
+	SpvOpTypeSampler = 26,
+	SpvOpTypeSampledImage = 27,
+	SpvOpTypeArray = 28,
+	SpvOpTypeRuntimeArray = 29,
+	SpvOpTypeStruct = 30,
+	SpvOpTypePointer = 32,
+	SpvOpConstantTrue = 41,
+	SpvOpConstant = 43,
+	SpvOpSpecConstantTrue = 48,
+	SpvOpSpecConstantFalse = 49,
+	SpvOpSpecConstant = 50,
+	SpvOpSpecConstantOp = 52,
+	SpvOpFunction = 54,
+	SpvOpVariable = 59,
+	SpvOpDecorate = 71,
+	SpvOpMemberDecorate = 72,
+	SpvOpExecutionModeId = 331,
+	SpvOpTypeAccelerationStructureKHR = 5341,
+};
+
+enum SpvDecoration : u32
+{
+	SpvDecorationSpecId = 1,
+	SpvDecorationBufferBlock = 3,
+	SpvDecorationArrayStride = 6,
+	SpvDecorationMatrixStride = 7,
+	SpvDecorationBuiltIn = 11,
+	SpvDecorationLocation = 30,
+	SpvDecorationBinding = 33,
+	SpvDecorationDescriptorSet = 34,
+	SpvDecorationOffset = 35,
+};
+
+enum SpvStorageClass : u32
+{
+	SpvStorageClassUniformConstant = 0,
+	SpvStorageClassInput = 1,
+	SpvStorageClassUniform = 2,
+	SpvStorageClassFunction = 7,
+	SpvStorageClassPushConstant = 9,
+	SpvStorageClassStorageBuffer = 12,
+};
+
+enum SpvExecutionMode : u32
+{
+	SpvExecutionModeLocalSize = 17,
+	SpvExecutionModeLocalSizeId = 38,
+};
+
+enum SpvDim : u32
+{
+	SpvDimBuffer = 5,
+	SpvDimSubpassData = 6,
+};
+
+// One pass over the declarations, everything up to the first function body
+class SpirvParser
+{
+private:
+
+	static constexpr u32 NONE = UINT32_MAX;
+
+	struct Decorations
+	{
+		u32 iSet = NONE;
+		u32 iBinding = NONE;
+		u32 iLocation = NONE;
+		u32 iSpecId = NONE;
+		u32 iArrayStride = 0;
+		bool bBuiltIn = false;
+		bool bBufferBlock = false;
+	};
+
+	const u32 *pWords;
+	size_t iWordCount;
+
+	// Word offset of the instruction that defines each id
+	Vec<u32> pArrDefinitions;
+	Vec<Decorations> pArrDecorations;
+
+	// Keyed by struct id << 32 | member
+	unordered_map<u64, u32> pArrMemberOffsets;
+	unordered_map<u64, u32> pArrMatrixStrides;
+
+	Vec<u32> pArrVariables;
+	Vec<u32> pArrSpecConstants;
+
+	bool bEntryPoint;
+	u32 iExecutionModel;
+	u32 iEntryFunction;
+	string sEntryName;
+
+	u32 iLocalSize[3];
+	u32 iLocalSizeIds[3];
+
+public:
+
+	SpirvParser(const void *pCode, size_t size) :
+		pWords(static_cast<const u32 *>(pCode)),
+		iWordCount(size / sizeof(u32)),
+		pArrDefinitions(),
+		pArrDecorations(),
+		pArrMemberOffsets(),
+		pArrMatrixStrides(),
+		pArrVariables(),
+		pArrSpecConstants(),
+		bEntryPoint(false),
+		iExecutionModel(NONE),
+		iEntryFunction(NONE),
+		sEntryName(),
+		iLocalSize{ 0, 0, 0 },
+		iLocalSizeIds{ NONE, NONE, NONE }
+	{
+		if (size % sizeof(u32) != 0 || iWordCount < SPV_HEADER_WORDS || pWords[0] != SPV_MAGIC)
+		{
+			throw runtime_error("Not a SPIR-V module");
+		}
+	}
+
+	ShaderReflection Parse()
+	{
+		u32 bound = pWords[3];
+		pArrDefinitions.assign(bound, NONE);
+		pArrDecorations.assign(bound, {});
+
+		size_t pos = SPV_HEADER_WORDS;
+		while (pos < iWordCount)
+		{
+			const u32 *p = pWords + pos;
+			u32 length = p[0] >> 16;
+			u32 op = p[0] & 0xffff;
+			if (length == 0 || pos + length > iWordCount)
+			{
+				throw runtime_error("SPIR-V instruction runs past the end of the module");
+			}
+
+			// Everything the reflection looks at is declared before the first function
+			if (op == SpvOpFunction)
+			{
+				break;
+			}
+
+			ParseInstruction(op, p, length, static_cast<u32>(pos));
+			pos += length;
+		}
+
+		ShaderReflection reflection;
+		reflection.stage = StageFromExecutionModel(iExecutionModel);
+		reflection.entryPoint = sEntryName;
+
+		for (u32 i = 0; i < 3; i++)
+		{
+			reflection.workgroupSize[i] = iLocalSizeIds[i] != NONE ? GetConstant(iLocalSizeIds[i]) : iLocalSize[i];
+		}
+
+		for (u32 variable : pArrVariables)
+		{
+			ReflectVariable(reflection, variable);
+		}
+
+		for (u32 constant : pArrSpecConstants)
+		{
+			const Decorations &decorations = pArrDecorations[constant];
+			if (decorations.iSpecId == NONE)
+			{
+				continue;
+			}
+
+			const u32 *type = Definition(Definition(constant)[1]);
+			u32 size = (type[0] & 0xffff) == SpvOpTypeBool ? 4 : type[2] / 8;
+			reflection.specConstants.push_back({ decorations.iSpecId, size });
+		}
+
+		sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ShaderBinding &a, const ShaderBinding &b)
+		{
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+		sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const ShaderVertexInput &a, const ShaderVertexInput &b)
+		{
+			return a.location < b.location;
+		});
+
+		return reflection;
+	}
+
+private:
+
+	void ParseInstruction(u32 op, const u32 *p, u32 length, u32 pos)
+	{
+		switch (op)
+		{
+		case SpvOpEntryPoint:
+			if (!bEntryPoint && length >= 4)
+			{
+				bEntryPoint = true;
+				iExecutionModel = p[1];
+				iEntryFunction = p[2];
+				sEntryName = string(reinterpret_cast<const char *>(p + 3), strnlen(reinterpret_cast<const char *>(p + 3), (length - 3) * sizeof(u32)));
+			}
+			break;
+
+		case SpvOpExecutionMode:
+			if (p[1] == iEntryFunction && length >= 6 && p[2] == SpvExecutionModeLocalSize)
+			{
+				iLocalSize[0] = p[3];
+				iLocalSize[1] = p[4];
+				iLocalSize[2] = p[5];
+			}
+			break;
+
+		case SpvOpExecutionModeId:
+			if (p[1] == iEntryFunction && length >= 6 && p[2] == SpvExecutionModeLocalSizeId)
+			{
+				iLocalSizeIds[0] = p[3];
+				iLocalSizeIds[1] = p[4];
+				iLocalSizeIds[2] = p[5];
+			}
+			break;
+
+		case SpvOpDecorate:
+			Decorate(Decoration(p[1]), p[2], length > 3 ? p[3] : 0);
+			break;
+
+		case SpvOpMemberDecorate:
+			if (length > 4 && p[3] == SpvDecorationOffset)
+			{
+				pArrMemberOffsets[MemberKey(p[1], p[2])] = p[4];
+			}
+			else if (length > 4 && p[3] == SpvDecorationMatrixStride)
+			{
+				pArrMatrixStrides[MemberKey(p[1], p[2])] = p[4];
+			}
+			break;
+
+		case SpvOpVariable:
+			Define(p[2], pos);
+			if (p[3] != SpvStorageClassFunction)
+			{
+				pArrVariables.push_back(p[2]);
+			}
+			break;
+
+		case SpvOpSpecConstantTrue:
+		case SpvOpSpecConstantFalse:
+		case SpvOpSpecConstant:
+			Define(p[2], pos);
+			pArrSpecConstants.push_back(p[2]);
+			break;
+
+		default:
+			// Types define their result in the first operand, constants in the second
+			if ((op >= SpvOpTypeBool && op <= SpvOpTypePointer) || op == SpvOpTypeAccelerationStructureKHR)
+			{
+				Define(p[1], pos);
+			}
+			else if (op >= SpvOpConstantTrue && op <= SpvOpSpecConstantOp)
+			{
+				Define(p[2], pos);
+			}
+			break;
+		}
+	}
+
+	void Decorate(Decorations &decorations, u32 decoration, u32 value)
+	{
+		switch (decoration)
+		{
+		case SpvDecorationDescriptorSet: decorations.iSet = value; break;
+		case SpvDecorationBinding: decorations.iBinding = value; break;
+		case SpvDecorationLocation: decorations.iLocation = value; break;
+		case SpvDecorationSpecId: decorations.iSpecId = value; break;
+		case SpvDecorationArrayStride: decorations.iArrayStride = value; break;
+		case SpvDecorationBuiltIn: decorations.bBuiltIn = true; break;
+		case SpvDecorationBufferBlock: decorations.bBufferBlock = true; break;
+		default: break;
+		}
+	}
+
+	void ReflectVariable(ShaderReflection &reflection, u32 variable)
+	{
+		const u32 *instruction = Definition(variable);
+		u32 storageClass = instruction[3];
+
+		// Variables are always pointers, what matters is what they point at
+		const u32 *pointer = Definition(instruction[1]);
+		u32 type = pointer[3];
+		const Decorations &decorations = pArrDecorations[variable];
+
+		switch (storageClass)
+		{
+		case SpvStorageClassInput:
+			if (reflection.stage == VK_SHADER_STAGE_VERTEX_BIT && !decorations.bBuiltIn && decorations.iLocation != NONE)
+			{
+				reflection.vertexInputs.push_back({ decorations.iLocation, GetFormat(type) });
+			}
+			break;
+
+		case SpvStorageClassPushConstant:
+			ReflectPushConstants(reflection, type);
+			break;
+
+		case SpvStorageClassUniformConstant:
+		case SpvStorageClassUniform:
+		case SpvStorageClassStorageBuffer:
+			if (decorations.iBinding != NONE)
+			{
+				ShaderBinding binding;
+				binding.set = decorations.iSet != NONE ? decorations.iSet : 0;
+				binding.binding = decorations.iBinding;
+				binding.stages = reflection.stage;
+
+				// Arrays of descriptors become the descriptor count
+				const u32 *element = Definition(type);
+				while (Op(element) == SpvOpTypeArray || Op(element) == SpvOpTypeRuntimeArray)
+				{
+					binding.count = Op(element) == SpvOpTypeArray ? binding.count * GetConstant(element[3]) : 0;
+					type = element[2];
+					element = Definition(type);
+				}
+
+				binding.type = GetDescriptorType(storageClass, type);
+				if (binding.type != VK_DESCRIPTOR_TYPE_MAX_ENUM)
+				{
+					reflection.bindings.push_back(binding);
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	void ReflectPushConstants(ShaderReflection &reflection, u32 type)
+	{
+		const u32 *block = Definition(type);
+		u32 memberCount = static_cast<u32>((block[0] >> 16) - 2);
+		if (Op(block) != SpvOpTypeStruct || memberCount == 0)
+		{
+			return;
+		}
+
+		// Blocks can start past 0 when stages split the push constants between them
+		u32 begin = UINT32_MAX;
+		u32 end = 0;
+		for (u32 i = 0; i < memberCount; i++)
+		{
+			u32 offset = GetMemberOffset(type, i);
+			begin = min(begin, offset);
+			end = max(end, offset + GetSize(block[2 + i], GetMatrixStride(type, i)));
+		}
+
+		reflection.pushConstants.stageFlags = reflection.stage;
+		reflection.pushConstants.offset = begin;
+		reflection.pushConstants.size = end - begin;
+	}
+
+	VkDescriptorType GetDescriptorType(u32 storageClass, u32 type) const
+	{
+		const u32 *p = Definition(type);
+		switch (Op(p))
+		{
+		case SpvOpTypeSampler:
+			return VK_DESCRIPTOR_TYPE_SAMPLER;
+		case SpvOpTypeSampledImage:
+			return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		case SpvOpTypeAccelerationStructureKHR:
+			return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+		case SpvOpTypeImage:
+		{
+			// Sampled is 1 for images read through a sampler and 2 for storage images
+			u32 dim = p[3];
+			u32 sampled = p[7];
+			if (dim == SpvDimBuffer)
+			{
+				return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+			}
+			if (dim == SpvDimSubpassData)
+			{
+				return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+			}
+			return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		case SpvOpTypeStruct:
+			// Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock
+			if (storageClass == SpvStorageClassStorageBuffer || pArrDecorations[type].bBufferBlock)
+			{
+				return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		default:
+			return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		}
+	}
+
+	// Size in bytes as laid out in a block, matrixStride comes from the member decoration if it is a matrix
+	u32 GetSize(u32 type, u32 matrixStride = 0) const
+	{
+		const u32 *p = Definition(type);
+		switch (Op(p))
+		{
+		case SpvOpTypeBool:
+			return 4;
+		case SpvOpTypeInt:
+		case SpvOpTypeFloat:
+			return p[2] / 8;
+		case SpvOpTypeVector:
+			return p[3] * GetSize(p[2]);
+		case SpvOpTypeMatrix:
+			return p[3] * (matrixStride != 0 ? matrixStride : GetSize(p[2]));
+		case SpvOpTypeArray:
+		{
+			u32 stride = pArrDecorations[type].iArrayStride;
+			return GetConstant(p[3]) * (stride != 0 ? stride : GetSize(p[2], matrixStride));
+		}
+		case SpvOpTypeStruct:
+		{
+			u32 size = 0;
+			u32 memberCount = (p[0] >> 16) - 2;
+			for (u32 i = 0; i < memberCount; i++)
+			{
+				size = max(size, GetMemberOffset(type, i) + GetSize(p[2 + i], GetMatrixStride(type, i)));
+			}
+			return size;
+		}
+		default:
+			// Runtime arrays and pointers don't take space in a push constant block
+			return 0;
+		}
+	}
+
+	VkFormat GetFormat(u32 type) const
+	{
+		const u32 *p = Definition(type);
+		u32 components = 1;
+		if (Op(p) == SpvOpTypeVector)
+		{
+			components = p[3];
+			p = Definition(p[2]);
+		}
+
+		if ((Op(p) != SpvOpTypeFloat && Op(p) != SpvOpTypeInt) || p[2] != 32 || components < 1 || components > 4)
+		{
+			return VK_FORMAT_UNDEFINED;
+		}
+
+		static const VkFormat floatFormats[4] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+		static const VkFormat intFormats[4] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+		static const VkFormat uintFormats[4] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+
+		if (Op(p) == SpvOpTypeFloat)
+		{
+			return floatFormats[components - 1];
+		}
+		return p[3] != 0 ? intFormats[components - 1] : uintFormats[components - 1];
+	}
+
+	// Value of a 32 bit constant, the default for specialization constants
+	u32 GetConstant(u32 id) const
+	{
+		const u32 *p = Definition(id);
+		if ((Op(p) != SpvOpConstant && Op(p) != SpvOpSpecConstant) || (p[0] >> 16) < 4)
+		{
+			throw runtime_error("SPIR-V array length or workgroup size isn't a plain constant");
+		}
+		return p[3];
+	}
+
+	u32 GetMemberOffset(u32 type, u32 member) const
+	{
+		auto it = pArrMemberOffsets.find(MemberKey(type, member));
+		return it != pArrMemberOffsets.end() ? it->second : 0;
+	}
+
+	u32 GetMatrixStride(u32 type, u32 member) const
+	{
+		auto it = pArrMatrixStrides.find(MemberKey(type, member));
+		return it != pArrMatrixStrides.end() ? it->second : 0;
+	}
+
+	void Define(u32 id, u32 pos)
+	{
+		if (id >= pArrDefinitions.size())
+		{
+			throw runtime_error("SPIR-V id out of bounds");
+		}
+		pArrDefinitions[id] = pos;
+	}
+
+	const u32 *Definition(u32 id) const
+	{
+		if (id >= pArrDefinitions.size() || pArrDefinitions[id] == NONE)
+		{
+			throw runtime_error("SPIR-V id " + to_string(id) + " is used but never declared");
+		}
+		return pWords + pArrDefinitions[id];
+	}
+
+	Decorations &Decoration(u32 id)
+	{
+		if (id >= pArrDecorations.size())
+		{
+			throw runtime_error("SPIR-V id out of bounds");
+		}
+		return pArrDecorations[id];
+	}
+
+	static u32 Op(const u32 *p)
+	{
+		return p[0] & 0xffff;
+	}
+
+	static u64 MemberKey(u32 type, u32 member)
+	{
+		return (static_cast<u64>(type) << 32) | member;
+	}
+
+	static VkShaderStageFlagBits StageFromExecutionModel(u32 model)
+	{
+		switch (model)
+		{
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return static_cast<VkShaderStageFlagBits>(0);
+		}
+	}
+};
+
+bool ShaderReflection::HasPushConstants() const
+{
+	return pushConstants.size > 0;
+}
+
+const char *ShaderReflection::GetEntryPointName() const
+{
+	return entryPoint.empty() ? "main" : entryPoint.c_str();
+}
+
+ShaderReflection ShaderReflection::Parse(const void *pCode, size_t size)
+{
+	return SpirvParser(pCode, size).Parse();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// A descriptor the shader declares. count is 0 for runtime sized arrays.
+struct ShaderBinding
+{
+	u32 set = 0;
+	u32 binding = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+	u32 count = 1;
+	VkShaderStageFlags stages = 0;
+};
+
+// A vertex shader input, format is what the shader reads it as, UNDEFINED for types without a plain 32 bit format
+struct ShaderVertexInput
+{
+	u32 location = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+struct ShaderSpecConstant
+{
+	u32 constantId = 0;
+	u32 size = 0;
+};
+
+// What a SPIR-V module declares, read straight from the binary at load time.
+// Only the first entry point is looked at, which is all glslang and dxc put in a module by default.
+struct ShaderReflection
+{
+	VkShaderStageFlagBits stage = static_cast<VkShaderStageFlagBits>(0);
+	string entryPoint;
+
+	// Sorted by set and binding
+	Vec<ShaderBinding> bindings;
+
+	// Size 0 if there's no push constant block
+	VkPushConstantRange pushConstants = {};
+
+	// Vertex shaders only, sorted by location, built-ins left out
+	Vec<ShaderVertexInput> vertexInputs;
+
+	Vec<ShaderSpecConstant> specConstants;
+
+	// Compute shaders only. A dimension set through a specialization constant reports its default.
+	u32 workgroupSize[3] = { 0, 0, 0 };
+
+public:
+
+	bool HasPushConstants() const;
+
+	// For VkPipelineShaderStageCreateInfo::pName, valid as long as the reflection. "main" if the module declares none.
+	const char *GetEntryPointName() const;
+
+	// Throws if the code isn't SPIR-V or is cut short
+	static ShaderReflection Parse(const void *pCode, size_t size);
+};
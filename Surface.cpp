@@ -25,6 +25,17 @@ Surface::~Surface()
 
 void Surface::Create()
 {
+	if (pVkSurface == VK_NULL_HANDLE && pInstance.IsHeadless())
+	{
+		auto _vkCreateHeadlessSurfaceEXT = (PFN_vkCreateHeadlessSurfaceEXT)vkGetInstanceProcAddr(pInstance.GetVkNative(), "vkCreateHeadlessSurfaceEXT");
+		ASSERT(_vkCreateHeadlessSurfaceEXT != nullptr, "vkCreateHeadlessSurfaceEXT not available");
+
+		VkHeadlessSurfaceCreateInfoEXT headlessCreateInfo = {};
+		headlessCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+		VK_CHECK_RESULT(_vkCreateHeadlessSurfaceEXT(pInstance.GetVkNative(), &headlessCreateInfo, nullptr, &pVkSurface));
+	}
+
+#ifndef CULKAN_HEADLESS
 	if (pVkSurface == VK_NULL_HANDLE)
 	{
 		if (glfwCreateWindowSurface(pInstance.GetVkNative(), pInstance.GetWindow(), nullptr, &pVkSurface) != VK_SUCCESS)
@@ -32,6 +43,7 @@ void Surface::Create()
 			throw runtime_error("Failed to create window surface");
 		}
 	}
+#endif
 }
 
 void Surface::Destroy()
@@ -53,7 +65,7 @@ VkSurfaceKHR Surface::GetVkNative() const
 	return pVkSurface;
 }
 
-const SwapChainSupportDetails &Surface::GetSwapChainSupportDetails(const PhysicalDevice &physicalDevice) const
+SwapChainSupportDetails Surface::GetSwapChainSupportDetails(const PhysicalDevice &physicalDevice) const
 {
 	SwapChainSupportDetails swapChainSupportDetails;
 	swapChainSupportDetails.capabilities = GetCapabilities(physicalDevice);
@@ -62,52 +74,38 @@ const SwapChainSupportDetails &Surface::GetSwapChainSupportDetails(const Physica
 	return swapChainSupportDetails;
 }
 
-const VkSurfaceCapabilitiesKHR &Surface::GetCapabilities(const PhysicalDevice &physicalDevice) const
+VkSurfaceCapabilitiesKHR Surface::GetCapabilities(const PhysicalDevice &physicalDevice) const
 {
 	VkSurfaceCapabilitiesKHR capabilities;
 	VK_CHECK_RESULT(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice.GetVkNative(), pVkSurface, &capabilities));
 	return capabilities;
 }
 
-const VkSurfaceCapabilitiesKHR &Surface::GetCapabilities(Ref<PhysicalDevice> physicalDevice) const
+VkSurfaceCapabilitiesKHR Surface::GetCapabilities(Ref<PhysicalDevice> physicalDevice) const
 {
 	return GetCapabilities(*physicalDevice);
 }
 
-Vec<VkSurfaceFormatKHR> &Surface::GetFormats(const PhysicalDevice &physicalDevice) const
+Vec<VkSurfaceFormatKHR> Surface::GetFormats(const PhysicalDevice &physicalDevice) const
 {
-	Vec<VkSurfaceFormatKHR> vSurfaceFormats = EnumerateSurfaceFormatsKHR(physicalDevice.GetVkNative(), pVkSurface);
-	return vSurfaceFormats;
+	return EnumerateSurfaceFormatsKHR(physicalDevice.GetVkNative(), pVkSurface);
 }
 
-Vec<VkSurfaceFormatKHR> &Surface::GetFormats(Ref<PhysicalDevice> physicalDevice) const
+Vec<VkSurfaceFormatKHR> Surface::GetFormats(Ref<PhysicalDevice> physicalDevice) const
 {
 	return GetFormats(*physicalDevice);
 }
 
-Vec<VkPresentModeKHR> &Surface::GetPresentModes(const PhysicalDevice &physicalDevice) const
+Vec<VkPresentModeKHR> Surface::GetPresentModes(const PhysicalDevice &physicalDevice) const
 {
-	Vec<VkPresentModeKHR> vPresentModes = EnumerateSurfacePresentModesKHR(physicalDevice.GetVkNative(), pVkSurface);
-	return vPresentModes;
+	return EnumerateSurfacePresentModesKHR(physicalDevice.GetVkNative(), pVkSurface);
 }
 
-Vec<VkPresentModeKHR> &Surface::GetPresentModes(Ref<PhysicalDevice> physicalDevice) const
+Vec<VkPresentModeKHR> Surface::GetPresentModes(Ref<PhysicalDevice> physicalDevice) const
 {
 	return GetPresentModes(*physicalDevice);
 }
 
-VkPresentModeKHR Surface::ChoosePresentMode(const Vec<VkPresentModeKHR> &vPresentModes) const
-{
-	for (const VkPresentModeKHR &vkPresentMode : vPresentModes)
-	{
-		if (vkPresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-		{
-			return vkPresentMode;
-		}
-	}
-	return VK_PRESENT_MODE_FIFO_KHR;
-}
-
 VkSurfaceFormatKHR Surface::ChooseSurfaceFormat(const Vec<VkSurfaceFormatKHR> &vSurfaceFormats) const
 {
 	for (const VkSurfaceFormatKHR &vkSurfaceFormat : vSurfaceFormats)
@@ -129,9 +127,16 @@ VkExtent2D Surface::ChooseSwapExtent(VkSurfaceCapabilitiesKHR capabilities) cons
 	}
 	else
 	{
-		int width, height;
-		glfwGetFramebufferSize(pInstance.GetWindow(), &width, &height);
-		VkExtent2D actualExtent = { static_cast<u32>(width), static_cast<u32>(height) };
+		// Headless surfaces have no size of their own, the swap chain decides
+		VkExtent2D actualExtent = pInstance.GetWindowSize();
+#ifndef CULKAN_HEADLESS
+		if (!pInstance.IsHeadless())
+		{
+			int width, height;
+			glfwGetFramebufferSize(pInstance.GetWindow(), &width, &height);
+			actualExtent = { static_cast<u32>(width), static_cast<u32>(height) };
+		}
+#endif
 		actualExtent.width = max(capabilities.minImageExtent.width, min(capabilities.maxImageExtent.width, actualExtent.width));
 		actualExtent.height = max(capabilities.minImageExtent.height, min(capabilities.maxImageExtent.height, actualExtent.height));
 		return actualExtent;
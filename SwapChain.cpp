@@ -4,6 +4,7 @@
 #include "Device.h"
 #include "PhysicalDevice.h"
 #include "Surface.h"
+#include "DeferredDestroyQueue.h"
 
 SwapChain::SwapChain(Device &device, Surface &surface) :
 	pVkSwapChain(VK_NULL_HANDLE),
@@ -11,8 +12,12 @@ SwapChain::SwapChain(Device &device, Surface &surface) :
 	pSurface(surface),
 	pArrImages(),
 	pArrImageViews(),
+	pArrRenderFinished(),
 	pFormat(VK_FORMAT_UNDEFINED),
-	pExtent({ 0, 0 })
+	pExtent({ 0, 0 }),
+	ePresentPolicy(PresentPolicy::VsyncStable),
+	ePresentMode(VK_PRESENT_MODE_FIFO_KHR),
+	iGeneration(0)
 {
 }
 
@@ -25,35 +30,33 @@ SwapChain::~SwapChain()
 }
 
 void SwapChain::Create()
+{
+	CreateSwapChain(VK_NULL_HANDLE);
+}
+
+void SwapChain::CreateSwapChain(VkSwapchainKHR oldSwapChain)
 {
 	// Get the swap chain support details
 	const PhysicalDevice &physicalDevice = pDevice.GetPhysicalDevice();
 	const Surface &surface = pSurface;
-	const SwapChainSupportDetails &swapChainSupportDetails = pSurface
+	const SwapChainSupportDetails swapChainSupportDetails = pSurface
 		.GetSwapChainSupportDetails(physicalDevice);
 
 	// Choose the surface format
-	const VkSurfaceFormatKHR &surfaceFormat = pSurface
+	const VkSurfaceFormatKHR surfaceFormat = pSurface
 		.ChooseSurfaceFormat(swapChainSupportDetails.formats);
 
 	// Choose the present mode
-	const VkPresentModeKHR &presentMode = pSurface
-		.ChoosePresentMode(swapChainSupportDetails.presentModes);
+	const VkPresentModeKHR presentMode = FramePacer::ChoosePresentMode(ePresentPolicy, swapChainSupportDetails.presentModes);
 
 	// Choose the swap extent
-	const VkSurfaceCapabilitiesKHR &surfaceCapabilities = pSurface
-		.GetCapabilities(physicalDevice);
+	const VkSurfaceCapabilitiesKHR &surfaceCapabilities = swapChainSupportDetails.capabilities;
 
-	const VkExtent2D &swapExtent = pSurface
+	const VkExtent2D swapExtent = pSurface
 		.ChooseSwapExtent(surfaceCapabilities);
 
-	// Get the number of images in the swap chain
-	u32 iImageCount = surfaceCapabilities.minImageCount + 1;
-
-	if (surfaceCapabilities.maxImageCount > 0 && iImageCount > surfaceCapabilities.maxImageCount)
-	{
-		iImageCount = surfaceCapabilities.maxImageCount;
-	}
+	// Get the number of images in the swap chain, each one queued for display is a frame of latency
+	u32 iImageCount = FramePacer::ChooseImageCount(ePresentPolicy, presentMode, surfaceCapabilities);
 
 	// Create the swap chain
 	VkSwapchainCreateInfoKHR vkSwapChainCreateInfo = {};
@@ -64,7 +67,10 @@ void SwapChain::Create()
 	vkSwapChainCreateInfo.imageColorSpace = surfaceFormat.colorSpace;
 	vkSwapChainCreateInfo.imageExtent = swapExtent;
 	vkSwapChainCreateInfo.imageArrayLayers = 1;
-	vkSwapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+	// The frame is cleared and copied straight into the back buffer, every desktop driver allows that
+	ASSERT(surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT, "Surface doesn't allow transfers into swap chain images, the back buffer is composited with a copy");
+	vkSwapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 	const QueueFamilyIndices &queueFamilyIndices = physicalDevice.
 		GetQueueFamilyIndices();
@@ -88,27 +94,79 @@ void SwapChain::Create()
 	vkSwapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	vkSwapChainCreateInfo.presentMode = presentMode;
 	vkSwapChainCreateInfo.clipped = VK_TRUE;
-	vkSwapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	vkSwapChainCreateInfo.oldSwapchain = oldSwapChain;
 
 	VK_CHECK_RESULT(vkCreateSwapchainKHR(pDevice.GetVkNative(), &vkSwapChainCreateInfo, nullptr, &pVkSwapChain));
 
+	if (pFormat != VK_FORMAT_UNDEFINED && pFormat != surfaceFormat.format)
+	{
+		cout << "WARNING: Swap chain format changed, pipelines built for the old one won't match" << endl;
+	}
+
+	pFormat = surfaceFormat.format;
+	pExtent = swapExtent;
+	ePresentMode = presentMode;
+	pArrImages = GetSwapchainImagesKHR(pDevice.GetVkNative(), pVkSwapChain);
+
+	CreateImageViews();
+	CreateSemaphores();
 }
 
 void SwapChain::Destroy()
 {
+	// Images may still be rendered to or waiting to be presented
 	for (VkImageView vkImageView : pArrImageViews)
 	{
-		vkDestroyImageView(pDevice.GetVkNative(), vkImageView, nullptr);
+		pDevice.GetDeferredDestroyQueue().DestroyImageView(vkImageView);
 	}
+	pArrImageViews.clear();
+	pArrImages.clear();
+	RetireSemaphores(pArrRenderFinished);
 
 	if (pVkSwapChain != VK_NULL_HANDLE)
 	{
-
-		vkDestroySwapchainKHR(pDevice.GetVkNative(), pVkSwapChain, nullptr);
+		pDevice.GetDeferredDestroyQueue().DestroySwapchain(pVkSwapChain);
 		pVkSwapChain = VK_NULL_HANDLE;
 	}
 }
 
+bool SwapChain::Recreate()
+{
+	const VkSurfaceCapabilitiesKHR capabilities = pSurface.GetCapabilities(pDevice.GetPhysicalDevice());
+	const VkExtent2D extent = pSurface.ChooseSwapExtent(capabilities);
+	if (extent.width == 0 || extent.height == 0)
+	{
+		return false;
+	}
+
+	VkSwapchainKHR oldSwapChain = pVkSwapChain;
+	Vec<VkImageView> oldImageViews = move(pArrImageViews);
+	pArrImageViews.clear();
+	Vec<VkSemaphore> oldRenderFinished = move(pArrRenderFinished);
+	pArrRenderFinished.clear();
+
+	CreateSwapChain(oldSwapChain);
+
+	// Frames in flight may still render into or present the old images, no need to wait for them here
+	for (VkImageView vkImageView : oldImageViews)
+	{
+		pDevice.GetDeferredDestroyQueue().DestroyImageView(vkImageView);
+	}
+	RetireSemaphores(oldRenderFinished);
+	if (oldSwapChain != VK_NULL_HANDLE)
+	{
+		pDevice.GetDeferredDestroyQueue().DestroySwapchain(oldSwapChain);
+	}
+
+	iGeneration++;
+	return true;
+}
+
+u32 SwapChain::GetGeneration() const
+{
+	return iGeneration;
+}
+
 bool SwapChain::IsValid() const
 {
 	return pVkSwapChain != VK_NULL_HANDLE;
@@ -121,8 +179,7 @@ VkSwapchainKHR SwapChain::GetVkNative() const
 
 const Vec<VkImage> &SwapChain::GetImages() const
 {
-	Vec<VkImage> vImages = GetSwapchainImagesKHR(pDevice.GetVkNative(), pVkSwapChain);
-	return vImages;
+	return pArrImages;
 }
 
 void SwapChain::CreateImageViews()
@@ -154,14 +211,55 @@ const Vec<VkImageView> &SwapChain::GetImageViews() const
 	return pArrImageViews;
 }
 
+void SwapChain::CreateSemaphores()
+{
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	pArrRenderFinished.resize(pArrImages.size());
+	for (VkSemaphore &semaphore : pArrRenderFinished)
+	{
+		VK_CHECK_RESULT(vkCreateSemaphore(pDevice.GetVkNative(), &semaphoreCreateInfo, nullptr, &semaphore));
+	}
+}
+
+void SwapChain::RetireSemaphores(Vec<VkSemaphore> &semaphores)
+{
+	for (VkSemaphore semaphore : semaphores)
+	{
+		pDevice.GetDeferredDestroyQueue().DestroySemaphore(semaphore);
+	}
+	semaphores.clear();
+}
+
+VkSemaphore SwapChain::GetRenderFinishedSemaphore(u32 imageIndex) const
+{
+	return pArrRenderFinished[imageIndex];
+}
+
 VkFormat SwapChain::GetFormat() const
 {
-	return VkFormat();
+	return pFormat;
 }
 
 VkExtent2D SwapChain::GetExtent() const
 {
-	return VkExtent2D();
+	return pExtent;
+}
+
+void SwapChain::SetPresentPolicy(PresentPolicy policy)
+{
+	ePresentPolicy = policy;
+}
+
+PresentPolicy SwapChain::GetPresentPolicy() const
+{
+	return ePresentPolicy;
+}
+
+VkPresentModeKHR SwapChain::GetPresentMode() const
+{
+	return ePresentMode;
 }
 
 
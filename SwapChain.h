@@ -1,5 +1,7 @@
 #pragma once
 
+#include "FramePacer.h"
+
 class Device;
 class Surface;
 
@@ -11,9 +13,19 @@ private:
 	Surface &pSurface;
 	Vec<VkImage> pArrImages;
 	Vec<VkImageView> pArrImageViews;
+
+	// Signaled by the submission rendering into each image and waited on by its present. Per image rather
+	// than per frame in flight, a present can still be waiting on one when its frame slot comes around again.
+	Vec<VkSemaphore> pArrRenderFinished;
 	VkFormat pFormat;
 	VkExtent2D pExtent;
 
+	PresentPolicy ePresentPolicy;
+	VkPresentModeKHR ePresentMode;
+
+	// Bumped by every Recreate, anything sized after the swap chain can compare against it
+	u32 iGeneration;
+
 public:
 
 	SwapChain(Device &device, Surface &surface);
@@ -28,14 +40,35 @@ public:
 
 public:
 
+	// Build a new swap chain for the current surface size from the old one, which is retired
+	// through the deferred destroy queue along with its views once the frames using it are done.
+	// Returns false and keeps the old one while the surface has no area, e.g. a minimized window.
+	bool Recreate();
+	u32 GetGeneration() const;
+
 	// Get the swap chain images
 	const Vec<VkImage> &GetImages() const;
 
 	void CreateImageViews();
 	// Get the swap chain image views
 	const Vec<VkImageView> &GetImageViews() const;
+	VkSemaphore GetRenderFinishedSemaphore(u32 imageIndex) const;
 	// Get the swap chain format
 	VkFormat GetFormat() const;
 	// Get the swap chain extent
 	VkExtent2D GetExtent() const;
+
+	// Decides the present mode and image count, set before Create() or Recreate()
+	void SetPresentPolicy(PresentPolicy policy);
+	PresentPolicy GetPresentPolicy() const;
+	VkPresentModeKHR GetPresentMode() const;
+
+private:
+
+	// oldSwapChain lets the driver hand resources over to the new one, it stays valid until destroyed
+	void CreateSwapChain(VkSwapchainKHR oldSwapChain);
+	void CreateSemaphores();
+
+	// Through the deferred destroy queue, a present may still wait on them
+	void RetireSemaphores(Vec<VkSemaphore> &semaphores);
 };
\ No newline at end of file
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "ImageDecoder.h"
+#include "BlockCompressor.h"
+#include "CookedTexture.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+
+#include <cmath>
+
+// Offline half of texture loading, built as its own target. Decodes PNG and WebP files, builds the
+// full mip chain, block compresses every level on all cores and writes it as a CookedTexture, which
+// the runtime TextureLoader uploads without decoding or generating anything.
+namespace
+{
+	struct CookOptions
+	{
+		BlockFormat format = BlockFormat::BC7;
+		bool bSrgb = true;
+		bool bMips = true;
+		int compressionLevel = 9;
+		string outDir;
+	};
+
+	// sRGB colors are averaged in linear light, or mips come out darker than the level above
+	struct SrgbTable
+	{
+		f32 toLinear[256];
+
+		SrgbTable()
+		{
+			for (u32 i = 0; i < 256; i++)
+			{
+				f32 value = i / 255.0f;
+				toLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+			}
+		}
+
+		static u8 FromLinear(f32 value)
+		{
+			value = clamp(value, 0.0f, 1.0f);
+			f32 srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+			return static_cast<u8>(srgb * 255.0f + 0.5f);
+		}
+	};
+
+	const SrgbTable &GetSrgbTable()
+	{
+		static SrgbTable table;
+		return table;
+	}
+
+	// 2x2 box, reading the same texels as Shaders/Downsample.comp
+	Vec<u8> Downsample(const Vec<u8> &src, VkExtent2D srcExtent, VkExtent2D dstExtent, bool bSrgb)
+	{
+		Vec<u8> dst(static_cast<size_t>(dstExtent.width) * dstExtent.height * 4);
+		const SrgbTable &table = GetSrgbTable();
+
+		Singleton<JobSystem>::GetInstance().ParallelFor(dstExtent.height, 16, [&](u32 begin, u32 end)
+		{
+			for (u32 y = begin; y < end; y++)
+			{
+				u32 rows[2] = { GetDownsampleTap(y, 0, srcExtent.height), GetDownsampleTap(y, 1, srcExtent.height) };
+				for (u32 x = 0; x < dstExtent.width; x++)
+				{
+					u32 columns[2] = { GetDownsampleTap(x, 0, srcExtent.width), GetDownsampleTap(x, 1, srcExtent.width) };
+
+					f32 sum[4] = {};
+					for (u32 row : rows)
+					{
+						for (u32 column : columns)
+						{
+							const u8 *pTexel = src.data() + (static_cast<size_t>(row) * srcExtent.width + column) * 4;
+							for (u32 c = 0; c < 4; c++)
+							{
+								sum[c] += bSrgb && c < 3 ? table.toLinear[pTexel[c]] : pTexel[c] / 255.0f;
+							}
+						}
+					}
+
+					u8 *pOut = dst.data() + (static_cast<size_t>(y) * dstExtent.width + x) * 4;
+					for (u32 c = 0; c < 4; c++)
+					{
+						f32 average = sum[c] * 0.25f;
+						pOut[c] = bSrgb && c < 3 ? SrgbTable::FromLinear(average) : static_cast<u8>(clamp(average, 0.0f, 1.0f) * 255.0f + 0.5f);
+					}
+				}
+			}
+		});
+
+		return dst;
+	}
+
+	// Throws with what went wrong
+	void Cook(const filesystem::path &input, const CookOptions &options)
+	{
+		auto tStart = chrono::steady_clock::now();
+
+		MappedFile file(input.string());
+		ImageFileInfo info;
+		ASSERT(ReadImageInfo(file.GetData(), file.GetSize(), info), "Not a PNG or WebP file");
+		ASSERT(info.extent.width > 0 && info.extent.height > 0, "Image has no pixels");
+
+		Vec<u8> level(static_cast<size_t>(info.extent.width) * info.extent.height * 4);
+		ASSERT(DecodeImage(file.GetData(), file.GetSize(), info, level.data()), "Failed to decode");
+
+		// BC5 holds data like normals, which have no sRGB variant and are filtered as they are
+		bool bSrgb = options.bSrgb && options.format != BlockFormat::BC5;
+		VkFormat format = GetBlockVkFormat(options.format, bSrgb);
+
+		u32 mipLevels = options.bMips ? GetMipLevelCount(info.extent) : 1;
+		Vec<Vec<u8>> mips(mipLevels);
+		VkExtent2D extent = info.extent;
+		for (u32 mip = 0; mip < mipLevels; mip++)
+		{
+			if (mip > 0)
+			{
+				VkExtent2D next = { GetMipSize(info.extent.width, mip), GetMipSize(info.extent.height, mip) };
+				level = Downsample(level, extent, next, bSrgb);
+				extent = next;
+			}
+
+			mips[mip].resize(static_cast<size_t>(CookedTexture::GetLevelSize(format, info.extent, mip)));
+			CompressImage(options.format, level.data(), extent, mips[mip].data());
+		}
+
+		filesystem::path output = input;
+		output.replace_extension(CookedTexture::EXTENSION);
+		if (!options.outDir.empty())
+		{
+			output = filesystem::path(options.outDir) / output.filename();
+		}
+		CookedTexture::Write(output.string(), format, info.extent, mips, options.compressionLevel);
+
+		u64 rgbaBytes = 0;
+		u64 blockBytes = 0;
+		for (u32 mip = 0; mip < mipLevels; mip++)
+		{
+			rgbaBytes += static_cast<u64>(GetMipSize(info.extent.width, mip)) * GetMipSize(info.extent.height, mip) * 4;
+			blockBytes += mips[mip].size();
+		}
+
+		auto tEnd = chrono::steady_clock::now();
+		cout << input.string() << " -> " << output.string() << ": " << info.extent.width << "x" << info.extent.height
+			<< ", " << mipLevels << " mips, " << GetBlockFormatName(options.format) << (bSrgb ? " sRGB" : "")
+			<< ", " << blockBytes / 1024 << " KB of VRAM instead of " << rgbaBytes / 1024 << " KB, "
+			<< filesystem::file_size(output) / 1024 << " KB on disk, "
+			<< chrono::duration<f64, milli>(tEnd - tStart).count() << " ms" << endl;
+	}
+
+	void PrintUsage()
+	{
+		cout << "Usage: TextureCooker [options] <file or directory>..." << endl;
+		cout << "Cooks PNG and WebP files, and those in the directories given, into " << CookedTexture::EXTENSION << " files" << endl;
+		cout << "  --format bc1|bc3|bc5|bc7  block format, bc7 by default" << endl;
+		cout << "  --linear                  the image holds data rather than sRGB colors" << endl;
+		cout << "  --no-mips                 only cook the top level" << endl;
+		cout << "  --level N                 zlib compression level from 0 to 9, 9 by default" << endl;
+		cout << "  --out DIR                 write next to the inputs otherwise" << endl;
+		cout << "  --job-workers N           job system workers next to the main thread, 0 picks one per core" << endl;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	CookOptions options;
+	u32 iJobWorkers = 0;
+	Vec<filesystem::path> inputs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--format" && i + 1 < argc)
+		{
+			optional<BlockFormat> format = ParseBlockFormat(argv[++i]);
+			if (!format)
+			{
+				cout << "Unknown block format " << argv[i] << endl;
+				return 1;
+			}
+			options.format = *format;
+		}
+		else if (arg == "--linear")
+		{
+			options.bSrgb = false;
+		}
+		else if (arg == "--no-mips")
+		{
+			options.bMips = false;
+		}
+		else if (arg == "--level" && i + 1 < argc)
+		{
+			options.compressionLevel = clamp(stoi(argv[++i]), 0, 9);
+		}
+		else if (arg == "--out" && i + 1 < argc)
+		{
+			options.outDir = argv[++i];
+		}
+		else if (arg == "--job-workers" && i + 1 < argc)
+		{
+			iJobWorkers = static_cast<u32>(stoul(argv[++i]));
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			PrintUsage();
+			return 0;
+		}
+		else if (filesystem::is_directory(arg))
+		{
+			for (const auto &entry : filesystem::directory_iterator(arg))
+			{
+				string extension = entry.path().extension().string();
+				if (extension == ".png" || extension == ".webp")
+				{
+					inputs.push_back(entry.path());
+				}
+			}
+		}
+		else
+		{
+			inputs.push_back(arg);
+		}
+	}
+
+	if (inputs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (!options.outDir.empty())
+	{
+		filesystem::create_directories(options.outDir);
+	}
+
+	// Blocks, downsampling and deflating of each file are spread over every core
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	jobSystem.SetWorkerCount(iJobWorkers);
+	jobSystem.Create();
+
+	u32 iFailed = 0;
+	for (const filesystem::path &input : inputs)
+	{
+		try
+		{
+			Cook(input, options);
+		}
+		catch (const exception &e)
+		{
+			cout << "ERROR: " << input.string() << ": " << e.what() << endl;
+			iFailed++;
+		}
+	}
+
+	jobSystem.Destroy();
+
+	cout << "Cooked " << inputs.size() - iFailed << " of " << inputs.size() << " textures" << endl;
+	return iFailed == 0 ? 0 : 1;
+}
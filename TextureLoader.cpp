@@ -0,0 +1,398 @@
+#pragma once
+
+#include "TextureLoader.h"
+#include "Device.h"
+#include "PhysicalDevice.h"
+#include "Image.h"
+#include "UploadQueue.h"
+#include "MappedFile.h"
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include "ImageDecoder.h"
+#include "CookedTexture.h"
+
+TextureLoader::TextureLoader(Device &device, VkDeviceSize budget) :
+	pDevice(device),
+	iBudget(budget),
+	iInFlightBytes(0),
+	iUnflushedBytes(0),
+	pArrPacks(),
+	pArrWaiting(),
+	pArrPending(),
+	pArrMipWaiters(),
+	iDecoding(0),
+	bRetiring(false),
+	pCounter(),
+	iLoadedCount(0),
+	iLoadedBytes(0),
+	iFailedCount(0),
+	iPeakInFlightBytes(0)
+{
+}
+
+TextureLoader::~TextureLoader()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void TextureLoader::Create()
+{
+	ASSERT(Singleton<JobSystem>::GetInstance().IsValid(), "TextureLoader needs the job system to be created first");
+
+	// Spans can only be retired once they are copied, so at least half the ring stays free for the
+	// decodes in flight to be reserved from no matter how the ring has wrapped
+	iBudget = min(iBudget, pDevice.GetUploadQueue().GetRingSize() / 2);
+	pCounter = make_shared<JobCounter>();
+}
+
+void TextureLoader::Destroy()
+{
+	WaitIdle();
+	pCounter.reset();
+}
+
+bool TextureLoader::IsValid() const
+{
+	return pCounter != nullptr;
+}
+
+TextureLoader::TextureFuture TextureLoader::Load(const string &path, bool bSrgb, bool bMips)
+{
+	ASSERT(IsValid(), "TextureLoader used before Create");
+
+	// Shared so the job function stays copyable, promises aren't
+	Ref<Request> request = make_shared<Request>();
+	request->sPath = path;
+	request->bSrgb = bSrgb;
+	request->bMips = bMips;
+	TextureFuture future = request->sPromise.get_future().share();
+
+	Singleton<JobSystem>::GetInstance().Submit([this, request]()
+	{
+		try
+		{
+			ReadHeader(*request);
+		}
+		catch (...)
+		{
+			request->sPromise.set_exception(current_exception());
+
+			lock_guard<mutex> lock(mLock);
+			iFailedCount++;
+			return;
+		}
+
+		lock_guard<mutex> lock(mLock);
+		pArrWaiting.push_back(request);
+		Dispatch();
+	}, pCounter);
+
+	return future;
+}
+
+void TextureLoader::MountPack(const Ref<AssetPack> &pack)
+{
+	lock_guard<mutex> lock(mLock);
+	pArrPacks.push_back(pack);
+}
+
+u64 TextureLoader::WaitIdle()
+{
+	if (pCounter)
+	{
+		Singleton<JobSystem>::GetInstance().Wait(pCounter);
+	}
+
+	Vec<MipWaiter> waiters;
+	{
+		lock_guard<mutex> lock(mLock);
+		iUnflushedBytes = 0;
+		waiters.swap(pArrMipWaiters);
+	}
+	FlushBatch(waiters);
+
+	lock_guard<mutex> lock(mLock);
+	u64 value = 0;
+	for (const PendingUpload &upload : pArrPending)
+	{
+		value = max(value, upload.iValue);
+	}
+	return value;
+}
+
+u64 TextureLoader::GetLoadedCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return iLoadedCount;
+}
+
+u64 TextureLoader::GetLoadedBytes()
+{
+	lock_guard<mutex> lock(mLock);
+	return iLoadedBytes;
+}
+
+u64 TextureLoader::GetFailedCount()
+{
+	lock_guard<mutex> lock(mLock);
+	return iFailedCount;
+}
+
+VkDeviceSize TextureLoader::GetBudget() const
+{
+	return iBudget;
+}
+
+VkDeviceSize TextureLoader::GetPeakInFlightBytes()
+{
+	lock_guard<mutex> lock(mLock);
+	return iPeakInFlightBytes;
+}
+
+bool TextureLoader::IsReady(const TextureFuture &future)
+{
+	return future.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+void TextureLoader::ReadHeader(Request &request)
+{
+	Vec<Ref<AssetPack>> packs;
+	{
+		lock_guard<mutex> lock(mLock);
+		packs = pArrPacks;
+	}
+
+	auto pack = find_if(packs.rbegin(), packs.rend(), [&](const Ref<AssetPack> &candidate) { return candidate->Contains(request.sPath); });
+	if (pack != packs.rend())
+	{
+		request.sFile = (*pack)->Open(request.sPath);
+	}
+	else
+	{
+		Ref<MappedFile> pFile = make_shared<MappedFile>(request.sPath);
+		request.sFile = { pFile, span<const u8>(pFile->GetData(), pFile->GetSize()) };
+	}
+
+	const u8 *pData = request.sFile.data.data();
+	size_t size = request.sFile.data.size();
+
+	if (CookedTexture::IsCooked(pData, size))
+	{
+		request.pCooked = make_shared<CookedTexture>(pData, size);
+
+		VkFormatFeatureFlags features = pDevice.GetPhysicalDevice().GetFormatProperties(request.pCooked->GetFormat()).optimalTilingFeatures;
+		ASSERT(pDevice.HasTextureCompressionBC() && (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT), "Device can't sample the block compressed format of " + request.sPath);
+
+		request.sInfo.extent = request.pCooked->GetExtent();
+		request.iBytes = request.pCooked->GetTotalSize();
+	}
+	else
+	{
+		ASSERT(ReadImageInfo(pData, size, request.sInfo), "Not a PNG, WebP or cooked texture file: " + request.sPath);
+		request.iBytes = static_cast<VkDeviceSize>(request.sInfo.extent.width) * request.sInfo.extent.height * 4;
+	}
+
+	ASSERT(request.iBytes > 0, "Texture has no pixels: " + request.sPath);
+	ASSERT(request.iBytes <= pDevice.GetUploadQueue().GetRingSize() / 2, "Texture is too big for the staging ring: " + request.sPath);
+}
+
+void TextureLoader::Decode(Request &request)
+{
+	UploadQueue &uploadQueue = pDevice.GetUploadQueue();
+	Ref<Texture> texture = make_shared<Texture>();
+	texture->path = request.sPath;
+
+	MipGenerator &mipGenerator = pDevice.GetMipGenerator();
+	bool bMips = false;
+
+	try
+	{
+		// Created before the span is reserved, a span that's never copied would hold up the ring for good
+		VkFormat format = request.bSrgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		u32 mipLevels = 1;
+
+		if (request.pCooked)
+		{
+			format = request.pCooked->GetFormat();
+			mipLevels = request.pCooked->GetMipLevels();
+		}
+		else
+		{
+			MipGenerator::Method method = request.bMips ? mipGenerator.GetMethod(format) : MipGenerator::Method::None;
+			if (method != MipGenerator::Method::None)
+			{
+				usage |= MipGenerator::GetRequiredUsage(method);
+				mipLevels = MipGenerator::GetMipLevelCount(request.sInfo.extent);
+				bMips = mipLevels > 1;
+			}
+		}
+
+		texture->image = make_shared<Image>(pDevice, request.sInfo.extent, format, usage, mipLevels);
+		texture->image->Create();
+	}
+	catch (...)
+	{
+		request.sPromise.set_exception(current_exception());
+
+		lock_guard<mutex> lock(mLock);
+		iInFlightBytes -= request.iBytes;
+		iDecoding--;
+		iFailedCount++;
+		Dispatch();
+		return;
+	}
+
+	bool bDecoded = true;
+	if (request.pCooked)
+	{
+		// A span per level, written once and copied once. The values only go up, the last one covers every level.
+		for (u32 level = 0; level < request.pCooked->GetMipLevels(); level++)
+		{
+			StagingSpan span = uploadQueue.Reserve(request.pCooked->GetMip(level).size);
+			if (!request.pCooked->ReadMip(level, span.pData))
+			{
+				cout << "WARNING: Failed to inflate mip " << level << " of " << request.sPath << ", leaving it black" << endl;
+				memset(span.pData, 0, static_cast<size_t>(span.size));
+				bDecoded = false;
+			}
+			texture->uploadValue = uploadQueue.CopyToImage(span, *texture->image, level);
+		}
+	}
+	else
+	{
+		StagingSpan span = uploadQueue.Reserve(request.iBytes);
+
+		bDecoded = DecodeImage(request.sFile.data.data(), request.sFile.data.size(), request.sInfo, span.pData);
+		if (!bDecoded)
+		{
+			cout << "WARNING: Failed to decode " << request.sPath << ", using a placeholder" << endl;
+			FillCheckerboard(span.pData, request.sInfo.extent);
+		}
+
+		texture->uploadValue = uploadQueue.CopyToImage(span, *texture->image);
+	}
+
+	// Done with the file, the pages go back to the file cache
+	request.pCooked.reset();
+	request.sFile = {};
+
+	if (bMips)
+	{
+		mipGenerator.Generate(*texture->image, texture->uploadValue);
+	}
+
+	// Copies go out in batches of a quarter of the budget, so the GPU gets going while the rest decodes.
+	// The last decode of a burst sends out whatever is left.
+	Vec<MipWaiter> waiters;
+	bool bFlush = false;
+	{
+		lock_guard<mutex> lock(mLock);
+		pArrPending.push_back({ texture->uploadValue, request.iBytes });
+		iUnflushedBytes += request.iBytes;
+		iDecoding--;
+		if (iUnflushedBytes >= iBudget / 4 || (iDecoding == 0 && pArrWaiting.empty()))
+		{
+			iUnflushedBytes = 0;
+			bFlush = true;
+		}
+
+		if (bMips)
+		{
+			pArrMipWaiters.push_back({ texture, move(request.sPromise) });
+		}
+		if (bFlush)
+		{
+			waiters.swap(pArrMipWaiters);
+		}
+
+		iLoadedCount++;
+		iLoadedBytes += request.iBytes;
+		if (!bDecoded)
+		{
+			iFailedCount++;
+		}
+	}
+
+	if (!bMips)
+	{
+		request.sPromise.set_value(texture);
+	}
+
+	if (bFlush)
+	{
+		FlushBatch(waiters);
+	}
+
+	lock_guard<mutex> lock(mLock);
+	Dispatch();
+}
+
+void TextureLoader::Dispatch()
+{
+	u64 completed = pDevice.GetUploadQueue().GetCompletedValue();
+	while (!pArrPending.empty() && pArrPending.front().iValue <= completed)
+	{
+		iInFlightBytes -= pArrPending.front().iBytes;
+		pArrPending.pop_front();
+	}
+
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+
+	// In order, a big texture isn't overtaken by small ones forever. One bigger than the whole budget goes on its own.
+	while (!pArrWaiting.empty())
+	{
+		Ref<Request> request = pArrWaiting.front();
+		if (iInFlightBytes != 0 && iInFlightBytes + request->iBytes > iBudget)
+		{
+			break;
+		}
+
+		pArrWaiting.pop_front();
+		iDecoding++;
+		iInFlightBytes += request->iBytes;
+		iPeakInFlightBytes = max(iPeakInFlightBytes, iInFlightBytes);
+
+		jobSystem.Submit([this, request]() { Decode(*request); }, pCounter);
+	}
+
+	// Out of budget, a finished decode or a completed copy frees some. One job waits for the
+	// oldest copy, so loads keep going even if nobody polls, and no other job blocks a worker.
+	if (!pArrWaiting.empty() && !pArrPending.empty() && !bRetiring)
+	{
+		bRetiring = true;
+		u64 value = pArrPending.front().iValue;
+		jobSystem.Submit([this, value]() { Retire(value); }, pCounter);
+	}
+}
+
+void TextureLoader::Retire(u64 value)
+{
+	// Flushes first if the copy is still in the batch being collected
+	pDevice.GetUploadQueue().Wait(value);
+
+	lock_guard<mutex> lock(mLock);
+	bRetiring = false;
+	Dispatch();
+}
+
+void TextureLoader::FlushBatch(Vec<MipWaiter> &waiters)
+{
+	pDevice.GetUploadQueue().Flush();
+
+	if (waiters.empty())
+	{
+		return;
+	}
+
+	// Images of waiters added after the swap may be in this submission too, they get a later value, which is still right
+	u64 mipValue = pDevice.GetMipGenerator().Flush();
+	for (MipWaiter &waiter : waiters)
+	{
+		waiter.pTexture->mipValue = mipValue;
+		waiter.sPromise.set_value(waiter.pTexture);
+	}
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ImageDecoder.h"
+#include "AssetPack.h"
+
+class Device;
+class Image;
+class CookedTexture;
+class JobCounter;
+
+// An image loaded from a file. Other queues have to wait on the upload queue's timeline
+// at uploadValue before reading it, it's in SHADER_READ_ONLY_OPTIMAL from then on.
+// With generated mips the graphics timeline has to reach mipValue as well.
+struct Texture
+{
+	Ref<Image> image;
+	string path;
+	u64 uploadValue = 0;
+	u64 mipValue = 0;
+};
+
+// Loads PNG and WebP files as RGBA8 textures on the job system.
+// A job maps the file and reads its header, which is all it takes to know the decoded size. Once that
+// much fits in the budget another job reserves it in the upload queue's staging ring and decodes right
+// into it, so pixels are written once and copied once, by the GPU. Budgeted bytes come back when their
+// copy has completed, which keeps decoding ahead of the GPU copies without running the ring full of
+// spans that can't be retired. Loads waiting for budget don't hold up a worker.
+// Mip chains are generated on the GPU by the device's MipGenerator, flushed along with the copies.
+// Textures cooked by the TextureCooker skip all of that, each of their mips goes into staging in one write.
+class TextureLoader : public IVkResource, public NonCopyable
+{
+public:
+
+	using TextureFuture = shared_future<Ref<Texture>>;
+
+	// Half the default ring, the rest stays free for anyone else uploading meanwhile
+	static constexpr VkDeviceSize DEFAULT_BUDGET = 32ull * 1024 * 1024;
+
+private:
+
+	struct Request
+	{
+		string sPath;
+		bool bSrgb = true;
+		bool bMips = false;
+		// The mapped file or the pack entry
+		AssetData sFile;
+
+		// The extent is filled in for cooked textures too
+		ImageFileInfo sInfo;
+
+		// Set for cooked textures, reads from sFile
+		Ref<CookedTexture> pCooked;
+		VkDeviceSize iBytes = 0;
+		promise<Ref<Texture>> sPromise;
+	};
+
+	// Resolved once the mips of its texture are submitted
+	struct MipWaiter
+	{
+		Ref<Texture> pTexture;
+		promise<Ref<Texture>> sPromise;
+	};
+
+	// Budget held by a copy until the upload timeline reaches iValue
+	struct PendingUpload
+	{
+		u64 iValue;
+		VkDeviceSize iBytes;
+	};
+
+	Device &pDevice;
+	VkDeviceSize iBudget;
+
+	// Bytes being decoded or waiting for their copy
+	VkDeviceSize iInFlightBytes;
+	VkDeviceSize iUnflushedBytes;
+
+	// Searched before loose files, the last one mounted first
+	Vec<Ref<AssetPack>> pArrPacks;
+
+	// Headers read, waiting for budget
+	deque<Ref<Request>> pArrWaiting;
+	deque<PendingUpload> pArrPending;
+	Vec<MipWaiter> pArrMipWaiters;
+
+	// Decode jobs submitted and not done yet
+	u32 iDecoding;
+
+	// A job is already waiting on the oldest copy to free budget
+	bool bRetiring;
+
+	// Counts every job of every load, so it only reaches zero once each load is decoded and its copy queued
+	Ref<JobCounter> pCounter;
+	mutex mLock;
+
+	u64 iLoadedCount;
+	u64 iLoadedBytes;
+	u64 iFailedCount;
+	VkDeviceSize iPeakInFlightBytes;
+
+public:
+
+	// Budget is capped to half the staging ring
+	TextureLoader(Device &device, VkDeviceSize budget = DEFAULT_BUDGET);
+	~TextureLoader();
+
+public:
+
+	// The job system has to be created first
+	void Create() override;
+
+	// Wait for every load to be decoded and queued
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Queue a file, sRGB decides between R8G8B8A8_SRGB and R8G8B8A8_UNORM.
+	// The future becomes ready once the copy is queued, or holds the exception if the file couldn't
+	// be opened or isn't a PNG, WebP or cooked texture. Files that turn out broken while decoding still give
+	// a texture, filled with a checkerboard, with a warning. With bMips the image gets a full mip chain, the
+	// future is ready once its generation is submitted. Formats the device can't generate mips for get one level.
+	// Cooked textures keep the format and the mips they were cooked with, bSrgb and bMips don't apply.
+	TextureFuture Load(const string &path, bool bSrgb = true, bool bMips = false);
+
+	// Paths found in the pack load from it instead, in place if the entry is stored as is
+	void MountPack(const Ref<AssetPack> &pack);
+
+	// Block until everything queued is decoded, then submit the copies and mip generation.
+	// Returns the upload timeline value every load so far is complete at.
+	u64 WaitIdle();
+
+	u64 GetLoadedCount();
+	u64 GetLoadedBytes();
+	u64 GetFailedCount();
+	VkDeviceSize GetBudget() const;
+	VkDeviceSize GetPeakInFlightBytes();
+
+	static bool IsReady(const TextureFuture &future);
+
+private:
+
+	void ReadHeader(Request &request);
+	void Decode(Request &request);
+
+	// Hand budget that came back to waiting loads, call with the lock held
+	void Dispatch();
+	void Retire(u64 value);
+
+	// Submit the copies collected so far, then the mips of the waiters, and resolve them
+	void FlushBatch(Vec<MipWaiter> &waiters);
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ThreadCommandPool.h"
+#include "Device.h"
+
+ThreadCommandPool::ThreadCommandPool(Device &device, u32 queueFamily) :
+	pCommandPool(VK_NULL_HANDLE),
+	pDevice(device),
+	iQueueFamily(queueFamily),
+	pArrPrimaries(),
+	pArrSecondaries(),
+	iUsedPrimaries(0),
+	iUsedSecondaries(0)
+{
+}
+
+ThreadCommandPool::~ThreadCommandPool()
+{
+	if (pCommandPool != VK_NULL_HANDLE)
+	{
+		Destroy();
+	}
+}
+
+void ThreadCommandPool::Create()
+{
+	// Transient because the pool is reset every time this frame comes around again
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = iQueueFamily;
+
+	VK_CHECK_RESULT(vkCreateCommandPool(pDevice.GetVkNative(), &commandPoolCreateInfo, nullptr, &pCommandPool));
+}
+
+void ThreadCommandPool::Destroy()
+{
+	// Freeing the pool frees its command buffers with it
+	if (pCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(pDevice.GetVkNative(), pCommandPool, nullptr);
+		pCommandPool = VK_NULL_HANDLE;
+	}
+
+	pArrPrimaries.clear();
+	pArrSecondaries.clear();
+	iUsedPrimaries = 0;
+	iUsedSecondaries = 0;
+}
+
+bool ThreadCommandPool::IsValid() const
+{
+	return pCommandPool != VK_NULL_HANDLE;
+}
+
+VkCommandPool ThreadCommandPool::GetVkNative() const
+{
+	return pCommandPool;
+}
+
+VkCommandBuffer ThreadCommandPool::AcquirePrimary()
+{
+	return Acquire(pArrPrimaries, iUsedPrimaries, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+VkCommandBuffer ThreadCommandPool::AcquireSecondary()
+{
+	return Acquire(pArrSecondaries, iUsedSecondaries, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+}
+
+void ThreadCommandPool::Reset()
+{
+	// One call resets every command buffer in the pool, no per buffer reset needed
+	VK_CHECK_RESULT(vkResetCommandPool(pDevice.GetVkNative(), pCommandPool, 0));
+	iUsedPrimaries = 0;
+	iUsedSecondaries = 0;
+}
+
+u32 ThreadCommandPool::GetUsedCount() const
+{
+	return iUsedPrimaries + iUsedSecondaries;
+}
+
+VkCommandBuffer ThreadCommandPool::Acquire(Vec<VkCommandBuffer> &commandBuffers, u32 &used, VkCommandBufferLevel level)
+{
+	if (used == commandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = pCommandPool;
+		allocateInfo.level = level;
+		allocateInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VK_CHECK_RESULT(vkAllocateCommandBuffers(pDevice.GetVkNative(), &allocateInfo, &commandBuffer));
+		commandBuffers.push_back(commandBuffer);
+	}
+
+	return commandBuffers[used++];
+}
\ No newline at end of file
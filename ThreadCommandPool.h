@@ -0,0 +1,47 @@
+#pragma once
+
+class Device;
+
+// A command pool owned by one recording thread for one frame in flight.
+// Command pools can't be used from two threads at once, so every thread that records
+// gets its own, and the whole pool is reset in one go once the frame comes around again.
+// Command buffers are allocated on first use and handed out again after every Reset().
+class ThreadCommandPool : public IVkResource, public NonCopyable
+{
+private:
+	VkCommandPool pCommandPool;
+	Device &pDevice;
+	u32 iQueueFamily;
+
+	Vec<VkCommandBuffer> pArrPrimaries;
+	Vec<VkCommandBuffer> pArrSecondaries;
+	u32 iUsedPrimaries;
+	u32 iUsedSecondaries;
+
+public:
+
+	ThreadCommandPool(Device &device, u32 queueFamily);
+	~ThreadCommandPool();
+
+public:
+
+	void Create() override;
+	void Destroy() override;
+	bool IsValid() const override;
+	VkCommandPool GetVkNative() const;
+
+public:
+
+	// Next unused command buffer of that level, not yet begun
+	VkCommandBuffer AcquirePrimary();
+	VkCommandBuffer AcquireSecondary();
+
+	// Recycle every command buffer handed out, only valid once the GPU is done with them
+	void Reset();
+
+	u32 GetUsedCount() const;
+
+private:
+
+	VkCommandBuffer Acquire(Vec<VkCommandBuffer> &commandBuffers, u32 &used, VkCommandBufferLevel level);
+};
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring>
 #include <memory>
 #include <vector>
 #include <string>
@@ -18,12 +19,27 @@
 #include <iomanip>
 #include <chrono>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <atomic>
+#include <filesystem>
+#include <span>
 
 #include "NonCopyable.h"
 
 #include <vulkan/vulkan.h>
+
+// CULKAN_HEADLESS builds leave GLFW out, for the tools and for machines without a display, and only ever render headless
+#ifndef CULKAN_HEADLESS
 #include <GLFW/glfw3.h>
+#if defined(GLFW_EXPOSE_NATIVE_WIN32) || defined(GLFW_EXPOSE_NATIVE_X11) || defined(GLFW_EXPOSE_NATIVE_WAYLAND) || defined(GLFW_EXPOSE_NATIVE_COCOA)
 #include <GLFW/glfw3native.h>
+#endif
+#else
+struct GLFWwindow;
+#endif
 
 using namespace std;
 
@@ -142,6 +158,9 @@ struct QueueFamilyIndices
 	u32 graphicsFamily = 0;
 	u32 presentFamily = 0;
 
+	// A transfer only family if the device has one, the graphics family otherwise
+	u32 transferFamily = 0;
+
 	bool IsComplete() const
 	{
 		return graphicsFamily >= 0 && presentFamily >= 0;
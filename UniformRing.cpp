@@ -0,0 +1,213 @@
+#pragma once
+
+#include "UniformRing.h"
+#include "Device.h"
+#include "PhysicalDevice.h"
+#include "Buffer.h"
+#include "BindlessHeap.h"
+#include "DescriptorAllocator.h"
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+UniformRing::UniformRing(Device &device, u32 frameCount, VkDeviceSize frameSize) :
+	pDevice(device),
+	pBuffer(),
+	pPool(VK_NULL_HANDLE),
+	pSet(VK_NULL_HANDLE),
+	iFrameCount(max(frameCount, 1u)),
+	iFrameSize(frameSize),
+	iAlignment(1),
+	iRange(0),
+	iFrame(0),
+	iHead(0),
+	iFrameAllocations(0),
+	iFrameOverflows(0),
+	iLastFrameBytes(0),
+	iPeakFrameBytes(0),
+	iOverflowCount(0)
+{
+}
+
+UniformRing::~UniformRing()
+{
+	Destroy();
+}
+
+void UniformRing::Create()
+{
+	VkPhysicalDeviceLimits limits = pDevice.GetPhysicalDevice().GetProperties().limits;
+	iAlignment = max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1);
+	iRange = min(MAX_ALLOCATION_SIZE, limits.maxUniformBufferRange);
+
+	// Regions start aligned, and the descriptor range past the last allocation of the last region still has to be inside the buffer
+	iFrameSize = AlignUp(max<VkDeviceSize>(iFrameSize, iRange), iAlignment);
+	VkDeviceSize size = iFrameSize * iFrameCount + iRange;
+
+	pBuffer = make_shared<Buffer>(pDevice, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MemoryUsage::CpuToGpu);
+	pBuffer->Create();
+	ASSERT(pBuffer->GetMapped() != nullptr, "Uniform ring memory is not host visible");
+
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	VK_CHECK_RESULT(vkCreateDescriptorPool(pDevice.GetVkNative(), &poolCreateInfo, nullptr, &pPool));
+
+	VkDescriptorSetLayout setLayout = pDevice.GetBindlessHeap().GetUniformSetLayout();
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = pPool;
+	allocateInfo.descriptorSetCount = 1;
+	allocateInfo.pSetLayouts = &setLayout;
+
+	VK_CHECK_RESULT(vkAllocateDescriptorSets(pDevice.GetVkNative(), &allocateInfo, &pSet));
+
+	// Written once, the offset into the buffer is dynamic
+	DescriptorAllocator::Write(pDevice, pSet, {
+		DescriptorWrite::Buffer(BindlessHeap::UNIFORM_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, pBuffer->GetVkNative(), 0, iRange)
+	});
+
+	iFrame = 0;
+	iHead = 0;
+}
+
+void UniformRing::Destroy()
+{
+	// The set goes with the pool
+	if (pPool != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(pDevice.GetVkNative(), pPool, nullptr);
+		pPool = VK_NULL_HANDLE;
+		pSet = VK_NULL_HANDLE;
+	}
+
+	pBuffer.reset();
+}
+
+bool UniformRing::IsValid() const
+{
+	return pBuffer != nullptr;
+}
+
+void UniformRing::BeginFrame(u32 frameIndex)
+{
+	ASSERT(frameIndex < iFrameCount, "Uniform ring frame index out of range");
+
+	// Wrap up the stats of the frame that just ended recording
+	iLastFrameBytes = GetFrameBytes();
+	iPeakFrameBytes = max(iPeakFrameBytes, iLastFrameBytes);
+	iOverflowCount += iFrameOverflows;
+
+	iFrame = frameIndex;
+	iHead = 0;
+	iFrameAllocations = 0;
+	iFrameOverflows = 0;
+}
+
+void UniformRing::Flush() const
+{
+	VkDeviceSize used = GetFrameBytes();
+	if (used > 0)
+	{
+		pDevice.GetAllocator().Flush(pBuffer->GetAllocation(), iFrame * iFrameSize, used);
+	}
+}
+
+UniformAllocation UniformRing::Allocate(u32 size)
+{
+	ASSERT(size > 0 && size <= iRange, "Uniform allocation has to fit in the descriptor range");
+
+	// Lock free, a thread that overflows leaves iHead past the end and everybody after it overflows too
+	VkDeviceSize offset = iHead.fetch_add(AlignUp(size, iAlignment));
+	if (offset + size > iFrameSize)
+	{
+		if (iFrameOverflows.fetch_add(1) == 0)
+		{
+			cout << "WARNING: Uniform ring region of " << iFrameSize / 1024 << "KB is full, dropping allocations this frame" << endl;
+		}
+		return {};
+	}
+
+	iFrameAllocations++;
+
+	VkDeviceSize bufferOffset = iFrame * iFrameSize + offset;
+
+	UniformAllocation allocation;
+	allocation.pData = static_cast<u8 *>(pBuffer->GetMapped()) + bufferOffset;
+	allocation.offset = static_cast<u32>(bufferOffset);
+	allocation.size = size;
+	return allocation;
+}
+
+UniformAllocation UniformRing::Push(const void *pData, u32 size)
+{
+	UniformAllocation allocation = Allocate(size);
+	if (allocation.IsValid())
+	{
+		memcpy(allocation.pData, pData, size);
+	}
+	return allocation;
+}
+
+void UniformRing::Bind(VkCommandBuffer commandBuffer, const UniformAllocation &allocation, VkPipelineBindPoint bindPoint) const
+{
+	Bind(commandBuffer, pDevice.GetBindlessHeap().GetPipelineLayout(), allocation, bindPoint);
+}
+
+void UniformRing::Bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, const UniformAllocation &allocation, VkPipelineBindPoint bindPoint) const
+{
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, BindlessHeap::UNIFORM_SET, 1, &pSet, 1, &allocation.offset);
+}
+
+VkBuffer UniformRing::GetVkNative() const
+{
+	return pBuffer->GetVkNative();
+}
+
+VkDescriptorSet UniformRing::GetDescriptorSet() const
+{
+	return pSet;
+}
+
+VkDeviceSize UniformRing::GetFrameSize() const
+{
+	return iFrameSize;
+}
+
+VkDeviceSize UniformRing::GetAlignment() const
+{
+	return iAlignment;
+}
+
+VkDeviceSize UniformRing::GetFrameBytes() const
+{
+	return min<VkDeviceSize>(iHead, iFrameSize);
+}
+
+u32 UniformRing::GetFrameAllocationCount() const
+{
+	return iFrameAllocations;
+}
+
+VkDeviceSize UniformRing::GetLastFrameBytes() const
+{
+	return iLastFrameBytes;
+}
+
+VkDeviceSize UniformRing::GetPeakFrameBytes() const
+{
+	return iPeakFrameBytes;
+}
+
+u64 UniformRing::GetOverflowCount() const
+{
+	return iOverflowCount + iFrameOverflows;
+}
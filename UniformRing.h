@@ -0,0 +1,114 @@
+#pragma once
+
+class Device;
+class Buffer;
+
+// A slice of the ring, valid until the frame it was handed out in comes around again
+struct UniformAllocation
+{
+	void *pData = nullptr;
+
+	// Dynamic offset to bind the ring's set with
+	u32 offset = 0;
+	u32 size = 0;
+
+	bool IsValid() const
+	{
+		return pData != nullptr;
+	}
+};
+
+// Per draw constants without a buffer or descriptor set per draw. One persistently mapped buffer
+// is split into a region per frame in flight, allocations bump a pointer through the region of the
+// current frame and come back aligned to minUniformBufferOffsetAlignment. Everything is read through
+// a single dynamic uniform buffer descriptor (set BindlessHeap::UNIFORM_SET), a draw only passes its
+// offset to vkCmdBindDescriptorSets. BeginFrame() starts over once the frame's last use retired.
+// A full region hands out invalid allocations instead of wrapping into data the GPU still reads.
+class UniformRing : public IVkResource, public NonCopyable
+{
+public:
+
+	static constexpr VkDeviceSize DEFAULT_FRAME_SIZE = 4 * 1024 * 1024;
+
+	// What a single allocation can span, the range of the descriptor. 64KB is what most devices allow.
+	static constexpr u32 MAX_ALLOCATION_SIZE = 64 * 1024;
+
+private:
+
+	Device &pDevice;
+
+	Ref<Buffer> pBuffer;
+	VkDescriptorPool pPool;
+	VkDescriptorSet pSet;
+
+	u32 iFrameCount;
+	VkDeviceSize iFrameSize;
+	VkDeviceSize iAlignment;
+	u32 iRange;
+
+	// Region of the frame being recorded, and how far into it allocations got
+	u32 iFrame;
+	atomic<VkDeviceSize> iHead;
+
+	// Stats, iHead can run past the region on overflow so used bytes are clamped
+	atomic<u32> iFrameAllocations;
+	atomic<u32> iFrameOverflows;
+	VkDeviceSize iLastFrameBytes;
+	VkDeviceSize iPeakFrameBytes;
+	u64 iOverflowCount;
+
+public:
+
+	// frameSize is per frame in flight
+	UniformRing(Device &device, u32 frameCount, VkDeviceSize frameSize = DEFAULT_FRAME_SIZE);
+	~UniformRing();
+
+public:
+
+	void Create() override;
+
+	// The GPU must not be reading from the ring anymore
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Switch to the region of frameIndex, only once the GPU is done with that frame's last submission
+	void BeginFrame(u32 frameIndex);
+
+	// Make this frame's writes visible on non coherent memory, before the frame is submitted
+	void Flush() const;
+
+	// Safe from any recording thread. Returns an invalid allocation once the frame's region is full.
+	UniformAllocation Allocate(u32 size);
+
+	// Allocate and copy in one go
+	UniformAllocation Push(const void *pData, u32 size);
+
+	template<typename T>
+	UniformAllocation Push(const T &data)
+	{
+		return Push(&data, static_cast<u32>(sizeof(T)));
+	}
+
+	// Bind the ring at the allocation's offset, layout must be compatible with the bindless pipeline layout up to the uniform set
+	void Bind(VkCommandBuffer commandBuffer, const UniformAllocation &allocation, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+	void Bind(VkCommandBuffer commandBuffer, VkPipelineLayout layout, const UniformAllocation &allocation, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+	VkBuffer GetVkNative() const;
+	VkDescriptorSet GetDescriptorSet() const;
+
+	VkDeviceSize GetFrameSize() const;
+	VkDeviceSize GetAlignment() const;
+
+	// Bytes and allocations of the frame being recorded
+	VkDeviceSize GetFrameBytes() const;
+	u32 GetFrameAllocationCount() const;
+
+	// Bytes the last finished frame used, and the most any frame used so far
+	VkDeviceSize GetLastFrameBytes() const;
+	VkDeviceSize GetPeakFrameBytes() const;
+
+	// Allocations that didn't fit, over every frame so far
+	u64 GetOverflowCount() const;
+};
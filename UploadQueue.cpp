@@ -0,0 +1,436 @@
+#pragma once
+
+#include "UploadQueue.h"
+#include "Device.h"
+#include "Buffer.h"
+#include "Image.h"
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+UploadQueue::UploadQueue(Device &device, VkDeviceSize ringSize) :
+	pDevice(device),
+	pVkStagingBuffer(VK_NULL_HANDLE),
+	sStagingAllocation(),
+	iRingSize(ringSize),
+	iHead(0),
+	iTail(0),
+	iUsed(0),
+	iBatchBytes(0),
+	pArrRegions(),
+	iOpenSpans(0),
+	pArrBufferCopies(),
+	pArrImageCopies(),
+	pCommandPool(VK_NULL_HANDLE),
+	pArrCommandBuffers(),
+	pTimeline()
+{
+}
+
+UploadQueue::~UploadQueue()
+{
+	if (IsValid())
+	{
+		Destroy();
+	}
+}
+
+void UploadQueue::Create()
+{
+	VkDevice vkDevice = pDevice.GetVkNative();
+
+	// Only ever read by the transfer queue, exclusive sharing is fine
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = iRingSize;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VK_CHECK_RESULT(vkCreateBuffer(vkDevice, &bufferCreateInfo, nullptr, &pVkStagingBuffer));
+
+	// Only the copy engine reads it, so it has no business in the device local, host visible heap, which is
+	// only 256 MB without resizable BAR and better left to the UniformRing
+	sStagingAllocation = pDevice.GetAllocator().AllocateForBuffer(pVkStagingBuffer, MemoryUsage::CpuOnly);
+	ASSERT(sStagingAllocation.pMapped != nullptr, "Staging ring is not host visible");
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolCreateInfo.queueFamilyIndex = pDevice.GetQueueFamilyIndices().transferFamily;
+
+	VK_CHECK_RESULT(vkCreateCommandPool(vkDevice, &commandPoolCreateInfo, nullptr, &pCommandPool));
+
+	pTimeline = make_shared<GpuTimeline>(pDevice, pDevice.GetTransferQueue());
+	pTimeline->Create();
+}
+
+void UploadQueue::Destroy()
+{
+	WaitIdle();
+
+	VkDevice vkDevice = pDevice.GetVkNative();
+
+	if (pCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(vkDevice, pCommandPool, nullptr);
+		pCommandPool = VK_NULL_HANDLE;
+	}
+	pArrCommandBuffers.clear();
+
+	pTimeline.reset();
+
+	if (pVkStagingBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(vkDevice, pVkStagingBuffer, nullptr);
+		pVkStagingBuffer = VK_NULL_HANDLE;
+	}
+	pDevice.GetAllocator().Free(sStagingAllocation);
+
+	pArrRegions.clear();
+	iHead = iTail = iUsed = iBatchBytes = 0;
+}
+
+bool UploadQueue::IsValid() const
+{
+	return pVkStagingBuffer != VK_NULL_HANDLE;
+}
+
+StagingSpan UploadQueue::Reserve(VkDeviceSize size, VkDeviceSize alignment)
+{
+	lock_guard<mutex> lock(mLock);
+
+	VkDeviceSize offset = Allocate(size, max(alignment, DEFAULT_ALIGNMENT));
+	iOpenSpans++;
+
+	StagingSpan span;
+	span.pData = static_cast<u8 *>(sStagingAllocation.pMapped) + offset;
+	span.offset = offset;
+	span.size = size;
+	return span;
+}
+
+u64 UploadQueue::CopyToBuffer(const StagingSpan &span, Buffer &dst, VkDeviceSize dstOffset)
+{
+	ASSERT(span.IsValid(), "Copy from an empty staging span");
+	ASSERT(dstOffset + span.size <= dst.GetSize(), "Upload out of range of the destination buffer");
+
+	lock_guard<mutex> lock(mLock);
+
+	BufferCopy copy;
+	copy.pDst = dst.GetVkNative();
+	copy.sRegion.srcOffset = span.offset;
+	copy.sRegion.dstOffset = dstOffset;
+	copy.sRegion.size = span.size;
+	pArrBufferCopies.push_back(copy);
+
+	iOpenSpans--;
+	return pTimeline->GetSubmittedValue() + 1;
+}
+
+u64 UploadQueue::CopyToImage(const StagingSpan &span, Image &dst, u32 mipLevel, u32 arrayLayer, VkImageLayout finalLayout)
+{
+	ASSERT(span.IsValid(), "Copy from an empty staging span");
+	ASSERT(mipLevel < dst.GetMipLevels() && arrayLayer < dst.GetArrayLayers(), "Upload to a subresource the image doesn't have");
+
+	lock_guard<mutex> lock(mLock);
+
+	// Each copy starts with a transition from UNDEFINED, a second one into the same subresource
+	// in this batch would throw the first away, so that one goes out first
+	for (const auto &pending : pArrImageCopies)
+	{
+		if (pending.pDst == dst.GetVkNative() &&
+			pending.sRegion.imageSubresource.mipLevel == mipLevel &&
+			pending.sRegion.imageSubresource.baseArrayLayer == arrayLayer)
+		{
+			FlushLocked();
+			break;
+		}
+	}
+
+	VkExtent2D extent = dst.GetExtent();
+
+	ImageCopy copy;
+	copy.pDst = dst.GetVkNative();
+	copy.eAspect = dst.GetAspectMask();
+	copy.eFinalLayout = finalLayout;
+	copy.sRegion.bufferOffset = span.offset;
+	copy.sRegion.bufferRowLength = 0;
+	copy.sRegion.bufferImageHeight = 0;
+	copy.sRegion.imageSubresource.aspectMask = copy.eAspect;
+	copy.sRegion.imageSubresource.mipLevel = mipLevel;
+	copy.sRegion.imageSubresource.baseArrayLayer = arrayLayer;
+	copy.sRegion.imageSubresource.layerCount = 1;
+	copy.sRegion.imageOffset = { 0, 0, 0 };
+	copy.sRegion.imageExtent = { max(1u, extent.width >> mipLevel), max(1u, extent.height >> mipLevel), 1 };
+	pArrImageCopies.push_back(copy);
+
+	iOpenSpans--;
+	return pTimeline->GetSubmittedValue() + 1;
+}
+
+u64 UploadQueue::Upload(Buffer &dst, const void *pData, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+	StagingSpan span = Reserve(size);
+	memcpy(span.pData, pData, static_cast<size_t>(size));
+	return CopyToBuffer(span, dst, dstOffset);
+}
+
+u64 UploadQueue::Upload(Image &dst, const void *pData, VkDeviceSize size, u32 mipLevel, u32 arrayLayer, VkImageLayout finalLayout)
+{
+	StagingSpan span = Reserve(size);
+	memcpy(span.pData, pData, static_cast<size_t>(size));
+	return CopyToImage(span, dst, mipLevel, arrayLayer, finalLayout);
+}
+
+u64 UploadQueue::Flush()
+{
+	lock_guard<mutex> lock(mLock);
+	return FlushLocked();
+}
+
+void UploadQueue::Wait(u64 value)
+{
+	{
+		lock_guard<mutex> lock(mLock);
+		if (value > pTimeline->GetSubmittedValue())
+		{
+			FlushLocked();
+		}
+		ASSERT(value <= pTimeline->GetSubmittedValue(), "Waiting on an upload that was never queued");
+	}
+
+	pTimeline->Wait(value);
+}
+
+bool UploadQueue::IsComplete(u64 value)
+{
+	return pTimeline->IsComplete(value);
+}
+
+void UploadQueue::WaitIdle()
+{
+	u64 value;
+	{
+		lock_guard<mutex> lock(mLock);
+		value = FlushLocked();
+	}
+
+	pTimeline->Wait(value);
+}
+
+u64 UploadQueue::GetCompletedValue() const
+{
+	return pTimeline->GetCompletedValue();
+}
+
+GpuTimeline &UploadQueue::GetTimeline() const
+{
+	return *pTimeline;
+}
+
+VkDeviceSize UploadQueue::GetRingSize() const
+{
+	return iRingSize;
+}
+
+VkDeviceSize UploadQueue::GetUsedBytes()
+{
+	lock_guard<mutex> lock(mLock);
+	Reclaim();
+	return iUsed;
+}
+
+VkDeviceSize UploadQueue::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	ASSERT(size > 0 && size <= iRingSize, "Upload has to fit in the staging ring");
+
+	while (true)
+	{
+		Reclaim();
+
+		// Free space runs from head to the end of the ring and on from the start up to tail,
+		// unless head has wrapped around behind tail already
+		bool bFreeWraps = iHead >= iTail && iUsed < iRingSize;
+		VkDeviceSize end = bFreeWraps ? iRingSize : iTail;
+		VkDeviceSize offset = AlignUp(iHead, alignment);
+
+		VkDeviceSize bytes = 0;
+		if (offset + size <= end)
+		{
+			bytes = offset + size - iHead;
+		}
+		else if (bFreeWraps && size <= iTail)
+		{
+			// Doesn't fit before the end, skip the rest of the ring and start over at 0
+			offset = 0;
+			bytes = (iRingSize - iHead) + size;
+		}
+
+		if (bytes != 0)
+		{
+			iHead = (offset + size) % iRingSize;
+			iUsed += bytes;
+			iBatchBytes += bytes;
+			return offset;
+		}
+
+		// Full, get the current batch going and wait for the oldest one to free its space
+		if (iOpenSpans == 0)
+		{
+			FlushLocked();
+		}
+		ASSERT(!pArrRegions.empty(), "Staging ring is full of spans that were never copied");
+		pTimeline->Wait(pArrRegions.front().iValue);
+	}
+}
+
+void UploadQueue::Reclaim()
+{
+	if (!pArrRegions.empty())
+	{
+		u64 completed = GetCompletedValue();
+		while (!pArrRegions.empty() && pArrRegions.front().iValue <= completed)
+		{
+			iTail = (iTail + pArrRegions.front().iBytes) % iRingSize;
+			iUsed -= pArrRegions.front().iBytes;
+			pArrRegions.pop_front();
+		}
+	}
+
+	// Nothing in flight, start from the beginning so big uploads don't have to wrap
+	if (iUsed == 0)
+	{
+		iHead = 0;
+		iTail = 0;
+	}
+}
+
+u64 UploadQueue::FlushLocked()
+{
+	if (pArrBufferCopies.empty() && pArrImageCopies.empty())
+	{
+		return pTimeline->GetSubmittedValue();
+	}
+
+	u64 value = pTimeline->GetSubmittedValue() + 1;
+
+	pDevice.GetAllocator().Flush(sStagingAllocation, 0, VK_WHOLE_SIZE);
+
+	VkCommandBuffer commandBuffer = AcquireCommandBuffer(value);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffer, &beginInfo));
+
+	// One vkCmdCopyBuffer per destination with all of its regions
+	stable_sort(pArrBufferCopies.begin(), pArrBufferCopies.end(), [](const BufferCopy &a, const BufferCopy &b) { return a.pDst < b.pDst; });
+
+	Vec<VkBufferCopy> regions;
+	for (size_t i = 0; i < pArrBufferCopies.size();)
+	{
+		VkBuffer dst = pArrBufferCopies[i].pDst;
+		regions.clear();
+		for (; i < pArrBufferCopies.size() && pArrBufferCopies[i].pDst == dst; i++)
+		{
+			regions.push_back(pArrBufferCopies[i].sRegion);
+		}
+		vkCmdCopyBuffer(commandBuffer, pVkStagingBuffer, dst, static_cast<u32>(regions.size()), regions.data());
+	}
+
+	if (!pArrImageCopies.empty())
+	{
+		stable_sort(pArrImageCopies.begin(), pArrImageCopies.end(), [](const ImageCopy &a, const ImageCopy &b) { return a.pDst < b.pDst; });
+
+		Vec<VkImageMemoryBarrier> barriers(pArrImageCopies.size());
+		for (size_t i = 0; i < pArrImageCopies.size(); i++)
+		{
+			const ImageCopy &copy = pArrImageCopies[i];
+
+			VkImageMemoryBarrier &barrier = barriers[i];
+			barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = copy.pDst;
+			barrier.subresourceRange.aspectMask = copy.eAspect;
+			barrier.subresourceRange.baseMipLevel = copy.sRegion.imageSubresource.mipLevel;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = copy.sRegion.imageSubresource.baseArrayLayer;
+			barrier.subresourceRange.layerCount = 1;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<u32>(barriers.size()), barriers.data());
+
+		Vec<VkBufferImageCopy> imageRegions;
+		for (size_t i = 0; i < pArrImageCopies.size();)
+		{
+			VkImage dst = pArrImageCopies[i].pDst;
+			imageRegions.clear();
+			for (; i < pArrImageCopies.size() && pArrImageCopies[i].pDst == dst; i++)
+			{
+				imageRegions.push_back(pArrImageCopies[i].sRegion);
+			}
+			vkCmdCopyBufferToImage(commandBuffer, pVkStagingBuffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<u32>(imageRegions.size()), imageRegions.data());
+		}
+
+		// Visibility for the reading queue comes from waiting on the timeline semaphore
+		for (size_t i = 0; i < pArrImageCopies.size(); i++)
+		{
+			barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barriers[i].dstAccessMask = 0;
+			barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barriers[i].newLayout = pArrImageCopies[i].eFinalLayout;
+		}
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, static_cast<u32>(barriers.size()), barriers.data());
+	}
+
+	VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffer));
+
+	// Only this queue submits to the timeline, so it signals the value predicted above
+	u64 submitted = pTimeline->Submit({ commandBuffer });
+	ASSERT(submitted == value, "Upload timeline was submitted to from outside the upload queue");
+
+	pArrBufferCopies.clear();
+	pArrImageCopies.clear();
+
+	// Spans still being filled belong to the next submission, so their bytes stay in the batch
+	if (iOpenSpans == 0 && iBatchBytes > 0)
+	{
+		pArrRegions.push_back({ iBatchBytes, value });
+		iBatchBytes = 0;
+	}
+
+	return value;
+}
+
+VkCommandBuffer UploadQueue::AcquireCommandBuffer(u64 value)
+{
+	// Oldest submission first, reuse its command buffer if it's done
+	if (!pArrCommandBuffers.empty() && pArrCommandBuffers.front().iValue <= GetCompletedValue())
+	{
+		CommandBuffer reused = pArrCommandBuffers.front();
+		pArrCommandBuffers.pop_front();
+
+		VK_CHECK_RESULT(vkResetCommandBuffer(reused.pCommandBuffer, 0));
+		reused.iValue = value;
+		pArrCommandBuffers.push_back(reused);
+		return reused.pCommandBuffer;
+	}
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = pCommandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = 1;
+
+	CommandBuffer commandBuffer = { VK_NULL_HANDLE, value };
+	VK_CHECK_RESULT(vkAllocateCommandBuffers(pDevice.GetVkNative(), &allocateInfo, &commandBuffer.pCommandBuffer));
+	pArrCommandBuffers.push_back(commandBuffer);
+	return commandBuffer.pCommandBuffer;
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "MemoryAllocator.h"
+#include "GpuTimeline.h"
+
+class Device;
+class Buffer;
+class Image;
+
+// Space in the staging ring to write source data into, handed to CopyToBuffer/CopyToImage once filled
+struct StagingSpan
+{
+	u8 *pData = nullptr;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+
+	bool IsValid() const
+	{
+		return pData != nullptr;
+	}
+};
+
+// Gets data onto the GPU through one persistently mapped staging ring.
+// Copies are collected into a batch and go out together in one submission on the transfer
+// queue, which is a dedicated transfer family if the device has one. Every submission signals
+// the next value of the queue's own GpuTimeline, so callers wait on a value rather than a fence.
+// Ring space is recycled in order once the submission that read it has completed.
+class UploadQueue : public IVkResource, public NonCopyable
+{
+public:
+
+	static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64ull * 1024 * 1024;
+	static constexpr VkDeviceSize DEFAULT_ALIGNMENT = 16;
+
+private:
+
+	// A stretch of the ring that is free again once the timeline reaches iValue
+	struct RingRegion
+	{
+		VkDeviceSize iBytes;
+		u64 iValue;
+	};
+
+	struct BufferCopy
+	{
+		VkBuffer pDst;
+		VkBufferCopy sRegion;
+	};
+
+	struct ImageCopy
+	{
+		VkImage pDst;
+		VkBufferImageCopy sRegion;
+		VkImageAspectFlags eAspect;
+		VkImageLayout eFinalLayout;
+	};
+
+	struct CommandBuffer
+	{
+		VkCommandBuffer pCommandBuffer;
+		u64 iValue;
+	};
+
+	Device &pDevice;
+
+	VkBuffer pVkStagingBuffer;
+	MemoryAllocation sStagingAllocation;
+	VkDeviceSize iRingSize;
+
+	// Ring state, iUsed tells a full ring from an empty one when head and tail meet
+	VkDeviceSize iHead;
+	VkDeviceSize iTail;
+	VkDeviceSize iUsed;
+	VkDeviceSize iBatchBytes;
+	deque<RingRegion> pArrRegions;
+
+	// Reserved spans that haven't been copied yet, the batch can't be retired while any are open
+	u32 iOpenSpans;
+
+	Vec<BufferCopy> pArrBufferCopies;
+	Vec<ImageCopy> pArrImageCopies;
+
+	VkCommandPool pCommandPool;
+	deque<CommandBuffer> pArrCommandBuffers;
+
+	// Only this queue submits to it, so the value of the batch being collected is always submitted + 1
+	Ref<GpuTimeline> pTimeline;
+
+	mutex mLock;
+
+public:
+
+	UploadQueue(Device &device, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+	~UploadQueue();
+
+public:
+
+	void Create() override;
+
+	// Wait for every upload to land and release the ring
+	void Destroy() override;
+	bool IsValid() const override;
+
+public:
+
+	// Reserve ring space to write into directly, e.g. to decode a file straight into staging memory.
+	// Every span has to be handed to CopyToBuffer or CopyToImage.
+	StagingSpan Reserve(VkDeviceSize size, VkDeviceSize alignment = DEFAULT_ALIGNMENT);
+
+	// Queue a copy out of a filled span. Returns the timeline value the copy is complete at.
+	u64 CopyToBuffer(const StagingSpan &span, Buffer &dst, VkDeviceSize dstOffset = 0);
+
+	// Replaces the whole subresource, tightly packed source data. The image ends up in finalLayout.
+	u64 CopyToImage(const StagingSpan &span, Image &dst, u32 mipLevel = 0, u32 arrayLayer = 0, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// Reserve, copy the data in and queue the copy in one go
+	u64 Upload(Buffer &dst, const void *pData, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	u64 Upload(Image &dst, const void *pData, VkDeviceSize size, u32 mipLevel = 0, u32 arrayLayer = 0, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	// Submit the current batch, returns the value it signals. Nothing is submitted if the batch is empty.
+	u64 Flush();
+
+	// Block until the timeline reaches value, flushing first if that value wasn't submitted yet
+	void Wait(u64 value);
+	bool IsComplete(u64 value);
+	void WaitIdle();
+
+	u64 GetCompletedValue() const;
+
+	// Other queues wait on this at the value returned by an upload before reading the data
+	GpuTimeline &GetTimeline() const;
+
+	VkDeviceSize GetRingSize() const;
+	VkDeviceSize GetUsedBytes();
+
+private:
+
+	VkDeviceSize Allocate(VkDeviceSize size, VkDeviceSize alignment);
+	void Reclaim();
+	u64 FlushLocked();
+	VkCommandBuffer AcquireCommandBuffer(u64 value);
+};
@@ -33,61 +33,544 @@ Create and destroy a simple Vulkan instance.
 #include "Surface.h"
 #include "SwapChain.h"
 #include "Pipeline.h"
+#include "PipelineCache.h"
+#include "PipelineCompiler.h"
+#include "PipelineRegistry.h"
+#include "Shader.h"
+#include "ShaderLibrary.h"
+#include "Renderer.h"
+#include "MemoryAllocator.h"
+#include "UploadQueue.h"
+#include "Buffer.h"
+#include "CommandRecorder.h"
+#include "JobSystem.h"
+#include "RenderGraph.h"
+#include "RenderPassCache.h"
+#include "FramePacer.h"
+#include "BindlessHeap.h"
+#include "PipelineLayoutCache.h"
+#include "UniformRing.h"
+#include "TextureLoader.h"
+#include "CookedTexture.h"
+#include "AssetPack.h"
+#include "MipGenerator.h"
+#include "GpuTimeline.h"
 
-int main()
+// Whole image copy between two color images of the same size and format
+static void RecordCopy(VkCommandBuffer commandBuffer, VkImage src, VkImage dst, VkExtent2D extent)
 {
+	VkImageCopy region = {};
+	region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.extent = { extent.width, extent.height, 1 };
+
+	vkCmdCopyImage(commandBuffer, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+int main(int argc, char **argv)
+{
+	// --frames N exits after N frames, handy for measuring throughput
+	// --frames-in-flight N overrides how far the CPU may run ahead of the GPU
+	// --job-workers N sets the number of job system workers next to the main thread, 0 picks one per core
+	// --headless renders without a window through VK_EXT_headless_surface, for build servers, always on in HEADLESS_ONLY builds
+	// --size WxH sets the window or headless swap chain size
+	// --record-stress N records N small commands per frame across the job system
+	// --present-policy low-latency|vsync|throughput picks present mode, image count and how far frames may queue up
+	u64 iMaxFrames = 0;
+	bool bHeadless = Instance::HEADLESS_ONLY;
+	u32 iWidth = 800;
+	u32 iHeight = 600;
+	u32 iFramesInFlight = Renderer::DEFAULT_FRAMES_IN_FLIGHT;
+	u32 iJobWorkers = 0;
+	u32 iRecordStress = 0;
+	PresentPolicy ePresentPolicy = PresentPolicy::VsyncStable;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--frames" && i + 1 < argc)
+		{
+			iMaxFrames = stoull(argv[++i]);
+		}
+		else if (arg == "--frames-in-flight" && i + 1 < argc)
+		{
+			iFramesInFlight = static_cast<u32>(stoul(argv[++i]));
+		}
+		else if (arg == "--job-workers" && i + 1 < argc)
+		{
+			iJobWorkers = static_cast<u32>(stoul(argv[++i]));
+		}
+		else if (arg == "--record-stress" && i + 1 < argc)
+		{
+			iRecordStress = static_cast<u32>(stoul(argv[++i]));
+		}
+		else if (arg == "--present-policy" && i + 1 < argc)
+		{
+			string policy = argv[++i];
+			if (policy == "low-latency")
+			{
+				ePresentPolicy = PresentPolicy::LowLatency;
+			}
+			else if (policy == "throughput")
+			{
+				ePresentPolicy = PresentPolicy::MaxThroughput;
+			}
+			else
+			{
+				ASSERT(policy == "vsync", "--present-policy expects low-latency, vsync or throughput");
+				ePresentPolicy = PresentPolicy::VsyncStable;
+			}
+		}
+		else if (arg == "--headless")
+		{
+			bHeadless = true;
+		}
+		else if (arg == "--size" && i + 1 < argc)
+		{
+			string size = argv[++i];
+			size_t separator = size.find('x');
+			ASSERT(separator != string::npos, "--size expects WxH");
+			iWidth = static_cast<u32>(stoul(size.substr(0, separator)));
+			iHeight = static_cast<u32>(stoul(size.substr(separator + 1)));
+		}
+	}
+
+	// Nobody is going to close a window that isn't there
+	if (bHeadless && iMaxFrames == 0)
+	{
+		iMaxFrames = 1000;
+	}
+
+	// Pipeline compiles, command recording and anything else that runs in parallel go through here
+	JobSystem &jobSystem = Singleton<JobSystem>::GetInstance();
+	jobSystem.SetWorkerCount(iJobWorkers);
+	jobSystem.Create();
+
 	Instance &instance = Singleton<Instance>::GetInstance();
     //instance.AddAllExtensions();
 	//instance.AddRequiredExtensions();
 
-	const char *extension1 = VK_KHR_SURFACE_EXTENSION_NAME;
-	const char *extension2 = VK_KHR_WIN32_SURFACE_EXTENSION_NAME;
-
-	instance.AddExtension(extension1);
-	instance.AddExtension(extension2);
-
 	instance.SetAppName("Vulkan Program");
+	instance.SetHeadless(bHeadless);
+	instance.SetWindowSize(iWidth, iHeight);
 	//instance.AddExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	instance.Create();
 
 	Vec<Ref<PhysicalDevice>> ppPhysicalDevices = instance.GetPhysicalDevices();
+	ASSERT(!ppPhysicalDevices.empty(), "No Vulkan devices found");
 
 	Ref<PhysicalDevice> pPhysicalDevice = ppPhysicalDevices[0];
 	u32 score = 0;
-	for (auto &pPhysicalDevice : ppPhysicalDevices)
+	for (auto &pCandidate : ppPhysicalDevices)
 	{
-		u32 testScore = pPhysicalDevice->RateSuitability();
-		if (score > pPhysicalDevice->RateSuitability())
+		u32 testScore = pCandidate->RateSuitability();
+		if (testScore > score)
 		{
-			pPhysicalDevice = pPhysicalDevice;
+			pPhysicalDevice = pCandidate;
 			score = testScore;
 		}
 	}
 
-	//
-	auto features = pPhysicalDevice->GetFeatures();
+	// Create the surface, the queue family search needs it to check for present support
+	Ref<Surface> pSurface = make_shared<Surface>(instance);
+	pSurface->Create();
+
 	pPhysicalDevice
-		->FindQueueFamilies();
+		->FindQueueFamilies(pSurface->GetVkNative());
 
 	// Create the device
 	Ref<Device> pDevice = pPhysicalDevice->CreateDevice();
 
-	// Create the surface
-	Ref<Surface> pSurface = make_shared<Surface>(instance);
-	pSurface->Create();
+	// Push some data through the upload queue to make sure the transfer path works
+	{
+		const VkDeviceSize iTestSize = 256 * 1024;
+		Buffer testBuffer(*pDevice, iTestSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MemoryUsage::GpuOnly);
+		testBuffer.Create();
+
+		Vec<u8> testData(static_cast<size_t>(iTestSize));
+		for (size_t i = 0; i < testData.size(); i++)
+		{
+			testData[i] = static_cast<u8>(i);
+		}
+
+		auto tUploadStart = chrono::steady_clock::now();
+		UploadQueue &uploadQueue = pDevice->GetUploadQueue();
+		u64 iUploadValue = 0;
+		for (VkDeviceSize offset = 0; offset < iTestSize; offset += 4096)
+		{
+			iUploadValue = uploadQueue.Upload(testBuffer, testData.data() + offset, 4096, offset);
+		}
+		uploadQueue.Wait(iUploadValue);
+
+		f64 fUploadMs = chrono::duration<f64, milli>(chrono::steady_clock::now() - tUploadStart).count();
+		cout << "Uploaded " << iTestSize / 1024 << "KB in " << iTestSize / 4096 << " copies, one submission, " << fUploadMs << "ms ("
+			<< (pDevice->HasDedicatedTransferQueue() ? "dedicated transfer queue" : "graphics queue") << ")" << endl;
+	}
 
 	// Create the swap chain
 	Ref<SwapChain> pSwapChain = make_shared<SwapChain>(*pDevice, *pSurface);
+	pSwapChain->SetPresentPolicy(ePresentPolicy);
 	pSwapChain->Create();
 
-	// Create the pipeline
-	Ref<Pipeline> pPipeline = make_shared<Pipeline>(*pDevice, *pSurface);
-	pPipeline->Create();
+	// Pipelines compile in the background while the render loop runs
+	Ref<PipelineCompiler> pPipelineCompiler = make_shared<PipelineCompiler>(*pDevice);
+	pPipelineCompiler->Create();
+
+	// Assets packed by the AssetPacker come out of one mapping instead of a file each
+	Ref<AssetPack> pAssetPack;
+	if (filesystem::exists("Assets.pak"))
+	{
+		pAssetPack = make_shared<AssetPack>("Assets.pak");
+		cout << "Mounted Assets.pak, " << pAssetPack->GetEntryCount() << " entries" << endl;
+	}
+
+	// Shaders are mapped rather than read, and the same SPIR-V under another name is the same module
+	ShaderLibrary shaderLibrary(*pDevice);
+	shaderLibrary.Create();
+	if (filesystem::exists("Shaders/Shaders.pak"))
+	{
+		shaderLibrary.MountArchive("Shaders/Shaders.pak");
+	}
+	if (pAssetPack)
+	{
+		shaderLibrary.MountPack(pAssetPack);
+	}
+
+	// Create the pipelines, only if the compiled shaders are around
+	PipelineCompiler::PipelineFuture pipelineFuture;
+	Ref<Shader> pVertShader;
+	Ref<Shader> pFragShader;
+	Ref<Pipeline> pScenePipeline;
+	auto fnAssetExists = [&](const string &name) { return filesystem::exists(name) || (pAssetPack && pAssetPack->Contains(name)); };
+	if (fnAssetExists("Shaders/Test.vert.spv") && fnAssetExists("Shaders/Test.frag.spv"))
+	{
+		pVertShader = shaderLibrary.Load("Shaders/Test.vert.spv");
+		pFragShader = shaderLibrary.Load("Shaders/Test.frag.spv");
+
+		PipelineStateDesc opaqueDesc;
+		opaqueDesc.AddShaderStage(*pVertShader);
+		opaqueDesc.AddShaderStage(*pFragShader);
+		opaqueDesc.AddColorTarget(pSwapChain->GetFormat());
 
-	// Destroy the pipeline
-	pPipeline->Destroy();	
+		PipelineStateDesc blendedDesc = opaqueDesc;
+		blendedDesc.blendStates[0] = PipelineStateDesc::BlendAlpha();
+
+		// The second opaque desc is identical to the first and shares its compile
+		Vec<PipelineCompiler::PipelineFuture> futures = pPipelineCompiler->Submit(Vec<PipelineStateDesc>{ opaqueDesc, blendedDesc, opaqueDesc });
+		pipelineFuture = futures[0];
+	}
+	else
+	{
+		cout << "Shaders/Test.vert.spv or Shaders/Test.frag.spv missing, skipping pipeline creation" << endl;
+	}
+
+	// Textures decode on the job system straight into staging memory while the pipelines compile
+	auto tTextureStart = chrono::steady_clock::now();
+	TextureLoader textureLoader(*pDevice);
+	textureLoader.Create();
+	if (pAssetPack)
+	{
+		textureLoader.MountPack(pAssetPack);
+	}
+	Vec<TextureLoader::TextureFuture> textureFutures;
+	if (filesystem::is_directory("Textures"))
+	{
+		for (const auto &entry : filesystem::directory_iterator("Textures"))
+		{
+			string extension = entry.path().extension().string();
+			if (extension == ".png" || extension == ".webp" || extension == CookedTexture::EXTENSION)
+			{
+				textureFutures.push_back(textureLoader.Load(entry.path().string(), true, true));
+			}
+		}
+	}
+
+	// Records into secondaries on the job system, every frame gets a command pool per job thread
+	Ref<CommandRecorder> pCommandRecorder = make_shared<CommandRecorder>(*pDevice);
+	pCommandRecorder->Create();
+
+	// Target for the record stress test, every command fills one word of it
+	const VkDeviceSize iStressWords = 16 * 1024;
+	Buffer stressBuffer(*pDevice, iStressWords * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MemoryUsage::GpuOnly);
+	stressBuffer.Create();
+
+	// Shaders reach it through its bindless index, nothing gets allocated or bound per draw
+	BindlessHeap &bindlessHeap = pDevice->GetBindlessHeap();
+	u32 iStressBufferIndex = bindlessHeap.AddStorageBuffer(stressBuffer.GetVkNative());
+
+	// Create the renderer
+	Ref<Renderer> pRenderer = make_shared<Renderer>(*pDevice, *pSwapChain, iFramesInFlight, pCommandRecorder->GetThreadCount());
+	pRenderer->Create();
+
+	// Everything the frames could sample has to be on the GPU before the first one
+	Vec<Ref<Texture>> textures;
+	if (!textureFutures.empty())
+	{
+		pDevice->GetUploadQueue().Wait(textureLoader.WaitIdle());
+		u64 iMipValue = 0;
+		for (auto &future : textureFutures)
+		{
+			try
+			{
+				textures.push_back(future.get());
+				iMipValue = max(iMipValue, textures.back()->mipValue);
+			}
+			catch (const exception &e)
+			{
+				cout << "WARNING: " << e.what() << endl;
+			}
+		}
+		pDevice->GetGraphicsTimeline().Wait(iMipValue);
+
+		f64 fTextureMs = chrono::duration<f64, milli>(chrono::steady_clock::now() - tTextureStart).count();
+		cout << "Loaded " << textureLoader.GetLoadedCount() << " textures, " << textureLoader.GetLoadedBytes() / 1024 << "KB in " << fTextureMs << "ms ("
+			<< textureLoader.GetFailedCount() << " failed, peak " << textureLoader.GetPeakInFlightBytes() / 1024 << "KB of "
+			<< textureLoader.GetBudget() / 1024 << "KB budget in flight), mips of " << pDevice->GetMipGenerator().GetImageCount() << " in "
+			<< pDevice->GetMipGenerator().GetSubmissionCount() << " submissions" << endl;
+	}
+
+	// Per draw constants come out of the renderer's ring, bound with a dynamic offset
+	UniformRing &uniformRing = pRenderer->GetUniformRing();
+
+	// Only the swap chain and the graph's transients depend on the window size, the graph picks the
+	// new extent up on its own next frame
+	u32 iSwapChainRecreations = 0;
+	pRenderer->SetSwapChainCallback([&](SwapChain &swapChain)
+	{
+		iSwapChainRecreations++;
+		cout << "Swap chain recreated at " << swapChain.GetExtent().width << "x" << swapChain.GetExtent().height << endl;
+	});
+
+	// Rebuilt every frame, the transient images stay as long as the passes don't change
+	RenderGraph renderGraph(*pDevice);
+	renderGraph.Create();
+
+	pRenderer->SetRecordCallback([&](VkCommandBuffer commandBuffer, u32 imageIndex)
+	{
+		u64 iFrame = pRenderer->GetFrameCount();
+		f32 t = static_cast<f32>(iFrame % 256) / 255.0f;
+		VkClearColorValue clearColor = { { t, 0.0f, 1.0f - t, 1.0f } };
+		VkClearColorValue overlayColor = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+		VkImageSubresourceRange colorRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		VkExtent2D extent = pSwapChain->GetExtent();
+		RenderGraphImageDesc colorDesc;
+		colorDesc.extent = extent;
+		colorDesc.format = pSwapChain->GetFormat();
+
+		renderGraph.Reset();
+
+		// The acquire semaphore is waited on at these stages, so that's all the first barrier has to wait for
+		RenderGraphResource backBuffer = renderGraph.ImportImage("BackBuffer", pSwapChain->GetImages()[imageIndex], pSwapChain->GetImageViews()[imageIndex],
+			colorDesc.format, extent, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+
+		// Cleared on load, plus the test triangle once its pipeline is compiled
+		RenderGraphResource scene;
+		renderGraph.AddPass("Scene", [&](RenderGraphBuilder &builder)
+		{
+			scene = builder.Write(builder.CreateImage("Scene", colorDesc), RenderGraphUsage::ColorAttachment);
+		}, [=, &pDevice, &pScenePipeline, &bindlessHeap, &uniformRing](VkCommandBuffer cmd, const RenderGraph &graph)
+		{
+			RenderingDesc renderingDesc;
+			renderingDesc.extent = extent;
+			renderingDesc.AddColorAttachment(graph.GetImageView(scene), colorDesc.format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, clearColor);
+
+			pDevice->CmdBeginRendering(cmd, renderingDesc);
+			if (pScenePipeline)
+			{
+				VkViewport viewport = { 0.0f, 0.0f, static_cast<f32>(extent.width), static_cast<f32>(extent.height), 0.0f, 1.0f };
+				VkRect2D scissor = { { 0, 0 }, extent };
+				vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pScenePipeline->GetVkNative());
+				bindlessHeap.Bind(cmd);
+
+				struct SceneConstants
+				{
+					f32 extent[2];
+					f32 time;
+					u32 frame;
+				};
+				SceneConstants constants = { { static_cast<f32>(extent.width), static_cast<f32>(extent.height) }, t, static_cast<u32>(iFrame) };
+				UniformAllocation sceneConstants = uniformRing.Push(constants);
+				if (sceneConstants.IsValid())
+				{
+					uniformRing.Bind(cmd, sceneConstants);
+				}
+
+				vkCmdPushConstants(cmd, pScenePipeline->GetLayout(), VK_SHADER_STAGE_ALL, 0, sizeof(u32), &iStressBufferIndex);
+				vkCmdSetViewport(cmd, 0, 1, &viewport);
+				vkCmdSetScissor(cmd, 0, 1, &scissor);
+				vkCmdDraw(cmd, 3, 1, 0, 0);
+			}
+			pDevice->CmdEndRendering(cmd);
+		});
+
+		// Nothing reads the overlay, so the graph culls the pass
+		RenderGraphResource overlay;
+		renderGraph.AddPass("DebugOverlay", [&](RenderGraphBuilder &builder)
+		{
+			overlay = builder.Write(builder.CreateImage("Overlay", colorDesc), RenderGraphUsage::TransferDst);
+		}, [=](VkCommandBuffer cmd, const RenderGraph &graph)
+		{
+			vkCmdClearColorImage(cmd, graph.GetImage(overlay), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &overlayColor, 1, &colorRange);
+		});
+
+		RenderGraphResource tonemapped;
+		renderGraph.AddPass("Tonemap", [&](RenderGraphBuilder &builder)
+		{
+			builder.Read(scene, RenderGraphUsage::TransferSrc);
+			tonemapped = builder.Write(builder.CreateImage("Tonemapped", colorDesc), RenderGraphUsage::TransferDst);
+		}, [=](VkCommandBuffer cmd, const RenderGraph &graph)
+		{
+			RecordCopy(cmd, graph.GetImage(scene), graph.GetImage(tonemapped), extent);
+		});
+
+		// Scene is dead by now, so this lands in the same memory
+		RenderGraphResource post;
+		renderGraph.AddPass("Post", [&](RenderGraphBuilder &builder)
+		{
+			builder.Read(tonemapped, RenderGraphUsage::TransferSrc);
+			post = builder.Write(builder.CreateImage("Post", colorDesc), RenderGraphUsage::TransferDst);
+		}, [=](VkCommandBuffer cmd, const RenderGraph &graph)
+		{
+			RecordCopy(cmd, graph.GetImage(tonemapped), graph.GetImage(post), extent);
+		});
+
+		renderGraph.AddPass("Composite", [&](RenderGraphBuilder &builder)
+		{
+			builder.Read(post, RenderGraphUsage::TransferSrc);
+			builder.Write(backBuffer, RenderGraphUsage::TransferDst);
+		}, [=](VkCommandBuffer cmd, const RenderGraph &graph)
+		{
+			RecordCopy(cmd, graph.GetImage(post), graph.GetImage(backBuffer), extent);
+		});
+
+		// Only touches a buffer the graph doesn't know about
+		renderGraph.AddPass("RecordStress", [&](RenderGraphBuilder &builder)
+		{
+			builder.SetSideEffect();
+		}, [&](VkCommandBuffer cmd, const RenderGraph &graph)
+		{
+			pCommandRecorder->Record(cmd, pRenderer->GetCurrentFrame(), iRecordStress, [&](VkCommandBuffer secondary, u32 begin, u32 end)
+			{
+				for (u32 i = begin; i < end; i++)
+				{
+					vkCmdFillBuffer(secondary, stressBuffer.GetVkNative(), (i % iStressWords) * 4, 4, i);
+				}
+			});
+		});
+
+		renderGraph.Compile();
+		renderGraph.Execute(commandBuffer);
+	});
+
+	auto tStart = chrono::steady_clock::now();
+	auto tLastReport = tStart;
+	u64 iLastReportFrame = 0;
+	bool bPipelineReported = false;
+
+	while (!instance.ShouldClose())
+	{
+		if (!instance.IsHeadless())
+		{
+			instance.PollEvents();
+
+			if (instance.ConsumeResize())
+			{
+				pRenderer->InvalidateSwapChain();
+			}
+
+			// Nothing to present to, sleep until the window comes back
+			if (instance.IsMinimized())
+			{
+				instance.WaitEvents();
+				continue;
+			}
+		}
+
+		// Jobs that have to run on this thread, e.g. anything touching GLFW
+		jobSystem.PumpMainThread();
+
+		pRenderer->DrawFrame();
+
+		if (!bPipelineReported && pipelineFuture.valid() && PipelineCompiler::IsReady(pipelineFuture))
+		{
+			pScenePipeline = pipelineFuture.get();
+			f64 fPipelineMs = chrono::duration<f64, milli>(chrono::steady_clock::now() - tStart).count();
+			cout << "Pipeline ready after " << fPipelineMs << "ms ("
+				<< (pDevice->GetPipelineCache().WasLoadedFromDisk() ? "warm" : "cold") << " cache, "
+				<< pPipelineCompiler->GetWorkerCount() << " threads)" << endl;
+			bPipelineReported = true;
+		}
+
+		auto tNow = chrono::steady_clock::now();
+		f64 fElapsed = chrono::duration<f64>(tNow - tLastReport).count();
+		if (fElapsed >= 1.0)
+		{
+			u64 iFrames = pRenderer->GetFrameCount() - iLastReportFrame;
+			cout << "Frames/sec: " << fixed << setprecision(1) << (iFrames / fElapsed) << endl;
+			tLastReport = tNow;
+			iLastReportFrame = pRenderer->GetFrameCount();
+		}
+
+		if (iMaxFrames != 0 && pRenderer->GetFrameCount() >= iMaxFrames)
+		{
+			break;
+		}
+	}
+
+	FramePacer &framePacer = pRenderer->GetFramePacer();
+	cout << "Present mode " << pSwapChain->GetPresentMode() << ", " << pSwapChain->GetImages().size() << " images, "
+		<< (framePacer.UsesPresentWait() ? "present wait" : "timeline") << " throttle blocked " << framePacer.GetThrottledFrameCount()
+		<< " frames for " << framePacer.GetAverageThrottleMs() << "ms on average" << endl;
+
+	cout << "Uniform ring: " << uniformRing.GetFrameSize() / 1024 << "KB per frame, " << uniformRing.GetAlignment() << "B alignment, peak "
+		<< uniformRing.GetPeakFrameBytes() << "B, " << uniformRing.GetOverflowCount() << " overflows" << endl;
+
+	pRenderer->Destroy();
+
+	f64 fTotal = chrono::duration<f64>(chrono::steady_clock::now() - tStart).count();
+	cout << "Rendered " << pRenderer->GetFrameCount() << " frames in " << fTotal << "s ("
+		<< (pRenderer->GetFrameCount() / fTotal) << " frames/sec, " << pRenderer->GetFramesInFlight() << " in flight, "
+		<< jobSystem.GetThreadCount() << " job threads, " << iSwapChainRecreations << " swap chain recreations)" << endl;
+
+	cout << "Render graph: " << renderGraph.GetPassCount() << " passes, " << renderGraph.GetCulledPassCount() << " culled, "
+		<< renderGraph.GetBarrierCount() << " barriers, transients " << renderGraph.GetTransientBytes() / 1024 << "KB aliased from "
+		<< renderGraph.GetUnaliasedBytes() / 1024 << "KB (" << (pDevice->HasSynchronization2() ? "synchronization2" : "legacy barriers") << ")" << endl;
+	if (pDevice->HasDynamicRendering())
+	{
+		cout << "Rendering through VK_KHR_dynamic_rendering" << endl;
+	}
+	else
+	{
+		cout << "Rendering through cached render passes: " << pDevice->GetRenderPassCache().GetRenderPassCount() << " render passes, "
+			<< pDevice->GetRenderPassCache().GetFramebufferCount() << " framebuffers" << endl;
+	}
+
+	renderGraph.Destroy();
+	pCommandRecorder->Destroy();
+	bindlessHeap.FreeStorageBuffer(iStressBufferIndex);
+	stressBuffer.Destroy();
+	textures.clear();
+	textureLoader.Destroy();
+
+	pDevice->GetAllocator().PrintStats();
+
+	// Destroy the pipelines, the compiler finishes whatever is left and merges its caches first
+	pPipelineCompiler->Destroy();
+	pScenePipeline.reset();
+	cout << "Pipeline registry held " << pDevice->GetPipelineRegistry().GetCount() << " pipelines" << endl;
+	cout << "Pipeline layout cache: " << pDevice->GetPipelineLayoutCache().GetPipelineLayoutCount() << " pipeline layouts, "
+		<< pDevice->GetPipelineLayoutCache().GetSetLayoutCount() << " set layouts beside the bindless one" << endl;
+	pDevice->GetPipelineRegistry().Clear();
+	cout << "Shader library: " << shaderLibrary.GetShaderCount() << " modules, " << shaderLibrary.GetDuplicateCount() << " duplicates, "
+		<< shaderLibrary.GetMappedBytes() / 1024 << "KB mapped" << endl;
+	pVertShader.reset();
+	pFragShader.reset();
+	shaderLibrary.Destroy();
+
+	jobSystem.Destroy();
 
 	std::cout << "Physical Device: " << pPhysicalDevice->GetVkNative() << std::endl;
 
     return 0;
-}
+}
\ No newline at end of file